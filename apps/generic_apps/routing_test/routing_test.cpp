@@ -282,7 +282,7 @@ class FloodingApplication
 
          debug_->debug( "Init flooding application at %u\n", radio_->id() );
 
-         flooding_.init( *radio_, *debug_ );
+         flooding_.init( *radio_, *timer_, *debug_ );
          flooding_.enable_radio();
          flooding_.reg_recv_callback<FloodingApplication, &FloodingApplication::receive_flooding_message>( this );
          //radio_->reg_recv_callback<FloodingApplication, &FloodingApplication::receive_radio_message>( this );
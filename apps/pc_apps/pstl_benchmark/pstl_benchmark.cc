@@ -0,0 +1,328 @@
+
+/*
+ * Throughput and memory footprint of the pSTL containers compared to their
+ * std:: counterparts.
+ *
+ * For every capacity N, each container is filled with N distinct keys
+ * (insert), every key is looked up once (find), the container is walked
+ * (iterate) and finally emptied again in a different order (erase). Every
+ * phase is repeated until about `ops` operations have been performed;
+ * results are given in million operations per second.
+ *
+ * The footprint is sizeof() of the container plus the heap memory it holds
+ * when filled with N elements (counted by CountingAllocator below), so the
+ * fixed-size pSTL containers can be compared to the node/heap based std::
+ * ones.
+ *
+ * Usage: pstl_benchmark [ops]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <memory>
+
+#include <algorithm>
+#include <vector>
+#include <list>
+#include <set>
+#include <map>
+#include <deque>
+#include <queue>
+
+#include "external_interface/pc/pc_os_model.h"
+#include "util/pstl/algorithm.h"
+#include "util/pstl/vector_static.h"
+#include "util/pstl/list_static.h"
+#include "util/pstl/set_static.h"
+#include "util/pstl/map_static_vector.h"
+#include "util/pstl/map_static_hash.h"
+#include "util/pstl/priority_queue.h"
+#include "util/pstl/queue_static.h"
+
+using namespace wiselib;
+
+typedef PCOsModel Os;
+typedef uint32_t elem_t;
+
+// --------------------------------------------------------------------------
+// Heap accounting
+
+static size_t heap_in_use = 0;
+
+/// std::allocator that keeps track of the bytes held by std:: containers.
+template<typename T>
+class CountingAllocator : public std::allocator<T> {
+	public:
+		typedef typename std::allocator<T>::pointer pointer;
+		typedef typename std::allocator<T>::size_type size_type;
+
+		template<typename U>
+		struct rebind { typedef CountingAllocator<U> other; };
+
+		CountingAllocator() {}
+		CountingAllocator(const CountingAllocator&) : std::allocator<T>() {}
+		template<typename U>
+		CountingAllocator(const CountingAllocator<U>&) {}
+
+		pointer allocate(size_type n, const void* = 0) {
+			heap_in_use += n * sizeof(T);
+			return std::allocator<T>::allocate(n);
+		}
+
+		void deallocate(pointer p, size_type n) {
+			heap_in_use -= n * sizeof(T);
+			std::allocator<T>::deallocate(p, n);
+		}
+};
+
+typedef CountingAllocator<elem_t> alloc_t;
+typedef std::vector<elem_t, alloc_t> std_vector_t;
+typedef std::list<elem_t, alloc_t> std_list_t;
+typedef std::set<elem_t, std::less<elem_t>, alloc_t> std_set_t;
+typedef std::map<elem_t, elem_t, std::less<elem_t>,
+		CountingAllocator<std::pair<const elem_t, elem_t> > > std_map_t;
+typedef std::priority_queue<elem_t, std_vector_t> std_priority_queue_t;
+typedef std::queue<elem_t, std::deque<elem_t, alloc_t> > std_queue_t;
+
+// --------------------------------------------------------------------------
+// Helpers
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// Keeps the compiler from optimizing benchmark loops away.
+static volatile elem_t sink;
+
+static uint32_t xorshift_state = 2463534242U;
+static uint32_t xorshift() {
+	xorshift_state ^= xorshift_state << 13;
+	xorshift_state ^= xorshift_state >> 17;
+	xorshift_state ^= xorshift_state << 5;
+	return xorshift_state;
+}
+
+static void shuffle(elem_t *keys, size_t n) {
+	for(size_t i = n - 1; i > 0; i--) {
+		std::swap(keys[i], keys[xorshift() % (i + 1)]);
+	}
+}
+
+// --------------------------------------------------------------------------
+// Adapters
+//
+// Every adapter maps the four benchmark operations onto the interface of a
+// container family, so the same adapter serves both the pSTL and the std::
+// variant. Operations a container does not offer are flagged and skipped.
+
+template<typename Container_P>
+struct SequenceOps {
+	enum { HAS_FIND = true, HAS_ITERATE = true };
+	static void insert(Container_P& c, elem_t k) { c.push_back(k); }
+	static bool find(Container_P& c, elem_t k) {
+		return wiselib::find(c.begin(), c.end(), k) != c.end();
+	}
+	static void erase(Container_P& c, elem_t k) {
+		typename Container_P::iterator it = wiselib::find(c.begin(), c.end(), k);
+		if(it != c.end()) {
+			c.erase(it);
+		}
+	}
+	static elem_t iterate(Container_P& c) {
+		elem_t sum = 0;
+		for(typename Container_P::iterator it = c.begin(); it != c.end(); ++it) {
+			sum += *it;
+		}
+		return sum;
+	}
+};
+
+template<typename Container_P>
+struct SetOps {
+	enum { HAS_FIND = true, HAS_ITERATE = true };
+	static void insert(Container_P& c, elem_t k) { c.insert(k); }
+	static bool find(Container_P& c, elem_t k) { return c.find(k) != c.end(); }
+	static void erase(Container_P& c, elem_t k) { c.erase(k); }
+	static elem_t iterate(Container_P& c) {
+		elem_t sum = 0;
+		for(typename Container_P::iterator it = c.begin(); it != c.end(); ++it) {
+			sum += *it;
+		}
+		return sum;
+	}
+};
+
+template<typename Container_P>
+struct MapOps {
+	enum { HAS_FIND = true, HAS_ITERATE = true };
+	static void insert(Container_P& c, elem_t k) { c[k] = k; }
+	static bool find(Container_P& c, elem_t k) { return c.find(k) != c.end(); }
+	static void erase(Container_P& c, elem_t k) { c.erase(k); }
+	static elem_t iterate(Container_P& c) {
+		elem_t sum = 0;
+		for(typename Container_P::iterator it = c.begin(); it != c.end(); ++it) {
+			sum += it->second;
+		}
+		return sum;
+	}
+};
+
+/// Priority queues and FIFOs: insert is push(), erase is pop().
+template<typename Container_P>
+struct HeapOps {
+	enum { HAS_FIND = false, HAS_ITERATE = false };
+	static void insert(Container_P& c, elem_t k) { c.push(k); }
+	static bool find(Container_P&, elem_t) { return false; }
+	static void erase(Container_P& c, elem_t) { sink = c.top(); c.pop(); }
+	static elem_t iterate(Container_P&) { return 0; }
+};
+
+template<typename Container_P>
+struct QueueOps {
+	enum { HAS_FIND = false, HAS_ITERATE = false };
+	static void insert(Container_P& c, elem_t k) { c.push(k); }
+	static bool find(Container_P&, elem_t) { return false; }
+	static void erase(Container_P& c, elem_t) { sink = c.front(); c.pop(); }
+	static elem_t iterate(Container_P&) { return 0; }
+};
+
+// --------------------------------------------------------------------------
+// Benchmark driver
+
+static size_t total_ops = 1 << 18;
+
+static void print_rate(bool supported, size_t ops, double t) {
+	if(!supported) {
+		printf(" %10s", "-");
+	}
+	else {
+		printf(" %10.2f", t > 0.0 ? ops / t / 1e6 : 0.0);
+	}
+}
+
+template<typename Container_P, typename Ops_P>
+void bench(const char *name, size_t n) {
+	elem_t *keys = new elem_t[n];
+	elem_t *erase_order = new elem_t[n];
+	for(size_t i = 0; i < n; i++) {
+		keys[i] = (elem_t)(i * 2654435761U);
+		erase_order[i] = keys[i];
+	}
+	shuffle(keys, n);
+	shuffle(erase_order, n);
+
+	size_t reps = total_ops / n;
+	if(reps < 1) {
+		reps = 1;
+	}
+
+	double t_insert = 0.0, t_find = 0.0, t_iterate = 0.0, t_erase = 0.0;
+	size_t footprint = 0;
+	elem_t acc = 0;
+
+	// Static containers can be large, keep them off the stack. The erase
+	// phase empties the container, so one instance serves all repetitions.
+	// Allocating one per repetition is also miscompiled by GCC 12.2: with
+	// -fstrict-aliasing (-O2, -Os), loop invariant motion hoists the load
+	// of list_static's empty_nodes_.next_ out of the insert loop, although
+	// unhook() stores to it, and every push_back() then reuses the same
+	// node. The code has no type punning; -fno-strict-aliasing,
+	// -fno-tree-loop-im, -O3 and UBSan builds all keep the whole list.
+	size_t heap_before = heap_in_use;
+	Container_P *c = new Container_P();
+
+	for(size_t r = 0; r < reps; r++) {
+		double t0 = now();
+		for(size_t i = 0; i < n; i++) {
+			Ops_P::insert(*c, keys[i]);
+		}
+		double t1 = now();
+		t_insert += t1 - t0;
+
+		if(r == 0) {
+			footprint = sizeof(Container_P) + (heap_in_use - heap_before);
+		}
+
+		if(Ops_P::HAS_FIND) {
+			t0 = now();
+			for(size_t i = 0; i < n; i++) {
+				acc += Ops_P::find(*c, erase_order[i]);
+			}
+			t1 = now();
+			t_find += t1 - t0;
+		}
+
+		if(Ops_P::HAS_ITERATE) {
+			t0 = now();
+			acc += Ops_P::iterate(*c);
+			t1 = now();
+			t_iterate += t1 - t0;
+		}
+
+		t0 = now();
+		for(size_t i = 0; i < n; i++) {
+			Ops_P::erase(*c, erase_order[i]);
+		}
+		t1 = now();
+		t_erase += t1 - t0;
+	}
+	delete c;
+	sink = acc;
+
+	printf("%-22s %6lu", name, (unsigned long)n);
+	print_rate(true, reps * n, t_insert);
+	print_rate(Ops_P::HAS_FIND, reps * n, t_find);
+	print_rate(true, reps * n, t_erase);
+	print_rate(Ops_P::HAS_ITERATE, reps * n, t_iterate);
+	printf(" %10lu\n", (unsigned long)footprint);
+
+	delete[] keys;
+	delete[] erase_order;
+}
+
+template<int N>
+void bench_capacity() {
+	bench<vector_static<Os, elem_t, N>, SequenceOps<vector_static<Os, elem_t, N> > >("vector_static", N);
+	bench<std_vector_t, SequenceOps<std_vector_t> >("std::vector", N);
+
+	bench<list_static<Os, elem_t, N>, SequenceOps<list_static<Os, elem_t, N> > >("list_static", N);
+	bench<std_list_t, SequenceOps<std_list_t> >("std::list", N);
+
+	bench<set_static<Os, elem_t, N>, SetOps<set_static<Os, elem_t, N> > >("set_static", N);
+	bench<std_set_t, SetOps<std_set_t> >("std::set", N);
+
+	bench<MapStaticVector<Os, elem_t, elem_t, N>, MapOps<MapStaticVector<Os, elem_t, elem_t, N> > >("MapStaticVector", N);
+	// Table twice the capacity keeps the load factor at 50%
+	bench<map_static_hash<Os, elem_t, elem_t, 2 * N>, MapOps<map_static_hash<Os, elem_t, elem_t, 2 * N> > >("map_static_hash", N);
+	bench<std_map_t, MapOps<std_map_t> >("std::map", N);
+
+	bench<priority_queue<Os, elem_t, N>, HeapOps<priority_queue<Os, elem_t, N> > >("priority_queue", N);
+	bench<std_priority_queue_t, HeapOps<std_priority_queue_t> >("std::priority_queue", N);
+
+	bench<queue_static<Os, elem_t, N>, QueueOps<queue_static<Os, elem_t, N> > >("queue_static", N);
+	bench<std_queue_t, QueueOps<std_queue_t> >("std::queue", N);
+
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+	if(argc > 1) {
+		total_ops = strtoul(argv[1], 0, 0);
+	}
+
+	printf("%-22s %6s %10s %10s %10s %10s %10s\n",
+			"container", "N", "insert", "find", "erase", "iterate", "bytes");
+	printf("%-22s %6s %10s %10s %10s %10s %10s\n",
+			"", "", "[Mop/s]", "[Mop/s]", "[Mop/s]", "[Mel/s]", "");
+
+	bench_capacity<16>();
+	bench_capacity<64>();
+	bench_capacity<256>();
+	bench_capacity<1024>();
+
+	return 0;
+}
+
@@ -66,9 +66,7 @@ namespace wiselib
             return;
 
          int offset = DATA_POS + (idx * ENTRY_SIZE);
-         write<OsModel, block_data_t, node_id_t>( buffer + offset, node );
-         write<OsModel, block_data_t, node_id_t>( buffer + offset + sizeof(node_id_t), entry.next_hop );
-         write<OsModel, block_data_t, uint8_t>( buffer + offset + sizeof(node_id_t) + sizeof(node_id_t), entry.hops );
+         write_fields<OsModel>( buffer + offset, node, entry.next_hop, entry.hops );
       };
       // --------------------------------------------------------------------
       inline bool entry( int idx, node_id_t& node, DsdvRtValue& entry )
@@ -77,9 +75,7 @@ namespace wiselib
             return false;
 
          int offset = DATA_POS + (idx * ENTRY_SIZE);
-         read<OsModel, block_data_t, node_id_t>( buffer + offset, node );
-         read<OsModel, block_data_t, node_id_t>( buffer + offset + sizeof(node_id_t), entry.next_hop );
-         read<OsModel, block_data_t, uint8_t>( buffer + offset + sizeof(node_id_t) + sizeof(node_id_t), entry.hops );
+         read_fields<OsModel>( buffer + offset, node, entry.next_hop, entry.hops );
          return true;
       };
       // --------------------------------------------------------------------
@@ -39,6 +39,13 @@ namespace wiselib
     *  \ingroup routing_algorithm
     *
     * DSDV routing implementation of \ref routing_concept "Routing Concept" ...
+    *
+    * The whole routing table is only broadcast every full_dump_interval
+    * work periods. In between, a period sends only the entries that changed
+    * since they were last advertised (nothing, if none did). Changes also
+    * trigger an update of the changed entries after the settling time; all
+    * changes within that time, e.g. a route improving several times while
+    * the network converges, go out in one update with their final values.
     */
    template<typename OsModel_P,
             typename RoutingTable_P,
@@ -132,6 +139,17 @@ namespace wiselib
       inline void set_work_period( millis_t t )
       { work_period_ = t; };
 
+      /** Every periods-th work period, the full routing table is sent; 1
+       *  sends it every period.
+       */
+      inline void set_full_dump_interval( uint8_t periods )
+      { full_dump_interval_ = periods ? periods : 1; };
+
+      /** Delay between a route change and its triggered update.
+       */
+      inline void set_settling_time( millis_t t )
+      { settling_time_ = t; };
+
    private:
 
       Radio& radio()
@@ -150,16 +168,24 @@ namespace wiselib
       ///@name Methods called by Timer
       ///@{
       void timer_elapsed( void *userdata );
+      void timer_triggered_update( void *userdata );
       ///@}
 
       ///@name Work on routing table
       ///@{
       void update_routing_table( node_id_t from, BroadcastMessage& message );
+      void set_route( node_id_t destination, node_id_t next_hop, uint8_t hops );
+      void advertise( bool changed_only );
       void print_routing_table( RoutingTable& rt );
       ///@}
 
       millis_t startup_time_;
       millis_t work_period_;
+      millis_t settling_time_;
+      uint8_t full_dump_interval_;
+      uint8_t period_cnt_;
+      bool update_pending_;
+      int changes_;
 
       RoutingTable routing_table_;
    };
@@ -177,7 +203,12 @@ namespace wiselib
          timer_ ( 0 ),
          debug_ ( 0 ),
          startup_time_ ( 2000 ),
-         work_period_ ( 5000 )
+         work_period_ ( 5000 ),
+         settling_time_ ( 500 ),
+         full_dump_interval_ ( 4 ),
+         period_cnt_ ( 0 ),
+         update_pending_ ( false ),
+         changes_ ( 0 )
    {}
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
@@ -203,6 +234,9 @@ namespace wiselib
    init( void )
    {
       routing_table_.clear();
+      period_cnt_ = 0;
+      changes_ = 0;
+      update_pending_ = false;
       enable_radio();
 
       return SUCCESS;
@@ -300,43 +334,98 @@ namespace wiselib
    {
 #ifdef ROUTING_DSDV_DEBUG
       debug().debug( "DsdvRouting: Execute TimerElapsed at %i\n", radio().id() );
+#endif
+      bool full_dump = ( period_cnt_ == 0 );
+      if ( ++period_cnt_ >= full_dump_interval_ )
+         period_cnt_ = 0;
+
+      if ( full_dump )
+         advertise( false );
+      else if ( changes_ )
+         advertise( true );
+
+#ifdef ROUTING_DSDV_DEBUG
+      print_routing_table( routing_table_ );
+#endif
+
+      timer().template set_timer<self_type, &self_type::timer_elapsed>(
+                                 work_period_, this, 0 );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Timer_P,
+            typename Debug_P>
+   void
+   DsdvRouting<OsModel_P, RoutingTable_P, Radio_P, Timer_P, Debug_P>::
+   timer_triggered_update( void* userdata )
+   {
+      update_pending_ = false;
+      // Periodic update may have sent the changes meanwhile
+      if ( changes_ )
+         advertise( true );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Timer_P,
+            typename Debug_P>
+   void
+   DsdvRouting<OsModel_P, RoutingTable_P, Radio_P, Timer_P, Debug_P>::
+   advertise( bool changed_only )
+   {
+#ifdef ROUTING_DSDV_DEBUG
       int messages = 0;
 #endif
+      BroadcastMessage message;
+      message.set_msg_id( DsdvBroadcastMsgId );
+      message.set_entry_cnt( 0 );
+
+      // Empty table: the (empty) full dump still announces this node
       if ( routing_table_.empty() )
       {
-         BroadcastMessage message;
-         message.set_msg_id( DsdvBroadcastMsgId );
-         message.set_entry_cnt( 0 );
-         radio().send( Radio::BROADCAST_ADDRESS, message.buffer_size(), (uint8_t*)&message );
+         if ( !changed_only )
+            radio().send( Radio::BROADCAST_ADDRESS, message.buffer_size(), (uint8_t*)&message );
+         return;
       }
-      else
+
+      int idx = 0;
+      for ( RoutingTableIterator it = routing_table_.begin(); it != routing_table_.end(); ++it )
       {
-         RoutingTableIterator it = routing_table_.begin();
-         while ( it != routing_table_.end() )
+         if ( changed_only && !it->second.changed )
+            continue;
+
+         it->second.changed = false;
+         message.set_entry( idx, it->first, it->second );
+         idx++;
+
+         if ( idx == BroadcastMessage::MAX_ENTRIES )
          {
-            BroadcastMessage message;
-            message.set_msg_id( DsdvBroadcastMsgId );
-            int idx = 0;
-            for ( ; it != routing_table_.end() && idx < BroadcastMessage::MAX_ENTRIES; ++it )
-            {
-               message.set_entry( idx, it->first, it->second );
-               idx++;
-            }
             message.set_entry_cnt( idx );
             radio().send( Radio::BROADCAST_ADDRESS, message.buffer_size(), (uint8_t*)&message );
+            idx = 0;
 #ifdef ROUTING_DSDV_DEBUG
             messages++;
-            debug().debug( "DsdvRouting: BC-Message %d with %i entries (%d max)\n", messages, idx, BroadcastMessage::MAX_ENTRIES );
 #endif
          }
       }
 
+      if ( idx > 0 )
+      {
+         message.set_entry_cnt( idx );
+         radio().send( Radio::BROADCAST_ADDRESS, message.buffer_size(), (uint8_t*)&message );
 #ifdef ROUTING_DSDV_DEBUG
-      print_routing_table( routing_table_ );
+         messages++;
 #endif
+      }
+      changes_ = 0;
 
-      timer().template set_timer<self_type, &self_type::timer_elapsed>(
-                                 work_period_, this, 0 );
+#ifdef ROUTING_DSDV_DEBUG
+      debug().debug( "DsdvRouting: %s dump in %d BC-Messages (%d entries max)\n",
+                     changed_only ? "Incremental" : "Full", messages, BroadcastMessage::MAX_ENTRIES );
+#endif
    }
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
@@ -355,7 +444,7 @@ namespace wiselib
       if ( msg_id == DsdvBroadcastMsgId )
       {
          BroadcastMessage *message = (BroadcastMessage *)data;
-         routing_table_[from] = RoutingTableEntry( from, 1 );
+         set_route( from, from, 1 );
          update_routing_table( from, *message );
       }
       else if ( msg_id == DsdvRoutingMsgId )
@@ -424,8 +513,7 @@ namespace wiselib
 #ifdef ROUTING_DSDV_DEBUG
 //                debug().debug( "DsdvRouting: Add %i because not known\n", value.first );
 #endif
-               routing_table_[value.first] = RoutingTableEntry(
-                  from, value.second.hops + 1 );
+               set_route( value.first, from, value.second.hops + 1 );
             }
             else if ( cur->second.hops > value.second.hops + 1 )
             {
@@ -433,8 +521,7 @@ namespace wiselib
 //                debug().debug( "DsdvRouting: Update %i because smaller hopcount (new %i < old %i)\n",
 //                      value.first, value.second.hops, cur->second.hops );
 #endif
-               routing_table_[value.first] = RoutingTableEntry(
-                  from, value.second.hops + 1 );
+               set_route( value.first, from, value.second.hops + 1 );
             }
          }
       }
@@ -447,6 +534,35 @@ namespace wiselib
             typename Debug_P>
    void
    DsdvRouting<OsModel_P, RoutingTable_P, Radio_P, Timer_P, Debug_P>::
+   set_route( node_id_t destination, node_id_t next_hop, uint8_t hops )
+   {
+      RoutingTableEntry& entry = routing_table_[destination];
+      if ( entry.next_hop == next_hop && entry.hops == hops )
+         return;
+
+      entry.next_hop = next_hop;
+      entry.hops = hops;
+      if ( !entry.changed )
+      {
+         entry.changed = true;
+         changes_++;
+      }
+
+      if ( !update_pending_ )
+      {
+         update_pending_ = true;
+         timer().template set_timer<self_type, &self_type::timer_triggered_update>(
+                                    settling_time_, this, 0 );
+      }
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Timer_P,
+            typename Debug_P>
+   void
+   DsdvRouting<OsModel_P, RoutingTable_P, Radio_P, Timer_P, Debug_P>::
    print_routing_table( RoutingTable& rt )
    {
 #ifdef ROUTING_DSDV_DEBUG
@@ -40,16 +40,20 @@ namespace wiselib
       // --------------------------------------------------------------------
       DsdvRoutingTableValue()
          : next_hop( Radio::NULL_NODE_ID ),
-            hops   ( 0 )
+            hops   ( 0 ),
+            changed( false )
       {}
       // --------------------------------------------------------------------
       DsdvRoutingTableValue( node_id_t next, uint8_t h )
          : next_hop    ( next ),
-            hops       ( h )
+            hops       ( h ),
+            changed    ( false )
       {}
       // --------------------------------------------------------------------
       node_id_t next_hop;
       uint8_t hops;
+      /// Changed since the last advertisement (not sent over the air)
+      bool changed;
    };
 
 }
@@ -0,0 +1,241 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef __ALGORITHMS_ROUTING_DSR_LINK_CACHE_H__
+#define __ALGORITHMS_ROUTING_DSR_LINK_CACHE_H__
+
+namespace wiselib
+{
+
+   /** \brief Link cache for DSR.
+    *
+    *  Stores the links of all learned paths as an undirected graph (DSR
+    *  in this implementation already relies on symmetric links when sending
+    *  replies back along the request path). A path to any node reachable
+    *  over cached links is found by breadth first search, so every prefix
+    *  and suffix of a learned path, as well as combinations of different
+    *  paths, can be used; the search always yields the shortest one.
+    *
+    *  Links age: every call to tick() makes them one tick older. Links that
+    *  reach LIFETIME ticks are handed out by expire(), so the owner can
+    *  drop routes using them. Only neighbor links, i.e., links of the
+    *  owning node to a node it has just heard, are renewed when added
+    *  again; links learned from paths in messages may come from stale
+    *  caches elsewhere and would otherwise never expire.
+    *
+    *  When full, the oldest cached link is replaced. Neighbor links are
+    *  only replaced when there is nothing else, since the routing relies
+    *  on them to tell whether a neighbor is still there.
+    */
+   template<typename OsModel_P,
+            typename Radio_P,
+            typename Path_P,
+            int MAX_LINKS,
+            int LIFETIME = 4>
+   class DsrLinkCache
+   {
+   public:
+      typedef OsModel_P OsModel;
+      typedef Radio_P Radio;
+      typedef Path_P Path;
+
+      typedef typename Radio::node_id_t node_id_t;
+
+      enum { LIFETIME_TICKS = LIFETIME };
+      // --------------------------------------------------------------------
+      DsrLinkCache()
+      { clear(); }
+      // --------------------------------------------------------------------
+      void clear()
+      {
+         cnt_ = 0;
+      }
+      // --------------------------------------------------------------------
+      void add_link( node_id_t a, node_id_t b, bool neighbor = false )
+      {
+         if ( a == b )
+            return;
+
+         int idx = find_link( a, b );
+         if ( idx >= 0 )
+         {
+            if ( neighbor )
+            {
+               links_[idx].age = 0;
+               links_[idx].neighbor = true;
+            }
+            return;
+         }
+
+         idx = cnt_;
+         if ( cnt_ < MAX_LINKS )
+            cnt_++;
+         else
+         {
+            idx = 0;
+            for ( int i = 1; i < cnt_; i++ )
+               if ( links_[i].neighbor < links_[idx].neighbor ||
+                     ( links_[i].neighbor == links_[idx].neighbor &&
+                       links_[i].age > links_[idx].age ) )
+                  idx = i;
+         }
+         links_[idx].a = a;
+         links_[idx].b = b;
+         links_[idx].age = 0;
+         links_[idx].neighbor = neighbor;
+      }
+      // --------------------------------------------------------------------
+      void add_path( Path& path )
+      {
+         for ( int i = 1; i < (int)path.size(); i++ )
+            add_link( path[i - 1], path[i] );
+      }
+      // --------------------------------------------------------------------
+      /** \return true if the link was cached
+       */
+      bool remove_link( node_id_t a, node_id_t b )
+      {
+         int idx = find_link( a, b );
+         if ( idx < 0 )
+            return false;
+
+         links_[idx] = links_[--cnt_];
+         return true;
+      }
+      // --------------------------------------------------------------------
+      /** \return true if the link was added as neighbor link and has not
+       *  expired since
+       */
+      bool neighbor_link( node_id_t a, node_id_t b )
+      {
+         int idx = find_link( a, b );
+         return idx >= 0 && links_[idx].neighbor;
+      }
+      // --------------------------------------------------------------------
+      void tick()
+      {
+         for ( int i = 0; i < cnt_; i++ )
+            if ( links_[i].age < LIFETIME )
+               links_[i].age++;
+      }
+      // --------------------------------------------------------------------
+      /** Removes one link that has not been learned again for LIFETIME
+       *  ticks.
+       *
+       *  \return false if there is none
+       */
+      bool expire( node_id_t& a, node_id_t& b )
+      {
+         for ( int i = 0; i < cnt_; i++ )
+            if ( links_[i].age >= LIFETIME )
+            {
+               a = links_[i].a;
+               b = links_[i].b;
+               links_[i] = links_[--cnt_];
+               return true;
+            }
+         return false;
+      }
+      // --------------------------------------------------------------------
+      /** Shortest path over cached links, including from and to.
+       *
+       *  \return false if there is none or it does not fit into path
+       */
+      bool find_path( node_id_t from, node_id_t to, Path& path )
+      {
+         // A connected graph with n links has at most n + 1 nodes
+         node_id_t nodes[MAX_LINKS + 1];
+         int parent[MAX_LINKS + 1];
+         int head = 0, tail = 1;
+         nodes[0] = from;
+         parent[0] = -1;
+
+         while ( head < tail && nodes[head] != to )
+         {
+            node_id_t u = nodes[head];
+            for ( int i = 0; i < cnt_; i++ )
+            {
+               node_id_t v;
+               if ( links_[i].a == u )
+                  v = links_[i].b;
+               else if ( links_[i].b == u )
+                  v = links_[i].a;
+               else
+                  continue;
+
+               if ( !visited( nodes, tail, v ) )
+               {
+                  nodes[tail] = v;
+                  parent[tail] = head;
+                  tail++;
+               }
+            }
+            head++;
+         }
+         if ( head == tail )
+            return false;
+
+         int len = 0;
+         for ( int n = head; n >= 0; n = parent[n] )
+            len++;
+         if ( len > (int)path.max_size() )
+            return false;
+
+         path.clear();
+         for ( int i = 0; i < len; i++ )
+            path.push_back( from );
+         for ( int n = head, i = len - 1; n >= 0; n = parent[n], i-- )
+            path[i] = nodes[n];
+         return true;
+      }
+      // --------------------------------------------------------------------
+      int size()
+      { return cnt_; }
+
+   private:
+      struct Link
+      {
+         node_id_t a;
+         node_id_t b;
+         uint8_t age;
+         bool neighbor;
+      };
+      // --------------------------------------------------------------------
+      int find_link( node_id_t a, node_id_t b )
+      {
+         for ( int i = 0; i < cnt_; i++ )
+            if ( ( links_[i].a == a && links_[i].b == b ) ||
+                  ( links_[i].a == b && links_[i].b == a ) )
+               return i;
+         return -1;
+      }
+      // --------------------------------------------------------------------
+      static bool visited( node_id_t *nodes, int cnt, node_id_t node )
+      {
+         for ( int i = 0; i < cnt; i++ )
+            if ( nodes[i] == node )
+               return true;
+         return false;
+      }
+      // --------------------------------------------------------------------
+      Link links_[MAX_LINKS];
+      int cnt_;
+   };
+
+}
+#endif
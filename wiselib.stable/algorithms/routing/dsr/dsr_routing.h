@@ -22,10 +22,20 @@
 #include "algorithms/routing/dsr/dsr_routing_types.h"
 #include "algorithms/routing/dsr/dsr_route_discovery_msg.h"
 #include "algorithms/routing/dsr/dsr_routing_msg.h"
+#include "algorithms/routing/dsr/dsr_link_cache.h"
 #include "util/base_classes/routing_base.h"
 #include "config.h"
 #include <string.h>
 
+#ifndef DSR_LINK_CACHE_SIZE
+#define DSR_LINK_CACHE_SIZE 32
+#endif
+
+#ifndef DSR_LINK_TIMEOUT
+/// Time (ms) after which a cached link that was not heard of again is dropped
+#define DSR_LINK_TIMEOUT 60000
+#endif
+
 
 namespace wiselib
 {
@@ -39,6 +49,19 @@ namespace wiselib
     *  \ingroup routing_algorithm
     *
     * DSR routing implementation of \ref routing_concept "Routing Concept" ...
+    *
+    * Every path seen in a route request, route reply or routing message is
+    * added to a link cache (see DsrLinkCache), so routes to all nodes on
+    * learned paths are known without a new route discovery, and
+    * intermediate nodes answer route requests from their cache.
+    *
+    * Cached links expire after DSR_LINK_TIMEOUT; only hearing a neighbor
+    * renews the link to it. A node forwarding a routing message takes the
+    * link to the next hop as broken if the radio fails to send over it or
+    * if that neighbor has not been heard of within the timeout. A broken link is removed from the
+    * cache, as are all routes using it, and a route error travels back to
+    * the source of the message. A route discovery that gets no reply within
+    * one to two timer intervals is given up, so send() does not stay busy.
     */
    template<typename OsModel_P,
             typename RoutingTable_P,
@@ -74,6 +97,9 @@ namespace wiselib
 
       typedef DsrRouteDiscoveryMessage<OsModel, Radio, Path> RouteDiscoveryMessage;
       typedef DsrRoutingMessage<OsModel, Radio, Path> RoutingMessage;
+      typedef DsrLinkCache<OsModel, Radio, Path, DSR_LINK_CACHE_SIZE> LinkCache;
+
+      enum { TIMER_INTERVAL = DSR_LINK_TIMEOUT / LinkCache::LIFETIME_TICKS };
       // --------------------------------------------------------------------
       enum ErrorCodes
       {
@@ -134,6 +160,12 @@ namespace wiselib
       { return radio_->id(); }
       ///@}
 
+      /** Removes the link between a and b from the cache, as well as all
+       *  routes using it. To be called when a broken link is detected
+       *  outside of the routing, e.g., by a neighborhood discovery.
+       */
+      void link_broken( node_id_t a, node_id_t b );
+
    private:
 
       Radio& radio()
@@ -152,14 +184,21 @@ namespace wiselib
       uint16_t seq_nr_;
 
       bool send_in_progress_;
+      uint8_t discovery_ticks_;
 
       RoutingTable routing_table_;
       RoutingMessage routing_message_;
+      LinkCache link_cache_;
 
       void handle_route_request( node_id_t from, RouteDiscoveryMessage& message );
       void handle_route_reply( node_id_t from, RouteDiscoveryMessage& message );
+      void handle_route_error( node_id_t from, RouteDiscoveryMessage& message );
       void handle_routing_message( node_id_t from, size_t len, RoutingMessage& message );
 
+      bool find_route( node_id_t destination, Path& path );
+      void set_route( node_id_t destination, Path& path );
+      void send_route_error( Path& path, uint8_t idx, node_id_t unreachable );
+
       void update_seq_nr( node_id_t node, uint16_t seq_nr );
       uint16_t get_seq_nr( node_id_t node );
 
@@ -174,7 +213,8 @@ namespace wiselib
    DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
    DsrRouting()
       : seq_nr_            ( 1 ),
-         send_in_progress_ ( false )
+         send_in_progress_ ( false ),
+         discovery_ticks_  ( 0 )
    {}
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
@@ -196,9 +236,11 @@ namespace wiselib
    init( void )
    {
       routing_table_.clear();
+      link_cache_.clear();
       routing_message_ = RoutingMessage();
       seq_nr_ = 1;
       send_in_progress_ = false;
+      discovery_ticks_ = 0;
 
       enable_radio();
 
@@ -230,7 +272,7 @@ namespace wiselib
       radio().template reg_recv_callback<self_type, &self_type::receive>( this );
 
       timer().template set_timer<self_type, &self_type::timer_elapsed>(
-                                 15000, this, 0 );
+                                 TIMER_INTERVAL, this, 0 );
 
       return SUCCESS;
    }
@@ -255,8 +297,17 @@ namespace wiselib
    DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
    timer_elapsed( void *userdata )
    {
+      link_cache_.tick();
+      node_id_t a, b;
+      while ( link_cache_.expire( a, b ) )
+         link_broken( a, b );
+
+      // No reply (request or reply lost): give up the pending message
+      if ( send_in_progress_ && ++discovery_ticks_ >= 2 )
+         send_in_progress_ = false;
+
       timer().template set_timer<self_type, &self_type::timer_elapsed>(
-                                 15000, this, 0 );
+                                 TIMER_INTERVAL, this, 0 );
    }
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
@@ -272,35 +323,38 @@ namespace wiselib
 
       routing_message_ = RoutingMessage( DsrRoutingMsgId, radio().id(), destination, 1, len, data );
 
-      RoutingTableIterator it = routing_table_.find( destination );
-      if ( it != routing_table_.end() )
+      Path path;
+      if ( find_route( destination, path ) )
       {
-         routing_message_.set_path( it->second.path );
-         radio().send( it->second.path[1], routing_message_.buffer_size(), (uint8_t*)&routing_message_ );
+         routing_message_.set_path( path );
 #ifdef ROUTING_DSR_DEBUG
-         debug().debug( "DsrRouting: Existing path in Cache with size %d hops %d idx %d\n",
-            it->second.path.size(), it->second.hops, routing_message_.path_idx() );
-         print_path( it->second.path );
+         debug().debug( "DsrRouting: Existing path in Cache with size %d idx %d\n",
+            path.size(), routing_message_.path_idx() );
+         print_path( path );
 #endif
+         if ( radio().send( path[1], routing_message_.buffer_size(), (uint8_t*)&routing_message_ ) == SUCCESS )
+            return SUCCESS;
+
+         // Broken first hop: forget it and discover a new route instead
+         link_broken( radio().id(), path[1] );
       }
-      else
-      {
-         send_in_progress_ = true;
-         RouteDiscoveryMessage message( DsrRouteRequestMsgId,
-                                        0, // hops
-                                        seq_nr_++,
-                                        radio().id(),
-                                        destination,
-                                        0 ); // path idx - not needed when sending request
-         Path path;
-         path.push_back( radio().id() );
-         message.set_path( path );
 
-         radio().send( Radio::BROADCAST_ADDRESS, message.buffer_size(), (uint8_t*)&message );
+      send_in_progress_ = true;
+      discovery_ticks_ = 0;
+      RouteDiscoveryMessage message( DsrRouteRequestMsgId,
+                                     0, // hops
+                                     seq_nr_++,
+                                     radio().id(),
+                                     destination,
+                                     0 ); // path idx - not needed when sending request
+      path.clear();
+      path.push_back( radio().id() );
+      message.set_path( path );
+
+      radio().send( Radio::BROADCAST_ADDRESS, message.buffer_size(), (uint8_t*)&message );
 #ifdef ROUTING_DSR_DEBUG
-         debug().debug( "DsrRouting: Start Route Request from %d to %d.\n", message.source(), message.destination() );
+      debug().debug( "DsrRouting: Start Route Request from %d to %d.\n", message.source(), message.destination() );
 #endif
-      }
 
       return SUCCESS;
    }
@@ -312,6 +366,9 @@ namespace wiselib
    DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
    receive( node_id_t from, size_t len, block_data_t *data )
    {
+      // Hearing a neighbor proves the link to it
+      link_cache_.add_link( from, radio().id(), true );
+
       message_id_t msg_id = read<OsModel, block_data_t, message_id_t>( data );
       if ( msg_id == DsrRouteRequestMsgId )
       {
@@ -323,6 +380,11 @@ namespace wiselib
          RouteDiscoveryMessage *message = reinterpret_cast<RouteDiscoveryMessage*>(data);
          handle_route_reply( from, *message );
       }
+      else if ( msg_id == DsrRouteErrorMsgId )
+      {
+         RouteDiscoveryMessage *message = reinterpret_cast<RouteDiscoveryMessage*>(data);
+         handle_route_error( from, *message );
+      }
       else if ( msg_id == DsrRoutingMsgId )
       {
          RoutingMessage *message = reinterpret_cast<RoutingMessage*>(data);
@@ -337,6 +399,11 @@ namespace wiselib
    DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
    handle_route_request( node_id_t from, RouteDiscoveryMessage& message )
    {
+      // Learn the reverse path, also from duplicates over other paths
+      Path request_path;
+      message.path( request_path );
+      link_cache_.add_path( request_path );
+
       if ( get_seq_nr(message.source()) >= message.sequence_nr() )
       {
 #ifdef ROUTING_DSR_DEBUG
@@ -348,6 +415,10 @@ namespace wiselib
       }
       update_seq_nr( message.source(), message.sequence_nr() );
 
+      // No room left to append this node: the path could not lead back
+      if ( request_path.size() >= request_path.max_size() )
+         return;
+
       if ( message.destination() == radio().id() )
       {
          RouteDiscoveryMessage msg(message);
@@ -371,6 +442,37 @@ namespace wiselib
       }
       else
       {
+         // Answer from the cache if the cached route does not loop back
+         // into the request path
+         Path cached;
+         if ( find_route( message.destination(), cached ) &&
+               request_path.size() + cached.size() <= request_path.max_size() )
+         {
+            bool loop = false;
+            for ( PathIterator it = request_path.begin(); it != request_path.end(); ++it )
+               for ( PathIterator cit = cached.begin(); cit != cached.end(); ++cit )
+                  if ( *it == *cit )
+                     loop = true;
+
+            if ( !loop )
+            {
+               for ( PathIterator cit = cached.begin(); cit != cached.end(); ++cit )
+                  request_path.push_back( *cit );
+
+               RouteDiscoveryMessage msg(message);
+               msg.set_msg_id( DsrRouteReplyMsgId );
+               msg.set_hops( request_path.size() - 1 );
+               msg.set_path( request_path );
+               radio().send( request_path[msg.path_idx()], msg.buffer_size(), (uint8_t*)&msg );
+#ifdef ROUTING_DSR_DEBUG
+               debug().debug( "DsrRouting: Reply to RREQ from %d for %d from cache at %d\n",
+                              msg.source(), msg.destination(), radio().id() );
+               print_path( request_path );
+#endif
+               return;
+            }
+         }
+
          RouteDiscoveryMessage msg(message);
          Path path;
          msg.path( path );
@@ -394,23 +496,25 @@ namespace wiselib
    DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
    handle_route_reply( node_id_t from, RouteDiscoveryMessage& message )
    {
+      Path path;
+      message.path( path );
+      link_cache_.add_path( path );
+
       if ( message.source() == radio().id() )
       {
 #ifdef ROUTING_DSR_DEBUG
          debug().debug( "DsrRouting: RREP -> HOME at %d from %d\n",
                         message.source(), message.destination() );
 #endif
-         routing_message_.set_path_idx( 1 );
-         Path path;
-         message.path( path );
-         routing_message_.set_path( path );
+         set_route( message.destination(), path );
 
-         RoutingTableValue value;
-         value.path = path;
-         value.hops = message.hops();
-         value.seq_nr = message.sequence_nr();
-         routing_table_[message.destination()] = value;
+         // Several nodes may reply from their caches; send only once
+         if ( !send_in_progress_ || routing_message_.destination() != message.destination() )
+            return;
 
+         find_route( message.destination(), path );
+         routing_message_.set_path_idx( 1 );
+         routing_message_.set_path( path );
          radio().send( path[routing_message_.path_idx()],
                       routing_message_.buffer_size(),
                       (uint8_t*)&routing_message_ );
@@ -424,8 +528,6 @@ namespace wiselib
       else
       {
          message.dec_path_idx();
-         Path path;
-         message.path( path );
          radio().send( path[message.path_idx()], message.buffer_size(), (uint8_t*)(&message) );
 #ifdef ROUTING_DSR_DEBUG
          debug().debug( "DsrRouting: Forward RREP at %d to %d (from %d to %d).\n",
@@ -445,6 +547,10 @@ namespace wiselib
    DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
    handle_routing_message( node_id_t from, size_t len, RoutingMessage& message )
    {
+      Path path;
+      message.path( path );
+      link_cache_.add_path( path );
+
       if ( message.destination() == radio().id() )
       {
 #ifdef ROUTING_DSR_DEBUG
@@ -456,11 +562,18 @@ namespace wiselib
       else
       {
          RoutingMessage msg( message );
-         Path path;
-         message.path( path );
          msg.inc_path_idx();
 
-         radio().send( path[msg.path_idx()], len, (uint8_t*)&msg );
+         // Radios without link layer acks always report success, so a
+         // neighbor not heard of within the link timeout counts as gone
+         node_id_t next = path[msg.path_idx()];
+         if ( !link_cache_.neighbor_link( radio().id(), next ) ||
+               radio().send( next, len, (uint8_t*)&msg ) != SUCCESS )
+         {
+            link_broken( radio().id(), next );
+            send_route_error( path, message.path_idx(), next );
+            return;
+         }
 #ifdef ROUTING_DSR_DEBUG
          debug().debug( "DsrRouting: Forward RoutingMsg at %d to %d with path idx %d (from %d to %d).\n",
                        radio().id(),
@@ -475,6 +588,125 @@ namespace wiselib
             typename Radio_P>
    void
    DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
+   handle_route_error( node_id_t from, RouteDiscoveryMessage& message )
+   {
+      // Broken link is source -> destination of the error message
+      link_broken( message.source(), message.destination() );
+
+      if ( message.path_idx() == 0 )
+         return;
+
+      Path path;
+      message.path( path );
+      message.dec_path_idx();
+      radio().send( path[message.path_idx()], message.buffer_size(), (uint8_t*)&message );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P>
+   void
+   DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
+   send_route_error( Path& path, uint8_t idx, node_id_t unreachable )
+   {
+      // This node is the source of the routing message
+      if ( idx == 0 )
+         return;
+
+      RouteDiscoveryMessage msg( DsrRouteErrorMsgId,
+                                 0, // hops
+                                 0, // seq nr - not needed for errors
+                                 radio().id(),
+                                 unreachable,
+                                 idx - 1 );
+      msg.set_path( path );
+      radio().send( path[msg.path_idx()], msg.buffer_size(), (uint8_t*)&msg );
+#ifdef ROUTING_DSR_DEBUG
+      debug().debug( "DsrRouting: Link %d -> %d broken, send RERR to %d\n",
+                     radio().id(), unreachable, path[0] );
+#endif
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P>
+   void
+   DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
+   link_broken( node_id_t a, node_id_t b )
+   {
+      link_cache_.remove_link( a, b );
+
+      // Only routes over exactly this link become invalid
+      for ( RoutingTableIterator it = routing_table_.begin(); it != routing_table_.end(); ++it )
+      {
+         Path& path = it->second.path;
+         for ( int i = 1; i < it->second.hops + 1 && i < (int)path.size(); i++ )
+            if ( ( path[i - 1] == a && path[i] == b ) ||
+                  ( path[i - 1] == b && path[i] == a ) )
+            {
+               path.clear();
+               it->second.hops = 0;
+               break;
+            }
+      }
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P>
+   bool
+   DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
+   find_route( node_id_t destination, Path& path )
+   {
+      // Entries with hops == 0 only hold sequence numbers of route requests
+      RoutingTableIterator it = routing_table_.find( destination );
+      if ( it != routing_table_.end() && it->second.hops > 0 )
+      {
+         path = it->second.path;
+         return true;
+      }
+
+      // A path to this node itself has no next hop
+      if ( !link_cache_.find_path( radio().id(), destination, path ) || path.size() < 2 )
+         return false;
+
+      set_route( destination, path );
+      return true;
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P>
+   void
+   DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
+   set_route( node_id_t destination, Path& path )
+   {
+      if ( path.size() < 2 || path[0] != radio().id() )
+         return;
+
+      RoutingTableIterator it = routing_table_.find( destination );
+      if ( it != routing_table_.end() )
+      {
+         if ( it->second.hops > 0 && it->second.hops <= path.size() - 1 )
+            return;
+
+         it->second.path = path;
+         it->second.hops = path.size() - 1;
+      }
+      else
+      {
+         RoutingTableValue value;
+         value.path = path;
+         value.hops = path.size() - 1;
+         routing_table_[destination] = value;
+      }
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P>
+   void
+   DsrRouting<OsModel_P, RoutingTable_P, Radio_P>::
    update_seq_nr( node_id_t node, uint16_t seq_nr )
    {
       RoutingTableIterator it = routing_table_.find( node );
@@ -146,7 +146,7 @@ namespace wiselib
       size_t buffer_size()
       {
          // overall size = PATH_POS + path entries + sizeof payload size + payload size
-         return PATH_POS + (entry_cnt() * sizeof(node_id_t)) + payload_size();
+         return PATH_POS + (entry_cnt() * sizeof(node_id_t)) + 1 + payload_size();
       }
 
    private:
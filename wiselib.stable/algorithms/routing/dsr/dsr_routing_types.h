@@ -26,7 +26,8 @@ namespace wiselib
    {
       DsrRouteRequestMsgId = 120, ///< Msg type for flooding network
       DsrRouteReplyMsgId   = 121, ///< Msg type for returning found path
-      DsrRoutingMsgId      = 122  ///< Msg type for routing messages
+      DsrRoutingMsgId      = 122, ///< Msg type for routing messages
+      DsrRouteErrorMsgId   = 123  ///< Msg type for reporting broken links
    };
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
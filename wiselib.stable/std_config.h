@@ -37,7 +37,14 @@
 #define UART_BASE_MAX_RECEIVERS 10
 #define STATE_CALLBACK_BASE_MAX_RECEIVERS 10
 #define SENSOR_CALLBACK_BASE_MAX_RECEIVERS 10
+#define RADIO_BASE_MAX_BUFFER_RECEIVERS 4
+// Receivers registered for a single message id; 0 saves the 256 byte
+// dispatch table in every radio layer
+#define RADIO_BASE_MAX_TYPED_RECEIVERS 0
 
 // ---------------- pSTL ----------------------------------------------------
+// Space reserved in front of a packet by layers that allocate packet
+// buffers, for the headers of all layers below
+#define PACKET_BUFFER_HEADROOM 32
 
 #endif
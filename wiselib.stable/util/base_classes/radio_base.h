@@ -21,17 +21,184 @@
 
 #include "util/delegates/delegate.hpp"
 #include "util/pstl/vector_static.h"
+#include "util/pstl/packet_buffer.h"
 #include "config.h"
 
+#ifndef RADIO_BASE_MAX_BUFFER_RECEIVERS
+#define RADIO_BASE_MAX_BUFFER_RECEIVERS 4
+#endif
+
+/// Receivers registered for a single message id (at most 254); 0 turns
+/// the per message id dispatch off
+#ifndef RADIO_BASE_MAX_TYPED_RECEIVERS
+#define RADIO_BASE_MAX_TYPED_RECEIVERS 0
+#endif
+
 namespace wiselib
 {
 
+   /** \brief One piece of a message given to sendv().
+    */
+   template<typename Size_P,
+            typename BlockData_P>
+   struct RadioIoVec
+   {
+      BlockData_P *data;
+      Size_P len;
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** \brief Receivers registered for a single message id, see RadioBase.
+    *
+    *  A 256 entry table maps each message id to the first of its
+    *  receivers, the receivers of one id are linked by index.
+    */
+   template<typename NodeId_P,
+            typename Size_P,
+            typename BlockData_P,
+            int MAX_TYPED>
+   class RadioTypedReceivers
+   {
+   public:
+      typedef NodeId_P node_id_t;
+      typedef Size_P size_t;
+      typedef BlockData_P block_data_t;
+      typedef uint8_t message_id_t;
+
+      typedef delegate3<void, node_id_t, size_t, block_data_t*> radio_delegate_t;
+      // --------------------------------------------------------------------
+      RadioTypedReceivers()
+      {
+         for ( unsigned int i = 0; i < 256; ++i )
+            first_[i] = NONE;
+         for ( int i = 0; i < MAX_TYPED; ++i )
+         {
+            next_[i] = NONE;
+            generations_[i] = 0;
+         }
+      }
+      // --------------------------------------------------------------------
+      /** \return index of the receiver, -1 if there is no room
+       */
+      int add( radio_delegate_t callback, message_id_t msg_id )
+      {
+         for ( int i = 0; i < MAX_TYPED; ++i )
+         {
+            if ( callbacks_[i] == radio_delegate_t() )
+            {
+               callbacks_[i] = callback;
+               ids_[i] = msg_id;
+               generations_[i]++;
+               next_[i] = first_[msg_id];
+               first_[msg_id] = i;
+               return i;
+            }
+         }
+
+         return -1;
+      }
+      // --------------------------------------------------------------------
+      void remove( int i )
+      {
+         if ( i < 0 || i >= MAX_TYPED || callbacks_[i] == radio_delegate_t() )
+            return;
+
+         uint8_t *link = &first_[ids_[i]];
+         while ( *link != i )
+            link = &next_[*link];
+         *link = next_[i];
+
+         callbacks_[i] = radio_delegate_t();
+         next_[i] = NONE;
+      }
+      // --------------------------------------------------------------------
+      void notify( node_id_t from, size_t len, block_data_t *data )
+      {
+         message_id_t id = data[0];
+
+         // Receivers may (un)register others, so take a snapshot of the
+         // list and skip those that are gone (or were replaced) by the time
+         // it is their turn
+         uint8_t receivers[MAX_TYPED];
+         uint8_t generations[MAX_TYPED];
+         int count = 0;
+         for ( uint8_t i = first_[id]; i != NONE; i = next_[i] )
+         {
+            receivers[count] = i;
+            generations[count++] = generations_[i];
+         }
+
+         for ( int k = 0; k < count; ++k )
+         {
+            uint8_t i = receivers[k];
+            if ( callbacks_[i] != radio_delegate_t() && generations_[i] == generations[k] )
+               callbacks_[i]( from, len, data );
+         }
+      }
+
+   private:
+      /// Marks the end of a receiver list
+      enum { NONE = 0xff };
+      // --------------------------------------------------------------------
+      /// First receiver for each message id, NONE if none
+      uint8_t first_[256];
+      /// Next receiver for the same message id
+      uint8_t next_[MAX_TYPED];
+      message_id_t ids_[MAX_TYPED];
+      /// Counts the registrations per slot, tells a reused slot apart
+      uint8_t generations_[MAX_TYPED];
+      radio_delegate_t callbacks_[MAX_TYPED];
+   };
+   // -----------------------------------------------------------------------
+   /** Per message id dispatch turned off: costs no RAM, registration
+    *  always fails.
+    */
+   template<typename NodeId_P,
+            typename Size_P,
+            typename BlockData_P>
+   class RadioTypedReceivers<NodeId_P, Size_P, BlockData_P, 0>
+   {
+   public:
+      typedef delegate3<void, NodeId_P, Size_P, BlockData_P*> radio_delegate_t;
+      // --------------------------------------------------------------------
+      int add( radio_delegate_t, uint8_t )
+      { return -1; }
+      // --------------------------------------------------------------------
+      void remove( int )
+      {}
+      // --------------------------------------------------------------------
+      void notify( NodeId_P, Size_P, BlockData_P* )
+      {}
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+
    /** \brief Base radio class
     * 
     *  \ingroup radio_concept
     *
     *  Basic radio class that provides helpful methods like registration of
     *  callbacks.
+    *
+    *  Besides the plain (node_id_t, size_t, block_data_t*) callbacks,
+    *  receivers can register for a packet_buffer_t&, which lets stacked
+    *  layers strip and add headers in place (see PacketBuffer). A layer
+    *  supporting this implements send_buffer( node_id_t, packet_buffer_t& )
+    *  and passes buffers down with send_packet_buffer().
+    *
+    *  Receivers only interested in one kind of message register with
+    *  reg_recv_callback<T, M>( obj, msg_id ) and are only called for
+    *  messages whose first byte is msg_id. A 256 entry table maps each
+    *  message id to the list of its receivers, so a message costs one
+    *  lookup plus the calls to exactly the interested receivers. Since
+    *  every radio layer would carry that table, this is only compiled in
+    *  if RADIO_BASE_MAX_TYPED_RECEIVERS is set in config.h.
+    *
+    *  Sending the same payload to several receivers, or a payload made of
+    *  several pieces, goes through send_multi() and sendv() below, which
+    *  use the radio's own implementation if it has one.
     */
    template<typename OsModel_P,
             typename NodeId_P,
@@ -51,12 +218,27 @@ namespace wiselib
 
       typedef vector_static<OsModel, radio_delegate_t, MAX_RECEIVERS> CallbackVector;
       typedef typename CallbackVector::iterator CallbackVectorIterator;
+
+      typedef PacketBuffer<OsModel, size_t, block_data_t> packet_buffer_t;
+      typedef delegate2<void, node_id_t, packet_buffer_t&> buffer_delegate_t;
+
+      typedef vector_static<OsModel, buffer_delegate_t, RADIO_BASE_MAX_BUFFER_RECEIVERS> BufferCallbackVector;
+
+      typedef uint8_t message_id_t;
+
+      typedef RadioIoVec<size_t, block_data_t> iovec_t;
       // --------------------------------------------------------------------
       enum ReturnValues
       {
          SUCCESS = OsModel::SUCCESS
       };
       // --------------------------------------------------------------------
+      /// Indices of buffer callbacks start here (after those of
+      /// ExtendedRadioBase)
+      enum { BUFFER_CALLBACK_OFFSET = 2 * MAX_RECEIVERS };
+      /// Indices of callbacks registered for a message id start here
+      enum { TYPED_CALLBACK_OFFSET = BUFFER_CALLBACK_OFFSET + RADIO_BASE_MAX_BUFFER_RECEIVERS };
+      // --------------------------------------------------------------------
       template<class T, void (T::*TMethod)(node_id_t, size_t, block_data_t*)>
       int reg_recv_callback( T *obj_pnt )
       {
@@ -75,9 +257,42 @@ namespace wiselib
          return -1;
       }
       // --------------------------------------------------------------------
+      template<class T, void (T::*TMethod)(node_id_t, packet_buffer_t&)>
+      int reg_recv_callback( T *obj_pnt )
+      {
+         if ( buffer_callbacks_.empty() )
+            buffer_callbacks_.assign( RADIO_BASE_MAX_BUFFER_RECEIVERS, buffer_delegate_t() );
+
+         for ( unsigned int i = 0; i < buffer_callbacks_.size(); ++i )
+         {
+            if ( buffer_callbacks_.at(i) == buffer_delegate_t() )
+            {
+               buffer_callbacks_.at(i) = buffer_delegate_t::template from_method<T, TMethod>( obj_pnt );
+               return BUFFER_CALLBACK_OFFSET + i;
+            }
+         }
+
+         return -1;
+      }
+      // --------------------------------------------------------------------
+      /** Registers a receiver for messages whose first byte is msg_id.
+       *  Fails (returns -1) unless RADIO_BASE_MAX_TYPED_RECEIVERS is set.
+       */
+      template<class T, void (T::*TMethod)(node_id_t, size_t, block_data_t*)>
+      int reg_recv_callback( T *obj_pnt, message_id_t msg_id )
+      {
+         int i = typed_.add( radio_delegate_t::template from_method<T, TMethod>( obj_pnt ), msg_id );
+         return i < 0 ? -1 : TYPED_CALLBACK_OFFSET + i;
+      }
+      // --------------------------------------------------------------------
       int unreg_recv_callback( int idx )
       {
-         callbacks_.at(idx) = radio_delegate_t();
+         if ( idx >= TYPED_CALLBACK_OFFSET )
+            typed_.remove( idx - TYPED_CALLBACK_OFFSET );
+         else if ( idx >= BUFFER_CALLBACK_OFFSET )
+            buffer_callbacks_.at( idx - BUFFER_CALLBACK_OFFSET ) = buffer_delegate_t();
+         else
+            callbacks_.at(idx) = radio_delegate_t();
          return SUCCESS;
       }
       // --------------------------------------------------------------------
@@ -91,12 +306,162 @@ namespace wiselib
             if ( *it != radio_delegate_t() )
                (*it)( from, len, data );
          }
+
+         if ( len > 0 )
+            typed_.notify( from, len, data );
+      }
+      // --------------------------------------------------------------------
+      /** Passes the buffer to all buffer callbacks (each one sees it as
+       *  given here, even if a previous one pulled headers), then its data
+       *  to the plain callbacks.
+       */
+      void notify_receivers( node_id_t from, packet_buffer_t& buffer )
+      {
+         typename packet_buffer_t::State state = buffer.state();
+         for ( unsigned int i = 0; i < buffer_callbacks_.size(); ++i )
+         {
+            if ( buffer_callbacks_.at(i) != buffer_delegate_t() )
+            {
+               buffer_callbacks_.at(i)( from, buffer );
+               buffer.restore( state );
+            }
+         }
+
+         notify_receivers( from, buffer.size(), buffer.data() );
       }
 
    private:
       CallbackVector callbacks_;
+      BufferCallbackVector buffer_callbacks_;
+      RadioTypedReceivers<node_id_t, size_t, block_data_t, RADIO_BASE_MAX_TYPED_RECEIVERS> typed_;
 
    };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** True if Radio_P implements
+    *  send_multi( node_id_t*, size_t, size_t, block_data_t* ) itself.
+    */
+   template<typename Radio_P>
+   struct HasSendMulti
+   {
+      typedef char yes[1];
+      typedef char no[2];
+
+      template<typename U, int (U::*)( typename U::node_id_t*, typename U::size_t,
+                                       typename U::size_t, typename U::block_data_t* )>
+      struct Check;
+
+      template<typename U> static yes& test( Check<U, &U::send_multi>* );
+      template<typename U> static no& test( ... );
+
+      enum { value = sizeof( test<Radio_P>( 0 ) ) == sizeof( yes ) };
+   };
+   // -----------------------------------------------------------------------
+   /** True if Radio_P implements
+    *  sendv( node_id_t, const iovec_t*, size_t ) itself.
+    */
+   template<typename Radio_P>
+   struct HasSendv
+   {
+      typedef char yes[1];
+      typedef char no[2];
+
+      template<typename U, int (U::*)( typename U::node_id_t,
+                                       const RadioIoVec<typename U::size_t, typename U::block_data_t>*,
+                                       typename U::size_t )>
+      struct Check;
+
+      template<typename U> static yes& test( Check<U, &U::sendv>* );
+      template<typename U> static no& test( ... );
+
+      enum { value = sizeof( test<Radio_P>( 0 ) ) == sizeof( yes ) };
+   };
+   // -----------------------------------------------------------------------
+   template<typename Radio_P,
+            bool SEND_MULTI = HasSendMulti<Radio_P>::value>
+   struct MultiSender
+   {
+      static int send( Radio_P& radio, typename Radio_P::node_id_t *ids,
+                       typename Radio_P::size_t n, typename Radio_P::size_t len,
+                       typename Radio_P::block_data_t *data )
+      {
+         int result = Radio_P::SUCCESS;
+         for ( typename Radio_P::size_t i = 0; i < n; ++i )
+         {
+            int r = radio.send( ids[i], len, data );
+            if ( r != Radio_P::SUCCESS )
+               result = r;
+         }
+         return result;
+      }
+   };
+   // -----------------------------------------------------------------------
+   template<typename Radio_P>
+   struct MultiSender<Radio_P, true>
+   {
+      static int send( Radio_P& radio, typename Radio_P::node_id_t *ids,
+                       typename Radio_P::size_t n, typename Radio_P::size_t len,
+                       typename Radio_P::block_data_t *data )
+      { return radio.send_multi( ids, n, len, data ); }
+   };
+   // -----------------------------------------------------------------------
+   template<typename Radio_P,
+            bool SENDV = HasSendv<Radio_P>::value>
+   struct VectorSender
+   {
+      typedef RadioIoVec<typename Radio_P::size_t, typename Radio_P::block_data_t> iovec_t;
+
+      static int send( Radio_P& radio, typename Radio_P::node_id_t to,
+                       const iovec_t *iov, typename Radio_P::size_t iovcnt )
+      {
+         typename Radio_P::block_data_t buffer[Radio_P::MAX_MESSAGE_LENGTH];
+         typename Radio_P::size_t len = 0;
+         for ( typename Radio_P::size_t i = 0; i < iovcnt; ++i )
+         {
+            if ( iov[i].len > Radio_P::MAX_MESSAGE_LENGTH - len )
+               return Radio_P::OsModel::ERR_UNSPEC;
+            for ( typename Radio_P::size_t j = 0; j < iov[i].len; ++j )
+               buffer[len++] = iov[i].data[j];
+         }
+         return radio.send( to, len, buffer );
+      }
+   };
+   // -----------------------------------------------------------------------
+   template<typename Radio_P>
+   struct VectorSender<Radio_P, true>
+   {
+      typedef RadioIoVec<typename Radio_P::size_t, typename Radio_P::block_data_t> iovec_t;
+
+      static int send( Radio_P& radio, typename Radio_P::node_id_t to,
+                       const iovec_t *iov, typename Radio_P::size_t iovcnt )
+      { return radio.sendv( to, iov, iovcnt ); }
+   };
+   // -----------------------------------------------------------------------
+   /** Sends the same message to the n nodes in ids: with the radio's
+    *  send_multi() if it can coalesce the transmissions, otherwise by
+    *  calling send() for every node. Returns SUCCESS, or the error of the
+    *  last failed send.
+    */
+   template<typename Radio_P>
+   inline int send_multi( Radio_P& radio, typename Radio_P::node_id_t *ids,
+                          typename Radio_P::size_t n, typename Radio_P::size_t len,
+                          typename Radio_P::block_data_t *data )
+   {
+      return MultiSender<Radio_P>::send( radio, ids, n, len, data );
+   }
+   // -----------------------------------------------------------------------
+   /** Sends the concatenation of the iovcnt pieces in iov as one message:
+    *  with the radio's sendv() if it has one, otherwise by gathering them
+    *  into a buffer of MAX_MESSAGE_LENGTH and calling send().
+    */
+   template<typename Radio_P>
+   inline int sendv( Radio_P& radio, typename Radio_P::node_id_t to,
+                     const RadioIoVec<typename Radio_P::size_t, typename Radio_P::block_data_t> *iov,
+                     typename Radio_P::size_t iovcnt )
+   {
+      return VectorSender<Radio_P>::send( radio, to, iov, iovcnt );
+   }
 
 }
 #endif
@@ -0,0 +1,334 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef __WISELIB_INTERNAL_INTERFACE_STL_PACKET_BUFFER_H
+#define __WISELIB_INTERNAL_INTERFACE_STL_PACKET_BUFFER_H
+
+#include <string.h>
+#include "config.h"
+
+#ifndef PACKET_BUFFER_HEADROOM
+#define PACKET_BUFFER_HEADROOM 32
+#endif
+
+namespace wiselib
+{
+
+   /** \brief Packet buffer with head- and tailroom.
+    *
+    *  A view on a region of storage (owned by a pool, a
+    *  StaticPacketBuffer, or the caller) of which the range
+    *  [data(), data() + size()) holds the packet. Radio layers prepend
+    *  their header with push() and strip it with pull(), so a payload is
+    *  written once and then handed down (and up) a radio stack without
+    *  being copied per layer.
+    *
+    *  Convention: send_buffer() of a layer may modify the buffer, but
+    *  restores data() and size() before it returns, and has to cope with
+    *  buffers lacking headroom (e.g., received data) by copying once. A
+    *  receiver may only rely on the buffer during the callback.
+    */
+   template<typename OsModel_P,
+            typename Size_P = typename OsModel_P::size_t,
+            typename BlockData_P = typename OsModel_P::block_data_t>
+   class PacketBuffer
+   {
+   public:
+      typedef OsModel_P OsModel;
+      typedef Size_P size_t;
+      typedef BlockData_P block_data_t;
+      typedef PacketBuffer<OsModel_P, Size_P, BlockData_P> self_type;
+
+      /// Position of the packet within the storage, see state()
+      struct State
+      {
+         size_t head;
+         size_t len;
+      };
+      // --------------------------------------------------------------------
+      PacketBuffer()
+         : storage_  ( 0 ),
+            capacity_ ( 0 ),
+            head_     ( 0 ),
+            len_      ( 0 )
+      {}
+      // --------------------------------------------------------------------
+      PacketBuffer( block_data_t *storage, size_t capacity, size_t headroom = 0 )
+      { init( storage, capacity, headroom ); }
+      // --------------------------------------------------------------------
+      /** Uses the given storage; the (empty) packet starts after headroom
+       *  bytes.
+       */
+      void init( block_data_t *storage, size_t capacity, size_t headroom = 0 )
+      {
+         storage_ = storage;
+         capacity_ = capacity;
+         head_ = ( headroom > capacity ) ? capacity : headroom;
+         len_ = 0;
+      }
+      // --------------------------------------------------------------------
+      /** View on received data, without head- or tailroom.
+       */
+      void wrap( block_data_t *data, size_t len )
+      {
+         storage_ = data;
+         capacity_ = len;
+         head_ = 0;
+         len_ = len;
+      }
+      // --------------------------------------------------------------------
+      /** Empties the buffer, keeping headroom bytes in front.
+       */
+      void reset( size_t headroom )
+      { init( storage_, capacity_, headroom ); }
+      // --------------------------------------------------------------------
+      ///@name Access
+      ///@{
+      block_data_t* data()
+      { return storage_ + head_; }
+      // --------------------------------------------------------------------
+      size_t size() const
+      { return len_; }
+      // --------------------------------------------------------------------
+      bool empty() const
+      { return len_ == 0; }
+      // --------------------------------------------------------------------
+      size_t capacity() const
+      { return capacity_; }
+      // --------------------------------------------------------------------
+      size_t headroom() const
+      { return head_; }
+      // --------------------------------------------------------------------
+      size_t tailroom() const
+      { return capacity_ - head_ - len_; }
+      ///@}
+      // --------------------------------------------------------------------
+      ///@name Modification
+      ///@{
+      /** Prepends len bytes and returns a pointer to them, or 0 if there
+       *  is not enough headroom.
+       */
+      block_data_t* push( size_t len )
+      {
+         if ( len > head_ )
+            return 0;
+         head_ -= len;
+         len_ += len;
+         return data();
+      }
+      // --------------------------------------------------------------------
+      /** Strips len bytes from the front and returns a pointer to the
+       *  remaining data, or 0 if the packet is shorter.
+       */
+      block_data_t* pull( size_t len )
+      {
+         if ( len > len_ )
+            return 0;
+         head_ += len;
+         len_ -= len;
+         return data();
+      }
+      // --------------------------------------------------------------------
+      /** Appends len bytes and returns a pointer to them, or 0 if there
+       *  is not enough tailroom.
+       */
+      block_data_t* put( size_t len )
+      {
+         if ( len > tailroom() )
+            return 0;
+         block_data_t *tail = data() + len_;
+         len_ += len;
+         return tail;
+      }
+      // --------------------------------------------------------------------
+      /** Appends a copy of the given data.
+       */
+      bool append( size_t len, const block_data_t *data )
+      {
+         block_data_t *tail = put( len );
+         if ( !tail )
+            return false;
+         memcpy( tail, data, len );
+         return true;
+      }
+      // --------------------------------------------------------------------
+      /** Shortens the packet to len bytes.
+       */
+      bool trim( size_t len )
+      {
+         if ( len > len_ )
+            return false;
+         len_ = len;
+         return true;
+      }
+      ///@}
+      // --------------------------------------------------------------------
+      State state() const
+      {
+         State s;
+         s.head = head_;
+         s.len = len_;
+         return s;
+      }
+      // --------------------------------------------------------------------
+      void restore( const State& s )
+      {
+         head_ = s.head;
+         len_ = s.len;
+      }
+
+   private:
+      block_data_t *storage_;
+      size_t capacity_;
+      size_t head_;
+      size_t len_;
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** \brief Packet buffer with embedded storage (e.g., on the stack).
+    */
+   template<typename OsModel_P,
+            int BUFFER_SIZE,
+            typename Size_P = typename OsModel_P::size_t,
+            typename BlockData_P = typename OsModel_P::block_data_t>
+   class StaticPacketBuffer
+      : public PacketBuffer<OsModel_P, Size_P, BlockData_P>
+   {
+   public:
+      typedef PacketBuffer<OsModel_P, Size_P, BlockData_P> base_type;
+      typedef Size_P size_t;
+      // --------------------------------------------------------------------
+      StaticPacketBuffer( size_t headroom = PACKET_BUFFER_HEADROOM )
+         : base_type( storage_, BUFFER_SIZE, headroom )
+      {}
+
+   private:
+      StaticPacketBuffer( const StaticPacketBuffer& );
+      StaticPacketBuffer& operator=( const StaticPacketBuffer& );
+
+      BlockData_P storage_[BUFFER_SIZE];
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** \brief Fixed pool of packet buffers.
+    *
+    *  For layers that have to keep packets beyond a call (queues,
+    *  retransmissions). allocate() and free() are O(1); nothing is taken
+    *  from the heap.
+    */
+   template<typename OsModel_P,
+            int BUFFER_SIZE,
+            int POOL_SIZE,
+            typename Size_P = typename OsModel_P::size_t,
+            typename BlockData_P = typename OsModel_P::block_data_t>
+   class PacketBufferPool
+   {
+   public:
+      typedef OsModel_P OsModel;
+      typedef Size_P size_t;
+      typedef BlockData_P block_data_t;
+      typedef PacketBuffer<OsModel_P, Size_P, BlockData_P> buffer_t;
+      // --------------------------------------------------------------------
+      PacketBufferPool()
+      {
+         for ( int i = 0; i < POOL_SIZE; i++ )
+            free_[i] = POOL_SIZE - 1 - i;
+         free_count_ = POOL_SIZE;
+      }
+      // --------------------------------------------------------------------
+      /** Returns an empty buffer with the given headroom, or 0 if the pool
+       *  is exhausted.
+       */
+      buffer_t* allocate( size_t headroom = PACKET_BUFFER_HEADROOM )
+      {
+         if ( free_count_ == 0 )
+            return 0;
+
+         int idx = free_[--free_count_];
+         buffers_[idx].init( storage_[idx], BUFFER_SIZE, headroom );
+         return &buffers_[idx];
+      }
+      // --------------------------------------------------------------------
+      void free( buffer_t *buffer )
+      {
+         int idx = buffer - buffers_;
+         if ( idx >= 0 && idx < POOL_SIZE && free_count_ < POOL_SIZE )
+            free_[free_count_++] = idx;
+      }
+      // --------------------------------------------------------------------
+      int available() const
+      { return free_count_; }
+
+   private:
+      block_data_t storage_[POOL_SIZE][BUFFER_SIZE];
+      buffer_t buffers_[POOL_SIZE];
+      int free_[POOL_SIZE];
+      int free_count_;
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** Tells whether Radio_P has
+    *  int send_buffer( node_id_t, packet_buffer_t& ).
+    */
+   template<typename Radio_P>
+   struct HasSendBuffer
+   {
+      typedef char yes[1];
+      typedef char no[2];
+
+      template<typename U, int (U::*)( typename U::node_id_t, typename U::packet_buffer_t& )>
+      struct Check;
+
+      template<typename U> static yes& test( Check<U, &U::send_buffer>* );
+      template<typename U> static no& test( ... );
+
+      enum { value = sizeof( test<Radio_P>( 0 ) ) == sizeof( yes ) };
+   };
+   // -----------------------------------------------------------------------
+   template<typename Radio_P,
+            bool SEND_BUFFER = HasSendBuffer<Radio_P>::value>
+   struct PacketBufferSender
+   {
+      template<typename Buffer_P>
+      static int send( Radio_P& radio, typename Radio_P::node_id_t to, Buffer_P& buffer )
+      { return radio.send( to, buffer.size(), buffer.data() ); }
+   };
+   // -----------------------------------------------------------------------
+   template<typename Radio_P>
+   struct PacketBufferSender<Radio_P, true>
+   {
+      template<typename Buffer_P>
+      static int send( Radio_P& radio, typename Radio_P::node_id_t to, Buffer_P& buffer )
+      { return radio.send_buffer( to, buffer ); }
+   };
+   // -----------------------------------------------------------------------
+   /** Hands a packet buffer to the given radio: to its send_buffer() if it
+    *  is a buffer-aware layer, otherwise to plain send().
+    */
+   template<typename Radio_P, typename Buffer_P>
+   inline int send_packet_buffer( Radio_P& radio, typename Radio_P::node_id_t to, Buffer_P& buffer )
+   {
+      return PacketBufferSender<Radio_P>::send( radio, to, buffer );
+   }
+
+}
+
+#endif
@@ -20,6 +20,8 @@
 #define __WISELIB_UTIL_SERIALIZATION_SERIALIZATION_H
 
 #include "util/serialization/endian.h"
+#include <stdint.h>
+#include <string.h>
 
 namespace wiselib
 {
@@ -89,6 +91,113 @@ namespace wiselib
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
+   /** Reverses the byte order of integral values of 1, 2, 4 or 8 bytes.
+    *  Uses the GCC builtins where available, which map to a single
+    *  instruction on most targets.
+    */
+   template<typename Type_P, int SIZE = sizeof(Type_P)>
+   struct ByteSwap
+   {
+      static inline Type_P swap( Type_P value )
+      {
+         Type_P result;
+         for ( int i = 0; i < SIZE; i++ )
+            *((uint8_t*)&result + i) = *((uint8_t*)&value + SIZE - 1 - i);
+         return result;
+      }
+   };
+   // -----------------------------------------------------------------------
+   template<typename Type_P>
+   struct ByteSwap<Type_P, 1>
+   {
+      static inline Type_P swap( Type_P value )
+      { return value; }
+   };
+   // -----------------------------------------------------------------------
+   template<typename Type_P>
+   struct ByteSwap<Type_P, 2>
+   {
+      static inline Type_P swap( Type_P value )
+      {
+         uint16_t v = (uint16_t)value;
+         return (Type_P)( (uint16_t)( (v >> 8) | (v << 8) ) );
+      }
+   };
+   // -----------------------------------------------------------------------
+   template<typename Type_P>
+   struct ByteSwap<Type_P, 4>
+   {
+      static inline Type_P swap( Type_P value )
+      {
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
+         return (Type_P)__builtin_bswap32( (uint32_t)value );
+#else
+         uint32_t v = (uint32_t)value;
+         return (Type_P)( (v >> 24) | ((v >> 8) & 0xff00UL) |
+            ((v << 8) & 0xff0000UL) | (v << 24) );
+#endif
+      }
+   };
+   // -----------------------------------------------------------------------
+   template<typename Type_P>
+   struct ByteSwap<Type_P, 8>
+   {
+      static inline Type_P swap( Type_P value )
+      {
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
+         return (Type_P)__builtin_bswap64( (uint64_t)value );
+#else
+         uint64_t v = (uint64_t)value;
+         uint32_t hi = ByteSwap<uint32_t>::swap( (uint32_t)v );
+         uint32_t lo = ByteSwap<uint32_t>::swap( (uint32_t)(v >> 32) );
+         return (Type_P)( ((uint64_t)hi << 32) | lo );
+#endif
+      }
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** Serialization of integral types with one (unaligned) load or store
+    *  instead of a byte loop. The wire format is big endian, like the
+    *  generic implementations above; on little endian hosts the value is
+    *  byte swapped, which is resolved at compile time. memcpy() with a
+    *  constant size is the portable way to express an unaligned access;
+    *  the compiler turns it into a single move where the target allows it.
+    *
+    *  Used as base class of the Serialization specializations for integral
+    *  types in simple_types.h.
+    */
+   template <typename OsModel_P,
+             Endianness Endianness_P,
+             typename BlockData_P,
+             typename Type_P>
+   struct WordSerialization
+   {
+      typedef OsModel_P OsModel;
+      typedef BlockData_P BlockData;
+      typedef Type_P Type;
+
+      typedef typename OsModel::size_t size_t;
+      // --------------------------------------------------------------------
+      static inline size_t write( BlockData *target, Type& value )
+      {
+         Type wire = ( Endianness_P == WISELIB_BIG_ENDIAN ) ?
+            value : ByteSwap<Type>::swap( value );
+         memcpy( target, &wire, sizeof(Type) );
+         return sizeof(Type);
+      }
+      // --------------------------------------------------------------------
+      static inline Type read( BlockData *target )
+      {
+         Type wire;
+         memcpy( &wire, target, sizeof(Type) );
+         return ( Endianness_P == WISELIB_BIG_ENDIAN ) ?
+            wire : ByteSwap<Type>::swap( wire );
+      }
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
    template<typename OsModel_P,
             typename BlockData_P,
             typename Type_P>
@@ -112,6 +221,157 @@ namespace wiselib
    {
       return Serialization<OsModel_P, OsModel_P::endianness, BlockData_P, Type_P>::write( target, value );
    }
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** Writes several fields back to back, e.g. a complete message header,
+    *  and returns the number of bytes written:
+    *
+    *  \code
+    *  write_fields<OsModel>( buffer + offset, node, next_hop, hops );
+    *  \endcode
+    *
+    *  Overloads exist for up to six fields.
+    */
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A>
+   inline typename OsModel_P::size_t write_fields( BlockData_P *target, A& a )
+   {
+      return write<OsModel_P, BlockData_P, A>( target, a );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B>
+   inline typename OsModel_P::size_t write_fields( BlockData_P *target, A& a, B& b )
+   {
+      typename OsModel_P::size_t len = write<OsModel_P, BlockData_P, A>( target, a );
+      return len + write_fields<OsModel_P, BlockData_P, B>( target + len, b );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B,
+            typename C>
+   inline typename OsModel_P::size_t write_fields( BlockData_P *target, A& a, B& b, C& c )
+   {
+      typename OsModel_P::size_t len = write<OsModel_P, BlockData_P, A>( target, a );
+      return len + write_fields<OsModel_P, BlockData_P, B, C>( target + len, b, c );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B,
+            typename C,
+            typename D>
+   inline typename OsModel_P::size_t write_fields( BlockData_P *target, A& a, B& b, C& c, D& d )
+   {
+      typename OsModel_P::size_t len = write<OsModel_P, BlockData_P, A>( target, a );
+      return len + write_fields<OsModel_P, BlockData_P, B, C, D>( target + len, b, c, d );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B,
+            typename C,
+            typename D,
+            typename E>
+   inline typename OsModel_P::size_t write_fields( BlockData_P *target, A& a, B& b, C& c, D& d, E& e )
+   {
+      typename OsModel_P::size_t len = write<OsModel_P, BlockData_P, A>( target, a );
+      return len + write_fields<OsModel_P, BlockData_P, B, C, D, E>( target + len, b, c, d, e );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B,
+            typename C,
+            typename D,
+            typename E,
+            typename F>
+   inline typename OsModel_P::size_t write_fields( BlockData_P *target, A& a, B& b, C& c, D& d, E& e, F& f )
+   {
+      typename OsModel_P::size_t len = write<OsModel_P, BlockData_P, A>( target, a );
+      return len + write_fields<OsModel_P, BlockData_P, B, C, D, E, F>( target + len, b, c, d, e, f );
+   }
+   // -----------------------------------------------------------------------
+   /** Reads fields that were written with write_fields() and returns the
+    *  number of bytes consumed.
+    */
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A>
+   inline typename OsModel_P::size_t read_fields( BlockData_P *target, A& a )
+   {
+      read<OsModel_P, BlockData_P, A>( target, a );
+      return sizeof(A);
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B>
+   inline typename OsModel_P::size_t read_fields( BlockData_P *target, A& a, B& b )
+   {
+      read<OsModel_P, BlockData_P, A>( target, a );
+      return sizeof(A) + read_fields<OsModel_P, BlockData_P, B>( target + sizeof(A), b );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B,
+            typename C>
+   inline typename OsModel_P::size_t read_fields( BlockData_P *target, A& a, B& b, C& c )
+   {
+      read<OsModel_P, BlockData_P, A>( target, a );
+      return sizeof(A) + read_fields<OsModel_P, BlockData_P, B, C>( target + sizeof(A), b, c );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B,
+            typename C,
+            typename D>
+   inline typename OsModel_P::size_t read_fields( BlockData_P *target, A& a, B& b, C& c, D& d )
+   {
+      read<OsModel_P, BlockData_P, A>( target, a );
+      return sizeof(A) + read_fields<OsModel_P, BlockData_P, B, C, D>( target + sizeof(A), b, c, d );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B,
+            typename C,
+            typename D,
+            typename E>
+   inline typename OsModel_P::size_t read_fields( BlockData_P *target, A& a, B& b, C& c, D& d, E& e )
+   {
+      read<OsModel_P, BlockData_P, A>( target, a );
+      return sizeof(A) + read_fields<OsModel_P, BlockData_P, B, C, D, E>( target + sizeof(A), b, c, d, e );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename BlockData_P,
+            typename A,
+            typename B,
+            typename C,
+            typename D,
+            typename E,
+            typename F>
+   inline typename OsModel_P::size_t read_fields( BlockData_P *target, A& a, B& b, C& c, D& d, E& e, F& f )
+   {
+      read<OsModel_P, BlockData_P, A>( target, a );
+      return sizeof(A) + read_fields<OsModel_P, BlockData_P, B, C, D, E, F>( target + sizeof(A), b, c, d, e, f );
+   }
 
 }
 
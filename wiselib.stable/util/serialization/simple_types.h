@@ -90,119 +90,102 @@ namespace wiselib
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
+   /** Integral types are (de)serialized word-at-a-time, see
+    *  WordSerialization.
+    */
    template <typename OsModel_P,
              typename BlockData_P>
    struct Serialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, uint16_t>
-   {
-   public:
-      typedef OsModel_P OsModel;
-      typedef BlockData_P BlockData;
-      typedef uint16_t Type;
-
-      typedef typename OsModel::size_t size_t;
-      // --------------------------------------------------------------------
-      static inline Type read( BlockData *target )
-      {
-         Type value;
-         *((BlockData*)&value + 1) = *target;
-         *((BlockData*)&value) = *(target + 1);
-         return value;
-      }
-      // --------------------------------------------------------------------
-      static inline size_t write( BlockData *target, Type& value )
-      {
-         *target = (value >> 8) & 0xff;
-         *(target + 1) = value & 0xff;
-         return sizeof(Type);
-      }
-   };
+      : public WordSerialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, uint16_t>
+   {};
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    template <typename OsModel_P,
              typename BlockData_P>
    struct Serialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, uint16_t>
-   {
-   public:
-      typedef OsModel_P OsModel;
-      typedef BlockData_P BlockData;
-      typedef uint16_t Type;
-
-      typedef typename OsModel::size_t size_t;
-      // --------------------------------------------------------------------
-      static inline Type read( BlockData *target )
-      {
-         Type value;
-         *((BlockData*)&value) = *target;
-         *((BlockData*)&value + 1) = *(target + 1);
-         return value;
-      }
-      // --------------------------------------------------------------------
-      static inline size_t write( BlockData *target, Type& value )
-      {
-         *target = (value >> 8) & 0xff;
-         *(target + 1) = value & 0xff;
-         return sizeof(Type);
-      }
-   };
+      : public WordSerialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, uint16_t>
+   {};
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    template <typename OsModel_P,
              typename BlockData_P>
    struct Serialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, int16_t>
-   {
-   public:
-      typedef OsModel_P OsModel;
-      typedef BlockData_P BlockData;
-      typedef int16_t Type;
-
-      typedef typename OsModel::size_t size_t;
-      // --------------------------------------------------------------------
-      static inline Type read( BlockData *target )
-      {
-         Type value;
-         *((BlockData*)&value + 1) = *target;
-         *((BlockData*)&value) = *(target + 1);
-         return value;
-      }
-      // --------------------------------------------------------------------
-      static inline size_t write( BlockData *target, Type& value )
-      {
-         *target = (value >> 8) & 0xff;
-         *(target + 1) = value & 0xff;
-         return sizeof(Type);
-      }
-   };
+      : public WordSerialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, int16_t>
+   {};
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    template <typename OsModel_P,
              typename BlockData_P>
    struct Serialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, int16_t>
-   {
-   public:
-      typedef OsModel_P OsModel;
-      typedef BlockData_P BlockData;
-      typedef int16_t Type;
-
-      typedef typename OsModel::size_t size_t;
-      // --------------------------------------------------------------------
-      static inline Type read( BlockData *target )
-      {
-         Type value;
-         *((BlockData*)&value) = *target;
-         *((BlockData*)&value + 1) = *(target + 1);
-         return value;
-      }
-      // --------------------------------------------------------------------
-      static inline size_t write( BlockData *target, Type& value )
-      {
-         *target = (value >> 8) & 0xff;
-         *(target + 1) = value & 0xff;
-         return sizeof(Type);
-      }
-   };
+      : public WordSerialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, int16_t>
+   {};
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   template <typename OsModel_P,
+             typename BlockData_P>
+   struct Serialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, uint32_t>
+      : public WordSerialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, uint32_t>
+   {};
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   template <typename OsModel_P,
+             typename BlockData_P>
+   struct Serialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, uint32_t>
+      : public WordSerialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, uint32_t>
+   {};
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   template <typename OsModel_P,
+             typename BlockData_P>
+   struct Serialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, int32_t>
+      : public WordSerialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, int32_t>
+   {};
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   template <typename OsModel_P,
+             typename BlockData_P>
+   struct Serialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, int32_t>
+      : public WordSerialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, int32_t>
+   {};
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   template <typename OsModel_P,
+             typename BlockData_P>
+   struct Serialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, uint64_t>
+      : public WordSerialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, uint64_t>
+   {};
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   template <typename OsModel_P,
+             typename BlockData_P>
+   struct Serialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, uint64_t>
+      : public WordSerialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, uint64_t>
+   {};
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   template <typename OsModel_P,
+             typename BlockData_P>
+   struct Serialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, int64_t>
+      : public WordSerialization<OsModel_P, WISELIB_LITTLE_ENDIAN, BlockData_P, int64_t>
+   {};
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   template <typename OsModel_P,
+             typename BlockData_P>
+   struct Serialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, int64_t>
+      : public WordSerialization<OsModel_P, WISELIB_BIG_ENDIAN, BlockData_P, int64_t>
+   {};
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
@@ -22,6 +22,19 @@
 
 #include "algorithms/crypto/pmp.h"
 
+/* Window width of the NAF used by c_mul(); 2^(w-2) odd multiples of the
+* point are precomputed per multiplication. Possible Values: 2 - 6 */
+#ifndef ECCFP_WNAF_WIDTH
+#define ECCFP_WNAF_WIDTH 4
+#endif
+
+/* Comb width for multiplications of the base point (gen_public_key(),
+* c_mul_base()); the table kept in every ECCFP instance holds 2^w - 1
+* points. Possible Values: 2 - 6 */
+#ifndef ECCFP_COMB_WIDTH
+#define ECCFP_COMB_WIDTH 4
+#endif
+
 namespace wiselib
 {
 
@@ -39,6 +52,8 @@ Params param;
 class ECCFP
 {
 public:
+
+	ECCFP() : base_table_valid(FALSE) {}
 	
 	/* ------------- Point functions ------------ */
 
@@ -240,22 +255,294 @@ public:
 		pmp.Assign(P0->x, t1, NUMWORDS);
 	}
 
+	/* ---------------- Jacobian coordinates -------------------
+	* (X, Y, Z) represents the affine point (X/Z^2, Y/Z^3); Z = 0 is the
+	* point at infinity. No modular inversion is needed for doubling and
+	* addition, only once per scalar multiplication in c_to_affine(). */
+
+	//P0 = 2*P1 in Jacobian coordinates, P0 and P1 can be same point
+	void c_dbl_projective(Point *P0, NN_DIGIT *Z0, Point *P1, NN_DIGIT *Z1)
+	{
+		NN_DIGIT n1[NUMWORDS], n2[NUMWORDS], n3[NUMWORDS];
+
+		if (pmp.Zero(Z1, NUMWORDS) || pmp.Zero(P1->y, NUMWORDS)){
+			p_clear(P0);
+			pmp.AssignZero(Z0, NUMWORDS);
+			return;
+		}
+
+		//n1 = M = 3*X1^2 + a*Z1^4
+		if (param.E.a_minus3){
+			pmp.ModSqrOpt(n1, Z1, param.p, param.omega, NUMWORDS); //Z1^2
+			pmp.ModAdd(n2, P1->x, n1, param.p, NUMWORDS); //X1+Z1^2
+			pmp.ModSub(n1, P1->x, n1, param.p, NUMWORDS); //X1-Z1^2
+			pmp.ModMultOpt(n1, n1, n2, param.p, param.omega, NUMWORDS);
+			pmp.ModAdd(n2, n1, n1, param.p, NUMWORDS);
+			pmp.ModAdd(n1, n1, n2, param.p, NUMWORDS); //3*(X1-Z1^2)*(X1+Z1^2)
+		}else{
+			pmp.ModSqrOpt(n1, P1->x, param.p, param.omega, NUMWORDS); //X1^2
+			pmp.ModAdd(n2, n1, n1, param.p, NUMWORDS);
+			pmp.ModAdd(n1, n1, n2, param.p, NUMWORDS); //3*X1^2
+			if (!param.E.a_zero){
+				pmp.ModSqrOpt(n2, Z1, param.p, param.omega, NUMWORDS);
+				pmp.ModSqrOpt(n2, n2, param.p, param.omega, NUMWORDS); //Z1^4
+				pmp.ModMultOpt(n2, n2, param.E.a, param.p, param.omega, NUMWORDS);
+				pmp.ModAdd(n1, n1, n2, param.p, NUMWORDS);
+			}
+		}
+
+		//Z0 = 2*Y1*Z1
+		pmp.ModMultOpt(n2, P1->y, Z1, param.p, param.omega, NUMWORDS);
+		pmp.ModAdd(Z0, n2, n2, param.p, NUMWORDS);
+
+		//n2 = S = 4*X1*Y1^2
+		pmp.ModSqrOpt(n3, P1->y, param.p, param.omega, NUMWORDS); //Y1^2
+		pmp.ModMultOpt(n2, P1->x, n3, param.p, param.omega, NUMWORDS);
+		pmp.ModAdd(n2, n2, n2, param.p, NUMWORDS);
+		pmp.ModAdd(n2, n2, n2, param.p, NUMWORDS);
+
+		//X0 = M^2 - 2*S
+		pmp.ModSqrOpt(P0->x, n1, param.p, param.omega, NUMWORDS);
+		pmp.ModSub(P0->x, P0->x, n2, param.p, NUMWORDS);
+		pmp.ModSub(P0->x, P0->x, n2, param.p, NUMWORDS);
+
+		//n3 = T = 8*Y1^4
+		pmp.ModSqrOpt(n3, n3, param.p, param.omega, NUMWORDS);
+		pmp.ModAdd(n3, n3, n3, param.p, NUMWORDS);
+		pmp.ModAdd(n3, n3, n3, param.p, NUMWORDS);
+		pmp.ModAdd(n3, n3, n3, param.p, NUMWORDS);
+
+		//Y0 = M*(S - X0) - T
+		pmp.ModSub(n2, n2, P0->x, param.p, NUMWORDS);
+		pmp.ModMultOpt(n2, n1, n2, param.p, param.omega, NUMWORDS);
+		pmp.ModSub(P0->y, n2, n3, param.p, NUMWORDS);
+	}
+
+	//mixed addition, P0 = P1 + P2 with P0, P1 in Jacobian and P2 in
+	//affine coordinates, P0 and P1 can be same point
+	void c_add_mix(Point *P0, NN_DIGIT *Z0, Point *P1, NN_DIGIT *Z1, Point *P2)
+	{
+		NN_DIGIT n1[NUMWORDS], n2[NUMWORDS], n3[NUMWORDS], n4[NUMWORDS];
+
+		if (p_iszero(P2)){
+			p_copy(P0, P1);
+			pmp.Assign(Z0, Z1, NUMWORDS);
+			return;
+		}
+		if (pmp.Zero(Z1, NUMWORDS)){
+			p_copy(P0, P2);
+			pmp.AssignDigit(Z0, 1, NUMWORDS);
+			return;
+		}
+
+		pmp.ModSqrOpt(n1, Z1, param.p, param.omega, NUMWORDS); //Z1^2
+		pmp.ModMultOpt(n2, P2->x, n1, param.p, param.omega, NUMWORDS); //U2 = x2*Z1^2
+		pmp.ModMultOpt(n1, n1, Z1, param.p, param.omega, NUMWORDS);
+		pmp.ModMultOpt(n1, P2->y, n1, param.p, param.omega, NUMWORDS); //S2 = y2*Z1^3
+		pmp.ModSub(n2, n2, P1->x, param.p, NUMWORDS); //H = U2 - X1
+		pmp.ModSub(n1, n1, P1->y, param.p, NUMWORDS); //R = S2 - Y1
+
+		if (pmp.Zero(n2, NUMWORDS)){
+			if (pmp.Zero(n1, NUMWORDS)){
+				//P1 == P2
+				c_dbl_projective(P0, Z0, P1, Z1);
+			}else{
+				//P1 == -P2
+				p_clear(P0);
+				pmp.AssignZero(Z0, NUMWORDS);
+			}
+			return;
+		}
+
+		//Z0 = Z1*H
+		pmp.ModMultOpt(Z0, Z1, n2, param.p, param.omega, NUMWORDS);
+
+		pmp.ModSqrOpt(n3, n2, param.p, param.omega, NUMWORDS); //H^2
+		pmp.ModMultOpt(n4, n3, n2, param.p, param.omega, NUMWORDS); //H^3
+		pmp.ModMultOpt(n3, P1->x, n3, param.p, param.omega, NUMWORDS); //X1*H^2
+
+		//X0 = R^2 - H^3 - 2*X1*H^2
+		pmp.ModSqrOpt(P0->x, n1, param.p, param.omega, NUMWORDS);
+		pmp.ModSub(P0->x, P0->x, n4, param.p, NUMWORDS);
+		pmp.ModSub(P0->x, P0->x, n3, param.p, NUMWORDS);
+		pmp.ModSub(P0->x, P0->x, n3, param.p, NUMWORDS);
+
+		//Y0 = R*(X1*H^2 - X0) - Y1*H^3
+		pmp.ModSub(n3, n3, P0->x, param.p, NUMWORDS);
+		pmp.ModMultOpt(n3, n1, n3, param.p, param.omega, NUMWORDS);
+		pmp.ModMultOpt(n4, P1->y, n4, param.p, param.omega, NUMWORDS);
+		pmp.ModSub(P0->y, n3, n4, param.p, NUMWORDS);
+	}
+
+	//convert P1 from Jacobian to affine coordinates, infinity becomes (0, 0)
+	void c_to_affine(Point *P0, Point *P1, NN_DIGIT *Z1)
+	{
+		NN_DIGIT n1[NUMWORDS], n2[NUMWORDS];
+
+		if (pmp.Zero(Z1, NUMWORDS)){
+			p_clear(P0);
+			return;
+		}
+		if (Z_is_one(Z1)){
+			p_copy(P0, P1);
+			return;
+		}
+
+		pmp.ModInv(n1, Z1, param.p, NUMWORDS); //1/Z1
+		pmp.ModSqrOpt(n2, n1, param.p, param.omega, NUMWORDS); //1/Z1^2
+		pmp.ModMultOpt(P0->x, P1->x, n2, param.p, param.omega, NUMWORDS);
+		pmp.ModMultOpt(n2, n2, n1, param.p, param.omega, NUMWORDS); //1/Z1^3
+		pmp.ModMultOpt(P0->y, P1->y, n2, param.p, param.omega, NUMWORDS);
+	}
+
+	//width-w non-adjacent form of n, naf[i] belongs to 2^i
+	//every nonzero digit is odd with |naf[i]| < 2^(w-1)
+	//returns the number of digits, at most NUMWORDS * NN_DIGIT_BITS + 1
+	int16 c_wnaf(int8_t *naf, NN_DIGIT *n)
+	{
+		//one more digit for the carry of k + |d| when n is close to
+		//2^(NUMWORDS * NN_DIGIT_BITS)
+		NN_DIGIT k[NUMWORDS + 1], t[NUMWORDS + 1];
+		int16 len = 0;
+		int8_t d;
+
+		pmp.Assign(k, n, NUMWORDS);
+		k[NUMWORDS] = 0;
+		while (!pmp.Zero(k, NUMWORDS + 1)){
+			d = 0;
+			if (k[0] & 1){
+				d = (int8_t)(k[0] & ((1 << ECCFP_WNAF_WIDTH) - 1));
+				if (d >= (1 << (ECCFP_WNAF_WIDTH - 1)))
+					d -= (1 << ECCFP_WNAF_WIDTH);
+				if (d > 0){
+					pmp.AssignDigit(t, (NN_DIGIT)d, NUMWORDS + 1);
+					pmp.Sub(k, k, t, NUMWORDS + 1);
+				}else{
+					pmp.AssignDigit(t, (NN_DIGIT)(-d), NUMWORDS + 1);
+					pmp.Add(k, k, t, NUMWORDS + 1);
+				}
+			}
+			naf[len++] = d;
+			pmp.RShift(k, k, 1, NUMWORDS + 1);
+		}
+		return len;
+	}
+
 	//scalar multiplication on elliptic curve
-	//P0= n * P1
+	//P0= n * P1, result in affine coordinates
+	//uses the wNAF of n and Jacobian coordinates, i.e. a single inversion
+	//besides the precomputation of the odd multiples of P1
 	void c_mul(Point * P0, Point * P1, NN_DIGIT * n)
 	{
-		int16 i, tmp;
+		Point odd[1 << (ECCFP_WNAF_WIDTH - 2)];
+		Point Q, twoP;
+		NN_DIGIT Z[NUMWORDS];
+		int8_t naf[NUMWORDS * NN_DIGIT_BITS + 1];
+		int16 i, len;
+		uint8_t j;
+
+		if (p_iszero(P1)){
+			p_clear(P0);
+			return;
+		}
+
+		//odd[j] = (2j+1) * P1
+		p_copy(&odd[0], P1);
+		if ((1 << (ECCFP_WNAF_WIDTH - 2)) > 1){
+			p_clear(&twoP);
+			c_dbl_affine(&twoP, P1);
+			for (j = 1; j < (1 << (ECCFP_WNAF_WIDTH - 2)); j++)
+				c_add_affine(&odd[j], &odd[j - 1], &twoP);
+		}
+
+		len = c_wnaf(naf, n);
+
+		p_clear(&Q);
+		pmp.AssignZero(Z, NUMWORDS);
+		for (i = len - 1; i >= 0; i--){
+			c_dbl_projective(&Q, Z, &Q, Z);
+			if (naf[i] > 0){
+				c_add_mix(&Q, Z, &Q, Z, &odd[naf[i] >> 1]);
+			}else if (naf[i] < 0){
+				p_copy(&twoP, &odd[(-naf[i]) >> 1]);
+				pmp.ModNeg(twoP.y, twoP.y, param.p, NUMWORDS);
+				c_add_mix(&Q, Z, &Q, Z, &twoP);
+			}
+		}
+
+		c_to_affine(P0, &Q, Z);
+	}
+
+	//precompute the comb table of the base point param.G:
+	//base_table[v-1] = sum of 2^(j*comb_d) * G over all bits j set in v
+	void precompute_base()
+	{
+		Point Gj[ECCFP_COMB_WIDTH];
+		Point Q;
+		NN_DIGIT Z[NUMWORDS];
+		uint16_t i, v;
+		uint8_t j;
+
+		comb_d = (pmp.Bits(param.r, NUMWORDS) + ECCFP_COMB_WIDTH - 1) / ECCFP_COMB_WIDTH;
+
+		//Gj[j] = 2^(j*comb_d) * G
+		p_copy(&Gj[0], &(param.G));
+		for (j = 1; j < ECCFP_COMB_WIDTH; j++){
+			p_copy(&Q, &Gj[j - 1]);
+			pmp.AssignDigit(Z, 1, NUMWORDS);
+			for (i = 0; i < comb_d; i++)
+				c_dbl_projective(&Q, Z, &Q, Z);
+			c_to_affine(&Gj[j], &Q, Z);
+		}
 
-		// clear point
-		p_clear(P0);
-		tmp = pmp.Bits(n, NUMWORDS);
+		for (v = 1; v < (1 << ECCFP_COMB_WIDTH); v++){
+			for (j = 0; !(v & (1 << j)); j++)
+				;
+			if (v == (1 << j))
+				p_copy(&base_table[v - 1], &Gj[j]);
+			else
+				c_add_affine(&base_table[v - 1], &base_table[(v & (v - 1)) - 1], &Gj[j]);
+		}
+
+		p_copy(&base_point, &(param.G));
+		base_table_valid = TRUE;
+	}
 
-		for (i = tmp-1; i >= 0; i--){
-			c_dbl_affine(P0, P0);
-			if (pmp.b_testbit(n, i)){
-				c_add_affine(P0, P0, P1);
+	//P0 = n * param.G with the fixed-base comb method: comb_d doublings
+	//and at most comb_d mixed additions. The table is computed on first
+	//use and whenever the curve parameters have changed.
+	void c_mul_base(Point * P0, NN_DIGIT * n)
+	{
+		Point Q;
+		NN_DIGIT Z[NUMWORDS];
+		int16 i;
+		int8_t j;
+		uint8_t v;
+
+		if (!base_table_valid || !p_equal(&base_point, &(param.G)))
+			precompute_base();
+
+		//scalar is not reduced modulo the order, the comb does not cover it
+		if (pmp.Bits(n, NUMWORDS) > comb_d * ECCFP_COMB_WIDTH){
+			c_mul(P0, &(param.G), n);
+			return;
+		}
+
+		p_clear(&Q);
+		pmp.AssignZero(Z, NUMWORDS);
+		for (i = comb_d - 1; i >= 0; i--){
+			c_dbl_projective(&Q, Z, &Q, Z);
+			v = 0;
+			for (j = ECCFP_COMB_WIDTH - 1; j >= 0; j--){
+				v <<= 1;
+				if (pmp.b_testbit(n, j * comb_d + i))
+					v |= 1;
 			}
+			if (v)
+				c_add_mix(&Q, Z, &Q, Z, &base_table[v - 1]);
 		}
+
+		c_to_affine(P0, &Q, Z);
 	}
 
 	//generate a private key using a random seed
@@ -300,7 +587,7 @@ public:
 	// PublicKey = PrivateKey * params.G
 	void gen_public_key(Point *PublicKey, NN_DIGIT *PrivateKey)
 	{
-		c_mul(PublicKey, &(param.G), PrivateKey);
+		c_mul_base(PublicKey, PrivateKey);
 	}
 
 	//initialize an 128-bit elliptic curve over F_{p}
@@ -1110,6 +1397,12 @@ public:
 
 private:
 	PMP pmp;
+
+	//comb table for multiples of base_point (a copy of param.G)
+	Point base_table[(1 << ECCFP_COMB_WIDTH) - 1];
+	Point base_point;
+	uint16_t comb_d;
+	bool base_table_valid;
 };
 
 } //end of namespace wiselib
@@ -230,7 +230,7 @@ private:
 		pmp.ModMult(u2, r, w, param.r, NUMWORDS);
 
 		//compute u1G + u2Q
-		eccfp.c_mul(&u1P, &(param.G), u1);  //u1*G
+		eccfp.c_mul_base(&u1P, u1);  //u1*G
 		eccfp.c_mul(&u2Q, Q, u2);  //u2*Q
 		eccfp.c_add_affine(&final, &u1P, &u2Q);
 
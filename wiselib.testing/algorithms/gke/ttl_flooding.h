@@ -21,15 +21,20 @@
 #define _TTL_FLOODING_H_
 
 #include "util/base_classes/radio_base.h"
-#include "util/pstl/set_static.h"
+#include "algorithms/routing/flooding/flooding_duplicate_cache.h"
+#include "algorithms/routing/flooding/flooding_suppression.h"
 
 #include "keylevels_message.h"
 //#include "ttl_message.h"
 
 namespace wiselib {
 
+/* SEEN_MESSAGE_SET_SIZE is the number of recently seen messages that are
+ * remembered (at most 255). It bounds RAM, not the network size: older
+ * messages are forgotten, the TTL keeps forgotten ones from circulating.
+ */
 template<typename OsModel_P, typename Radio_P,
-		typename Debug_P = typename OsModel_P::Debug, int SEEN_MESSAGE_SET_SIZE = 100>
+		typename Debug_P = typename OsModel_P::Debug, int SEEN_MESSAGE_SET_SIZE = 32>
 class TTLFlooding: public RadioBase<OsModel_P, typename Radio_P::node_id_t,
 		typename Radio_P::size_t, typename Radio_P::block_data_t> {
 public:
@@ -43,8 +48,9 @@ public:
 	typedef typename Radio::size_t size_t;
 	typedef typename Radio::block_data_t block_data_t;
 	typedef typename Radio::message_id_t message_id_t;
-	typedef typename wiselib::set_static<OsModel, node_id_t, SEEN_MESSAGE_SET_SIZE>
+	typedef FloodingDuplicateCache<OsModel, node_id_t, node_id_t, SEEN_MESSAGE_SET_SIZE>
 			message_set_t;
+	typedef FloodingSuppression<OsModel> suppression_t;
 
 	typedef KeylevelsMessage<OsModel, Radio> Message;
 
@@ -66,6 +72,7 @@ public:
 		debug_ = &debug;
 		notify_all_on_path = false;
 		ttl = 0;
+		suppression.seed(radio.id() + 1);
 
 		return SUCCESS;
 	}
@@ -100,6 +107,13 @@ public:
 		notify_all_on_path = notify;
 	}
 
+	/** Proxies forward a message only with the given probability
+	 *  (gossiping) instead of always.
+	 */
+	void set_rebroadcast_probability(uint8_t percent) {
+		suppression.set_probabilistic(percent);
+	}
+
 	void show_ttl_message(Message* msg, int dir){
 #ifndef KL_EXTREME
 		return;
@@ -129,6 +143,7 @@ private:
 	bool notify_all_on_path;
 	uint8_t ttl;
 	message_set_t set;
+	suppression_t suppression;
 };
 
 template<typename OsModel_P, typename Radio_P, typename Debug_P, int SEEN_MESSAGE_SET_SIZE>
@@ -177,9 +192,10 @@ void TTLFlooding<OsModel_P, Radio_P, Debug_P, SEEN_MESSAGE_SET_SIZE>::receive(no
 
 		if (message->source() == radio_->id()) 	return;
 
-		if (set.find(message->message_id()) != set.end())
-		{ }
-		else
+		// No timer to age the cache: make room by forgetting the oldest one
+		if (set.full() && !set.contains(message->source(), message->message_id()))
+			set.expire_oldest();
+		if (set.insert(message->source(), message->message_id()))
 		{
 			uint8_t msg_ttl = message->ttl();
 			if (notify_all_on_path || msg_ttl == 1)
@@ -191,7 +207,7 @@ void TTLFlooding<OsModel_P, Radio_P, Debug_P, SEEN_MESSAGE_SET_SIZE>::receive(no
 						 );
 			}
 
-			if (msg_ttl > 1)
+			if (msg_ttl > 1 && suppression.forward())
 			{
 #ifdef TTL_FLOODING_DEBUG
 				debug_->debug("[KLT] {%d} proxing message id %d\n", radio_->id(), message->message_id());
@@ -207,8 +223,6 @@ void TTLFlooding<OsModel_P, Radio_P, Debug_P, SEEN_MESSAGE_SET_SIZE>::receive(no
 				radio_->send(radio_->BROADCAST_ADDRESS, proxyMessage.buffer_size(),
 						(block_data_t*) &proxyMessage);
 			}
-
-			set.insert(message->message_id());
 		}
 	}
 }
@@ -76,7 +76,7 @@ public:
 	typedef KeylevelsMessage<OsModel, Radio> KeylevelMessage;
 
 	typedef KeyShare<OsModel, Radio> keyshare_t;
-	typedef TTLFlooding<OsModel, Radio, Debug, NODES_MAX> radio_ttl_t;
+	typedef TTLFlooding<OsModel, Radio, Debug> radio_ttl_t;
 
 	enum ReturnValues {
 		SUCCESS = OsModel::SUCCESS
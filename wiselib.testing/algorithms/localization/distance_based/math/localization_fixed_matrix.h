@@ -0,0 +1,234 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef __ALGORITHMS_LOCALIZATION_DISTANCE_BASED_MATH_FIXED_MATRIX_H
+#define __ALGORITHMS_LOCALIZATION_DISTANCE_BASED_MATH_FIXED_MATRIX_H
+
+#include <math.h>
+
+namespace wiselib
+{
+
+   /** Matrix with size known at compile time, stored in place. Unlike
+    *  SimpleMatrix, there are no size checks at runtime and all loops have
+    *  constant bounds, so the compiler can unroll and vectorize them.
+    */
+   template<typename OsModel_P,
+            typename T,
+            int ROWS,
+            int COLS>
+   class FixedMatrix
+   {
+
+   public:
+      typedef OsModel_P OsModel;
+      typedef FixedMatrix<OsModel, T, ROWS, COLS> self_type;
+
+      enum { ROW_CNT = ROWS, COL_CNT = COLS };
+      // --------------------------------------------------------------------
+      inline T& operator() ( int row, int col )
+      { return m_[row][col]; }
+
+      inline const T& operator() ( int row, int col ) const
+      { return m_[row][col]; }
+      // --------------------------------------------------------------------
+      void zero( void )
+      {
+         for ( int i = 0; i < ROWS; i++ )
+            for ( int j = 0; j < COLS; j++ )
+               m_[i][j] = 0;
+      }
+      // --------------------------------------------------------------------
+      template<int COLS2>
+      FixedMatrix<OsModel, T, ROWS, COLS2>
+      operator* ( const FixedMatrix<OsModel, T, COLS, COLS2>& m ) const
+      {
+         FixedMatrix<OsModel, T, ROWS, COLS2> tmp;
+         for ( int i = 0; i < ROWS; i++ )
+            for ( int j = 0; j < COLS2; j++ )
+            {
+               T sum = 0;
+               for ( int k = 0; k < COLS; k++ )
+                  sum += m_[i][k] * m(k,j);
+               tmp(i,j) = sum;
+            }
+
+         return tmp;
+      }
+      // --------------------------------------------------------------------
+      self_type& operator*= ( T value )
+      {
+         for ( int i = 0; i < ROWS; i++ )
+            for ( int j = 0; j < COLS; j++ )
+               m_[i][j] *= value;
+
+         return *this;
+      }
+      // --------------------------------------------------------------------
+      self_type& operator+= ( const self_type& m )
+      {
+         for ( int i = 0; i < ROWS; i++ )
+            for ( int j = 0; j < COLS; j++ )
+               m_[i][j] += m(i,j);
+
+         return *this;
+      }
+      // --------------------------------------------------------------------
+      self_type& operator-= ( const self_type& m )
+      {
+         for ( int i = 0; i < ROWS; i++ )
+            for ( int j = 0; j < COLS; j++ )
+               m_[i][j] -= m(i,j);
+
+         return *this;
+      }
+      // --------------------------------------------------------------------
+      FixedMatrix<OsModel, T, COLS, ROWS> transposed( void ) const
+      {
+         FixedMatrix<OsModel, T, COLS, ROWS> tmp;
+         for ( int i = 0; i < ROWS; i++ )
+            for ( int j = 0; j < COLS; j++ )
+               tmp(j,i) = m_[i][j];
+
+         return tmp;
+      }
+      // --------------------------------------------------------------------
+      /** Solves this * x = b for a symmetric positive definite matrix
+       *  by Cholesky decomposition (only the lower triangle is read).
+       *
+       *  \param b right-hand side, overwritten by the solution x
+       *  \param det determinant of this, as a by-product
+       *  \result \c false, if the matrix is not positive definite
+       */
+      bool cholesky_solve( FixedMatrix<OsModel, T, ROWS, 1>& b, T& det ) const
+      {
+         // this = L * L^T, L stored in l
+         T l[ROWS][ROWS];
+         det = 1;
+         for ( int j = 0; j < ROWS; j++ )
+         {
+            T d = m_[j][j];
+            for ( int k = 0; k < j; k++ )
+               d -= l[j][k] * l[j][k];
+            if ( d <= 0 )
+               return false;
+
+            det *= d;
+            l[j][j] = sqrt( d );
+            for ( int i = j + 1; i < ROWS; i++ )
+            {
+               T s = m_[i][j];
+               for ( int k = 0; k < j; k++ )
+                  s -= l[i][k] * l[j][k];
+               l[i][j] = s / l[j][j];
+            }
+         }
+
+         // L * y = b
+         for ( int i = 0; i < ROWS; i++ )
+         {
+            T s = b(i,0);
+            for ( int k = 0; k < i; k++ )
+               s -= l[i][k] * b(k,0);
+            b(i,0) = s / l[i][i];
+         }
+         // L^T * x = y
+         for ( int i = ROWS - 1; i >= 0; i-- )
+         {
+            T s = b(i,0);
+            for ( int k = i + 1; k < ROWS; k++ )
+               s -= l[k][i] * b(k,0);
+            b(i,0) = s / l[i][i];
+         }
+
+         return true;
+      }
+
+   private:
+      T m_[ROWS][COLS];
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** Linear least squares for an overdetermined system A * x = b with N
+    *  unknowns, as used by lateration. Rows of A are added one by one and
+    *  directly accumulated into the normal equations A^T A x = A^T b, so
+    *  neither A nor any transposed copy is ever stored, whatever the
+    *  number of equations.
+    */
+   template<typename OsModel_P,
+            typename T,
+            int N>
+   class LocalizationNormalEquations
+   {
+
+   public:
+      typedef OsModel_P OsModel;
+      typedef FixedMatrix<OsModel, T, N, N> Matrix;
+      typedef FixedMatrix<OsModel, T, N, 1> Vector;
+      // --------------------------------------------------------------------
+      LocalizationNormalEquations()
+      { clear(); }
+      // --------------------------------------------------------------------
+      void clear( void )
+      {
+         ata_.zero();
+         atb_.zero();
+         rows_ = 0;
+      }
+      // --------------------------------------------------------------------
+      /** Adds the equation a * x = b (one row of the system).
+       */
+      void add_row( const T (&a)[N], T b )
+      {
+         for ( int i = 0; i < N; i++ )
+         {
+            // A^T A is symmetric, the solver only needs the lower triangle
+            for ( int j = 0; j <= i; j++ )
+               ata_(i,j) += a[i] * a[j];
+            atb_(i,0) += a[i] * b;
+         }
+         rows_++;
+      }
+      // --------------------------------------------------------------------
+      int row_cnt( void ) const
+      { return rows_; }
+      // --------------------------------------------------------------------
+      /** \param x least squares solution
+       *  \param min_det systems with det(A^T A) below are rejected as
+       *    (nearly) singular, e.g. for collinear anchors
+       *  \result \c true, if a solution was found
+       */
+      bool solve( Vector& x, T min_det ) const
+      {
+         T det;
+         x = atb_;
+         if ( !ata_.cholesky_solve( x, det ) )
+            return false;
+
+         return det >= min_det;
+      }
+
+   private:
+      Matrix ata_;
+      Vector atb_;
+      int rows_;
+   };
+
+}// namespace wiselib
+#endif
@@ -21,6 +21,7 @@
 
 #include "algorithms/localization/distance_based/math/vec.h"
 #include "algorithms/localization/distance_based/math/localization_simple_matrix.h"
+#include "algorithms/localization/distance_based/math/localization_fixed_matrix.h"
 #include "algorithms/localization/distance_based/neighborhood/localization_neighborhood.h"
 #include "algorithms/localization/distance_based/util/localization_defutils.h"
 #include "util/pstl/algorithm.h"
@@ -199,139 +200,56 @@ namespace wiselib
 
 
       typedef typename NeighborInfoList::iterator NeighborInfoListIterator;
-
+      typedef LocalizationNormalEquations<OsModel_P, Arithmatic_P, 2>
+         NormalEquations;
 
       int nbr_size = neighbors.size();
       if ( nbr_size < 3 ) return false;
 
-
-
-      typedef SimpleMatrix<OsModel_P, Arithmatic_P> Matrix;
-      Matrix m_a;
-      Matrix m_b;
-      Matrix m_x;
-
-
-
       NeighborInfoListIterator it = neighbors.begin();
 
-
-
-
       Arithmatic_P x_1, y_1, d_1;
       if ( use_pos )
       {
-         m_a = Matrix( nbr_size, 2 );
-         m_b = Matrix( nbr_size, 1 );
          x_1 = pos.x();
          y_1 = pos.y();
          d_1 = 0;
       }
       else
       {
-         m_a = Matrix( nbr_size - 1, 2 );
-         m_b = Matrix( nbr_size - 1, 1 );
          x_1 = (*it)->pos().x();
          y_1 = (*it)->pos().y();
          d_1 = (*it)->distance();
          ++it;
       }
 
-     /* if(isense::JennicOs::jennic_os->id()==0x9999)
-                  	  isense::JennicOs::jennic_os->debug("befgin it %f %f %f",x_1,y_1,d_1);*/
-
-      int row = 0;
+      // Rows of A * x = b are accumulated into A^T A * x = A^T b right
+      // away, which is then solved by Cholesky decomposition
+      NormalEquations equations;
       for ( ; it != neighbors.end(); ++it )
       {
          Arithmatic_P confidence = (*it)->confidence();
-
-             /*  if(isense::JennicOs::jennic_os->id()==0x9999)
-             	  isense::JennicOs::jennic_os->debug("it %f %f %f %f",(*it)->pos().x(),(*it)->pos().y(),(*it)->distance(),(*it)->confidence());*/
-
          if ( lat_type == lat_anchors ) confidence = 1;
 
+         Arithmatic_P a[2];
+         a[0] = 2 * ( (*it)->pos().x() - x_1 ) * confidence;
+         a[1] = 2 * ( (*it)->pos().y() - y_1 ) * confidence;
 
-         m_a(row,0) = 2 * ( (*it)->pos().x() - x_1 ) * confidence;
-         m_a(row,1) = 2 * ( (*it)->pos().y() - y_1 ) * confidence;
-
-       m_b(row,0) =
+         Arithmatic_P b =
             ( SQR( (*it)->pos().x() ) - SQR( x_1 )
                + SQR( (*it)->pos().y() ) - SQR( y_1 )
                + SQR( d_1 )
                - SQR( (*it)->distance() ) )
             * confidence;
-//    std::cout << "distanz von Knoten"<<  <<"gesch�tzt: " << (*
-/*     m_b(row,0) = 
-          ( SQR( (*it)->pos().x() -  x_1 )
-               + SQR( (*it)->pos().y() - y_1 )
-               + SQR( d_1 )
-               - SQR( (*it)->distance() ) ) *  0.5;
-*/         row++;
-      }
-
-
-//
-//     if (
-//    		  (( m_a.transposed() * m_a ).det() < 0.0001 )&&
-//    		  (( m_a.transposed() * m_a ).det() > -0.0001 )
-//    	){
-//    	  /*if(isense::JennicOs::jennic_os->id()==0x9999)
-//    		  isense::JennicOs::jennic_os->debug("before second transport");*/
-//    	  return false;
-//      }else
-//      {
-//    	 /* if(isense::JennicOs::jennic_os->id()==0x9999)
-//    	     		  isense::JennicOs::jennic_os->debug("det %f",( m_a.transposed() * m_a ).det());*/
-//    	 // return true;
-//      }
-
-
-
-Matrix tmp = m_a.transposed();
-tmp*=m_a;
-
-Arithmatic_P det = tmp.det();
-
-
-
 
-if( (det < 0.0001 )&&(det > -0.0001 ))
-{
-	return false;
-}
-
-
-
-
-m_x = tmp.inverse();
-
-
-
-tmp = m_a.transposed();
-
-
-
-
-
-
-tmp*=m_b;
-
-
-
-
-m_x*=tmp;
-
-
-
-     // solve Ax = b
- /*     m_x = ( m_a.transposed() * m_a ).inverse()
-         * ( m_a.transposed() * m_b );*/
+         equations.add_row( a, b );
+      }
 
-/*      if(isense::JennicOs::jennic_os->id()==0x9999)
-    	  isense::JennicOs::jennic_os->debug("after second transport");
-      return true;*/
+      typename NormalEquations::Vector m_x;
+      if ( !equations.solve( m_x, 0.0001 ) )
+         return false;
 
-      pos = Vec<Arithmatic_P>( m_x(0,0), m_x(1,0));
+      pos = Vec<Arithmatic_P>( m_x(0,0), m_x(1,0) );
 
       return true;
    }
@@ -44,7 +44,9 @@
 //#define DEBUG_ECHO_EXTRA
 //#define DEBUG_PIGGYBACKING
 #define MAX_PG_PAYLOAD 30
+#ifndef ECHO_MAX_NODES
 #define ECHO_MAX_NODES 60
+#endif
 
 /**
  *	If enabled, beacons that are below certain LQI thresholds
@@ -120,6 +122,7 @@ public:
 		uint32_t total_beacons;
 		uint8_t inverse_link_assoc;
 		uint16_t stability;
+		uint16_t period;
 		bool active;
 		bool stable;
 		bool bidi;
@@ -157,11 +160,25 @@ public:
 	typedef typename node_info_vector_t::iterator iterator_t;
 
 	/**
-	 * Actual Vector containing the nodes in the neighborhood
+	 * Actual Vector containing the nodes in the neighborhood.
+	 *
+	 * Entries are never erased (dropped neighbors are only marked as
+	 * inactive), so their positions are stable. Do not modify it from
+	 * outside, the index below and the neighbor counters depend on it.
 	 */
 	node_info_vector_t neighborhood;
 	// --------------------------------------------------------------------
 
+	/**
+	 * Which neighbors get_neighbors() returns.
+	 */
+	enum neighbor_filters {
+		ACTIVE_NB = 0, /*!< All neighbors beacons are received from */
+		STABLE_NB = 1, /*!< Only stable neighbors */
+		BIDI_NB = 2 /*!< Only neighbors with bidirectional links */
+	};
+	// --------------------------------------------------------------------
+
 	enum error_codes {
 		SUCCESS = OsModel::SUCCESS, /*!< The method return with no errors */
 		RGD_NUM_INUSE = 1, /*!< This app number is already registered */
@@ -191,7 +208,7 @@ public:
 	 * Sets status to waiting.
 	 */
 	Echo() :
-		status_(WAITING) {
+		status_(WAITING), max_beacon_period(0), beacon_round(0) {
 	}
 	;
 
@@ -223,6 +240,8 @@ public:
 		 * Initialize vectors and variables.
 		 */
 		init_echo();
+		cur_beacon_period = beacon_period;
+		nb_changed = false;
 
 		/**
 		 * Code for paying with different TxPower values.
@@ -235,8 +254,9 @@ public:
 		 */
 		set_status(SEARCHING);
 
-		// send first beacon
-		say_hello(0);
+		// send first beacon, timers of an earlier enable are dropped
+		beacon_round++;
+		say_hello((void*) (long) beacon_round);
 
 #ifdef DEBUG_ECHO
 		debug().debug("Neighborhood discovery enabled in node %d\n",radio().id());
@@ -274,6 +294,12 @@ public:
 	 * */
 	void init_echo() {
 		neighborhood.clear();
+		for (int i = 0; i < ECHO_INDEX_SIZE; i++)
+			index_[i] = NO_SLOT;
+		oldest_ = newest_ = NO_SLOT;
+		active_cnt_ = stable_cnt_ = bidi_cnt_ = 0;
+		assoc_sum_ = assoc_cnt_ = 0;
+		ilink_sum_ = ilink_cnt_ = 0;
 		node_stability = 0;
 	}
 	;
@@ -367,108 +393,101 @@ public:
 	}
 
 	bool is_neighbor(node_id_t id) {
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->stable && it->id == id)
-				return true;
-		}
-		return false;
+		neighbor_entry_t *nb = find_neighbor(id);
+		return nb && nb->stable;
 	}
 
 	bool is_neighbor_bidi(node_id_t id) {
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->bidi && it->id == id)
-				return true;
-		}
-		return false;
+		neighbor_entry_t *nb = find_neighbor(id);
+		return nb && nb->bidi;
 	}
 
 	uint8_t nb_size(void) {
-		uint8_t size = 0;
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->active)
-				size++;
-		}
-
-		return size;
+		return active_cnt_;
 	}
 
 	uint8_t stable_nb_size(void) {
-		uint8_t size = 0;
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->stable)
-				size++;
-		}
-
-		return size;
+		return stable_cnt_;
 	}
 
 	uint8_t bidi_nb_size(void) {
-		uint8_t size = 0;
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->bidi)
-				size++;
-		}
-
-		return size;
+		return bidi_cnt_;
 	}
 
 	uint8_t get_link_assoc(node_id_t neighbor_id) {
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->id == neighbor_id) {
-				return it->beacons_in_row;
-			}
-		}
-		return 0;
+		neighbor_entry_t *nb = find_neighbor(neighbor_id);
+		return nb ? nb->beacons_in_row : 0;
 	}
 
 	uint8_t get_ilink_assoc(node_id_t neighbor_id) {
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->id == neighbor_id) {
-				return it->inverse_link_assoc;
-			}
-		}
-		return 0;
+		neighbor_entry_t *nb = find_neighbor(neighbor_id);
+		return nb ? nb->inverse_link_assoc : 0;
 	}
 
 	uint8_t get_nb_stability(node_id_t id) {
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->id == id) {
-				return it->stability;
-			}
-		}
-		return 0;
+		neighbor_entry_t *nb = find_neighbor(id);
+		return nb ? nb->stability : 0;
 	}
 
 	uint8_t get_nb_receive_stability(node_id_t id) {
-		uint8_t stability = 0;
-		for (iterator_t it = neighborhood.begin(); it != neighborhood.end(); ++it) {
-			if (it->id == id) {
-				uint32_t millis = (uint32_t) clock().milliseconds(
-						clock().time()) + clock().seconds(clock().time())
-						* 1000 - (uint32_t) clock().milliseconds(
-						it->first_beacon) - (uint32_t) clock().seconds(
-						it->first_beacon) * 1000;
-				uint32_t beacons_send = (millis / beacon_period) + 1;
+		neighbor_entry_t *nb = find_neighbor(id);
+		if (!nb)
+			return 0;
+
+		uint32_t millis = (uint32_t) clock().milliseconds(
+				clock().time()) + clock().seconds(clock().time())
+				* 1000 - (uint32_t) clock().milliseconds(
+				nb->first_beacon) - (uint32_t) clock().seconds(
+				nb->first_beacon) * 1000;
+		// the neighbor beacons at its own (possibly adaptive) interval
+		uint32_t beacons_send = (millis / period_of(*nb)) + 1;
 
 #ifdef DEBUG_ECHO
-				if ( beacons_send < it->total_beacons )
-				debug().debug( "WARNING beacons_send %d total_beacons %d\n",beacons_send,it->total_beacons);
+		if ( beacons_send < nb->total_beacons )
+		debug().debug( "WARNING beacons_send %d total_beacons %d\n",beacons_send,nb->total_beacons);
 #endif
+		// the interval may have grown since its first beacon
+		if (beacons_send < nb->total_beacons)
+			beacons_send = nb->total_beacons;
 
-				stability = (it->total_beacons * 100) / beacons_send;
+		uint8_t stability = (nb->total_beacons * 100) / beacons_send;
 #ifdef DEBUG_ECHO
-				if ( stability > 100 ) {
-					debug().debug( "stability of %x is %d\n",it->id,stability);
-				}
-#endif
-
-				break;
-			}
+		if ( stability > 100 ) {
+			debug().debug( "stability of %x is %d\n",nb->id,stability);
 		}
+#endif
 
 		return stability;
 	}
 
+	/**
+	 * Returns the entry of a (possibly inactive) neighbor, or 0 if no
+	 * beacon was ever received from it.
+	 */
+	const neighbor_entry_t* get_nb_entry(node_id_t id) {
+		return find_neighbor(id);
+	}
+
+	/**
+	 * Copies the entries of the neighbors selected by filter (see
+	 * neighbor_filters) into nbs, at most max of them, and returns how
+	 * many were copied. Lets an algorithm take the whole neighborhood at
+	 * once instead of querying every neighbor on its own.
+	 */
+	uint8_t get_neighbors(neighbor_entry_t *nbs, uint8_t max,
+			uint8_t filter = ACTIVE_NB) {
+		uint8_t cnt = 0;
+		for (uint16_t slot = newest_; slot != NO_SLOT && cnt < max; slot
+				= older_[slot]) {
+			neighbor_entry_t &nb = neighborhood[slot];
+			if ((filter == STABLE_NB && !nb.stable) || (filter == BIDI_NB
+					&& !nb.bidi))
+				continue;
+			nbs[cnt++] = nb;
+		}
+		return cnt;
+	}
+
 	/**
 	 * \brief Initialize the module.
 	 */
@@ -513,6 +532,24 @@ public:
 		timeout_period = timeout_pd;
 	}
 	;
+
+	/**
+	 * Enables adaptive (Trickle-style) beaconing: while the neighborhood
+	 * does not change, the interval doubles after every beacon, from
+	 * beacon_period up to max_beacon_pd. A new, dropped or changed
+	 * neighbor resets it to beacon_period. Every beacon carries the
+	 * interval to the next one, so neighbors judge missed beacons by that.
+	 *
+	 * The interval never exceeds a third of the timeout period, so a
+	 * neighbor is not dropped for two lost beacons. 0 disables it.
+	 */
+	void set_adaptive_beacon_period(uint16_t max_beacon_pd) {
+		max_beacon_period = max_beacon_pd;
+	}
+
+	uint16_t current_beacon_period() {
+		return cur_beacon_period;
+	}
 	// --------------------------------------------------------------------
 	template<class T, void(T::*TMethod)(uint8_t, node_id_t, uint8_t, uint8_t*)>
 	uint8_t reg_event_callback(uint8_t alg_id, uint8_t events_flag, T *obj_pnt) {
@@ -570,11 +607,15 @@ private:
 	 * long time without communication and remove them from Neighborhood.
 	 *
 	 */
-	void say_hello(void * a) {
+	void say_hello(void * round) {
 
+		// the interval was reset meanwhile, a newer timer is pending
+		if ((uint8_t) (long) round != beacon_round)
+			return;
 
 			// Check for Neighbors that do not exist and need to be dropped
 		cleanup_nearby();
+		update_beacon_period();
 
 		// if in searching mode send a new beacon
 		if (status() == SEARCHING) {
@@ -608,6 +649,9 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 				,echomsg.nb_list_size());*/
 #endif
 			add_pg_payload(&echomsg);
+			if (max_beacon_period != 0) {
+				add_period_payload(&echomsg);
+			}
 
 
 			//send the Beacon
@@ -644,8 +688,9 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 		}
 
 		//Reset the timoout for the next beacon
-		timer().template set_timer<self_t, &self_t::say_hello> (beacon_period,
-				this, (void*) 0);
+		beacon_round++;
+		timer().template set_timer<self_t, &self_t::say_hello> (
+				cur_beacon_period, this, (void*) (long) beacon_round);
 	}
 	;
 	
@@ -702,165 +747,157 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 			received_beacon(from);
 #endif
 
-			for (iterator_t
-					it = neighborhood.begin();
-					it != neighborhood.end();
-					++it) {
+			neighbor_entry_t *it = find_neighbor(from);
+			if (it && it->active) {
 
-				bool contains_my_id = false;
-				if (!it->active) {
-					continue;
-				}
+				it->period = advertised_period(recvmsg);
 
-				if (it->id == from ) {
+				bool contains_my_id = false;
 
-					uint8_t nb_size_bytes = recvmsg->nb_list_size();
-					uint8_t bytes_read = 0;
+				uint8_t nb_size_bytes = recvmsg->nb_list_size();
+				uint8_t bytes_read = 0;
 
 
-					while (nb_size_bytes != bytes_read) {
+				while (nb_size_bytes != bytes_read) {
 
-						node_id_t neighbor_id = read<OsModel, block_data_t, node_id_t> (
-								recvmsg->payload() + bytes_read);
-						bytes_read += sizeof(node_id_t);
+					node_id_t neighbor_id = read<OsModel, block_data_t, node_id_t> (
+							recvmsg->payload() + bytes_read);
+					bytes_read += sizeof(node_id_t);
 //						debug().debug( "Debug::echo::receive %d got beacon from %d bytes_read= %d \n", radio().id(), from, bytes_read);
 
 /*						if (radio().id()==4 && from==9) {
-							debug().debug( "Debug::echo::receive %d got beacon from %d bytes_read= %d \n", radio().id(), from, bytes_read);
-							debug().debug("TEST2: id: %d stability: %d size of list of neighbors: %d\n",read<OsModel, block_data_t, node_id_t> (
-									recvmsg->payload()),read<OsModel, block_data_t, uint8_t> (
-											recvmsg->payload() + sizeof(node_id_t))
-											,recvmsg->nb_list_size());
-						}*/
-
-						if ( neighbor_id == radio().id()) {
+						debug().debug( "Debug::echo::receive %d got beacon from %d bytes_read= %d \n", radio().id(), from, bytes_read);
+						debug().debug("TEST2: id: %d stability: %d size of list of neighbors: %d\n",read<OsModel, block_data_t, node_id_t> (
+								recvmsg->payload()),read<OsModel, block_data_t, uint8_t> (
+										recvmsg->payload() + sizeof(node_id_t))
+										,recvmsg->nb_list_size());
+					}*/
+
+					if ( neighbor_id == radio().id()) {
 #ifndef ENABLE_STABILITY_THRESHOLDS
-							contains_my_id = true;
+						contains_my_id = true;
 #endif
 //							debug().debug( "Debug::echo::NO %d got beacon from %d size= %d \n", radio().id(), bytes_read, nb_size_bytes);
 
 #ifdef CALCULATE_INVERSE_STABILITY
-							it->inverse_link_assoc
-									= read<OsModel, block_data_t, uint8_t> (
-											recvmsg->payload() + bytes_read );
+						set_ilink_assoc(*it,
+								read<OsModel, block_data_t, uint8_t> (
+										recvmsg->payload() + bytes_read ));
 //							debug().debug( "Debug::echo::XXXXXX %d from %d it->inverse_link_assoc %d\n",
 //									radio().id(), from, it->inverse_link_assoc);
 
 
-							bytes_read += sizeof(uint8_t);
+						bytes_read += sizeof(uint8_t);
 #endif
 #ifndef ENABLE_STABILITY_THRESHOLDS
-							break;
+						break;
 #endif
-						}
+					}
 #ifdef ENABLE_STABILITY_THRESHOLDS
-						else if (neighbor_id == from) {
+					else if (neighbor_id == from) {
 
 
-							it->stability = read<OsModel, block_data_t, uint16_t > (recvmsg->payload()+bytes_read);
+						it->stability = read<OsModel, block_data_t, uint16_t > (recvmsg->payload()+bytes_read);
 //							debug().debug( "Debug::echo::received_beacon::%d  stability %d threshold %d\n", radio().id(), it->stability, max_stability_threshold);
-							/*
-							if (radio().id()==4&& from==9)
-							debug().debug( "Debug::echo::XXXXXX %d from %d stability %d iLinkAssoc %d linkAssoc %d\n",
-									radio().id(), bytes_read, nb_size_bytes , get_ilink_assoc(from), it->inverse_link_assoc);*/
+						/*
+						if (radio().id()==4&& from==9)
+						debug().debug( "Debug::echo::XXXXXX %d from %d stability %d iLinkAssoc %d linkAssoc %d\n",
+								radio().id(), bytes_read, nb_size_bytes , get_ilink_assoc(from), it->inverse_link_assoc);*/
 
-							bytes_read+=sizeof(uint16_t);
+						bytes_read+=sizeof(uint16_t);
                                                         if (
-								//((6 * node_stability > 5 * it->stability)
+							//((6 * node_stability > 5 * it->stability)
                                                                 //&& ( 4 * node_stability < 5 * it->stability))
                                                                 //&&
-								(it->stability > max_stability_threshold) &&
-								(node_stability > max_stability_threshold)
-								) {
+							(it->stability > max_stability_threshold) &&
+							(node_stability > max_stability_threshold)
+							) {
                                                             contains_my_id = true;
                                                         }
 
 /*							if (radio().id()==4 && from==9) {
-							debug().debug( "Debug::echo::YES %d got beacon from %d size= %d \n", radio().id(), bytes_read, nb_size_bytes);
+						debug().debug( "Debug::echo::YES %d got beacon from %d size= %d \n", radio().id(), bytes_read, nb_size_bytes);
 //							exit(1);
-							}*/
-						}
+						}*/
+					}
 #endif
 #ifdef CALCULATE_INVERSE_STABILITY
-						else {
-							bytes_read+=sizeof(uint8_t);
-						}
-#endif
+					else {
+						bytes_read+=sizeof(uint8_t);
 					}
+#endif
+				}
 
-					if (!it->stable) {
-						continue;
-					}
+				if (!it->stable) {
+					return;
+				}
 #ifdef DEBUG_ECHO
 #ifdef ISENSE
-					debug().debug( "Debug::echo NODE %x has bidirectional communication with %x", radio().id(), from);
+				debug().debug( "Debug::echo NODE %x has bidirectional communication with %x", radio().id(), from);
 #else
 #endif
-					debug().debug( "Debug::echo NODE %d has bidirectional communication with %d\n", radio().id(), from);
+				debug().debug( "Debug::echo NODE %d has bidirectional communication with %d\n", radio().id(), from);
 #endif
 
-					if (contains_my_id) {
-						if (!it->bidi) {
-							it->bidi = true;
-							notify_listeners(NEW_NB_BIDI, from, 0, 0);
-						}
-
+				if (contains_my_id) {
+					if (!it->bidi) {
+						set_bidi(*it, true);
+						notify_listeners(NEW_NB_BIDI, from, 0, 0);
 					}
-					else {
-						if (it->bidi) {
-							it->bidi = false;
-							notify_listeners(LOST_NB_BIDI, from, 0, 0);
-						}
+
+				}
+				else {
+					if (it->bidi) {
+						set_bidi(*it, false);
+						notify_listeners(LOST_NB_BIDI, from, 0, 0);
 					}
+				}
 
-					uint8_t * alg_pl = recvmsg->payload()
-							+ recvmsg->nb_list_size();
-					for (int i = 0; i < recvmsg->get_pg_payloads_num(); i++) {
+				uint8_t * alg_pl = recvmsg->payload()
+						+ recvmsg->nb_list_size();
+				for (int i = 0; i < recvmsg->get_pg_payloads_num(); i++) {
 
 #ifdef DEBUG_PIGGYBACKING
-						debug().debug( "Debug::echo NODE %d: new payload from %d with alg_id %d and size %d ",
-								radio().id(), from, *alg_pl, *(alg_pl+1) );
+					debug().debug( "Debug::echo NODE %d: new payload from %d with alg_id %d and size %d ",
+							radio().id(), from, *alg_pl, *(alg_pl+1) );
 
-						debug().debug( " [");
-						for (uint8_t j = 1; j<= *(alg_pl + 1); j++) {
-							debug().debug( "%d ", *(alg_pl + j + 1) );
-						}
-						debug().debug( "]\n");
+					debug().debug( " [");
+					for (uint8_t j = 1; j<= *(alg_pl + 1); j++) {
+						debug().debug( "%d ", *(alg_pl + j + 1) );
+					}
+					debug().debug( "]\n");
 #endif
 
-						for (reg_alg_iterator_t it = registered_apps.begin(); it
-								!= registered_apps.end(); it++) {
-
-							if ((it->alg_id == *alg_pl)
-									&& (it->event_notifier_callback != 0)) {
-								if ((it->events_flag & (uint8_t) NEW_PAYLOAD)
-										== (uint8_t) NEW_PAYLOAD) {
-									it->event_notifier_callback(NEW_PAYLOAD,
-											from, *(alg_pl + 1), alg_pl + 2);
-								} else if (((it->events_flag
-										& (uint8_t) NEW_PAYLOAD_BIDI)
-										== (uint8_t) NEW_PAYLOAD_BIDI)
-										&& is_neighbor_bidi(from)) {
-									it->event_notifier_callback(
-											NEW_PAYLOAD_BIDI, from, *(alg_pl
-													+ 1), alg_pl + 2);
-								}
+					for (reg_alg_iterator_t it = registered_apps.begin(); it
+							!= registered_apps.end(); it++) {
+
+						if ((it->alg_id == *alg_pl)
+								&& (it->event_notifier_callback != 0)) {
+							if ((it->events_flag & (uint8_t) NEW_PAYLOAD)
+									== (uint8_t) NEW_PAYLOAD) {
+								it->event_notifier_callback(NEW_PAYLOAD,
+										from, *(alg_pl + 1), alg_pl + 2);
+							} else if (((it->events_flag
+									& (uint8_t) NEW_PAYLOAD_BIDI)
+									== (uint8_t) NEW_PAYLOAD_BIDI)
+									&& is_neighbor_bidi(from)) {
+								it->event_notifier_callback(
+										NEW_PAYLOAD_BIDI, from, *(alg_pl
+												+ 1), alg_pl + 2);
 							}
 						}
+					}
 
-						alg_pl += *(alg_pl + 1) + 2;
+					alg_pl += *(alg_pl + 1) + 2;
 
 #ifdef DEBUG_ECHO
 #ifdef ISENSE
-						debug().debug( "Debug::echo NODE %x has bidirectional communication with %x", radio().id(), from);
+					debug().debug( "Debug::echo NODE %x has bidirectional communication with %x", radio().id(), from);
 #else
-						debug().debug( "Debug::echo NODE %d has bidirectional communication with %d\n", radio().id(), from);
+					debug().debug( "Debug::echo NODE %d has bidirectional communication with %d\n", radio().id(), from);
 #endif
 #endif
-					}
-					break;
 				}
-
 			}
 		}
 
@@ -901,124 +938,114 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 #else
 	void received_beacon(node_id_t from, ExData ex) {
 #endif
-		// known is true if node from was contacted before
-		bool known = false;
-		iterator_t it = neighborhood.begin();
-		// iterate nearby nodes to see if from is known
-		for (; it != neighborhood.end(); ++it) {
-			// if known
-			if (it->id == from) {
+		neighbor_entry_t *it = find_neighbor(from);
 
-//				debug().debug( "Debug::echo::received_beacon::%d new neighbor %d  stability %d iLinkAssoc %d linkAssoc %d\n",
-//						radio().id(), from, get_nb_stability(from) , get_ilink_assoc(from), get_link_assoc(from));
+		if (it && it->active) {
 
-				it->total_beacons++;
+//			debug().debug( "Debug::echo::received_beacon::%d new neighbor %d  stability %d iLinkAssoc %d linkAssoc %d\n",
+//					radio().id(), from, get_nb_stability(from) , get_ilink_assoc(from), get_link_assoc(from));
 
-				if (!it->active) {
-					break;
-				}
+			it->total_beacons++;
 
 #ifdef ENABLE_LQI_THRESHOLDS
 #ifndef SHAWN
-				if (!it->stable) {
-					if ( ex.link_metric() > min_lqi_threshold ) {
-						return;
-					}
+			if (!it->stable) {
+				if ( ex.link_metric() > min_lqi_threshold ) {
+					return;
 				}
+			}
 #endif
 #endif
 
-				// set the latest beacon received to now
-				it->last_echo = clock().time();
-				// increase the beacons received so far by one
-				if (it->beacons_in_row != 255) {
-					it->beacons_in_row++;
-				}
-#ifndef SHAWN				
-				it->last_lqi = ex.link_metric();
+			// set the latest beacon received to now
+			it->last_echo = clock().time();
+			touch(*it);
+			// increase the beacons received so far by one
+			if (it->beacons_in_row != 255) {
+				set_link_assoc(*it, it->beacons_in_row + 1);
+			}
+#ifndef SHAWN
+			it->last_lqi = ex.link_metric();
 #endif
-				//                    it->timeout = it->last_echo + timeout_period;
-
-				// set as a known source node
-				known = true;
+			//                    it->timeout = it->last_echo + timeout_period;
 
 #ifdef ENABLE_STABILITY_THRESHOLDS
-//				debug().debug( "Debug::echo::received_beacon2::%d  stability %d threshold %d\n", radio().id(), it->stability, max_stability_threshold);
-				if (
-//					((6 * it->stability > 5 * node_stability)
+//			debug().debug( "Debug::echo::received_beacon2::%d  stability %d threshold %d\n", radio().id(), it->stability, max_stability_threshold);
+			if (
+//				((6 * it->stability > 5 * node_stability)
 //                                        && ( 4 * it->stability < 5 * node_stability))
 //                                        && (!it->stable)
-//                                        && 
-					it->stability > max_stability_threshold)
+//                                        &&
+				it->stability > max_stability_threshold)
 //                                        && (it->stability * ((255 + it->inverse_link_assoc)/510) > max_stability_threshold))
                                 {
-					it->stable = true;
-					notify_listeners(NEW_NB, from, 0, 0);
-				}
+				set_stable(*it, true);
+				notify_listeners(NEW_NB, from, 0, 0);
+			}
 #else
-				//if heard ECHO_TIMES_ACC_NEARBY or more beacons in a row add to listen_only
-				if ((it->beacons_in_row == ECHO_TIMES_ACC_NEARBY)
-						&& (!it->stable)) {
-					// add to the listen only vector
-					it->stable = true;
-					notify_listeners(NEW_NB, from, 0, 0);
+			//if heard ECHO_TIMES_ACC_NEARBY or more beacons in a row add to listen_only
+			if ((it->beacons_in_row == ECHO_TIMES_ACC_NEARBY)
+					&& (!it->stable)) {
+				// add to the listen only vector
+				set_stable(*it, true);
+				notify_listeners(NEW_NB, from, 0, 0);
 #ifdef DEBUG_ECHO
 #ifdef ISENSE_APP
-					debug().debug( "Debug::echo NODE %x can listen messages of %x", radio().id(), from);
+				debug().debug( "Debug::echo NODE %x can listen messages of %x", radio().id(), from);
 #else
-					debug().debug( "Debug::echo NODE %d can listen messages of %d\n", radio().id(), from);
-#endif
+				debug().debug( "Debug::echo NODE %d can listen messages of %d\n", radio().id(), from);
 #endif
-				}
 #endif
-				break;
 			}
+#endif
+			return;
 		}
 
-		// if not known so far add to the vector if space available
-		if (!known) {
+		// not known so far (or dropped before): (re)add to the neighborhood
 
 #ifdef ENABLE_LQI_THRESHOLDS
 #ifndef SHAWN
-			if ( ex.link_metric() > min_lqi_threshold ) {
-				return;
-			}
+		if ( ex.link_metric() > min_lqi_threshold ) {
+			if (it)
+				it->total_beacons++;
+			return;
+		}
 #endif
 #endif
-			if (neighborhood.size() < neighborhood.max_size()) {
-
-				if (it == neighborhood.end()) {
-					// create a new struct entry for the vector
-					neighbor_entry_t new_nb_entry;
-					new_nb_entry.id = from;
-					new_nb_entry.first_beacon = clock().time();
-					new_nb_entry.last_echo = clock().time();
-					//                    new_nb_entry.timeout = new_nb_entry.last_echo + timeout_period;
-					new_nb_entry.beacons_in_row = 1;
-					new_nb_entry.stability = 0;
-					new_nb_entry.inverse_link_assoc = 0;
-					new_nb_entry.total_beacons = 1;
-					new_nb_entry.active = true;
-					new_nb_entry.stable = false;
-					new_nb_entry.bidi = false;
-
-					//                    a.uptime = ((double)a.time_known-(double)a.beacons_missed)/(double)a.time_known;
-					//add the struct to the vector
-					neighborhood.push_back(new_nb_entry);
-				} else {
-					it->active = true;
-					it->last_echo = clock().time();
-					it->beacons_in_row = 1;
-					it->stable = false;
-					it->bidi = false;
-					it->total_beacons++;
-				}
-
-//debug().debug("Added new neighbor %d %d\n",radio().id(),from);
+		if (!it) {
+			if (neighborhood.size() == neighborhood.max_size())
+				return;
 
-			}
+			// create a new struct entry for the vector
+			neighbor_entry_t new_nb_entry;
+			new_nb_entry.id = from;
+			new_nb_entry.first_beacon = clock().time();
+			new_nb_entry.beacons_in_row = 0;
+			new_nb_entry.stability = 0;
+			new_nb_entry.period = 0;
+			new_nb_entry.inverse_link_assoc = 0;
+			new_nb_entry.total_beacons = 0;
+			new_nb_entry.active = false;
+			new_nb_entry.stable = false;
+			new_nb_entry.bidi = false;
+
+			//                    a.uptime = ((double)a.time_known-(double)a.beacons_missed)/(double)a.time_known;
+			//add the struct to the vector
+			neighborhood.push_back(new_nb_entry);
+			it = &neighborhood.back();
+			index_insert(from, neighborhood.size() - 1);
 		}
 
+		it->last_echo = clock().time();
+		//                    new_nb_entry.timeout = new_nb_entry.last_echo + timeout_period;
+		set_active(*it, true);
+		set_link_assoc(*it, 1);
+		set_stable(*it, false);
+		set_bidi(*it, false);
+		it->total_beacons++;
+		neighborhood_changed();
+
+//debug().debug("Added new neighbor %d %d\n",radio().id(),from);
 	};
 
 	/**
@@ -1108,103 +1135,64 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 			notify_listeners(NB_READY, 0, 0, 0);
 
 		}
-		// iterate the nearby_nodes vector for the missing nodes
-		for (iterator_t
-				it = neighborhood.begin();
-				it != neighborhood.end();
-				++it) {
-
-			if (!it->active)
-				continue;
+		// Active neighbors are ordered by their last beacon: only the
+		// oldest ones can have missed beacons, stop at the first that did not
+		uint16_t slot = oldest_;
+		while (slot != NO_SLOT) {
+			neighbor_entry_t &nb = neighborhood[slot];
+			slot = newer_[slot];
 
-			uint32_t last_echo_millisec = clock().seconds(it->last_echo) * 1000
-					+ (uint32_t) clock().milliseconds(it->last_echo);
+			uint32_t last_echo_millisec = clock().seconds(nb.last_echo) * 1000
+					+ (uint32_t) clock().milliseconds(nb.last_echo);
 
 			//               debug().debug( "Debug::echo NODE %d cleanup %d %d\n",
 			//                       radio().id(),
 			//                       last_echo_millisec ,
 			//                       current_millisec );
 
-			if ((last_echo_millisec + beacon_period + 40) < current_millisec) {
-				it->beacons_in_row = 0;
+			// (no neighbor beacons faster than beacon_period)
+			if ((last_echo_millisec + beacon_period + 40) >= current_millisec) {
+				break;
 			}
+			if ((last_echo_millisec + period_of(nb) + 40) < current_millisec) {
+				set_link_assoc(nb, 0);
+			}
+
 			//TODO: Add a delta to last_echo_millisec
 			// if last echo was too long before
 			if ((last_echo_millisec + (uint32_t) timeout_period)
 					< current_millisec) {
 
 				// remove the node from the neighborhood
-				//                    remove_from_neighborhood(it);
-				//                    neighborhood.erase(it);
-				if (it->stable) {
-//					debug().debug( "::timout NODE %x dropped from neighbors %x", it->id, radio().id(),it->stability);
-					notify_listeners(DROPPED_NB, it->id, 0, 0);
+				if (nb.stable) {
+//					debug().debug( "::timout NODE %x dropped from neighbors %x", nb.id, radio().id(),nb.stability);
+					notify_listeners(DROPPED_NB, nb.id, 0, 0);
 				}
-				it->active = false;
-				it->stable = false;
-				it->bidi = false;
-				it->beacons_in_row = 0;
-				it->stability = 0;
+				set_active(nb, false);
+				set_stable(nb, false);
+				set_bidi(nb, false);
+				nb.stability = 0;
 
 #ifdef DEBUG_ECHO
 #ifdef ISENSE
-				debug().debug( "Debug::echo NODE %x dropped from neighbors %x", radio().id(), it->id);
+				debug().debug( "Debug::echo NODE %x dropped from neighbors %x", radio().id(), nb.id);
 #else
-				debug().debug( "Debug::echo NODE %d droped from neighbors %d\n", radio().id(), it->id);
+				debug().debug( "Debug::echo NODE %d droped from neighbors %d\n", radio().id(), nb.id);
 #endif
 #endif
-				cleanup_nearby();
-				break;
 			}
-/*
-#ifdef ENABLE_STABILITY_THRESHOLDSX
-			else if (( it->stability < min_stability_threshold) && (it->stable)) {
-//				debug().debug( "Debug::echo NODE %d dpd %d \n", radio().id(), it->id);
-
-//				debug().debug( "::ss NODE %x dropped from neighbors %x", it->id, radio().id(),it->stability);
-				notify_listeners(DROPPED_NB, it->id, 0, 0);
-//                                it->beacons_in_row = 0;
-				it->active = false;
-				it->stable = false;
-				it->bidi = false;
-				cleanup_nearby();
-				break;
-			}
-#endif
-*/
 		}
 
 		/**
-		 * Calculate the sum of all the link assoc's
+		 * Calculate the average of all the link assoc's
 		 */
-		uint16_t new_node_stability = 0;
-		uint16_t nodes_counted = 0;
-		for (iterator_t
-				it = neighborhood.begin();
-				it != neighborhood.end();
-				++it) {
 #ifdef CALCULATE_INVERSE_STABILITY
-			if (it->inverse_link_assoc > 0) {
-				new_node_stability += it->inverse_link_assoc;
-				nodes_counted++;
-			}
-                        /*else if (it->inverse_link_assoc > 1) {
-				nodes_counted++;
-                        }*/
-
-//			debug().debug( "Debug::echo %d Adding [%d] with iAssoc %d\n", radio().id(), it->id, it->inverse_link_assoc);
+		uint32_t new_node_stability = ilink_sum_;
+		uint16_t nodes_counted = ilink_cnt_;
 #else
-			if ( it->beacons_in_row > 0 ) {
-				new_node_stability += it->beacons_in_row;
-				nodes_counted++;
-			}
-//			debug().debug( "Debug::echo %d Adding [%d] with Assoc %d\n", radio().id(), it->id, it->beacons_in_row);
+		uint32_t new_node_stability = assoc_sum_;
+		uint16_t nodes_counted = assoc_cnt_;
 #endif
-		}
-
-		/**
-		 * Calculate the sum of all the link assoc's
-		 */
 		if (nodes_counted != 0) {
 			new_node_stability = new_node_stability / nodes_counted;
 		}
@@ -1248,6 +1236,10 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 	void notify_listeners(uint8_t event, node_id_t from, uint8_t len,
 			uint8_t *data) {
 
+		if (event & (NEW_NB | DROPPED_NB | NEW_NB_BIDI | LOST_NB_BIDI)) {
+			neighborhood_changed();
+		}
+
 		for (reg_alg_iterator_t ait = registered_apps.begin(); ait
 				!= registered_apps.end(); ++ait) {
 
@@ -1281,18 +1273,14 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 	void add_list_to_beacon(EchoMsg_t * msg) {
 
 		// add only the stable neighbor nodes to the array
-		for (iterator_t
-				it = neighborhood.begin();
-				it != neighborhood.end();
-				++it) {
+		for (uint16_t slot = newest_; slot != NO_SLOT; slot = older_[slot]) {
+			neighbor_entry_t &nb = neighborhood[slot];
 #ifdef CALCULATE_INVERSE_STABILITY
-			if (it->active) {
-				msg->add_nb_entry(it->id);
-				msg->add(it->beacons_in_row);
-			}
+			msg->add_nb_entry(nb.id);
+			msg->add(nb.beacons_in_row);
 #else
-			if (it->stable) {
-				msg->add_nb_entry(it->id);
+			if (nb.stable) {
+				msg->add_nb_entry(nb.id);
 			}
 #endif
 		}
@@ -1323,6 +1311,196 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 		//
 	}
 
+	/**
+	 * Picks the interval to the next beacon: doubled while the
+	 * neighborhood is consistent (unchanged since the last beacon, and
+	 * all active neighbors stable, which needs beacons in a row), else
+	 * beacon_period.
+	 */
+	void update_beacon_period() {
+		uint32_t max = max_beacon_period;
+		if (max > timeout_period / 3u)
+			max = timeout_period / 3u;
+
+		if (nb_changed || active_cnt_ != stable_cnt_ || max <= beacon_period) {
+			cur_beacon_period = beacon_period;
+		} else {
+			uint32_t next = 2 * (uint32_t) cur_beacon_period;
+			cur_beacon_period = (uint16_t) (next > max ? max : next);
+		}
+		nb_changed = false;
+	}
+
+	/**
+	 * Resets the beacon interval. If a long interval is running, the next
+	 * beacon is rescheduled after beacon_period; the pending timer is
+	 * ignored once it fires, as beacon_round changed.
+	 */
+	void neighborhood_changed() {
+		nb_changed = true;
+		if (cur_beacon_period > beacon_period && status() == SEARCHING) {
+			cur_beacon_period = beacon_period;
+			beacon_round++;
+			timer().template set_timer<self_t, &self_t::say_hello> (
+					beacon_period, this, (void*) (long) beacon_round);
+		}
+	}
+
+	/**
+	 * The interval to the next beacon is sent as a piggybacked payload
+	 * with the id reserved for echo itself.
+	 */
+	void add_period_payload(EchoMsg_t * msg) {
+		uint8_t id = RESERVED;
+		uint8_t len = sizeof(uint16_t);
+		block_data_t buf[sizeof(uint16_t)];
+		write<OsModel, block_data_t, uint16_t> (buf, cur_beacon_period);
+		msg->append_payload(id, buf, len);
+	}
+
+	/**
+	 * The interval to the next beacon of the sender of msg, 0 if it
+	 * does not adapt it.
+	 */
+	uint16_t advertised_period(EchoMsg_t * msg) {
+		uint8_t * pl = msg->payload() + msg->nb_list_size();
+		for (int i = 0; i < msg->get_pg_payloads_num(); i++) {
+			if (*pl == RESERVED && *(pl + 1) == sizeof(uint16_t))
+				return read<OsModel, block_data_t, uint16_t> (pl + 2);
+			pl += *(pl + 1) + 2;
+		}
+		return 0;
+	}
+
+	uint16_t period_of(neighbor_entry_t &nb) {
+		return nb.period > beacon_period ? nb.period : beacon_period;
+	}
+
+	/**
+	 * Looks up a neighbor in the index, 0 if it is not in the
+	 * neighborhood.
+	 */
+	neighbor_entry_t* find_neighbor(node_id_t id) {
+		uint16_t h = hash(id);
+		while (index_[h] != NO_SLOT) {
+			if (neighborhood[index_[h]].id == id)
+				return &neighborhood[index_[h]];
+			h = (h + 1) % ECHO_INDEX_SIZE;
+		}
+		return 0;
+	}
+
+	static uint16_t hash(node_id_t id) {
+		return (uint16_t) (((uint32_t) id * 2654435761UL) % ECHO_INDEX_SIZE);
+	}
+
+	void index_insert(node_id_t id, uint16_t slot) {
+		uint16_t h = hash(id);
+		while (index_[h] != NO_SLOT)
+			h = (h + 1) % ECHO_INDEX_SIZE;
+		index_[h] = slot;
+	}
+
+	uint16_t slot_of(neighbor_entry_t &nb) {
+		return (uint16_t) (&nb - &neighborhood[0]);
+	}
+
+	/**
+	 * Active neighbors are kept in a list ordered by the time of their
+	 * last beacon, oldest first.
+	 */
+	void unlink(uint16_t slot) {
+		if (older_[slot] != NO_SLOT)
+			newer_[older_[slot]] = newer_[slot];
+		else
+			oldest_ = newer_[slot];
+		if (newer_[slot] != NO_SLOT)
+			older_[newer_[slot]] = older_[slot];
+		else
+			newest_ = older_[slot];
+	}
+
+	void append_newest(uint16_t slot) {
+		older_[slot] = newest_;
+		newer_[slot] = NO_SLOT;
+		if (newest_ != NO_SLOT)
+			newer_[newest_] = slot;
+		else
+			oldest_ = slot;
+		newest_ = slot;
+	}
+
+	/**
+	 * Moves an active neighbor to the end of the list after a beacon.
+	 */
+	void touch(neighbor_entry_t &nb) {
+		uint16_t slot = slot_of(nb);
+		if (slot == newest_)
+			return;
+		unlink(slot);
+		append_newest(slot);
+	}
+
+	// The setters below keep the counters and sums in line with the
+	// flags and associations of the entries.
+	void set_active(neighbor_entry_t &nb, bool active) {
+		if (nb.active == active)
+			return;
+		nb.active = active;
+		if (active) {
+			active_cnt_++;
+			append_newest(slot_of(nb));
+		} else {
+			active_cnt_--;
+			unlink(slot_of(nb));
+			set_link_assoc(nb, 0);
+		}
+	}
+
+	void set_stable(neighbor_entry_t &nb, bool stable) {
+		if (nb.stable == stable)
+			return;
+		nb.stable = stable;
+		if (stable)
+			stable_cnt_++;
+		else
+			stable_cnt_--;
+	}
+
+	void set_bidi(neighbor_entry_t &nb, bool bidi) {
+		if (nb.bidi == bidi)
+			return;
+		nb.bidi = bidi;
+		if (bidi)
+			bidi_cnt_++;
+		else
+			bidi_cnt_--;
+	}
+
+	void set_link_assoc(neighbor_entry_t &nb, uint8_t assoc) {
+		if (nb.beacons_in_row > 0) {
+			assoc_sum_ -= nb.beacons_in_row;
+			assoc_cnt_--;
+		}
+		nb.beacons_in_row = assoc;
+		if (assoc > 0) {
+			assoc_sum_ += assoc;
+			assoc_cnt_++;
+		}
+	}
+
+	void set_ilink_assoc(neighbor_entry_t &nb, uint8_t assoc) {
+		if (nb.inverse_link_assoc > 0) {
+			ilink_sum_ -= nb.inverse_link_assoc;
+			ilink_cnt_--;
+		}
+		nb.inverse_link_assoc = assoc;
+		if (assoc > 0) {
+			ilink_sum_ += assoc;
+			ilink_cnt_++;
+		}
+	}
+
 	enum NODE_ECHO_STATUS {
 		SEARCHING = 1, WAITING = 0
 	};
@@ -1372,6 +1550,22 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 	 * max_lqi_threshold.
 	 */
 	uint16_t max_stability_threshold;
+	/**
+	 * Upper bound of the adaptive beacon interval, 0 if disabled.
+	 */
+	uint16_t max_beacon_period;
+	/**
+	 * Interval to the next beacon.
+	 */
+	uint16_t cur_beacon_period;
+	/**
+	 * Tags the beacon timer, timers with an older tag are ignored.
+	 */
+	uint8_t beacon_round;
+	/**
+	 * The neighborhood changed since the last beacon.
+	 */
+	bool nb_changed;
 
 
 	struct messages_statistics {
@@ -1379,6 +1573,30 @@ debug().debug("TEST: id: %d stability: %d size of list of neighbors: %d\n",read<
 		uint32_t echo_msg_size; /*!< The total size of the echo messages that were send */
 	} msgs_stats;
 
+	enum {
+		ECHO_INDEX_SIZE = 2 * ECHO_MAX_NODES, NO_SLOT = 0xffff
+	};
+
+	/**
+	 * Open addressing index from node id to position in neighborhood.
+	 */
+	uint16_t index_[ECHO_INDEX_SIZE];
+	/**
+	 * Links of the list of active neighbors, by position in neighborhood.
+	 */
+	uint16_t older_[ECHO_MAX_NODES];
+	uint16_t newer_[ECHO_MAX_NODES];
+	uint16_t oldest_;
+	uint16_t newest_;
+
+	uint16_t active_cnt_;
+	uint16_t stable_cnt_;
+	uint16_t bidi_cnt_;
+	uint32_t assoc_sum_;
+	uint16_t assoc_cnt_;
+	uint32_t ilink_sum_;
+	uint16_t ilink_cnt_;
+
 	Radio * radio_;
 	Clock * clock_;
 	Timer * timer_;
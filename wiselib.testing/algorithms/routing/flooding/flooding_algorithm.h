@@ -20,13 +20,44 @@
 #define __FLOODING_ALGORITHM_H__
 
 #include "util/base_classes/routing_base.h"
+#include "util/pstl/packet_buffer.h"
 #include "flooding_message.h"
+#include "flooding_duplicate_cache.h"
+#include "flooding_suppression.h"
 #include <string.h>
 
+#ifndef FLOODING_DUPLICATE_CACHE_SIZE
+#define FLOODING_DUPLICATE_CACHE_SIZE 32
+#endif
+
+/// Time in ms a flood is remembered (needs the timer passed to init())
+#ifndef FLOODING_DUPLICATE_CACHE_TIMEOUT
+#define FLOODING_DUPLICATE_CACHE_TIMEOUT 4000
+#endif
+
+/// Number of rebroadcasts that can wait for their assessment delay at once
+#ifndef FLOODING_MAX_PENDING
+#define FLOODING_MAX_PENDING 2
+#endif
+
 namespace wiselib
 {
 
    /** Flooding Algorithm for the Wiselib.
+    *
+    *  Duplicates are detected by (source, sequence number) in a
+    *  FloodingDuplicateCache that remembers every flood for
+    *  FLOODING_DUPLICATE_CACHE_TIMEOUT ms. Floods arriving while all
+    *  FLOODING_DUPLICATE_CACHE_SIZE entries are in use are dropped.
+    *  Without a timer (see init()) floods cannot age; the oldest one is
+    *  then forgotten when the cache is full, which is only safe as long as
+    *  fewer floods circulate at the same time. NodeidIntMap_P is not used
+    *  anymore, it is kept so that existing instantiations remain valid.
+    *
+    *  By default every message is rebroadcast once; see
+    *  set_rebroadcast_probability() and set_rebroadcast_counter() for
+    *  suppression of redundant rebroadcasts. The counter-based mode needs
+    *  the timer passed to init().
     * 
     *  \ingroup routing_concept
     *  \ingroup radio_concept
@@ -36,7 +67,8 @@ namespace wiselib
    template<typename OsModel_P,
             typename NodeidIntMap_P,
             typename Radio_P = typename OsModel_P::Radio,
-            typename Debug_P = typename OsModel_P::Debug>
+            typename Debug_P = typename OsModel_P::Debug,
+            typename Timer_P = typename OsModel_P::Timer>
    class FloodingAlgorithm
       : public RoutingBase<OsModel_P, Radio_P>
    {
@@ -44,11 +76,11 @@ namespace wiselib
       typedef OsModel_P OsModel;
       typedef Radio_P Radio;
       typedef Debug_P Debug;
+      typedef Timer_P Timer;
 
       typedef NodeidIntMap_P MapType;
-      typedef typename MapType::iterator MapTypeIterator;
 
-      typedef FloodingAlgorithm<OsModel, MapType, Radio, Debug> self_type;
+      typedef FloodingAlgorithm<OsModel, MapType, Radio, Debug, Timer> self_type;
       typedef self_type* self_pointer_t;
 
       typedef typename Radio::node_id_t node_id_t;
@@ -57,6 +89,16 @@ namespace wiselib
       typedef typename Radio::message_id_t message_id_t;
 
       typedef FloodingMessage<OsModel, Radio> Message;
+      typedef PacketBuffer<OsModel, size_t, block_data_t> packet_buffer_t;
+      typedef FloodingDuplicateCache<OsModel, node_id_t, typename Message::seq_nr_t,
+                                     FLOODING_DUPLICATE_CACHE_SIZE> duplicate_cache_t;
+      typedef FloodingSuppression<OsModel> suppression_t;
+      // --------------------------------------------------------------------
+      enum
+      {
+         /// The cache ages in steps of CACHE_TICK ms
+         CACHE_TICK = FLOODING_DUPLICATE_CACHE_TIMEOUT / duplicate_cache_t::LIFETIME_TICKS
+      };
       // --------------------------------------------------------------------
       enum ErrorCodes
       {
@@ -76,6 +118,11 @@ namespace wiselib
          MAX_MESSAGE_LENGTH = Radio_P::MAX_MESSAGE_LENGTH - Message::PAYLOAD_POS  ///< Maximal number of bytes in payload
       };
       // --------------------------------------------------------------------
+      enum
+      {
+         HEADER_SIZE = Message::PAYLOAD_POS + sizeof(size_t)
+      };
+      // --------------------------------------------------------------------
       ///@name Construction / Destruction
       ///@{
       FloodingAlgorithm();
@@ -93,9 +140,16 @@ namespace wiselib
       /**
        */
       int send( node_id_t receiver, size_t len, block_data_t *data );
+      /** Prepends the flooding header in place and passes the buffer to
+       *  the radio below.
+       */
+      int send_buffer( node_id_t receiver, packet_buffer_t& buffer );
       /**
        */
       void receive( node_id_t from, size_t len, block_data_t *data );
+      /**
+       */
+      void receive_buffer( node_id_t from, packet_buffer_t& buffer );
       /**
        */
       typename Radio::node_id_t id()
@@ -105,6 +159,15 @@ namespace wiselib
       int init( Radio& radio, Debug& debug )
       {
          radio_ = &radio;
+         timer_ = 0;
+         debug_ = &debug;
+         return SUCCESS;
+      }
+
+      int init( Radio& radio, Timer& timer, Debug& debug )
+      {
+         radio_ = &radio;
+         timer_ = &timer;
          debug_ = &debug;
          return SUCCESS;
       }
@@ -112,6 +175,7 @@ namespace wiselib
       int init()
       {
          seq_nr_ = FLOODING_INIT_SEQ_NR;
+         seen_.clear();
          return enable_radio();
       }
 
@@ -120,14 +184,41 @@ namespace wiselib
          return disable_radio();
       }
 
+      ///@name Rebroadcast Suppression
+      ///@{
+      /** Every node forwards every message once (default).
+       */
+      void set_rebroadcast_always()
+      { suppression_.set_always(); }
+      /** Gossiping: a message is forwarded with the given probability.
+       */
+      void set_rebroadcast_probability( uint8_t percent )
+      { suppression_.set_probabilistic( percent ); }
+      /** A message is forwarded after a random delay of up to max_delay ms,
+       *  unless threshold copies of it have been heard meanwhile. Without
+       *  a timer (see init()) messages are forwarded immediately.
+       */
+      void set_rebroadcast_counter( uint8_t threshold, uint16_t max_delay )
+      { suppression_.set_counter_based( threshold, max_delay ); }
+      ///@}
+
    private:
       Radio& radio()
       { return *radio_; }
 
+      Timer& timer()
+      { return *timer_; }
+
+      void defer_rebroadcast( node_id_t source, typename Message::seq_nr_t seq,
+                              packet_buffer_t& buffer );
+      void timer_rebroadcast( void *userdata );
+      void timer_expire( void *userdata );
+
       Debug& debug()
       { return *debug_; }
 
       typename Radio::self_pointer_t radio_;
+      typename Timer::self_pointer_t timer_;
       typename Debug::self_pointer_t debug_;
 
       enum MessageIds
@@ -140,10 +231,24 @@ namespace wiselib
          FLOODING_INIT_SEQ_NR = 0
       };
 
+      /// Copy of a message waiting for its assessment delay
+      struct PendingRebroadcast
+      {
+         bool used;
+         node_id_t source;
+         typename Message::seq_nr_t seq;
+         size_t len;
+         block_data_t data[Radio::MAX_MESSAGE_LENGTH];
+      };
+
       int callback_id_;
       uint16_t seq_nr_;
+      bool enabled_;
+      bool aging_;
 
-      MapType seq_map_;
+      duplicate_cache_t seen_;
+      suppression_t suppression_;
+      PendingRebroadcast pending_[FLOODING_MAX_PENDING];
    };
    // -----------------------------------------------------------------------
    // -----------------------------------------------------------------------
@@ -151,18 +256,28 @@ namespace wiselib
    template<typename OsModel_P,
             typename RoutingTable_P,
             typename Radio_P,
-            typename Debug_P>
-   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
+            typename Debug_P,
+            typename Timer_P>
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
    FloodingAlgorithm()
-      : callback_id_ ( 0 ),
-         seq_nr_     ( FLOODING_INIT_SEQ_NR )
-   {}
+      : radio_       ( 0 ),
+         timer_      ( 0 ),
+         debug_      ( 0 ),
+         callback_id_ ( 0 ),
+         seq_nr_     ( FLOODING_INIT_SEQ_NR ),
+         enabled_    ( false ),
+         aging_      ( false )
+   {
+      for ( int i = 0; i < FLOODING_MAX_PENDING; i++ )
+         pending_[i].used = false;
+   }
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
             typename RoutingTable_P,
             typename Radio_P,
-            typename Debug_P>
-   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
+            typename Debug_P,
+            typename Timer_P>
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
    ~FloodingAlgorithm()
    {
 #ifdef ROUTING_FLOODING_DEBUG
@@ -173,9 +288,10 @@ namespace wiselib
    template<typename OsModel_P,
             typename RoutingTable_P,
             typename Radio_P,
-            typename Debug_P>
+            typename Debug_P,
+            typename Timer_P>
    int
-   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
    enable_radio( void )
    {
 #ifdef ROUTING_FLOODING_DEBUG
@@ -183,16 +299,27 @@ namespace wiselib
 #endif
 
       radio().enable_radio();
+      // Neighbors must not take the same random decisions
+      suppression_.seed( radio().id() + 1 );
       callback_id_ = radio().template reg_recv_callback<self_type, &self_type::receive>( this );
+      enabled_ = true;
+      // A timer chain may still be running from before disable_radio()
+      if ( timer_ && !aging_ )
+      {
+         aging_ = true;
+         timer().template set_timer<self_type, &self_type::timer_expire>(
+            CACHE_TICK, this, 0 );
+      }
       return SUCCESS;
    }
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
             typename RoutingTable_P,
             typename Radio_P,
-            typename Debug_P>
+            typename Debug_P,
+            typename Timer_P>
    int
-   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
    disable_radio( void )
    {
 #ifdef ROUTING_FLOODING_DEBUG
@@ -200,28 +327,65 @@ namespace wiselib
 #endif
       radio().unreg_recv_callback( callback_id_ );
       radio().disable_radio();
+      enabled_ = false;
+      for ( int i = 0; i < FLOODING_MAX_PENDING; i++ )
+         pending_[i].used = false;
       return SUCCESS;
    }
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
             typename RoutingTable_P,
             typename Radio_P,
-            typename Debug_P>
+            typename Debug_P,
+            typename Timer_P>
    int
-   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
    send( node_id_t destination, size_t len, block_data_t *data )
+   {
+      StaticPacketBuffer<OsModel, Radio::MAX_MESSAGE_LENGTH + PACKET_BUFFER_HEADROOM + HEADER_SIZE,
+                         size_t, block_data_t> buffer( PACKET_BUFFER_HEADROOM + HEADER_SIZE );
+      if ( !buffer.append( len, data ) )
+         return ERR_UNSPEC;
+      return send_buffer( destination, buffer );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Debug_P,
+            typename Timer_P>
+   int
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
+   send_buffer( node_id_t destination, packet_buffer_t& buffer )
    {
 #ifdef ROUTING_FLOODING_DEBUG
       debug().debug( "FloodingAlgorithm: Send at %d\n", radio_->id() );
 #endif
+      if ( buffer.size() > (size_t)MAX_MESSAGE_LENGTH - sizeof(size_t) )
+         return ERR_UNSPEC;
+
+      // No room for the header (e.g., received data): copy once, leaving
+      // room for this header and those of the layers below
+      if ( buffer.headroom() < HEADER_SIZE )
+      {
+         StaticPacketBuffer<OsModel, Radio::MAX_MESSAGE_LENGTH + PACKET_BUFFER_HEADROOM + HEADER_SIZE,
+                            size_t, block_data_t> copy( PACKET_BUFFER_HEADROOM + HEADER_SIZE );
+         if ( !copy.append( buffer.size(), buffer.data() ) )
+            return ERR_UNSPEC;
+         return send_buffer( destination, copy );
+      }
 
-      Message message;
-      message.set_msg_id( FLOODING_MESSAGE_ID );
-      message.set_node_id( radio().id() );
-      message.set_seq_nr( seq_nr_ );
-      message.set_payload( len, data );
+      message_id_t msg_id = FLOODING_MESSAGE_ID;
+      node_id_t id = radio().id();
+      size_t len = buffer.size();
+      block_data_t *header = buffer.push( HEADER_SIZE );
+      write<OsModel, block_data_t, message_id_t>( header, msg_id );
+      write<OsModel, block_data_t, node_id_t>( header + Message::NODE_ID_POS, id );
+      write<OsModel, block_data_t, uint16_t>( header + Message::SEQ_NR_POS, seq_nr_ );
+      write<OsModel, block_data_t, size_t>( header + Message::PAYLOAD_POS, len );
 
-      radio().send( radio().BROADCAST_ADDRESS, message.buffer_size(), (block_data_t*)&message );
+      send_packet_buffer( radio(), radio().BROADCAST_ADDRESS, buffer );
+      buffer.pull( HEADER_SIZE );
 
       seq_nr_++;
       return SUCCESS;
@@ -230,12 +394,26 @@ namespace wiselib
    template<typename OsModel_P,
             typename RoutingTable_P,
             typename Radio_P,
-            typename Debug_P>
+            typename Debug_P,
+            typename Timer_P>
    void
-   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
    receive( node_id_t from, size_t len, block_data_t *data )
    {
-
+      packet_buffer_t buffer;
+      buffer.wrap( data, len );
+      receive_buffer( from, buffer );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Debug_P,
+            typename Timer_P>
+   void
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
+   receive_buffer( node_id_t from, packet_buffer_t& buffer )
+   {
       if ( from == radio().id() )
       {
 #ifdef ROUTING_FLOODING_DEBUG
@@ -245,11 +423,14 @@ namespace wiselib
       }
 
 
-      message_id_t msg_id = read<OsModel, block_data_t, message_id_t>( data );
+      if ( buffer.size() < HEADER_SIZE )
+         return;
+
+      message_id_t msg_id = read<OsModel, block_data_t, message_id_t>( buffer.data() );
 
       if ( msg_id == FLOODING_MESSAGE_ID )
       {
-         Message *message = (Message *)data;
+         Message *message = (Message *)buffer.data();
          if ( message->node_id() == radio().id() )
          {
 #ifdef ROUTING_FLOODING_DEBUG
@@ -258,33 +439,37 @@ namespace wiselib
             return;
          }
 
-         // Has message already been received? If so, return.
-         // Of course, there is a simplification with the check for seq_nr
-         // just to be greater than the known one---but this can be done for
-         // simplicity reasons (code-space!!)
-         MapTypeIterator it = seq_map_.find( message->node_id() );
-         if ( it == seq_map_.end() ||
-               ( it != seq_map_.end() &&
-                  ( message->seq_nr() > it->second ||
-                  ( message->seq_nr() == FLOODING_INIT_SEQ_NR && it->second >= 2))) )
+         // Has message already been received? If so, only count the copy
+         // (used by counter-based suppression) and return.
+         node_id_t source = message->node_id();
+         typename Message::seq_nr_t seq = message->seq_nr();
+         if ( !timer_ && seen_.full() && !seen_.contains( source, seq ) )
+            seen_.expire_oldest();
+         if ( seen_.insert( source, seq ) )
          {
-            // Update sequence number, and forward the message to neighbors.
-            seq_map_[message->node_id()] = message->seq_nr();
-            radio().send( radio().BROADCAST_ADDRESS, len, data );
-
 #ifdef ROUTING_FLOODING_DEBUG
-            debug().debug( "FloodingAlgorithm: receive at %d from %d with seqnr %d (here is %d)\n",
-                           radio_->id(), message->node_id(), message->seq_nr(), seq_map_[message->node_id()] );
+            debug().debug( "FloodingAlgorithm: receive at %d from %d with seqnr %d\n",
+                           radio_->id(), source, seq );
 #endif
+            if ( suppression_.deferred() && timer_ )
+               defer_rebroadcast( source, seq, buffer );
+            else if ( suppression_.forward() )
+               send_packet_buffer( radio(), radio().BROADCAST_ADDRESS, buffer );
 
-            // Pass message to each registered receiver.
-            notify_receivers( message->node_id(), message->payload_size(), message->payload() );
+            // Pass message to each registered receiver, without copying.
+            size_t payload_size = message->payload_size();
+            buffer.pull( HEADER_SIZE );
+            if ( payload_size <= buffer.size() )
+            {
+               buffer.trim( payload_size );
+               this->notify_receivers( source, buffer );
+            }
          }
          else
          {
 #ifdef ROUTING_FLOODING_DEBUG
-   debug().debug( "FloodingAlgorithm ERROR: sequence number already known at %d (%d <= %d)\n",
-                     radio_->id(), message->seq_nr(), seq_map_[message->node_id()]  );
+   debug().debug( "FloodingAlgorithm ERROR: message already known at %d (%d, %d)\n",
+                     radio_->id(), source, seq );
 #endif
          }
       }
@@ -295,6 +480,84 @@ namespace wiselib
 #endif
       }
    }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Debug_P,
+            typename Timer_P>
+   void
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
+   defer_rebroadcast( node_id_t source, typename Message::seq_nr_t seq,
+                      packet_buffer_t& buffer )
+   {
+      for ( int i = 0; i < FLOODING_MAX_PENDING; i++ )
+      {
+         PendingRebroadcast& p = pending_[i];
+         if ( p.used )
+            continue;
+
+         p.used = true;
+         p.source = source;
+         p.seq = seq;
+         p.len = buffer.size();
+         memcpy( p.data, buffer.data(), p.len );
+         timer().template set_timer<self_type, &self_type::timer_rebroadcast>(
+            suppression_.assessment_delay(), this, (void*)(long)i );
+         return;
+      }
+
+      // No room to wait: forward right away rather than dropping the flood
+      send_packet_buffer( radio(), radio().BROADCAST_ADDRESS, buffer );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Debug_P,
+            typename Timer_P>
+   void
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
+   timer_rebroadcast( void *userdata )
+   {
+      PendingRebroadcast& p = pending_[(long)userdata];
+      if ( !p.used )
+         return;
+      p.used = false;
+
+      // Expired from the cache (delay longer than the timeout): forward
+      uint8_t copies = seen_.copies( p.source, p.seq );
+      if ( copies && suppression_.suppressed( copies ) )
+      {
+#ifdef ROUTING_FLOODING_DEBUG
+         debug().debug( "FloodingAlgorithm: suppress (%d, %d) at %d after %d copies\n",
+                        p.source, p.seq, radio_->id(), copies );
+#endif
+         return;
+      }
+
+      radio().send( radio().BROADCAST_ADDRESS, p.len, p.data );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Debug_P,
+            typename Timer_P>
+   void
+   FloodingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P, Timer_P>::
+   timer_expire( void *userdata )
+   {
+      if ( !enabled_ )
+      {
+         aging_ = false;
+         return;
+      }
+
+      seen_.tick();
+      timer().template set_timer<self_type, &self_type::timer_expire>(
+         CACHE_TICK, this, 0 );
+   }
 
 }
 #endif
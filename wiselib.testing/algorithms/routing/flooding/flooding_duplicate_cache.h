@@ -0,0 +1,172 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef __FLOODING_DUPLICATE_CACHE_H__
+#define __FLOODING_DUPLICATE_CACHE_H__
+
+namespace wiselib
+{
+
+   /** \brief Duplicate detection for flooding protocols.
+    *
+    *  Remembers (source, sequence number) pairs for a fixed time window:
+    *  the owner calls tick() periodically, and an entry expires LIFETIME
+    *  ticks after it was inserted. Entries are never evicted because newer
+    *  floods arrive. If the cache is full of live entries, a new message is
+    *  reported as known, so it is neither delivered nor forwarded; dropping
+    *  a flood is better than accepting a copy of a message that was already
+    *  forwarded, which leads to a broadcast storm. SIZE therefore has to
+    *  cover the floods a node sees within the window.
+    *
+    *  All entries have the same lifetime, so they are kept in a ring in
+    *  insertion order and expire from its tail. Owners without a timer can
+    *  make room with expire_oldest() instead, which turns the cache into a
+    *  window over the last SIZE floods.
+    *
+    *  For every cached message the number of received copies is counted,
+    *  which is what counter-based rebroadcast suppression needs; the
+    *  lifetime must thus exceed the assessment delay.
+    *
+    *  SIZE and LIFETIME must not exceed 255.
+    */
+   template<typename OsModel_P,
+            typename Source_P,
+            typename Seq_P,
+            int SIZE = 32,
+            int LIFETIME = 4>
+   class FloodingDuplicateCache
+   {
+   public:
+      typedef OsModel_P OsModel;
+      typedef Source_P source_t;
+      typedef Seq_P seq_t;
+
+      typedef FloodingDuplicateCache<OsModel, source_t, seq_t, SIZE, LIFETIME> self_type;
+      // --------------------------------------------------------------------
+      enum
+      {
+         LIFETIME_TICKS = LIFETIME,
+         NOT_FOUND = -1
+      };
+      // --------------------------------------------------------------------
+      FloodingDuplicateCache()
+      { clear(); }
+      // --------------------------------------------------------------------
+      void clear()
+      {
+         tail_ = 0;
+         count_ = 0;
+         now_ = 0;
+      }
+      // --------------------------------------------------------------------
+      /** Records a copy of the given message.
+       *
+       *  \return true if the message was not known before (and is cached
+       *    now), false if it is a duplicate (its copy counter is increased)
+       *    or the cache is full
+       */
+      bool insert( source_t source, seq_t seq )
+      {
+         int idx = find( source, seq );
+         if ( idx != NOT_FOUND )
+         {
+            if ( entries_[idx].copies < 0xff )
+               entries_[idx].copies++;
+            return false;
+         }
+
+         if ( count_ == SIZE )
+            return false;
+
+         Entry& e = entries_[( tail_ + count_ ) % SIZE];
+         e.source = source;
+         e.seq = seq;
+         e.copies = 1;
+         e.born = now_;
+         count_++;
+         return true;
+      }
+      // --------------------------------------------------------------------
+      /** Advances the time window by one tick and drops the entries that
+       *  have reached their lifetime.
+       */
+      void tick()
+      {
+         now_++;
+         while ( count_ > 0 && (uint8_t)( now_ - entries_[tail_].born ) >= LIFETIME )
+            expire_oldest();
+      }
+      // --------------------------------------------------------------------
+      void expire_oldest()
+      {
+         if ( count_ == 0 )
+            return;
+         tail_ = ( tail_ + 1 ) % SIZE;
+         count_--;
+      }
+      // --------------------------------------------------------------------
+      bool contains( source_t source, seq_t seq )
+      { return find( source, seq ) != NOT_FOUND; }
+      // --------------------------------------------------------------------
+      /** \return number of copies received of the given message, 0 if it
+       *    is not (or no longer) cached
+       */
+      uint8_t copies( source_t source, seq_t seq )
+      {
+         int idx = find( source, seq );
+         return idx == NOT_FOUND ? 0 : entries_[idx].copies;
+      }
+      // --------------------------------------------------------------------
+      int size()
+      { return count_; }
+      // --------------------------------------------------------------------
+      bool full()
+      { return count_ == SIZE; }
+
+   private:
+      typedef char size_must_not_exceed_255[ SIZE > 0 && SIZE <= 255 ? 1 : -1 ];
+      typedef char lifetime_must_not_exceed_255[ LIFETIME > 0 && LIFETIME <= 255 ? 1 : -1 ];
+      // --------------------------------------------------------------------
+      struct Entry
+      {
+         source_t source;
+         seq_t seq;
+         uint8_t copies;
+         uint8_t born;
+      };
+      // --------------------------------------------------------------------
+      int find( source_t source, seq_t seq )
+      {
+         // Newest first: duplicates usually arrive shortly after the original
+         for ( int i = count_ - 1; i >= 0; i-- )
+         {
+            int idx = ( tail_ + i ) % SIZE;
+            if ( entries_[idx].source == source && entries_[idx].seq == seq )
+               return idx;
+         }
+         return NOT_FOUND;
+      }
+      // --------------------------------------------------------------------
+      Entry entries_[SIZE];
+      uint8_t tail_;
+      uint8_t count_;
+      uint8_t now_;
+   };
+
+}
+#endif
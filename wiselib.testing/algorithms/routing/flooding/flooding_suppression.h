@@ -0,0 +1,128 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef __FLOODING_SUPPRESSION_H__
+#define __FLOODING_SUPPRESSION_H__
+
+namespace wiselib
+{
+
+   /** \brief Rebroadcast policy for flooding protocols.
+    *
+    *  Decides whether a node forwards a flood it received for the first
+    *  time:
+    *
+    *  - ALWAYS: plain flooding, every node forwards every message once.
+    *  - PROBABILISTIC: gossiping, a message is forwarded with a fixed
+    *    probability (given in percent).
+    *  - COUNTER_BASED: the node waits a random assessment delay and
+    *    forwards only if it heard less than a threshold of copies of the
+    *    message meanwhile. The copies are counted by the caller (see
+    *    FloodingDuplicateCache); delaying the rebroadcast needs a timer, so
+    *    this mode is only available to algorithms that have one.
+    *
+    *  Uses a small xorshift generator; seed it with the node id so that
+    *  neighbors do not make the same decisions.
+    */
+   template<typename OsModel_P>
+   class FloodingSuppression
+   {
+   public:
+      typedef OsModel_P OsModel;
+      // --------------------------------------------------------------------
+      enum Modes
+      {
+         ALWAYS,
+         PROBABILISTIC,
+         COUNTER_BASED
+      };
+      // --------------------------------------------------------------------
+      FloodingSuppression()
+         : mode_      ( ALWAYS ),
+            percent_   ( 100 ),
+            threshold_ ( 0 ),
+            max_delay_ ( 0 ),
+            state_     ( 2463534242UL )
+      {}
+      // --------------------------------------------------------------------
+      void seed( uint32_t seed )
+      { state_ = seed ? seed : 2463534242UL; }
+      // --------------------------------------------------------------------
+      void set_always()
+      { mode_ = ALWAYS; }
+      // --------------------------------------------------------------------
+      void set_probabilistic( uint8_t percent )
+      {
+         mode_ = PROBABILISTIC;
+         percent_ = percent;
+      }
+      // --------------------------------------------------------------------
+      /** \param threshold Rebroadcast is cancelled once this many copies
+       *    (including the first one) have been heard
+       *  \param max_delay Upper bound of the random assessment delay in ms
+       */
+      void set_counter_based( uint8_t threshold, uint16_t max_delay )
+      {
+         mode_ = COUNTER_BASED;
+         threshold_ = threshold;
+         max_delay_ = max_delay;
+      }
+      // --------------------------------------------------------------------
+      int mode()
+      { return mode_; }
+      // --------------------------------------------------------------------
+      /// Whether the rebroadcast has to wait for assessment_delay()
+      bool deferred()
+      { return mode_ == COUNTER_BASED; }
+      // --------------------------------------------------------------------
+      /** Decision on the first reception of a message. In COUNTER_BASED
+       *  mode this is always true, the final decision is suppressed().
+       */
+      bool forward()
+      {
+         if ( mode_ != PROBABILISTIC || percent_ >= 100 )
+            return true;
+         return random() % 100 < percent_;
+      }
+      // --------------------------------------------------------------------
+      /// Random assessment delay in ms, in [1, max_delay]
+      uint16_t assessment_delay()
+      { return max_delay_ ? (uint16_t)( 1 + random() % max_delay_ ) : 1; }
+      // --------------------------------------------------------------------
+      /// Whether a deferred rebroadcast is cancelled after hearing copies
+      bool suppressed( uint8_t copies )
+      { return mode_ == COUNTER_BASED && copies >= threshold_; }
+
+   private:
+      uint32_t random()
+      {
+         state_ ^= state_ << 13;
+         state_ ^= state_ >> 17;
+         state_ ^= state_ << 5;
+         return state_;
+      }
+      // --------------------------------------------------------------------
+      uint8_t mode_;
+      uint8_t percent_;
+      uint8_t threshold_;
+      uint16_t max_delay_;
+      uint32_t state_;
+   };
+
+}
+#endif
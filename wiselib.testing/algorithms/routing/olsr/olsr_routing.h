@@ -59,6 +59,15 @@
 #define OLSR_TOP_HOLD_TIME		3*OLSR_TC_INTERVAL
 #define OLSR_DUP_HOLD_TIME		30
 
+#ifndef OLSR_EXPIRY_TICK
+#define OLSR_EXPIRY_TICK		500									// Resolution (in ms) of the expiry wheel shared by all tuple sets
+#endif
+#define OLSR_EXPIRY_SLOTS		32									// Tuples expiring later than OLSR_EXPIRY_SLOTS ticks ahead go around the wheel
+
+#ifndef OLSR_RECOMPUTE_INTERVAL
+#define OLSR_RECOMPUTE_INTERVAL	200									// Changes within this many ms are coalesced into one MPR/route recomputation
+#endif
+
 #define OLSR_UNSPEC_LINK	0
 #define OLSR_ASYM_LINK		1
 #define OLSR_SYM_LINK		2
@@ -179,6 +188,7 @@ namespace wiselib
             	double				asym_time_;			// The link is considered unidirectional until this time.
             	double				lost_time_;			// The link is considered lost until this time (used for link layer notification).
             	double				time_;				// Time at which this tuple expires and must be removed.
+            	uint32_t			expiry_gen_;		// Generation of the expiry wheel entry that may remove this tuple.
 
             	inline node_id_t&	local_node_addr()	{ return local_node_addr_; }
             	inline node_id_t&	nb_node_addr()		{ return nb_node_addr_; }
@@ -186,6 +196,7 @@ namespace wiselib
             	inline double&		asym_time()			{ return asym_time_; }
             	inline double&		lost_time()			{ return lost_time_; }
             	inline double&		time()				{ return time_; }
+            	inline uint32_t&	expiry_gen()		{ return expiry_gen_; }
 
             } OLSR_link_tuple;
 
@@ -208,10 +219,12 @@ namespace wiselib
             	node_id_t			nb_node_addr_;		// Address of the neighbor node.
             	node_id_t			nb2hop_addr_;		// Address of a 2-hop neighbor with a symmetric link to nb_node_addr.
             	double				time_;				// Time at which this tuple expires and must be removed.
+            	uint32_t			expiry_gen_;		// Generation of the expiry wheel entry that may remove this tuple.
 
             	inline node_id_t&	nb_node_addr()		{ return nb_node_addr_; }
             	inline node_id_t&	nb2hop_addr()		{ return nb2hop_addr_; }
             	inline double&		time()				{ return time_; }
+            	inline uint32_t&	expiry_gen()		{ return expiry_gen_; }
 
          } OLSR_nb2hop_tuple;
 
@@ -220,9 +233,11 @@ namespace wiselib
 
             	node_id_t			node_addr_;			// Address of a node which have selected this node as a MPR.
             	double				time_;				// Time at which this tuple expires and must be removed.
+            	uint32_t			expiry_gen_;		// Generation of the expiry wheel entry that may remove this tuple.
 
             	inline node_id_t&	node_addr()			{ return node_addr_; }
             	inline double&		time()				{ return time_; }
+            	inline uint32_t&	expiry_gen()		{ return expiry_gen_; }
 
          } OLSR_mprsel_tuple;
 
@@ -233,11 +248,13 @@ namespace wiselib
             	uint16_t			seq_num_;			// Message sequence number.
             	bool				retransmitted_;		// Indicates whether the message has been retransmitted or not.
             	double				time_;				// Time at which this tuple expires and must be removed.
+            	uint32_t			expiry_gen_;		// Generation of the expiry wheel entry that may remove this tuple.
 
             	inline node_id_t&	addr()				{ return addr_; }
             	inline uint16_t&	seq_num()			{ return seq_num_; }
             	inline bool&		retransmitted()		{ return retransmitted_; }
             	inline double&		time()				{ return time_; }
+            	inline uint32_t&	expiry_gen()		{ return expiry_gen_; }
 
          } OLSR_dup_tuple;
 
@@ -248,14 +265,30 @@ namespace wiselib
             	node_id_t			last_addr_;			// Address of a node which is a neighbor of the destination.
             	uint16_t			seq_;				// Sequence number.
             	double				time_;				// Time at which this tuple expires and must be removed.
+            	uint32_t			expiry_gen_;		// Generation of the expiry wheel entry that may remove this tuple.
 
             	inline node_id_t&	dest_addr()			{ return dest_addr_; }
             	inline node_id_t&	last_addr()			{ return last_addr_; }
             	inline uint16_t&	seq()				{ return seq_; }
             	inline double&		time()				{ return time_; }
+            	inline uint32_t&	expiry_gen()		{ return expiry_gen_; }
 
           } OLSR_topology_tuple;
 
+
+          typedef struct OLSR_expiry {					// An entry of the expiry wheel. Refers to its tuple by key, so
+          												// tuples can be removed without touching the wheel. An entry
+          												// is only valid while its generation matches the tuple's.
+            	uint8_t				type_;				// Which tuple set, see ExpiryTypes
+            	node_id_t			addr1_;				// Main key of the tuple (neighbor, originator, destination)
+            	node_id_t			addr2_;				// Second key of nb2hop and topology tuples
+            	uint16_t			seq_;				// Sequence number of dup tuples
+            	uint32_t			gen_;				// Generation, see expiry_gen_ of the tuples
+
+          } OLSR_expiry;
+
+          enum ExpiryTypes { OLSR_EXPIRE_LINK, OLSR_EXPIRE_NB2HOP, OLSR_EXPIRE_TOPOLOGY, OLSR_EXPIRE_MPRSEL, OLSR_EXPIRE_DUP };
+
           typedef std::vector<OLSR_link_tuple*>			linkset_t;
           typedef std::vector<OLSR_nb_tuple*>			nbset_t;
           typedef std::vector<OLSR_nb2hop_tuple*>		nb2hopset_t;
@@ -272,6 +305,30 @@ namespace wiselib
           topologyset_t	topologyset_;
           dupset_t		dupset_;
 
+          // Indices into the sets above, all lookups go through them
+          typedef std::pair<node_id_t, node_id_t>					addr_pair_t;
+          typedef std::map<node_id_t, OLSR_link_tuple*>				link_index_t;		// nb_node_addr
+          typedef std::map<node_id_t, OLSR_nb_tuple*>				nb_index_t;			// nb_node_addr
+          typedef std::map<addr_pair_t, OLSR_nb2hop_tuple*>			nb2hop_index_t;		// (nb_node_addr, nb2hop_addr)
+          typedef std::map<node_id_t, OLSR_mprsel_tuple*>			mprsel_index_t;		// node_addr
+          typedef std::map<addr_pair_t, OLSR_topology_tuple*>		topology_index_t;	// (last_addr, dest_addr)
+          typedef std::map<std::pair<node_id_t, uint16_t>, OLSR_dup_tuple*>	dup_index_t;	// (addr, seq_num)
+
+          link_index_t		link_index_;
+          nb_index_t		nb_index_;
+          nb2hop_index_t	nb2hop_index_;
+          mprsel_index_t	mprsel_index_;
+          topology_index_t	topology_index_;
+          dup_index_t		dup_index_;
+
+          typedef std::vector<OLSR_expiry>							expiry_slot_t;
+
+          expiry_slot_t		expiry_wheel_[OLSR_EXPIRY_SLOTS];
+          uint8_t			expiry_pos_;									// Slot handled by the last tick
+          size_t			expiry_count_;									// Entries on the wheel
+          bool				expiry_running_;								// Wheel timer is armed
+          uint32_t			expiry_gen_;									// Generation handed to the last scheduled entry
+
 
             /**********************************************************************/
             //                        Messages in OLSR                             /
@@ -398,6 +455,13 @@ namespace wiselib
 	        void						nb_loss(OLSR_link_tuple* tuple);						// Case of Neighbor loss
 
             void 						routing_table_computation();      						// Compute the Routing Table
+            void						update_routes();										// Recompute MPR set and routing table if they are outdated
+            void						schedule_update();										// Recompute at the latest after recompute_interval_
+            void						neighborhood_changed();									// Link, neighbor or 2-hop set changed: MPR set and routes are outdated
+            void						topology_added(OLSR_topology_tuple*);					// Extend the routing table by a new topology tuple
+            void						topology_removed(OLSR_topology_tuple*);					// Check whether routes depended on a removed topology tuple
+            inline void					set_recompute_interval( millis_t interval )
+										{ recompute_interval_ = interval; }
 			int 						degree(OLSR_nb_tuple*);	    		     				// This function is used for calculating the MPR Set
 			bool 						route_exists(node_id_t destination);					// Check whether there is an entry in the local routing table for the destination in the received message
 
@@ -484,12 +548,17 @@ namespace wiselib
 	    	//int random_limit=1;
 	    	//double random(random_limit);
 	        void timer_elapsed( void *userdata );      												// Methods called by Timer
+	        void timer_update_routes( void *userdata );
 
-	        void timer_expire_link_tuple( OLSR_link_tuple* );										// Link_tuple     expiration
-	        void timer_expire_nb2hop_tuple( OLSR_nb2hop_tuple* );									// Nb2hop_tuple   expiration
-	        void timer_expire_topology_tuple( OLSR_topology_tuple* );								// Topology_tuple expiration
-	        void timer_expire_mprsel_tuple( OLSR_mprsel_tuple* );									// Mprsel_tuple   expiration
-	        void timer_expire_dup_tuple( OLSR_dup_tuple* );											// Dup_tuple      expiration
+	        void timer_expiry_wheel( void *userdata );												// Expiry wheel tick
+	        void expire( OLSR_expiry&, time_t );													// Removes the tuple of an entry if it has expired, or requeues it
+
+	        void schedule_expiry( OLSR_link_tuple* );												// Queue tuples on the expiry wheel
+	        void schedule_expiry( OLSR_nb2hop_tuple* );
+	        void schedule_expiry( OLSR_topology_tuple* );
+	        void schedule_expiry( OLSR_mprsel_tuple* );
+	        void schedule_expiry( OLSR_dup_tuple* );
+	        void schedule_expiry( OLSR_expiry&, double );
 
 	        void receive( node_id_t from, size_t len, block_data_t *data );      					//@name Methods called by RadioModel
 	        void print_routing_table( RoutingTable rt );
@@ -517,6 +586,11 @@ namespace wiselib
 
 	        uint16_t msg_seq_;
 	        uint16_t ansn_;
+
+	        bool mpr_dirty_;																		// MPR set needs to be recomputed
+	        bool routes_dirty_;																		// Routing table needs to be rebuilt
+	        bool update_pending_;																	// timer_update_routes() is scheduled
+	        millis_t recompute_interval_;
    };
 
    // -----------------------------------------------------------------------
@@ -532,8 +606,16 @@ namespace wiselib
       :  startup_time_		   ( 2000 ),
          work_period_		   ( 5000 ),
          delay_				   ( rand()%50 ),
-         os_( 0 )
+         os_( 0 ),
+         mpr_dirty_			   ( false ),
+         routes_dirty_		   ( false ),
+         update_pending_	   ( false ),
+         recompute_interval_   ( OLSR_RECOMPUTE_INTERVAL )
    {
+       expiry_pos_		= 0;
+       expiry_count_	= 0;
+       expiry_running_	= false;
+       expiry_gen_		= 0;
 
 
 
@@ -599,6 +681,7 @@ namespace wiselib
    send( node_id_t destination, size_t len, block_data_t *data )			// Send the DATA message according to the routing table entry
    {
 	  Debug::debug( os(), "OlsrRouting: START TO SEND DATA.\n" );
+	  update_routes();
       RoutingTableIterator it = routing_table_.find( destination );
       if ( it != routing_table_.end() && it->second.next_addr != Radio::NULL_NODE_ID )
       {
@@ -634,6 +717,8 @@ namespace wiselib
 
 		time_t now = Clock::time( os() );
 
+		update_routes();													// Neighbor types below depend on the MPR set
+
 		hellomessage.set_msg_id( HELLO );
 		hellomessage.set_vtime( seconds_to_emf(OLSR_NEIGHB_HOLD_TIME) );
 		hellomessage.set_originator_addr( Radio::id(os()) );
@@ -837,6 +922,13 @@ namespace wiselib
    }
 
    // -----------------------------------------------------------------------
+   // brief Expiration of all tuple sets is handled by one timing wheel of OLSR_EXPIRY_SLOTS slots, advanced
+   //		every OLSR_EXPIRY_TICK ms while it holds entries. A tuple has one entry at a time: when it comes due,
+   //		the tuple is removed if it has expired, otherwise (its time may have been extended meanwhile) it is
+   //		queued again for its current expiration time. Every entry carries a generation that is also stored
+   //		in its tuple, so entries left behind by a removed tuple neither touch nor requeue a tuple that has
+   //		been added again under the same key.
+
    template<typename OsModel_P,
             typename RoutingTable_P,
             typename Clock_P,
@@ -844,50 +936,51 @@ namespace wiselib
             typename Debug_P>
    void
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
-   timer_expire_link_tuple( OLSR_link_tuple* tuple )// Removes link_tuple if expired.
-													// Else if symmetric time has expired then it is assumed a neighbor loss, the timer is rescheduled to expire at tuple_->time().
-													// Otherwise the timer is rescheduled to expire at the minimum between tuple_->time() and tuple_->sym_time().
+   schedule_expiry( OLSR_expiry& entry, double time )
    {
 	   time_t now = Clock::time( os() );
 
-	   if (tuple->time() < now)
-		{
-			rm_link_tuple(tuple);
-			delete tuple;
-			delete this;
-		}
-		else if (tuple->sym_time() < now)
-		{
-			nb_loss(tuple);
-			Timer::template set_timer<self_type, &self_type::timer_elapsed>( os(), ( (tuple->time()) - now ), this, 0 );
-		}
-		else
-		    Timer::template set_timer<self_type, &self_type::timer_elapsed>( os(), ( MIN( tuple->time(), tuple->sym_time()) - now ), this, 0 );
+	   uint32_t ticks = 1;
+	   if (time > now)
+		   ticks = (uint32_t)((time - now) * 1000 / OLSR_EXPIRY_TICK) + 1;
+	   if (ticks >= OLSR_EXPIRY_SLOTS)
+		   ticks = OLSR_EXPIRY_SLOTS - 1;
 
-   }
+	   entry.gen_ = ++expiry_gen_;
+	   expiry_wheel_[(expiry_pos_ + ticks) % OLSR_EXPIRY_SLOTS].push_back(entry);
+	   expiry_count_++;
 
+	   if (!expiry_running_)
+	   {
+		   expiry_running_ = true;
+		   Timer::template set_timer<self_type, &self_type::timer_expiry_wheel>( os(), OLSR_EXPIRY_TICK, this, 0 );
+	   }
+   }
    // -----------------------------------------------------------------------
-   /*template<typename OsModel_P,
+   // brief A link tuple is due when its symmetric time runs out (neighbor loss) or when it expires. While the link
+   //		is not symmetric it is checked every OLSR_REFRESH_INTERVAL, so a link becoming symmetric is watched again.
+
+   template<typename OsModel_P,
             typename RoutingTable_P,
             typename Clock_P,
             typename Radio_P,
             typename Debug_P>
    void
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
-   timer_expire_nb_tuple( OLSR_nb_tuple* tuple )
+   schedule_expiry( OLSR_link_tuple* tuple )
    {
 	   time_t now = Clock::time( os() );
 
-	   if (tuple.time() < now)
-		{
-			rm_nb_tuple(tuple);
-			delete tuple;
-			delete this;
-		}
+	   OLSR_expiry entry;
+	   entry.type_		= OLSR_EXPIRE_LINK;
+	   entry.addr1_		= tuple->nb_node_addr();
 
-	   Timer::template set_timer<self_type, &self_type::timer_elapsed>( os(), nb_tuple_expire_, this, 0 );
+	   if (tuple->sym_time() >= now)
+		   schedule_expiry(entry, MIN(tuple->time(), tuple->sym_time()));
+	   else
+		   schedule_expiry(entry, MIN(tuple->time(), now + OLSR_REFRESH_INTERVAL));
+	   tuple->expiry_gen() = entry.gen_;
    }
-	*/
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
             typename RoutingTable_P,
@@ -896,24 +989,15 @@ namespace wiselib
             typename Debug_P>
    void
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
-   timer_expire_nb2hop_tuple( OLSR_nb2hop_tuple* tuple )
+   schedule_expiry( OLSR_nb2hop_tuple* tuple )
    {
-	   time_t now = Clock::time( os() );
-
-	   if (tuple->time() < now)
-		{
-			rm_nb2hop_tuple(tuple);
-			delete tuple;
-			delete this;
-		}
-	   else
-	   {
-		   Timer::template set_timer<self_type, &self_type::timer_elapsed>( os(), ( (tuple->time()) - now ), this, 0 );
-	   }
-
-
+	   OLSR_expiry entry;
+	   entry.type_		= OLSR_EXPIRE_NB2HOP;
+	   entry.addr1_		= tuple->nb_node_addr();
+	   entry.addr2_		= tuple->nb2hop_addr();
+	   schedule_expiry(entry, tuple->time());
+	   tuple->expiry_gen() = entry.gen_;
    }
-
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
             typename RoutingTable_P,
@@ -922,22 +1006,15 @@ namespace wiselib
             typename Debug_P>
    void
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
-   timer_expire_topology_tuple( OLSR_topology_tuple* tuple )
+   schedule_expiry( OLSR_topology_tuple* tuple )
    {
-	   time_t now = Clock::time( os() );
-
-	   if (tuple->time() < now)
-		{
-			rm_topology_tuple(tuple);
-			delete tuple;
-			delete this;
-		}
-	   else
-	   	{
-	   		Timer::template set_timer<self_type, &self_type::timer_elapsed>( os(), ( (tuple->time()) - now ), this, 0 );
-	   	}
+	   OLSR_expiry entry;
+	   entry.type_		= OLSR_EXPIRE_TOPOLOGY;
+	   entry.addr1_		= tuple->dest_addr();
+	   entry.addr2_		= tuple->last_addr();
+	   schedule_expiry(entry, tuple->time());
+	   tuple->expiry_gen() = entry.gen_;
    }
-
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
             typename RoutingTable_P,
@@ -946,23 +1023,14 @@ namespace wiselib
             typename Debug_P>
    void
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
-   timer_expire_mprsel_tuple( OLSR_mprsel_tuple* tuple )
+   schedule_expiry( OLSR_mprsel_tuple* tuple )
    {
-	   //time_t now = Clock::time( os() );
-	   double  now = Clock::time( os() );
-
-	   if (tuple->time() < now)
-		{
-			rm_mprsel_tuple(tuple);
-			delete tuple;
-			delete this;
-		}
-	   else
-	   	{
-	   		Timer::template set_timer<self_type, &self_type::timer_elapsed>( os(), ( (tuple->time()) - now ), this, 0 );
-	   	}
+	   OLSR_expiry entry;
+	   entry.type_		= OLSR_EXPIRE_MPRSEL;
+	   entry.addr1_		= tuple->node_addr();
+	   schedule_expiry(entry, tuple->time());
+	   tuple->expiry_gen() = entry.gen_;
    }
-
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
             typename RoutingTable_P,
@@ -971,20 +1039,131 @@ namespace wiselib
             typename Debug_P>
    void
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
-   timer_expire_dup_tuple( OLSR_dup_tuple* tuple )
+   schedule_expiry( OLSR_dup_tuple* tuple )
    {
+	   OLSR_expiry entry;
+	   entry.type_		= OLSR_EXPIRE_DUP;
+	   entry.addr1_		= tuple->addr();
+	   entry.seq_		= tuple->seq_num();
+	   schedule_expiry(entry, tuple->time());
+	   tuple->expiry_gen() = entry.gen_;
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Clock_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
+   timer_expiry_wheel( void* userdata )
+   {
+	   expiry_pos_ = (expiry_pos_ + 1) % OLSR_EXPIRY_SLOTS;
+
+	   expiry_slot_t due;
+	   due.swap(expiry_wheel_[expiry_pos_]);
+	   expiry_count_ -= due.size();
+
 	   time_t now = Clock::time( os() );
+	   for (typename expiry_slot_t::iterator it = due.begin(); it != due.end(); it++)
+		   expire(*it, now);
 
-	   if (tuple->time() < now)
-		{
-			rm_dup_tuple(tuple);
-			delete tuple;
-			delete this;
-		}
+	   if (expiry_count_ > 0)
+		   Timer::template set_timer<self_type, &self_type::timer_expiry_wheel>( os(), OLSR_EXPIRY_TICK, this, 0 );
 	   else
-	   	{
-	   		Timer::template set_timer<self_type, &self_type::timer_elapsed>( os(), ( (tuple->time()) - now ), this, 0 );
-	   	}
+		   expiry_running_ = false;
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Clock_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
+   expire( OLSR_expiry& entry, time_t now )
+   {
+	   switch (entry.type_)
+	   {
+		   case OLSR_EXPIRE_LINK:
+		   {
+			   OLSR_link_tuple* tuple = find_link_tuple(entry.addr1_);
+			   if (tuple == NULL || tuple->expiry_gen() != entry.gen_)
+				   break;
+
+			   if (tuple->time() < now)
+			   {
+				   rm_link_tuple(tuple);
+				   delete tuple;
+				   break;
+			   }
+
+			   if (tuple->sym_time() < now && find_sym_nb_tuple(tuple->nb_node_addr()) != NULL)
+				   nb_loss(tuple);
+			   schedule_expiry(tuple);
+			   break;
+		   }
+		   case OLSR_EXPIRE_NB2HOP:
+		   {
+			   OLSR_nb2hop_tuple* tuple = find_nb2hop_tuple(entry.addr1_, entry.addr2_);
+			   if (tuple == NULL || tuple->expiry_gen() != entry.gen_)
+				   break;
+
+			   if (tuple->time() < now)
+			   {
+				   rm_nb2hop_tuple(tuple);
+				   delete tuple;
+			   }
+			   else
+				   schedule_expiry(tuple);
+			   break;
+		   }
+		   case OLSR_EXPIRE_TOPOLOGY:
+		   {
+			   OLSR_topology_tuple* tuple = find_topology_tuple(entry.addr1_, entry.addr2_);
+			   if (tuple == NULL || tuple->expiry_gen() != entry.gen_)
+				   break;
+
+			   if (tuple->time() < now)
+			   {
+				   rm_topology_tuple(tuple);
+				   delete tuple;
+			   }
+			   else
+				   schedule_expiry(tuple);
+			   break;
+		   }
+		   case OLSR_EXPIRE_MPRSEL:
+		   {
+			   OLSR_mprsel_tuple* tuple = find_mprsel_tuple(entry.addr1_);
+			   if (tuple == NULL || tuple->expiry_gen() != entry.gen_)
+				   break;
+
+			   if (tuple->time() < now)
+			   {
+				   rm_mprsel_tuple(tuple);
+				   delete tuple;
+			   }
+			   else
+				   schedule_expiry(tuple);
+			   break;
+		   }
+		   case OLSR_EXPIRE_DUP:
+		   {
+			   OLSR_dup_tuple* tuple = find_dup_tuple(entry.addr1_, entry.seq_);
+			   if (tuple == NULL || tuple->expiry_gen() != entry.gen_)
+				   break;
+
+			   if (tuple->time() < now)
+			   {
+				   rm_dup_tuple(tuple);
+				   delete tuple;
+			   }
+			   else
+				   schedule_expiry(tuple);
+			   break;
+		   }
+	   }
    }
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
@@ -1047,9 +1226,6 @@ namespace wiselib
                  Debug::debug(os(), "%i received UNRECOGNIZED message type [%i]\n", Radio::id(os()), msg_id);
              }
          }
-
-	   	routing_table_computation();											// After processing all OLSR messages, recompute routing table
-
    }
 
    // -----------------------------------------------------------------------
@@ -1073,7 +1249,6 @@ namespace wiselib
     link_sensing(message, sender);
    	populate_nbset(message);
    	populate_nb2hopset(message);
-   	mpr_computation();
    	populate_mprselset(message);
    }
 
@@ -1181,8 +1356,9 @@ namespace wiselib
    	if (updated)										// whenever the link tuple is updated, the corresponding neighbor tuple also needs update
    		updated_link_tuple(link_tuple);
 
-   	// Schedules link tuple deletion
-   	timer_expire_link_tuple(link_tuple);
+   	// Schedules link tuple deletion, the wheel follows later changes of its times
+   	if (created)
+   		schedule_expiry(link_tuple);
 
    }
 
@@ -1202,8 +1378,11 @@ namespace wiselib
    populate_nbset(BroadcastHelloMessage& message)
    {
    	OLSR_nb_tuple* nb_tuple = find_nb_tuple(message.originator_addr());
-   	if (nb_tuple != NULL)
+   	if (nb_tuple != NULL && nb_tuple->willingness() != message.willingness())
+   	{
    		nb_tuple->willingness() = message.willingness();
+   		neighborhood_changed();
+   	}
    }
 
    // -----------------------------------------------------------------------
@@ -1278,7 +1457,7 @@ namespace wiselib
    									nb2hop_tuple->time() = now + emf_to_seconds(message.vtime());
 
    									// Schedules nb2hop tuple deletion
-   									timer_expire_nb2hop_tuple(nb2hop_tuple);
+   									schedule_expiry(nb2hop_tuple);
 
    								}
    								else
@@ -1603,7 +1782,7 @@ namespace wiselib
    						add_mprsel_tuple(mprsel_tuple);
 
    						// Schedules mpr selector tuple deletion
-   						timer_expire_mprsel_tuple(mprsel_tuple);
+   						schedule_expiry(mprsel_tuple);
 
    					}
    					else
@@ -1675,7 +1854,7 @@ namespace wiselib
    		add_dup_tuple(new_dup);
 
    		// Schedules dup tuple deletion
-   		timer_expire_dup_tuple(new_dup);
+   		schedule_expiry(new_dup);
    	}
    }
    // -----------------------------------------------------------------------
@@ -1739,7 +1918,7 @@ namespace wiselib
    		add_dup_tuple(new_dup);
 
    		// Schedules dup tuple deletion
-   		timer_expire_dup_tuple(new_dup);
+   		schedule_expiry(new_dup);
    	}
    }
 
@@ -1817,7 +1996,7 @@ namespace wiselib
    			add_topology_tuple(topology_tuple);
 
    			// Schedules topology tuple deletion
-   			timer_expire_topology_tuple(topology_tuple);
+   			schedule_expiry(topology_tuple);
    		}
    	}
    }
@@ -1837,6 +2016,8 @@ namespace wiselib
     {
        Debug::debug(os(), "%i received DATA from %i \n", Radio::id(os()), msg.source());
 
+       update_routes();
+
        if (msg.destination() == Radio::id(os()))																// Got the destination
 		{
            Debug::debug(os(), "%i got his DATA from %i \n", Radio::id(os()), msg.source());
@@ -1962,7 +2143,7 @@ namespace wiselib
    			OLSR_topology_tuple* topology_tuple = *it;
    			RoutingTableIterator it1 = routing_table_.find(topology_tuple->dest_addr());
    			RoutingTableIterator it2 = routing_table_.find(topology_tuple->last_addr());
-   			 if (it1 == routing_table_.end() && it2 != routing_table_.end() && it2->second.dest_addr == h)
+   			 if (it1 == routing_table_.end() && it2 != routing_table_.end() && it2->second.hops == h)
    			 {
 #ifdef DEBUG_OLSRROUTING
 				 Debug::debug( os(), "OlsrRouting: Add %i because not known\n", topology_tuple->dest_addr() );
@@ -1978,6 +2159,158 @@ namespace wiselib
    	 }
    }
 
+   // -----------------------------------------------------------------------
+   // brief Brings MPR set and routing table up to date. Changes to the tuple sets only mark them as outdated;
+   //		they are recomputed here, at most once per recompute_interval_ or when they are about to be used.
+
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Clock_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
+   update_routes()
+   {
+	   if (mpr_dirty_)
+	   {
+		   mpr_dirty_ = false;
+		   mpr_computation();
+	   }
+
+	   if (routes_dirty_)
+	   {
+		   routes_dirty_ = false;
+		   routing_table_computation();
+	   }
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Clock_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
+   schedule_update()
+   {
+	   if (update_pending_)
+		   return;
+
+	   update_pending_ = true;
+	   Timer::template set_timer<self_type, &self_type::timer_update_routes>( os(), recompute_interval_, this, 0 );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Clock_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
+   timer_update_routes( void* userdata )
+   {
+	   update_pending_ = false;
+	   update_routes();
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Clock_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
+   neighborhood_changed()
+   {
+	   mpr_dirty_		= true;
+	   routes_dirty_	= true;
+	   schedule_update();
+   }
+   // -----------------------------------------------------------------------
+   // brief A new topology tuple can only shorten routes, so the routing table is extended by a breadth-first
+   //		search starting at its destination instead of being rebuilt. Uses the same rules as step 4 of
+   //		routing_table_computation(): only routes of at least 2 hops are extended by topology tuples.
+
+   // param tuple the topology tuple which has been added.
+
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Clock_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
+   topology_added(OLSR_topology_tuple* tuple)
+   {
+	   if (routes_dirty_)															// The whole table is rebuilt anyway
+		   return;
+
+	   RoutingTableIterator last = routing_table_.find(tuple->last_addr());
+	   if (last == routing_table_.end() || last->second.hops < 2 || tuple->dest_addr() == Radio::id(os()))
+		   return;
+
+	   RoutingTableIterator dest = routing_table_.find(tuple->dest_addr());
+	   if (dest != routing_table_.end() && dest->second.hops <= last->second.hops + 1)
+		   return;
+
+	   routing_table_[tuple->dest_addr()] = RoutingTableEntry(tuple->dest_addr(), last->second.next_addr, last->second.hops + 1);
+
+	   std::vector<node_id_t> queue;
+	   queue.push_back(tuple->dest_addr());
+	   for (size_t i = 0; i < queue.size(); i++)
+	   {
+		   RoutingTableEntry via = routing_table_[queue[i]];
+
+		   for (typename topology_index_t::iterator it = topology_index_.lower_bound(addr_pair_t(queue[i], 0));
+				   it != topology_index_.end() && it->first.first == queue[i]; it++)
+		   {
+			   OLSR_topology_tuple* topology_tuple = it->second;
+			   if (topology_tuple->dest_addr() == Radio::id(os()))
+				   continue;
+
+			   RoutingTableIterator it1 = routing_table_.find(topology_tuple->dest_addr());
+			   if (it1 == routing_table_.end() || it1->second.hops > via.hops + 1)
+			   {
+#ifdef DEBUG_OLSRROUTING
+				   Debug::debug( os(), "OlsrRouting: Add %i over new topology tuple\n", topology_tuple->dest_addr() );
+#endif
+				   routing_table_[topology_tuple->dest_addr()] = RoutingTableEntry(topology_tuple->dest_addr(), via.next_addr, via.hops + 1);
+				   queue.push_back(topology_tuple->dest_addr());
+			   }
+		   }
+	   }
+   }
+   // -----------------------------------------------------------------------
+   // brief Removing a topology tuple only affects the routing table if the route to its destination may have
+   //		been derived from it; only then the table is rebuilt.
+
+   // param tuple the topology tuple which has been removed.
+
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Clock_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
+   topology_removed(OLSR_topology_tuple* tuple)
+   {
+	   if (routes_dirty_)
+		   return;
+
+	   RoutingTableIterator dest = routing_table_.find(tuple->dest_addr());
+	   RoutingTableIterator last = routing_table_.find(tuple->last_addr());
+	   if (dest == routing_table_.end() || last == routing_table_.end())
+		   return;
+
+	   if (dest->second.hops == last->second.hops + 1 && dest->second.next_addr == last->second.next_addr)
+	   {
+		   routes_dirty_ = true;
+		   schedule_update();
+	   }
+   }
+
    // -----------------------------------------------------------------------
 
    template<typename OsModel_P,
@@ -2001,14 +2334,10 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_dup_tuple(node_id_t addr, uint16_t seq_num)
    {
-   	for (typename dupset_t::iterator it = dupset_.begin(); it != dupset_.end(); it++)
-		{
-			OLSR_dup_tuple* tuple = *it;
-			if (tuple->addr() == addr && tuple->seq_num() == seq_num)
-				return tuple;
-		}
-
-   	return NULL;
+   	typename dup_index_t::iterator it = dup_index_.find(std::make_pair(addr, seq_num));
+   	if (it == dup_index_.end())
+   		return NULL;
+   	return it->second;
    }
 
    // -----------------------------------------------------------------------
@@ -2039,6 +2368,7 @@ namespace wiselib
    		if (*it == tuple)
    		{
    			dupset_.erase(it);
+   			dup_index_.erase(std::make_pair(tuple->addr(), tuple->seq_num()));
    			break;
    		}
    	}
@@ -2056,6 +2386,7 @@ namespace wiselib
    insert_dup_tuple(OLSR_dup_tuple* tuple)
    {
    	dupset_.push_back(tuple);
+   	dup_index_[std::make_pair(tuple->addr(), tuple->seq_num())] = tuple;
    }
 
    // -----------------------------------------------------------------------
@@ -2133,12 +2464,16 @@ namespace wiselib
    	// Each time a link tuple changes, the associated neighbor tuple must be recomputed, basically the "nb_tuple->status" should be updated
    	OLSR_nb_tuple* nb_tuple = find_nb_tuple(tuple->nb_node_addr());
    	if (nb_tuple != NULL) {
+   		uint8_t status = nb_tuple->status();
    		if (tuple->lost_time() >= now)
    			nb_tuple->status() = OLSR_STATUS_NOT_SYM;
    		else if (tuple->sym_time() >= now)
    			nb_tuple->status() = OLSR_STATUS_SYM;
    		else
    			nb_tuple->status() = OLSR_STATUS_NOT_SYM;
+
+   		if (nb_tuple->status() != status)
+   			neighborhood_changed();
    	}
 
 #ifdef DEBUG_OLSRROUTING
@@ -2157,24 +2492,10 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_link_tuple(node_id_t node_addr)
    {
-   	for (typename linkset_t::iterator it = linkset_.begin(); it != linkset_.end(); it++)
-   	{
-   		OLSR_link_tuple* tuple = *it;
-   		if (tuple->nb_node_addr() == node_addr)
-   		{
-#ifdef DEBUG_OLSRROUTING
-   			Debug::debug(os(), "Find existing tuple!!!\n");
-#endif
-   			return tuple;
-   		}
-   		else
-   		{
-#ifdef DEBUG_OLSRROUTING
-   			Debug::debug(os(), "NO existing tuple!!!\n");
-#endif
-   			return NULL;
-   		}
-   	}
+   	typename link_index_t::iterator it = link_index_.find(node_addr);
+   	if (it == link_index_.end())
+   		return NULL;
+   	return it->second;
    }
 
    // -----------------------------------------------------------------------
@@ -2188,18 +2509,9 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_sym_link_tuple(node_id_t node_addr, double now)
    {
-
-   	for (typename linkset_t::iterator it = linkset_.begin(); it != linkset_.end(); it++)
-   	{
-   		OLSR_link_tuple* tuple = *it;
-   		if (tuple->nb_node_addr() == node_addr)
-   		{
-   			if (tuple->sym_time() > now)
-   				return tuple;
-   			else
-   				break;
-   		}
-   	}
+   	OLSR_link_tuple* tuple = find_link_tuple(node_addr);
+   	if (tuple != NULL && tuple->sym_time() > now)
+   		return tuple;
    	return NULL;
    }
 
@@ -2219,6 +2531,8 @@ namespace wiselib
 			if (*it == tuple)
 			{
 				linkset_.erase(it);
+				link_index_.erase(tuple->nb_node_addr());
+				neighborhood_changed();
 				break;
 			}
 		}
@@ -2236,6 +2550,8 @@ namespace wiselib
    insert_link_tuple(OLSR_link_tuple* tuple)
    {
    	linkset_.push_back(tuple);
+   	link_index_[tuple->nb_node_addr()] = tuple;
+   	neighborhood_changed();
    }
    // -----------------------------------------------------------------------
 
@@ -2291,13 +2607,10 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_nb_tuple(node_id_t node_addr) 						// find a neighbor with NO SPECIFIC requirement
    {
-   	for (typename nbset_t::iterator it = nbset_.begin(); it != nbset_.end(); it++)
-	{
-		OLSR_nb_tuple* tuple = *it;
-		if (tuple->nb_node_addr() == node_addr)
-			return tuple;
-	}
-   	return NULL;
+   	typename nb_index_t::iterator it = nb_index_.find(node_addr);
+   	if (it == nb_index_.end())
+   		return NULL;
+   	return it->second;
    }
 
    // -----------------------------------------------------------------------
@@ -2310,12 +2623,9 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_nb_tuple(node_id_t node_addr, uint8_t willingness) // find a neighbor with certain WILLNESS requirement
    {
-   	for (typename nbset_t::iterator it = nbset_.begin(); it != nbset_.end(); it++)
-   	{
-   		OLSR_nb_tuple* tuple = *it;
-   		if (tuple->nb_node_addr() == node_addr && tuple->willingness() == willingness)
-   			return tuple;
-   	}
+   	OLSR_nb_tuple* tuple = find_nb_tuple(node_addr);
+   	if (tuple != NULL && tuple->willingness() == willingness)
+   		return tuple;
    	return NULL;
    }
 
@@ -2329,12 +2639,9 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_sym_nb_tuple(node_id_t node_addr) 					// find a neighbor with certain SYMMETRIC requirement
    {
-   	for (typename nbset_t::iterator it = nbset_.begin(); it != nbset_.end(); it++)
-   	{
-   		OLSR_nb_tuple* tuple = *it;
-   		if (tuple->nb_node_addr() == node_addr && tuple->status() == OLSR_STATUS_SYM)
-   			return tuple;
-   	}
+   	OLSR_nb_tuple* tuple = find_nb_tuple(node_addr);
+   	if (tuple != NULL && tuple->status() == OLSR_STATUS_SYM)
+   		return tuple;
    	return NULL;
    }
 
@@ -2352,6 +2659,8 @@ namespace wiselib
    	{
    		if (*it == tuple) {
    			nbset_.erase(it);
+   			nb_index_.erase(tuple->nb_node_addr());
+   			neighborhood_changed();
    			break;
    		}
    	}
@@ -2368,6 +2677,8 @@ namespace wiselib
    insert_nb_tuple(OLSR_nb_tuple* tuple)
    {
    	nbset_.push_back(tuple);
+   	nb_index_[tuple->nb_node_addr()] = tuple;
+   	neighborhood_changed();
    }
 
    // -----------------------------------------------------------------------
@@ -2421,13 +2732,10 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_nb2hop_tuple(node_id_t nb_node_addr, node_id_t nb2hop_addr)
    {
-   	for (typename nb2hopset_t::iterator it = nb2hopset_.begin(); it != nb2hopset_.end(); it++)
-   	{
-   		OLSR_nb2hop_tuple* tuple = *it;
-   		if (tuple->nb_node_addr() == nb_node_addr && tuple->nb2hop_addr() == nb2hop_addr)
-   			return tuple;
-   	}
-   	return NULL;
+   	typename nb2hop_index_t::iterator it = nb2hop_index_.find(addr_pair_t(nb_node_addr, nb2hop_addr));
+   	if (it == nb2hop_index_.end())
+   		return NULL;
+   	return it->second;
    }
 
    // -----------------------------------------------------------------------
@@ -2446,6 +2754,8 @@ namespace wiselib
    		if (*it == tuple)
    		{
    			nb2hopset_.erase(it);
+   			nb2hop_index_.erase(addr_pair_t(tuple->nb_node_addr(), tuple->nb2hop_addr()));
+   			neighborhood_changed();
    			break;
    		}
    	}
@@ -2461,15 +2771,15 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    erase_nb2hop_tuples(node_id_t nb_node_addr)
    {
-	for (typename nb2hopset_t::iterator it = nb2hopset_.begin(); it != nb2hopset_.end(); it++)
-		{
-			OLSR_nb2hop_tuple* tuple = *it;
-			if (tuple->nb_node_addr() == nb_node_addr)
-			{
-				it = nb2hopset_.erase(it);
-				it--;
-			}
-		}
+	// The index is ordered by neighbor first, so its 2-hop tuples are adjacent
+	typename nb2hop_index_t::iterator it = nb2hop_index_.lower_bound(addr_pair_t(nb_node_addr, 0));
+	while (it != nb2hop_index_.end() && it->first.first == nb_node_addr)
+	{
+		OLSR_nb2hop_tuple* tuple = it->second;
+		it++;
+		erase_nb2hop_tuple(tuple);
+		delete tuple;
+	}
    }
    // -----------------------------------------------------------------------
 
@@ -2482,15 +2792,12 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    erase_nb2hop_tuples(node_id_t nb_node_addr, node_id_t nb2hop_addr)
    {
-   	for (typename nb2hopset_t::iterator it = nb2hopset_.begin(); it != nb2hopset_.end(); it++)
-		{
-			OLSR_nb2hop_tuple* tuple = *it;
-			if (tuple->nb_node_addr() == nb_node_addr && tuple->nb2hop_addr() == nb2hop_addr)
-			{
-				it = nb2hopset_.erase(it);
-				it--;
-			}
-		}
+   	OLSR_nb2hop_tuple* tuple = find_nb2hop_tuple(nb_node_addr, nb2hop_addr);
+   	if (tuple != NULL)
+   	{
+   		erase_nb2hop_tuple(tuple);
+   		delete tuple;
+   	}
    }
    // -----------------------------------------------------------------------
 
@@ -2504,6 +2811,8 @@ namespace wiselib
    insert_nb2hop_tuple(OLSR_nb2hop_tuple* tuple)
    {
    	nb2hopset_.push_back(tuple);
+   	nb2hop_index_[addr_pair_t(tuple->nb_node_addr(), tuple->nb2hop_addr())] = tuple;
+   	neighborhood_changed();
    }
 
    // -----------------------------------------------------------------------
@@ -2554,13 +2863,10 @@ namespace wiselib
    class OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::OLSR_mprsel_tuple *
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_mprsel_tuple(node_id_t node_addr) {
-   	for (typename mprselset_t::iterator it = mprselset_.begin(); it != mprselset_.end(); it++)
-   	{
-   		OLSR_mprsel_tuple* tuple = *it;
-   		if (tuple->node_addr() == node_addr)
-   			return tuple;
-   	}
-   	return NULL;
+   	typename mprsel_index_t::iterator it = mprsel_index_.find(node_addr);
+   	if (it == mprsel_index_.end())
+   		return NULL;
+   	return it->second;
    }
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
@@ -2577,6 +2883,7 @@ namespace wiselib
    		if (*it == tuple)
    		{
    			mprselset_.erase(it);
+   			mprsel_index_.erase(tuple->node_addr());
    			break;
    		}
    	}
@@ -2591,13 +2898,11 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    erase_mprsel_tuples(node_id_t node_addr)
    {
-		for (typename mprselset_t::iterator it = mprselset_.begin(); it != mprselset_.end(); it++)
+		OLSR_mprsel_tuple* tuple = find_mprsel_tuple(node_addr);
+		if (tuple != NULL)
 		{
-			OLSR_mprsel_tuple* tuple = *it;
-			if (tuple->node_addr() == node_addr) {
-				it = mprselset_.erase(it);
-				it--;
-			}
+			erase_mprsel_tuple(tuple);
+			delete tuple;
 		}
    }
    // -----------------------------------------------------------------------
@@ -2611,6 +2916,7 @@ namespace wiselib
    insert_mprsel_tuple(OLSR_mprsel_tuple* tuple)
    {
    	mprselset_.push_back(tuple);
+   	mprsel_index_[tuple->node_addr()] = tuple;
    }
 
    // -----------------------------------------------------------------------
@@ -2674,13 +2980,10 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_topology_tuple(node_id_t dest_addr, node_id_t last_addr)
    {
-   	for (typename topologyset_t::iterator it = topologyset_.begin(); it != topologyset_.end(); it++)
-   	{
-   		OLSR_topology_tuple* tuple = *it;
-   		if (tuple->dest_addr() == dest_addr && tuple->last_addr() == last_addr)
-   			return tuple;
-   	}
-   	return NULL;
+   	typename topology_index_t::iterator it = topology_index_.find(addr_pair_t(last_addr, dest_addr));
+   	if (it == topology_index_.end())
+   		return NULL;
+   	return it->second;
    }
    // -----------------------------------------------------------------------
 
@@ -2693,10 +2996,11 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    find_newer_topology_tuple(node_id_t last_addr, u_int16_t ansn)
    {
-   	for (typename topologyset_t::iterator it = topologyset_.begin(); it != topologyset_.end(); it++)
+   	for (typename topology_index_t::iterator it = topology_index_.lower_bound(addr_pair_t(last_addr, 0));
+   			it != topology_index_.end() && it->first.first == last_addr; it++)
    	{
-   		OLSR_topology_tuple* tuple = *it;
-   		if (tuple->last_addr() == last_addr && tuple->seq() > ansn)
+   		OLSR_topology_tuple* tuple = it->second;
+   		if (tuple->seq() > ansn)
    			return tuple;
    	}
    	return NULL;
@@ -2716,6 +3020,8 @@ namespace wiselib
    		if (*it == tuple)
    		{
    			topologyset_.erase(it);
+   			topology_index_.erase(addr_pair_t(tuple->last_addr(), tuple->dest_addr()));
+   			topology_removed(tuple);
    			break;
    		}
    	}
@@ -2730,13 +3036,15 @@ namespace wiselib
    OlsrRouting<OsModel_P, RoutingTable_P, Clock_P, Radio_P, Debug_P>::
    erase_older_topology_tuples(node_id_t last_addr, uint16_t ansn)
    {
-   	for (typename topologyset_t::iterator it = topologyset_.begin(); it != topologyset_.end(); it++)
+   	typename topology_index_t::iterator it = topology_index_.lower_bound(addr_pair_t(last_addr, 0));
+   	while (it != topology_index_.end() && it->first.first == last_addr)
    	{
-   		OLSR_topology_tuple* tuple = *it;
-   		if (tuple->last_addr() == last_addr && tuple->seq() < ansn)
+   		OLSR_topology_tuple* tuple = it->second;
+   		it++;
+   		if (tuple->seq() < ansn)
    		{
-   			it = topologyset_.erase(it);
-   			it--;
+   			erase_topology_tuple(tuple);
+   			delete tuple;
    		}
    	}
    }
@@ -2751,6 +3059,8 @@ namespace wiselib
    insert_topology_tuple(OLSR_topology_tuple* tuple)
    {
    	topologyset_.push_back(tuple);
+   	topology_index_[addr_pair_t(tuple->last_addr(), tuple->dest_addr())] = tuple;
+   	topology_added(tuple);
    }
    // -----------------------------------------------------------------------
    template<typename OsModel_P,
@@ -2896,8 +3206,7 @@ namespace wiselib
    	erase_nb2hop_tuples(tuple->nb_node_addr());
    	erase_mprsel_tuples(tuple->nb_node_addr());
 
-   	mpr_computation();
-    routing_table_computation();
+   	neighborhood_changed();
    }
 
    // -----------------------------------------------------------------------
@@ -64,7 +64,7 @@ namespace wiselib {
         typedef typename Radio::message_id_t message_id_t;
 
         typedef wiselib::StaticArrayRoutingTable<OsModel, Radio, 20 > FloodingStaticMap;
-        typedef wiselib::FloodingAlgorithm<OsModel, FloodingStaticMap, Radio, Debug> routing_t;
+        typedef wiselib::FloodingAlgorithm<OsModel, FloodingStaticMap, Radio, Debug, Timer> routing_t;
 
         typedef QueryMsg<OsModel, Radio> QueryMsg_t;
 
@@ -175,10 +175,31 @@ namespace wiselib {
          */
         void init(Radio& radio, Timer& timer, Debug& debug, Semantics_t &semantics, nd_t &nd) {
             radio_ = &radio;
+            timer_ = &timer;
             debug_ = &debug;
             semantics_ = &semantics;
             nd_ = &nd;
         }
+        // --------------------------------------------------------------------
+
+        /**
+         * Queries are rebroadcast with the given probability (gossiping).
+         * @param percent forwarding probability in percent
+         */
+        void set_rebroadcast_probability(uint8_t percent) {
+            routing().set_rebroadcast_probability(percent);
+        }
+        // --------------------------------------------------------------------
+
+        /**
+         * Queries are rebroadcast after a random delay, unless enough copies
+         * were overheard meanwhile.
+         * @param threshold number of copies that cancels the rebroadcast
+         * @param max_delay maximal assessment delay in ms
+         */
+        void set_rebroadcast_counter(uint8_t threshold, uint16_t max_delay) {
+            routing().set_rebroadcast_counter(threshold, max_delay);
+        }
 
     private:
 
@@ -187,6 +208,7 @@ namespace wiselib {
         routing_t routing_;
 
         Radio * radio_; //radio module
+        Timer * timer_; //timer module
         Debug * debug_; //debug module
         Semantics_t * semantics_;
         nd_t * nd_;
@@ -246,7 +268,7 @@ namespace wiselib {
         debug().debug("SeQueryFlooding: Boot for %x", radio().id());
 #endif
 
-        routing().init(*radio_, *debug_);
+        routing().init(*radio_, *timer_, *debug_);
         routing().enable_radio();
         callback_id_ = routing().template reg_recv_callback<self_type, &self_type::receive > (this);
 
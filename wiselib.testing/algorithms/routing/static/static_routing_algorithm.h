@@ -20,6 +20,7 @@
 #define __STATIC_ROUTING_ALGORITHM_H__
 
 #include "util/base_classes/routing_base.h"
+#include "util/pstl/packet_buffer.h"
 #include "static_routing_message.h"
 
 
@@ -57,6 +58,7 @@ namespace wiselib
       typedef typename Radio::message_id_t message_id_t;
 
       typedef StaticRoutingMessage<OsModel, Radio> Message;
+      typedef PacketBuffer<OsModel, size_t, block_data_t> packet_buffer_t;
       // --------------------------------------------------------------------
       enum ErrorCodes
       {
@@ -75,6 +77,8 @@ namespace wiselib
          MAX_MESSAGE_LENGTH = Radio_P::MAX_MESSAGE_LENGTH - Message::PAYLOAD_POS  ///< Maximal number of bytes in payload
       };
       // --------------------------------------------------------------------
+      enum { HEADER_SIZE = Message::PAYLOAD_POS + sizeof(size_t) };
+      // --------------------------------------------------------------------
       ///@name Construction / Destruction
       ///@{
       StaticRoutingAlgorithm();
@@ -102,9 +106,16 @@ namespace wiselib
       /**
        */
       int send( node_id_t receiver, size_t len, block_data_t *data );
+      /** Puts the header in front of the buffer (see PacketBuffer), so a
+       *  payload handed down by a buffer-aware layer is not copied here.
+       */
+      int send_buffer( node_id_t receiver, packet_buffer_t& buffer );
       /**
        */
       void receive( node_id_t from, size_t len, block_data_t *data );
+      /** Forwards and delivers received messages without copying.
+       */
+      void receive_buffer( node_id_t from, packet_buffer_t& buffer );
       /**
        */
       void add_hop(node_id_t from, node_id_t to);
@@ -232,35 +243,63 @@ namespace wiselib
    StaticRoutingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
    send( node_id_t destination, size_t len, block_data_t *data )
    {
-      Message message;
-      message.set_msg_id( STATIC_ROUTING_ID );
-      message.set_source_id( radio().id() );
-      message.set_destination( destination );
-      message.set_payload( len, data );
+      StaticPacketBuffer<OsModel, Radio::MAX_MESSAGE_LENGTH + PACKET_BUFFER_HEADROOM + HEADER_SIZE,
+                         size_t, block_data_t> buffer( PACKET_BUFFER_HEADROOM + HEADER_SIZE );
+      if ( !buffer.append( len, data ) )
+         return ERR_UNSPEC;
+      return send_buffer( destination, buffer );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Debug_P>
+   int
+   StaticRoutingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
+   send_buffer( node_id_t destination, packet_buffer_t& buffer )
+   {
+      if ( buffer.size() > (size_t)MAX_MESSAGE_LENGTH - sizeof(size_t) )
+         return ERR_UNSPEC;
 
-      if(destination == route_end_ && route_start_ != radio_->id() )
+      // No room for the header (e.g., received data): copy once, leaving
+      // room for this header and those of the layers below
+      if ( buffer.headroom() < HEADER_SIZE )
       {
-#ifdef ROUTING_STATIC_DEBUG
-      debug().debug( "StaticRoutingAlgorithm: node %d Send to %d over %d\n", radio().id(), destination, route_start_ );
-#endif
-          radio().send( route_start_, message.buffer_size(), (block_data_t*)&message );
+         StaticPacketBuffer<OsModel, Radio::MAX_MESSAGE_LENGTH + PACKET_BUFFER_HEADROOM + HEADER_SIZE,
+                            size_t, block_data_t> copy( PACKET_BUFFER_HEADROOM + HEADER_SIZE );
+         if ( !copy.append( buffer.size(), buffer.data() ) )
+            return ERR_UNSPEC;
+         return send_buffer( destination, copy );
       }
-      else if(destination == route_end_ && route_start_ == radio_->id() )
+
+      node_id_t next_hop = destination;
+      if ( destination == route_end_ && route_start_ != radio().id() )
+         next_hop = route_start_;
+      else if ( destination == route_end_ )
       {
-         if ( hop_map_.find( radio().id()) == hop_map_.end() )
+         MapTypeIterator it = hop_map_.find( radio().id() );
+         if ( it == hop_map_.end() )
          {
             debug().debug( "FATAL send: no entry for %d\n", radio().id() );
             return ERR_UNSPEC;
          }
-         radio().send( hop_map_[radio().id()], message.buffer_size(), (block_data_t*)&message );
+         next_hop = it->second;
       }
-      else
-      {
 #ifdef ROUTING_STATIC_DEBUG
-      debug().debug( "StaticRoutingAlgorithm: node %d Send to %d\n", radio().id(), destination );
+      debug().debug( "StaticRoutingAlgorithm: node %d Send to %d over %d\n", radio().id(), destination, next_hop );
 #endif
-          radio().send( destination, message.buffer_size(), (block_data_t*)&message );
-      }
+
+      message_id_t msg_id = STATIC_ROUTING_ID;
+      node_id_t id = radio().id();
+      size_t len = buffer.size();
+      block_data_t *header = buffer.push( HEADER_SIZE );
+      write<OsModel, block_data_t, message_id_t>( header, msg_id );
+      write<OsModel, block_data_t, node_id_t>( header + Message::SOURCE_ID_POS, id );
+      write<OsModel, block_data_t, node_id_t>( header + Message::DESTINATION_POS, destination );
+      write<OsModel, block_data_t, size_t>( header + Message::PAYLOAD_POS, len );
+
+      send_packet_buffer( radio(), next_hop, buffer );
+      buffer.pull( HEADER_SIZE );
 
       return SUCCESS;
    }
@@ -306,30 +345,47 @@ namespace wiselib
    void
    StaticRoutingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
    receive( node_id_t from, size_t len, block_data_t *data )
+   {
+      packet_buffer_t buffer;
+      buffer.wrap( data, len );
+      receive_buffer( from, buffer );
+   }
+   // -----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename RoutingTable_P,
+            typename Radio_P,
+            typename Debug_P>
+   void
+   StaticRoutingAlgorithm<OsModel_P, RoutingTable_P, Radio_P, Debug_P>::
+   receive_buffer( node_id_t from, packet_buffer_t& buffer )
    {
       if ( from == radio().id() )
          return;
 
-      message_id_t msg_id = read<OsModel, block_data_t, message_id_t>( data );
+      if ( buffer.size() < HEADER_SIZE )
+         return;
+
+      message_id_t msg_id = read<OsModel, block_data_t, message_id_t>( buffer.data() );
       if ( msg_id == STATIC_ROUTING_ID )
       {
          #ifdef ROUTING_STATIC_DEBUG
-            debug().debug( "StaticRoutingAlgorithm: got Message from %d on %d size: %d\n", from,radio().id(),len);
+            debug().debug( "StaticRoutingAlgorithm: got Message from %d on %d size: %d\n", from,radio().id(),buffer.size());
          #endif
 
-         Message *message = (Message *)data;
+         Message *message = (Message *)buffer.data();
          if ( message->destination() != radio().id() )
          {
-            #ifdef ROUTING_STATIC_DEBUG
-                debug().debug( "StaticRoutingAlgorithm: forward from node %d to node %d\n",
-                        radio().id(),hop_map_[radio().id()] );
-            #endif
-            if ( hop_map_.find( radio().id()) == hop_map_.end() )
+            MapTypeIterator it = hop_map_.find( radio().id() );
+            if ( it == hop_map_.end() )
             {
                debug().debug( "FATAL fwd: no entry for %d\n", radio().id() );
                return;
             }
-            radio().send( hop_map_[radio().id()], len, data );
+            #ifdef ROUTING_STATIC_DEBUG
+                debug().debug( "StaticRoutingAlgorithm: forward from node %d to node %d\n",
+                        radio().id(),it->second );
+            #endif
+            send_packet_buffer( radio(), it->second, buffer );
             return;
          }
          else
@@ -337,7 +393,15 @@ namespace wiselib
              #ifdef ROUTING_STATIC_DEBUG
                 debug().debug( "StaticRoutingAlgorithm: receive\n" );
              #endif
-             notify_receivers( message->source_id(), message->payload_size(), message->payload() );
+             // Pass message to each registered receiver, without copying.
+             node_id_t source = message->source_id();
+             size_t payload_size = message->payload_size();
+             buffer.pull( HEADER_SIZE );
+             if ( payload_size <= buffer.size() )
+             {
+                buffer.trim( payload_size );
+                this->notify_receivers( source, buffer );
+             }
              return;
          }
 
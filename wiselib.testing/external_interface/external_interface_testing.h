@@ -100,6 +100,15 @@
 #include "external_interface/pc/pc_rand.h"
 #include "external_interface/pc/pc_timer.h"
 #include "external_interface/pc/pc_wiselib_application.h"
+#ifdef PC_EVENT
+#include "external_interface/pc/pc_event_os_model.h"
+#endif
+#endif
+
+#ifdef PC_SIM
+#include "external_interface/pc_sim/pc_sim_os_model.h"
+#include "external_interface/pc_sim/pc_sim_facet_provider.h"
+#include "external_interface/pc_sim/pc_sim_wiselib_application.h"
 #endif
 
 #ifdef TRISOS
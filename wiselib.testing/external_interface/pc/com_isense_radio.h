@@ -96,15 +96,21 @@ namespace wiselib {
 			TxPower power();
 
 			int send(node_id_t, size_t, block_data_t*, int8_t tx_power=1);
+			int send_multi(node_id_t*, size_t, size_t, block_data_t*);
 
 			void uart_receive(typename ComUart::size_t, typename ComUart::block_data_t*);
 
 		private:
 			enum { DLE = 0x10, STX = 0x02, ETX = 0x03 };
+			/// Worst case: every byte of a maximum size packet escaped, plus framing
+			enum { FRAME_BUFFER_SIZE = 2 * 255 + 4 };
+			/// Frames send_multi() collects before writing them to the uart
+			enum { MULTI_FRAMES = 8 };
 
 			/// Shortcut for sending a single byte over uart
 			void send_uart(uint8_t);
 			int write_packet(packet_t&);
+			size_t append_frame(packet_t&, uint8_t*);
 
 			void interpret_uart_packet();
 
@@ -184,7 +190,9 @@ namespace wiselib {
 			write_packet(p);
 			// I know active waiting sucks, but probably requiring
 			// a clock/timer just for this would suck more
-			while(!id_valid_) {}
+			while(!id_valid_) {
+				uart_->process_input();
+			}
 		}
 
 		return id_;
@@ -214,7 +222,9 @@ namespace wiselib {
 		write_packet(p);
 		// I know active waiting sucks, but probably requiring
 		// a clock/timer just for this would suck more
-		while(busy_waiting_for_power_) {}
+		while(busy_waiting_for_power_) {
+			uart_->process_input();
+		}
 
 		return tx_power_;
 	}
@@ -247,6 +257,40 @@ namespace wiselib {
 		return write_packet(p);
 	}
 
+	/* Sends the message to all n destinations with unchanged transmission
+	 * power. The iSense radio protocol has no frame with a list of
+	 * destinations, so there is still one frame per destination, but the
+	 * frames are written to the uart in batches of MULTI_FRAMES.
+	 */
+	template<typename OsModel_P, typename ComUart_P, typename ExtendedData_P>
+	int ComISenseRadioModel<OsModel_P, ComUart_P, ExtendedData_P>::
+	send_multi( node_id_t* destinations, size_t n, size_t size, block_data_t* data ) {
+		uint8_t frames[MULTI_FRAMES * FRAME_BUFFER_SIZE];
+		size_t len = 0;
+
+		for(size_t i = 0; i < n; i++) {
+			packet_t p(packet_t::SUB_NONE);
+
+			p.push_header(packet_t::SUB_RADIO_OUT);
+			p.push_header(1);
+			p.push_header16((uint16_t)destinations[i]);
+
+			p.set_data(size, data);
+
+			len += append_frame(p, frames + len);
+
+			if( len > ( MULTI_FRAMES - 1 ) * FRAME_BUFFER_SIZE ) {
+				uart_->write(len, reinterpret_cast<typename ComUart::block_data_t*>(frames));
+				len = 0;
+			}
+		}
+
+		if( len > 0 )
+			uart_->write(len, reinterpret_cast<typename ComUart::block_data_t*>(frames));
+
+		return OsModel::SUCCESS;
+	}
+
 	// private:
 
 	template<typename OsModel_P, typename ComUart_P, typename ExtendedData_P>
@@ -258,59 +302,49 @@ namespace wiselib {
 	template<typename OsModel_P, typename ComUart_P, typename ExtendedData_P>
 	int ComISenseRadioModel<OsModel_P, ComUart_P, ExtendedData_P>::
 	write_packet(packet_t& p) {
-		// Block SIGALRM to avoid interrupting call of timer_handler.
+		// Assemble the whole frame first and hand it to the uart in one
+		// write, so frames sent from timer/signal context can not
+		// interleave with ours and there is one syscall per packet instead
+		// of one per byte.
+		uint8_t frame[FRAME_BUFFER_SIZE];
+		size_t len = append_frame(p, frame);
 
-		sigset_t signal_set, old_signal_set;
-		if ( ( sigemptyset( &signal_set ) == -1 ) ||
-				( sigaddset( &signal_set, SIGALRM ) == -1 ) ||
-				pthread_sigmask( SIG_BLOCK, &signal_set, &old_signal_set ) )
-		{
-			perror( "Failed to block SIGALRM" );
-		}
-                
-		send_uart(DLE);
-		send_uart(STX);
-
-		
-//		for(size_t i=0; i<p.header_size(); i++) {
-//			std::cout << "header[" << (int)i << "]=" << (int)p.header()[i] << "\n";
-//		}
-//		for(size_t i=0; i<p.data_size(); i++) {
-//			std::cout << "data[" << (int)i << "]=" << (int)p.data()[i] << "\n";
-//		}
-		
+		uart_->write(len, reinterpret_cast<typename ComUart::block_data_t*>(frame));
+
+		return OsModel::SUCCESS;
+	}
+
+	/* Writes the DLE/STX framed packet to frame, which must have room for
+	 * FRAME_BUFFER_SIZE bytes, and returns the number of bytes written.
+	 */
+	template<typename OsModel_P, typename ComUart_P, typename ExtendedData_P>
+	typename ComISenseRadioModel<OsModel_P, ComUart_P, ExtendedData_P>::size_t
+	ComISenseRadioModel<OsModel_P, ComUart_P, ExtendedData_P>::
+	append_frame(packet_t& p, uint8_t* frame) {
+		size_t len = 0;
+
+		frame[len++] = DLE;
+		frame[len++] = STX;
 
-                
 		for(size_t i=0; i<p.header_size(); i++) {
 			//DLE characters must be sent twice.
 			if( (uint8_t)p.header()[i] == DLE )
-				send_uart( DLE );
+				frame[len++] = DLE;
 
-			send_uart( p.header()[i] );
+			frame[len++] = p.header()[i];
 		}
 		for(size_t i=0; i<p.data_size(); i++) {
 			//DLE characters must be sent twice.
 			if( (uint8_t)p.data()[i] == DLE )
-				send_uart( DLE );
+				frame[len++] = DLE;
 
-			send_uart( p.data()[i] );
+			frame[len++] = p.data()[i];
 		}
 
-		send_uart(DLE);
-		send_uart(ETX);
-
-		// Unblock SIGALRM.
-		if( sigismember( &old_signal_set, SIGALRM ) == 0 )
-		{
-			if ( ( sigemptyset( &signal_set ) == -1 ) ||
-					( sigaddset( &signal_set, SIGALRM ) == -1 ) ||
-					pthread_sigmask( SIG_UNBLOCK, &signal_set, 0 ) )
-			{
-				perror( "Failed to unblock SIGALRM" );
-			}
-		}
+		frame[len++] = DLE;
+		frame[len++] = ETX;
 
-		return OsModel::SUCCESS;
+		return len;
 	}
 
 	template<typename OsModel_P, typename ComUart_P, typename ExtendedData_P>
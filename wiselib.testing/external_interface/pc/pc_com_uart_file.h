@@ -113,6 +113,12 @@ namespace wiselib {
 			int write(size_t len, block_data_t* buf);
 			void try_read(void* userdata);
 			
+			/**
+			 * Input is polled from the timer (i.e. from the SIGALRM
+			 * handler), so busy-waiting callers need not do anything.
+			 */
+			void process_input(int timeout_ms = 10) {}
+			
 			const char* address() { return address_; }
 			
 		private:
@@ -0,0 +1,245 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+// vim: set noexpandtab ts=4 sw=4:
+
+#ifndef PC_EVENT_COM_UART_H
+#define PC_EVENT_COM_UART_H
+
+#include "util/base_classes/uart_base.h"
+
+#include <cassert>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <err.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+
+namespace wiselib {
+
+	/** \brief Uart model for the epoll based PC OS model
+	 *  \ingroup uart_concept
+	 *  \ingroup serial_communication_concept
+	 *
+	 *  Same configuration as PCComUartModel (set_address(), set_baudrate(),
+	 *  then enable_serial_comm()), but instead of polling the port from a
+	 *  10ms timer, the port is registered with the event loop and read as
+	 *  soon as data arrives. No signals need to be blocked.
+	 *
+	 *  \tparam isense_reset If true, toggle RTS/DTR lines at beginning of communication so
+	 *                 an attached iSense node will reboot.
+	 */
+	template<
+		typename OsModel_P,
+		const bool isense_reset_ = false,
+		typename EventLoop_P = typename OsModel_P::EventLoop,
+		typename Timer_P = typename OsModel_P::Timer
+	>
+	class PCEventComUartModel
+		: public UartBase<OsModel_P, typename OsModel_P::size_t, char>
+	{
+		public:
+			typedef OsModel_P OsModel;
+			typedef EventLoop_P EventLoop;
+			typedef Timer_P Timer;
+			typedef typename OsModel::size_t size_t;
+			typedef char block_data_t;
+			typedef PCEventComUartModel<OsModel_P, isense_reset_, EventLoop_P, Timer_P> self_type;
+			typedef self_type* self_pointer_t;
+
+			enum ErrorCodes
+			{
+				SUCCESS = OsModel::SUCCESS,
+				ERR_UNSPEC = OsModel::ERR_UNSPEC
+			};
+
+			enum { BUFFER_SIZE = 256 };
+
+			PCEventComUartModel();
+
+			void set_baudrate(uint32_t baudrate) {
+				switch(baudrate) {
+					case 9600: baudrate_ = B9600; break;
+					case 19200: baudrate_ = B19200; break;
+					case 38400: baudrate_ = B38400; break;
+					case 57600: baudrate_ = B57600; break;
+					case 115200: baudrate_ = B115200; break;
+					default:
+						assert(false);
+				}
+			}
+
+			void set_address(const char* port) {
+				address_ = port;
+			}
+
+			int enable_serial_comm();
+			int disable_serial_comm();
+
+			int write(size_t len, block_data_t* buf);
+
+			/**
+			 * Waits up to timeout_ms for input and handles it right away.
+			 * For callers that need to busy-wait for an answer while the
+			 * event loop is not running.
+			 */
+			void process_input(int timeout_ms = 10);
+
+			const char* address() { return address_; }
+
+		private:
+			void on_readable(int fd);
+
+			Timer timer_;
+			::speed_t baudrate_;
+			const char* address_;
+
+			int port_fd_;
+	}; // class PCEventComUartModel
+
+	template<typename OsModel_P, const bool isense_reset_, typename EventLoop_P, typename Timer_P>
+	PCEventComUartModel<OsModel_P, isense_reset_, EventLoop_P, Timer_P>::
+	PCEventComUartModel() : baudrate_(B115200), address_("/dev/ttyUSB0"), port_fd_(-1) {
+	}
+
+	template<typename OsModel_P, const bool isense_reset_, typename EventLoop_P, typename Timer_P>
+	int PCEventComUartModel<OsModel_P, isense_reset_, EventLoop_P, Timer_P>::
+	enable_serial_comm() {
+		struct termios attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.c_cflag = baudrate_|CS8|CREAD|CLOCAL; // 8N1
+		attr.c_iflag = 0;
+		attr.c_oflag = 0;
+		attr.c_lflag = 0;
+		attr.c_cc[VMIN] = 1;
+		attr.c_cc[VTIME] = 0;
+
+		port_fd_ = open(address_, O_RDWR | O_NONBLOCK | O_NOCTTY);
+		if(port_fd_ < 0) {
+			err(1, "Error opening UART %s", address_);
+		}
+
+		if( ( cfsetospeed(&attr, baudrate_) == -1 ) ||
+			( cfsetispeed(&attr, baudrate_) == -1 ) )
+		{
+			perror( "Could not set baudrate:" );
+		}
+
+		tcflush(port_fd_, TCOFLUSH);
+		tcflush(port_fd_, TCIFLUSH);
+		if(tcsetattr(port_fd_, TCSANOW, &attr) == -1) {
+			err(1, "Error during tcsetattr() on %s", address_);
+		}
+
+		if(isense_reset_) {
+			int status = TIOCM_RTS | TIOCM_DTR;
+			ioctl(port_fd_, TIOCMSET, &status);
+			timer_.sleep(100);
+			status = 0;
+			ioctl(port_fd_, TIOCMSET, &status);
+			timer_.sleep(100);
+		}
+
+		if(EventLoop::add_fd(port_fd_, EventLoop::fd_delegate_t::template from_method<self_type, &self_type::on_readable>(this)) != SUCCESS) {
+			return ERR_UNSPEC;
+		}
+
+		return SUCCESS;
+	}
+
+	template<typename OsModel_P, const bool isense_reset_, typename EventLoop_P, typename Timer_P>
+	int PCEventComUartModel<OsModel_P, isense_reset_, EventLoop_P, Timer_P>::
+	disable_serial_comm() {
+		if(port_fd_ != -1) {
+			EventLoop::remove_fd(port_fd_);
+			close(port_fd_);
+			port_fd_ = -1;
+		}
+		return SUCCESS;
+	}
+
+	template<typename OsModel_P, const bool isense_reset_, typename EventLoop_P, typename Timer_P>
+	int PCEventComUartModel<OsModel_P, isense_reset_, EventLoop_P, Timer_P>::
+	write(size_t len, block_data_t* buf) {
+		size_t written = 0;
+
+		while(written < len) {
+			int r = ::write(port_fd_, reinterpret_cast<void*>(buf + written), len - written);
+			if(r >= 0) {
+				written += r;
+			}
+			else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+				// Output buffer full, wait until the port drains
+				struct pollfd pfd;
+				pfd.fd = port_fd_;
+				pfd.events = POLLOUT;
+				poll(&pfd, 1, -1);
+			}
+			else if(errno != EINTR) {
+				warn("Error writing to UART %s", address_);
+				return ERR_UNSPEC;
+			}
+		}
+
+		return SUCCESS;
+	}
+
+	template<typename OsModel_P, const bool isense_reset_, typename EventLoop_P, typename Timer_P>
+	void PCEventComUartModel<OsModel_P, isense_reset_, EventLoop_P, Timer_P>::
+	process_input(int timeout_ms) {
+		struct pollfd pfd;
+		pfd.fd = port_fd_;
+		pfd.events = POLLIN;
+		if(poll(&pfd, 1, timeout_ms) > 0) {
+			on_readable(port_fd_);
+		}
+	}
+
+	template<typename OsModel_P, const bool isense_reset_, typename EventLoop_P, typename Timer_P>
+	void PCEventComUartModel<OsModel_P, isense_reset_, EventLoop_P, Timer_P>::
+	on_readable(int fd) {
+		block_data_t buffer[BUFFER_SIZE];
+
+		// drain everything that is available, the fd is non-blocking
+		while(true) {
+			int bytes = ::read(fd, static_cast<void*>(buffer), BUFFER_SIZE);
+			if(bytes > 0) {
+				self_type::notify_receivers(bytes, buffer);
+			}
+			else if(bytes == -1 && errno == EINTR) {
+				continue;
+			}
+			else {
+				if(bytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+					err(1, "Couldnt read from UART %s", address_);
+				}
+				break;
+			}
+		}
+	}
+
+} // ns wiselib
+
+#endif // PC_EVENT_COM_UART_H
+
@@ -0,0 +1,283 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+// vim: set noexpandtab ts=4 sw=4:
+
+#ifndef PC_EVENT_LOOP_H
+#define PC_EVENT_LOOP_H
+
+#include <err.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "util/delegates/delegate.hpp"
+#include "external_interface/pc/pc_timer.h"
+
+namespace wiselib {
+
+	/** \brief Single-threaded epoll reactor for the PC platform (Linux only).
+	 *
+	 * All timers share one timerfd which is always armed for the earliest
+	 * deadline of a HeapTimerQueue; file descriptors (UARTs, sockets) are
+	 * watched for readability. Callbacks are invoked from run(), i.e. in
+	 * normal thread context, never from a signal handler, so no signal
+	 * masking is needed anywhere.
+	 *
+	 * Like PCTimerModel, the state is static so all Timer/Uart instances
+	 * of one OS model share the same loop.
+	 */
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	class PCEventLoop {
+		public:
+			typedef OsModel_P OsModel;
+			typedef PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P> self_t;
+			typedef HeapTimerQueue<OsModel_P, MaxTimers_P> queue_t;
+			typedef typename queue_t::micros_t micros_t;
+			typedef typename queue_t::timer_delegate_t timer_delegate_t;
+			typedef delegate1<void, int> fd_delegate_t;
+
+			enum Restrictions {
+				MAX_TIMERS = MaxTimers_P,
+				MAX_WATCHES = MaxWatches_P
+			};
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+
+			/**
+			 * Call callback with the file descriptor whenever fd becomes
+			 * readable. fd should be non-blocking.
+			 */
+			static int add_fd(int fd, fd_delegate_t callback);
+			static int remove_fd(int fd);
+
+			static int set_timer(micros_t interval, timer_delegate_t callback, void* userdata);
+
+			/**
+			 * Wait for at most timeout_ms (-1 = forever) and dispatch all
+			 * events that occurred.
+			 */
+			static int run_once(int timeout_ms = -1);
+
+			/// Dispatch events until stop() is called.
+			static void run();
+			static void stop() { running_ = false; }
+
+		private:
+			enum { TIMER_WATCH = 0xffffffff };
+
+			struct Watch {
+				int fd_;
+				fd_delegate_t callback_;
+			};
+
+			static void init();
+			static void arm_timer();
+			static void handle_timers();
+
+			static queue_t queue_;
+			static Watch watches_[MaxWatches_P];
+			static int epoll_fd_;
+			static int timer_fd_;
+			static bool running_;
+			static bool dispatching_timers_;
+	};
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	typename PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::queue_t
+	PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::queue_;
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	typename PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::Watch
+	PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::watches_[MaxWatches_P];
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	int PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::epoll_fd_ = -1;
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	int PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::timer_fd_ = -1;
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	bool PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::running_ = false;
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	bool PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::dispatching_timers_ = false;
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	void PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::
+	init() {
+		if(epoll_fd_ != -1) {
+			return;
+		}
+
+		for(size_t i = 0; i < MAX_WATCHES; i++) {
+			watches_[i].fd_ = -1;
+		}
+
+		epoll_fd_ = epoll_create(MAX_WATCHES + 1);
+		if(epoll_fd_ == -1) {
+			err(1, "epoll_create() failed");
+		}
+
+		timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+		if(timer_fd_ == -1) {
+			err(1, "timerfd_create() failed");
+		}
+
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u32 = TIMER_WATCH;
+		if(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &ev) == -1) {
+			err(1, "epoll_ctl() failed for timerfd");
+		}
+	}
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	int PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::
+	add_fd(int fd, fd_delegate_t callback) {
+		init();
+
+		for(size_t i = 0; i < MAX_WATCHES; i++) {
+			if(watches_[i].fd_ == -1) {
+				struct epoll_event ev;
+				ev.events = EPOLLIN;
+				ev.data.u32 = i;
+				if(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+					perror("epoll_ctl() failed");
+					return ERR_UNSPEC;
+				}
+				watches_[i].fd_ = fd;
+				watches_[i].callback_ = callback;
+				return SUCCESS;
+			}
+		}
+		return ERR_UNSPEC;
+	}
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	int PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::
+	remove_fd(int fd) {
+		init();
+
+		for(size_t i = 0; i < MAX_WATCHES; i++) {
+			if(watches_[i].fd_ == fd) {
+				epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, 0);
+				watches_[i].fd_ = -1;
+				return SUCCESS;
+			}
+		}
+		return ERR_UNSPEC;
+	}
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	int PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::
+	set_timer(micros_t interval, timer_delegate_t callback, void* userdata) {
+		init();
+
+		if(queue_.insert(interval, callback, userdata) == ERR_UNSPEC) {
+			return ERR_UNSPEC;
+		}
+
+		// Timers set from within timer callbacks are accounted for when
+		// the dispatch loop re-arms the timerfd
+		if(!dispatching_timers_) {
+			arm_timer();
+		}
+		return SUCCESS;
+	}
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	void PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::
+	arm_timer() {
+		struct itimerval timer;
+		queue_.to_itimer(timer);
+
+		struct itimerspec spec;
+		spec.it_interval.tv_sec = 0;
+		spec.it_interval.tv_nsec = 0;
+		spec.it_value.tv_sec = timer.it_value.tv_sec;
+		spec.it_value.tv_nsec = timer.it_value.tv_usec * 1000;
+
+		if(timerfd_settime(timer_fd_, 0, &spec, 0) == -1) {
+			perror("timerfd_settime() failed");
+		}
+	}
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	void PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::
+	handle_timers() {
+		uint64_t expirations;
+		if(::read(timer_fd_, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+			perror("read() on timerfd failed");
+		}
+
+		dispatching_timers_ = true;
+		while(queue_.has_event()) {
+			timer_delegate_t callback = queue_.current_callback();
+			void *userdata = queue_.current_userdata();
+			queue_.pop();
+			callback(userdata);
+		}
+		dispatching_timers_ = false;
+
+		arm_timer();
+	}
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	int PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::
+	run_once(int timeout_ms) {
+		init();
+
+		struct epoll_event events[MAX_WATCHES + 1];
+		int n = epoll_wait(epoll_fd_, events, MAX_WATCHES + 1, timeout_ms);
+		if(n == -1) {
+			if(errno != EINTR) {
+				perror("epoll_wait() failed");
+				return ERR_UNSPEC;
+			}
+			return SUCCESS;
+		}
+
+		for(int i = 0; i < n; i++) {
+			uint32_t w = events[i].data.u32;
+			if(w == TIMER_WATCH) {
+				handle_timers();
+			}
+			else if(w < MAX_WATCHES && watches_[w].fd_ != -1) {
+				watches_[w].callback_(watches_[w].fd_);
+			}
+		}
+		return SUCCESS;
+	}
+
+	template<typename OsModel_P, size_t MaxTimers_P, size_t MaxWatches_P>
+	void PCEventLoop<OsModel_P, MaxTimers_P, MaxWatches_P>::
+	run() {
+		running_ = true;
+		while(running_) {
+			if(run_once() == ERR_UNSPEC) {
+				break;
+			}
+		}
+	}
+
+} // namespace wiselib
+
+#endif // PC_EVENT_LOOP_H
+
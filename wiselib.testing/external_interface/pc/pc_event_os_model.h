@@ -0,0 +1,68 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+// vim: set noexpandtab ts=4 sw=4:
+
+#ifndef PC_EVENT_OS_MODEL_H
+#define PC_EVENT_OS_MODEL_H
+
+#include "external_interface/pc/pc_os_model.h"
+#include "external_interface/pc/pc_event_loop.h"
+#include "external_interface/pc/pc_event_timer.h"
+#include "external_interface/pc/pc_event_com_uart.h"
+
+namespace wiselib {
+	/** \brief PC OS model driven by a single-threaded epoll reactor
+	 *  (Linux only).
+	 *
+	 * Alternative to PCOsModel: timers use a timerfd and UART input is
+	 * delivered on fd readiness, all from EventLoop::run() (see
+	 * standalone/main_event.cc), so no callback ever runs in signal
+	 * context.
+	 */
+	class PCEventOsModel
+		: public DefaultReturnValues<PCEventOsModel>
+	{
+		public:
+			int argc;
+			const char** argv;
+
+			typedef PCEventOsModel AppMainParameter;
+			typedef PCEventOsModel Os;
+
+			typedef uint32_t size_t;
+			typedef uint8_t block_data_t;
+
+			typedef PCEventLoop<PCEventOsModel, 1000, 16> EventLoop;
+
+			typedef PCClockModel<PCEventOsModel> Clock;
+			typedef PCDebug<PCEventOsModel> Debug;
+			typedef PCRandModel<PCEventOsModel> Rand;
+			typedef PCEventTimerModel<PCEventOsModel, EventLoop> Timer;
+
+			typedef PCEventComUartModel<PCEventOsModel, true, EventLoop, Timer> ISenseUart;
+			typedef PCEventComUartModel<PCEventOsModel, false, EventLoop, Timer> Uart;
+			typedef ComISenseRadioModel<PCEventOsModel, ISenseUart> Radio;
+
+			static const Endianness endianness = WISELIB_ENDIANNESS;
+	};
+} // ns wiselib
+
+#endif // PC_EVENT_OS_MODEL_H
+
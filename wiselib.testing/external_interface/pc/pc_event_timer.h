@@ -0,0 +1,87 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+// vim: set noexpandtab ts=4 sw=4:
+
+#ifndef PC_EVENT_TIMER_H
+#define PC_EVENT_TIMER_H
+
+#include <time.h>
+#include <errno.h>
+
+#include "util/delegates/delegate.hpp"
+
+namespace wiselib {
+
+	/** \brief Timer model for the epoll based PC OS model.
+	 *  \ingroup timer_concept
+	 *
+	 * Timers are kept by the shared PCEventLoop and fire from its run()
+	 * loop instead of a SIGALRM handler.
+	 */
+	template<typename OsModel_P, typename EventLoop_P = typename OsModel_P::EventLoop>
+	class PCEventTimerModel {
+		public:
+			typedef OsModel_P OsModel;
+			typedef EventLoop_P EventLoop;
+			typedef suseconds_t millis_t;
+			typedef suseconds_t micros_t;
+			typedef delegate1<void, void*> timer_delegate_t;
+			typedef PCEventTimerModel<OsModel_P, EventLoop_P> self_t;
+			typedef self_t* self_pointer_t;
+
+			enum Restrictions {
+				MAX_TIMERS = EventLoop::MAX_TIMERS
+			};
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+
+			PCEventTimerModel() {
+			}
+
+			template<typename T, void (T::*TMethod)(void*)>
+			int set_timer(millis_t millis, T* obj, void* userdata) {
+				if(millis < 1) {
+					return ERR_UNSPEC;
+				}
+				return EventLoop::set_timer(millis * 1000, timer_delegate_t::from_method<T, TMethod>(obj), userdata);
+			}
+
+			/**
+			 * Blocks the whole event loop, no timers or I/O are handled
+			 * meanwhile.
+			 */
+			int sleep(millis_t millis) {
+				timespec interval, remainder;
+
+				interval.tv_sec = millis / 1000;
+				interval.tv_nsec = (millis % 1000) * 1000000;
+
+				while((nanosleep(&interval, &remainder) == -1) && (errno == EINTR)) {
+					interval.tv_sec = remainder.tv_sec;
+					interval.tv_nsec = remainder.tv_nsec;
+				}
+
+				return SUCCESS;
+			}
+	}; // class PCEventTimerModel
+
+} // namespace wiselib
+
+#endif // PC_EVENT_TIMER_H
+
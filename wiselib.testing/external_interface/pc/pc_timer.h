@@ -83,14 +83,73 @@ namespace wiselib {
 			bool locked_;
 	};
 	
+	/**
+	 * Timer queue backed by a binary min-heap of absolute (monotonic)
+	 * deadlines. Unlike TimerQueue, which keeps a sorted list of delta
+	 * offsets and thus needs O(n) per insertion, both insert() and pop()
+	 * are O(log n). Timers with equal deadlines fire in insertion order.
+	 * 
+	 * Select it as third template parameter of PCTimerModel, e.g.
+	 * PCTimerModel<Os, 1000, HeapTimerQueue<Os, 1000> >.
+	 */
 	template<typename OsModel_P, size_t MaxTimers_P>
+	class HeapTimerQueue {
+		public:
+			typedef HeapTimerQueue<OsModel_P, MaxTimers_P> self_t;
+			typedef suseconds_t micros_t;
+			typedef suseconds_t millis_t;
+			typedef delegate1<void, void*> timer_delegate_t;
+			typedef OsModel_P OsModel;
+			
+			enum Restrictions {
+				MAX_TIMERS = MaxTimers_P
+			};
+			
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+			
+			HeapTimerQueue();
+			
+			int insert(micros_t interval, timer_delegate_t callback, void* userdata);
+			int lock();
+			int unlock();
+			int from_itimer(struct itimerval& timer);
+			int to_itimer(struct itimerval& timer);
+			bool has_event();
+			timer_delegate_t current_callback();
+			void* current_userdata();
+			int pop();
+			
+			size_t size() { return size_; }
+			void debug();
+			
+		private:
+			typedef uint64_t abs_micros_t;
+			
+			struct Timer {
+				timer_delegate_t callback_;
+				abs_micros_t deadline_;
+				uint32_t seq_;
+				void *userdata_;
+			};
+			
+			static abs_micros_t now();
+			bool before(const Timer& a, const Timer& b) const;
+			
+			Timer data_[MAX_TIMERS];
+			size_t size_;
+			uint32_t seq_;
+			bool locked_;
+	};
+	
+	template<typename OsModel_P, size_t MaxTimers_P, typename Queue_P = TimerQueue<OsModel_P, MaxTimers_P> >
 	class PCTimerModel {
 		public:
 			typedef OsModel_P OsModel;
 			typedef suseconds_t millis_t;
 			typedef suseconds_t micros_t;
 			typedef delegate1<void, void*> timer_delegate_t;
-			typedef PCTimerModel<OsModel_P, MaxTimers_P> self_t;
+			typedef PCTimerModel<OsModel_P, MaxTimers_P, Queue_P> self_t;
+			typedef Queue_P queue_t;
 			typedef self_t* self_pointer_t;
 			
 			enum Restrictions {
@@ -123,7 +182,7 @@ namespace wiselib {
 				return OsModel::SUCCESS;
 			}
 			
-			static TimerQueue<OsModel_P, MaxTimers_P> queue_;
+			static queue_t queue_;
 			static void timer_handler_(int signum);
 			
 			/**
@@ -249,19 +308,165 @@ namespace wiselib {
 	}
 	
 	//
-	// Implementation PCTimerModel
+	// Implementation HeapTimerQueue
 	//
 	
 	template<typename OsModel_P, size_t MaxTimers_P>
-	TimerQueue<OsModel_P, MaxTimers_P>
-	PCTimerModel<OsModel_P, MaxTimers_P>::queue_;
+	HeapTimerQueue<OsModel_P, MaxTimers_P>::HeapTimerQueue() : size_(0), seq_(0), locked_(false) {
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	typename HeapTimerQueue<OsModel_P, MaxTimers_P>::abs_micros_t HeapTimerQueue<OsModel_P, MaxTimers_P>::now() {
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (abs_micros_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	bool HeapTimerQueue<OsModel_P, MaxTimers_P>::before(const Timer& a, const Timer& b) const {
+		if(a.deadline_ != b.deadline_) {
+			return a.deadline_ < b.deadline_;
+		}
+		// sequence numbers may wrap, compare them as a window
+		return (int32_t)(a.seq_ - b.seq_) < 0;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	int HeapTimerQueue<OsModel_P, MaxTimers_P>::insert(
+		HeapTimerQueue<OsModel_P, MaxTimers_P>::micros_t interval,
+		HeapTimerQueue<OsModel_P, MaxTimers_P>::timer_delegate_t callback,
+		void* userdata
+	) {
+		if(size_ == MAX_TIMERS) {
+			return ERR_UNSPEC;
+		}
+		
+		Timer new_timer;
+		new_timer.callback_ = callback;
+		new_timer.deadline_ = now() + interval;
+		new_timer.seq_ = seq_++;
+		new_timer.userdata_ = userdata;
+		
+		// sift up
+		size_t i = size_++;
+		while(i > 0 && before(new_timer, data_[(i - 1) / 2])) {
+			data_[i] = data_[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+		data_[i] = new_timer;
+		
+		return SUCCESS;
+	}
 	
 	template<typename OsModel_P, size_t MaxTimers_P>
+	int HeapTimerQueue<OsModel_P, MaxTimers_P>::lock() {
+		if(locked_) {
+			return ERR_UNSPEC;
+		}
+		locked_ = true;
+		return SUCCESS;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	int HeapTimerQueue<OsModel_P, MaxTimers_P>::unlock() {
+		locked_ = false;
+		return SUCCESS;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	int HeapTimerQueue<OsModel_P, MaxTimers_P>::from_itimer(struct itimerval& timer) {
+		// Deadlines are absolute, nothing to account for
+		return SUCCESS;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	int HeapTimerQueue<OsModel_P, MaxTimers_P>::to_itimer(struct itimerval& timer) {
+		timer.it_interval.tv_sec = 0;
+		timer.it_interval.tv_usec = 0;
+		timer.it_value.tv_sec = 0;
+		timer.it_value.tv_usec = 0;
+		if(size_ == 0) {
+			return SUCCESS;
+		}
+		
+		abs_micros_t t = now();
+		// an all-zero it_value would disarm the timer, so fire in 1us when
+		// the deadline has already passed
+		abs_micros_t delta = (data_[0].deadline_ > t) ? (data_[0].deadline_ - t) : 1;
+		timer.it_value.tv_sec = delta / 1000000;
+		timer.it_value.tv_usec = delta % 1000000;
+		return SUCCESS;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	bool HeapTimerQueue<OsModel_P, MaxTimers_P>::has_event() {
+		return (size_ != 0) && (data_[0].deadline_ <= now());
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	typename HeapTimerQueue<OsModel_P, MaxTimers_P>::timer_delegate_t HeapTimerQueue<OsModel_P, MaxTimers_P>::current_callback() {
+		return data_[0].callback_;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	void* HeapTimerQueue<OsModel_P, MaxTimers_P>::current_userdata() {
+		return data_[0].userdata_;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	int HeapTimerQueue<OsModel_P, MaxTimers_P>::pop() {
+		if(size_ == 0) {
+			return SUCCESS;
+		}
+		
+		// sift down the last element from the root
+		Timer last = data_[--size_];
+		size_t i = 0;
+		while(2 * i + 1 < size_) {
+			size_t c = 2 * i + 1;
+			if(c + 1 < size_ && before(data_[c + 1], data_[c])) {
+				c++;
+			}
+			if(!before(data_[c], last)) {
+				break;
+			}
+			data_[i] = data_[c];
+			i = c;
+		}
+		data_[i] = last;
+		
+		return SUCCESS;
+	}
+	
+	template<typename OsModel_P, size_t MaxTimers_P>
+	void HeapTimerQueue<OsModel_P, MaxTimers_P>::debug() {
+		abs_micros_t t = now();
+		for(size_t i = 0; i < size_; i++) {
+			std::cout << (int64_t)(data_[i].deadline_ - t) << " ";
+		}
+		if(has_event()) {
+			std::cout << "[has_event] ";
+		}
+		if(size_ == MAX_TIMERS) {
+			std::cout << "[FULL!] ";
+		}
+		std::cout << std::endl;
+	}
+	
+	//
+	// Implementation PCTimerModel
+	//
+	
+	template<typename OsModel_P, size_t MaxTimers_P, typename Queue_P>
+	Queue_P
+	PCTimerModel<OsModel_P, MaxTimers_P, Queue_P>::queue_;
+	
+	template<typename OsModel_P, size_t MaxTimers_P, typename Queue_P>
 	bool
-	PCTimerModel<OsModel_P, MaxTimers_P>::itimer_active_;
+	PCTimerModel<OsModel_P, MaxTimers_P, Queue_P>::itimer_active_;
 
-	template<typename OsModel_P, size_t MaxTimers_P>
-	PCTimerModel<OsModel_P, MaxTimers_P>::PCTimerModel() {
+	template<typename OsModel_P, size_t MaxTimers_P, typename Queue_P>
+	PCTimerModel<OsModel_P, MaxTimers_P, Queue_P>::PCTimerModel() {
 		struct sigaction alarm_action;
 		alarm_action.sa_handler = &PCTimerModel::timer_handler_;
 		alarm_action.sa_flags = 0;
@@ -275,9 +480,9 @@ namespace wiselib {
 		itimer_active_ = false;
 	}
 		
-	template<typename OsModel_P, size_t MaxTimers_P>
+	template<typename OsModel_P, size_t MaxTimers_P, typename Queue_P>
 	template<typename T, void (T::*TMethod)(void*)>
-	int PCTimerModel<OsModel_P, MaxTimers_P>::
+	int PCTimerModel<OsModel_P, MaxTimers_P, Queue_P>::
 	set_timer(millis_t millis, T* obj, void* userdata) {
 		struct itimerval timer;
 		
@@ -327,8 +532,8 @@ namespace wiselib {
 		return OsModel::SUCCESS;
 	}
 	
-	template<typename OsModel_P, size_t MaxTimers_P>
-	void PCTimerModel<OsModel_P, MaxTimers_P>::
+	template<typename OsModel_P, size_t MaxTimers_P, typename Queue_P>
+	void PCTimerModel<OsModel_P, MaxTimers_P, Queue_P>::
 	timer_handler_(int signum) {
 		int save_errno = errno;
 		
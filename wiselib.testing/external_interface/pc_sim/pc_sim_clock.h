@@ -0,0 +1,90 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef CONNECTOR_PC_SIM_CLOCK_H
+#define CONNECTOR_PC_SIM_CLOCK_H
+
+#include "external_interface/pc_sim/pc_sim_world.h"
+
+namespace wiselib
+{
+   /** \brief PC simulator implementation of \ref clock_concept "Clock Concept"
+    *  \ingroup clock_concept
+    *
+    *  Returns the simulated time in seconds, like ShawnClockModel.
+    */
+   template<typename OsModel_P>
+   class PCSimClockModel
+   {
+   public:
+      typedef OsModel_P OsModel;
+
+      typedef PCSimClockModel<OsModel> self_type;
+      typedef self_type* self_pointer_t;
+
+      typedef double time_t;
+      // --------------------------------------------------------------------
+      enum
+      {
+         READY = OsModel::READY,
+         NO_VALUE = OsModel::NO_VALUE,
+         INACTIVE = OsModel::INACTIVE
+      };
+      // --------------------------------------------------------------------
+      enum {
+         CLOCKS_PER_SECOND = 1000
+      };
+      // --------------------------------------------------------------------
+      PCSimClockModel( PCSimOs& os )
+         : os_(os)
+      {}
+      // --------------------------------------------------------------------
+      int state()
+      {
+         return READY;
+      }
+      // --------------------------------------------------------------------
+      time_t time()
+      {
+         return os().world->now( os().id ) / 1000000.0;
+      }
+      // --------------------------------------------------------------------
+      uint16_t microseconds( time_t time )
+      {
+         return (uint16_t)( (uint32_t)( time * 1000000.0 ) % 1000 );
+      }
+      // --------------------------------------------------------------------
+      uint16_t milliseconds( time_t time )
+      {
+         return (uint16_t)( (uint32_t)( time * 1000.0 ) % 1000 );
+      }
+      // --------------------------------------------------------------------
+      uint32_t seconds( time_t time )
+      {
+         return (uint32_t)time;
+      }
+
+   private:
+      PCSimOs& os()
+      { return os_; }
+      // --------------------------------------------------------------------
+      PCSimOs& os_;
+   };
+}
+
+#endif
@@ -0,0 +1,72 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef CONNECTOR_PC_SIM_DEBUG_H
+#define CONNECTOR_PC_SIM_DEBUG_H
+
+#include <cstdarg>
+#include <cstdio>
+
+#include "external_interface/pc_sim/pc_sim_world.h"
+
+namespace wiselib
+{
+
+   /** \brief PC simulator implementation of \ref debug_concept "Debug Concept".
+    *
+    *  \ingroup debug_concept
+    *
+    *  Prefixes every message with simulated time and node id. Output can
+    *  be switched off for the whole world, which matters for large runs.
+    */
+   template<typename OsModel_P>
+   class PCSimDebug
+   {
+   public:
+      typedef OsModel_P OsModel;
+
+      typedef PCSimDebug<OsModel> self_type;
+      typedef self_type* self_pointer_t;
+      // --------------------------------------------------------------------
+      PCSimDebug( PCSimOs& os )
+         : os_(os)
+      {}
+      // --------------------------------------------------------------------
+      void debug( const char *msg, ... )
+      {
+         if ( !os().world->debug_enabled() )
+            return;
+
+         va_list fmtargs;
+         char buffer[1024];
+         va_start( fmtargs, msg );
+         vsnprintf( buffer, sizeof(buffer) - 1, msg, fmtargs );
+         va_end( fmtargs );
+         printf( "[%.6f %u] %s", os().world->now( os().id ) / 1000000.0,
+            (unsigned)os().id, buffer );
+      }
+
+   private:
+      PCSimOs& os()
+      { return os_; }
+      // --------------------------------------------------------------------
+      PCSimOs& os_;
+   };
+}
+
+#endif
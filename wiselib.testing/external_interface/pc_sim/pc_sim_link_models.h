@@ -0,0 +1,203 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef CONNECTOR_PC_SIM_LINK_MODELS_H
+#define CONNECTOR_PC_SIM_LINK_MODELS_H
+
+#include <stdint.h>
+#include <math.h>
+
+namespace wiselib
+{
+
+   /** \brief Small deterministic PRNG (xorshift64*) used by the simulator.
+    *
+    *  Every run with the same seed produces the same result, independent
+    *  of the C library.
+    */
+   class PCSimRandom
+   {
+   public:
+      PCSimRandom( uint64_t seed = 1 )
+      { srand( seed ); }
+      // --------------------------------------------------------------------
+      void srand( uint64_t seed )
+      { state_ = seed ? seed : 0x9e3779b97f4a7c15ULL; }
+      // --------------------------------------------------------------------
+      uint32_t operator()()
+      {
+         state_ ^= state_ >> 12;
+         state_ ^= state_ << 25;
+         state_ ^= state_ >> 27;
+         return (uint32_t)( ( state_ * 2685821657736338717ULL ) >> 32 );
+      }
+      // --------------------------------------------------------------------
+      /// Uniformly distributed in [0, 1)
+      double uniform()
+      { return (*this)() / 4294967296.0; }
+      // --------------------------------------------------------------------
+      /// Standard normal distribution (Box-Muller)
+      double gaussian()
+      {
+         double u1 = uniform();
+         double u2 = uniform();
+         if ( u1 < 1e-12 )
+            u1 = 1e-12;
+         return sqrt( -2.0 * log( u1 ) ) * cos( 2.0 * M_PI * u2 );
+      }
+
+   private:
+      uint64_t state_;
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** \brief Interface of link models for the PC simulator.
+    *
+    *  A link model decides, for a given sender/receiver distance, whether a
+    *  transmission is received, and which link metric (the smaller, the
+    *  better) is reported along with it.
+    */
+   class PCSimLinkModel
+   {
+   public:
+      virtual ~PCSimLinkModel() {}
+      // --------------------------------------------------------------------
+      /** Maximum distance at which any transmission can be received. Used
+       *  to restrict the set of candidate receivers.
+       */
+      virtual double range() const = 0;
+      // --------------------------------------------------------------------
+      virtual bool deliver( double distance, PCSimRandom& rand, uint16_t& link_metric ) = 0;
+   };
+   // -----------------------------------------------------------------------
+   /** \brief Unit disk graph: everything within range is received.
+    */
+   class PCSimUnitDiskLinkModel
+      : public PCSimLinkModel
+   {
+   public:
+      PCSimUnitDiskLinkModel( double range )
+         : range_ ( range )
+      {}
+      // --------------------------------------------------------------------
+      double range() const
+      { return range_; }
+      // --------------------------------------------------------------------
+      bool deliver( double distance, PCSimRandom& rand, uint16_t& link_metric )
+      {
+         if ( distance > range_ )
+            return false;
+
+         link_metric = (uint16_t)( 255.0 * distance / range_ );
+         return true;
+      }
+
+   private:
+      double range_;
+   };
+   // -----------------------------------------------------------------------
+   /** \brief Unit disk graph where every packet is lost with a fixed
+    *  probability.
+    */
+   class PCSimLossyLinkModel
+      : public PCSimLinkModel
+   {
+   public:
+      PCSimLossyLinkModel( double range, double loss_probability )
+         : range_            ( range ),
+            loss_probability_ ( loss_probability )
+      {}
+      // --------------------------------------------------------------------
+      double range() const
+      { return range_; }
+      // --------------------------------------------------------------------
+      bool deliver( double distance, PCSimRandom& rand, uint16_t& link_metric )
+      {
+         if ( distance > range_ || rand.uniform() < loss_probability_ )
+            return false;
+
+         link_metric = (uint16_t)( 255.0 * distance / range_ );
+         return true;
+      }
+
+   private:
+      double range_;
+      double loss_probability_;
+   };
+   // -----------------------------------------------------------------------
+   /** \brief Log-distance path loss with optional log-normal shadowing.
+    *
+    *  RSSI = tx_power - PL(d0) - 10 * n * log10(d / d0) + X(sigma); the
+    *  packet is received if the RSSI is above the receiver sensitivity.
+    *  The reported link metric is -RSSI (in dBm), so closer nodes have
+    *  smaller metrics.
+    */
+   class PCSimRssiLinkModel
+      : public PCSimLinkModel
+   {
+   public:
+      PCSimRssiLinkModel( double tx_power_dbm = 0.0,
+                          double sensitivity_dbm = -95.0,
+                          double path_loss_exponent = 3.0,
+                          double reference_loss_db = 40.0,
+                          double shadowing_sigma_db = 0.0 )
+         : tx_power_       ( tx_power_dbm ),
+            sensitivity_    ( sensitivity_dbm ),
+            exponent_       ( path_loss_exponent ),
+            reference_loss_ ( reference_loss_db ),
+            sigma_          ( shadowing_sigma_db )
+      {
+         // Distance at which the mean RSSI equals sensitivity plus three
+         // standard deviations of shadowing; nothing beyond is received
+         // with any relevant probability.
+         double margin = tx_power_ - reference_loss_ - sensitivity_ + 3.0 * sigma_;
+         range_ = pow( 10.0, margin / ( 10.0 * exponent_ ) );
+      }
+      // --------------------------------------------------------------------
+      double range() const
+      { return range_; }
+      // --------------------------------------------------------------------
+      bool deliver( double distance, PCSimRandom& rand, uint16_t& link_metric )
+      {
+         if ( distance < 1.0 )
+            distance = 1.0;
+
+         double rssi = tx_power_ - reference_loss_ - 10.0 * exponent_ * log10( distance );
+         if ( sigma_ > 0.0 )
+            rssi += sigma_ * rand.gaussian();
+
+         if ( rssi < sensitivity_ )
+            return false;
+
+         link_metric = ( rssi >= 0.0 ) ? 0 : (uint16_t)( -rssi );
+         return true;
+      }
+
+   private:
+      double tx_power_;
+      double sensitivity_;
+      double exponent_;
+      double reference_loss_;
+      double sigma_;
+      double range_;
+   };
+
+}
+
+#endif
@@ -0,0 +1,64 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef CONNECTOR_PC_SIM_OS_MODEL_H
+#define CONNECTOR_PC_SIM_OS_MODEL_H
+
+#include "external_interface/default_return_values.h"
+#include "external_interface/pc_sim/pc_sim_world.h"
+#include "external_interface/pc_sim/pc_sim_radio.h"
+#include "external_interface/pc_sim/pc_sim_timer.h"
+#include "external_interface/pc_sim/pc_sim_clock.h"
+#include "external_interface/pc_sim/pc_sim_debug.h"
+#include "external_interface/pc_sim/pc_sim_rand.h"
+#include "util/serialization/endian.h"
+
+namespace wiselib
+{
+   /** \brief OS model of the in-process PC simulator.
+    *
+    *  Runs any number of nodes of a Wiselib application inside one process
+    *  on a discrete event scheduler (see PCSimWorld). Like with Shawn,
+    *  application_main is called once per node with that node's PCSimOs,
+    *  and all facets are per-node instances constructed from it.
+    */
+   class PCSimOsModel
+      : public DefaultReturnValues<PCSimOsModel>
+   {
+   public:
+      typedef PCSimOs AppMainParameter;
+      typedef PCSimOs Os;
+
+      typedef uint32_t size_t;
+      typedef uint8_t block_data_t;
+
+      typedef PCSimWorld<PCSimOsModel> World;
+
+      typedef PCSimTimerModel<PCSimOsModel> Timer;
+      typedef PCSimRadioModel<PCSimOsModel> Radio;
+      typedef PCSimRadioModel<PCSimOsModel> ExtendedRadio;
+      typedef PCSimRadioModel<PCSimOsModel> TxRadio;
+      typedef PCSimDebug<PCSimOsModel> Debug;
+      typedef PCSimRandModel<PCSimOsModel> Rand;
+      typedef PCSimClockModel<PCSimOsModel> Clock;
+
+      static const Endianness endianness = WISELIB_ENDIANNESS;
+   };
+}
+
+#endif
@@ -0,0 +1,169 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef CONNECTOR_PC_SIM_RADIO_H
+#define CONNECTOR_PC_SIM_RADIO_H
+
+#include "external_interface/pc_sim/pc_sim_world.h"
+#include "external_interface/pc/com_isense_txpower.h"
+#include "util/base_classes/radio_base.h"
+
+namespace wiselib
+{
+   /** \brief PC simulator implementation of \ref radio_concept "Radio concept"
+    *  \ingroup radio_concept
+    *
+    *  Thin facade of one node's radio; sending, receiver registration and
+    *  delivery are handled by the PCSimWorld the node belongs to.
+    */
+   template<typename OsModel_P>
+   class PCSimRadioModel
+   {
+   public:
+      typedef OsModel_P OsModel;
+
+      typedef PCSimRadioModel<OsModel> self_type;
+      typedef self_type* self_pointer_t;
+
+      typedef PCSimWorld<OsModel> World;
+      typedef typename World::node_id_t node_id_t;
+      typedef typename World::size_t size_t;
+      typedef typename World::block_data_t block_data_t;
+      typedef typename World::ExtendedData ExtendedData;
+      typedef ComIsenseTxPower<OsModel> TxPower;
+      typedef uint8_t message_id_t;
+      typedef RadioIoVec<size_t, block_data_t> iovec_t;
+      typedef typename World::packet_buffer_t packet_buffer_t;
+      // --------------------------------------------------------------------
+      enum ErrorCodes
+      {
+         SUCCESS = OsModel::SUCCESS,
+         ERR_UNSPEC = OsModel::ERR_UNSPEC
+      };
+      // --------------------------------------------------------------------
+      enum SpecialNodeIds {
+         BROADCAST_ADDRESS = World::BROADCAST_ADDRESS, ///< All nodes in communication range
+         NULL_NODE_ID      = World::NULL_NODE_ID       ///< Unknown/No node id
+      };
+      // --------------------------------------------------------------------
+      enum Restrictions {
+         MAX_MESSAGE_LENGTH = World::MAX_MESSAGE_LENGTH ///< Maximal number of bytes in payload
+      };
+      // --------------------------------------------------------------------
+      PCSimRadioModel( PCSimOs& os )
+         : os_(os),
+            tx_power_( TxPower::MAX )
+      {}
+      // --------------------------------------------------------------------
+      int send( node_id_t id, size_t len, block_data_t *data )
+      {
+         return os().world->send( os().id, id, len, data );
+      }
+      // --------------------------------------------------------------------
+      /// The world copies the packet anyway, see PacketBuffer
+      int send_buffer( node_id_t id, packet_buffer_t& buffer )
+      {
+         return os().world->send( os().id, id, buffer.size(), buffer.data() );
+      }
+      // --------------------------------------------------------------------
+      /// One transmission reaching all n nodes in ids, see send_multi()
+      int send_multi( node_id_t *ids, size_t n, size_t len, block_data_t *data )
+      {
+         return os().world->send_multi( os().id, ids, n, len, data );
+      }
+      // --------------------------------------------------------------------
+      /// Gathers the pieces directly into the message, see sendv()
+      int sendv( node_id_t id, const iovec_t *iov, size_t iovcnt )
+      {
+         block_data_t buffer[MAX_MESSAGE_LENGTH];
+         size_t len = 0;
+         for ( size_t i = 0; i < iovcnt; i++ )
+         {
+            if ( iov[i].len > MAX_MESSAGE_LENGTH - len )
+               return ERR_UNSPEC;
+            memcpy( buffer + len, iov[i].data, iov[i].len );
+            len += iov[i].len;
+         }
+         return os().world->send( os().id, id, len, buffer );
+      }
+      // --------------------------------------------------------------------
+      int enable_radio()
+      {
+         os().world->enable_radio( os().id );
+         return SUCCESS;
+      }
+      // --------------------------------------------------------------------
+      int disable_radio()
+      {
+         os().world->disable_radio( os().id );
+         return SUCCESS;
+      }
+      // --------------------------------------------------------------------
+      node_id_t id()
+      {
+         return os().id;
+      }
+      // --------------------------------------------------------------------
+      /** The power is only stored; reception is decided by the link model
+       *  of the world, which does not take it into account.
+       */
+      int set_power( TxPower p )
+      {
+         tx_power_ = p;
+         return SUCCESS;
+      }
+      // --------------------------------------------------------------------
+      TxPower power()
+      {
+         return tx_power_;
+      }
+      // --------------------------------------------------------------------
+      template<class T, void (T::*TMethod)(node_id_t, size_t, block_data_t*)>
+      int reg_recv_callback( T *obj_pnt )
+      {
+         return os().world->receivers( os().id ).template reg_recv_callback<T, TMethod>( obj_pnt );
+      }
+      // --------------------------------------------------------------------
+      template<class T, void (T::*TMethod)(node_id_t, size_t, block_data_t*, const ExtendedData&)>
+      int reg_recv_callback( T *obj_pnt )
+      {
+         return os().world->receivers( os().id ).template reg_recv_callback<T, TMethod>( obj_pnt );
+      }
+      // --------------------------------------------------------------------
+      /// Received packets come with PACKET_BUFFER_HEADROOM bytes of headroom
+      template<class T, void (T::*TMethod)(node_id_t, packet_buffer_t&)>
+      int reg_recv_callback( T *obj_pnt )
+      {
+         return os().world->receivers( os().id ).template reg_recv_callback<T, TMethod>( obj_pnt );
+      }
+      // --------------------------------------------------------------------
+      int unreg_recv_callback( int idx )
+      {
+         return os().world->receivers( os().id ).unreg_recv_callback( idx );
+      }
+
+   private:
+      PCSimOs& os()
+      { return os_; }
+      // --------------------------------------------------------------------
+      PCSimOs& os_;
+      TxPower tx_power_;
+   };
+}
+
+#endif
@@ -0,0 +1,72 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef CONNECTOR_PC_SIM_RANDMODEL_H
+#define CONNECTOR_PC_SIM_RANDMODEL_H
+
+#include "external_interface/pc_sim/pc_sim_world.h"
+
+namespace wiselib
+{
+   /** \brief PC simulator implementation of the Rand concept.
+    *
+    *  Draws from the world's generator, so a simulation is reproducible
+    *  from its seed.
+    */
+   template<typename OsModel_P>
+   class PCSimRandModel
+   {
+   public:
+      typedef OsModel_P OsModel;
+      typedef PCSimRandModel<OsModel> self_type;
+      typedef self_type* self_pointer_t;
+
+      typedef uint32_t rand_t;
+      typedef uint32_t value_t;
+      // --------------------------------------------------------------------
+      enum { RANDOM_MAX = 0xffffffff };
+      // --------------------------------------------------------------------
+      PCSimRandModel( PCSimOs& os )
+         : os_(os)
+      {}
+      // --------------------------------------------------------------------
+      /** Ignored; the whole simulation is seeded through PCSimWorld.
+       */
+      void srand( value_t seed )
+      {}
+      // --------------------------------------------------------------------
+      value_t operator()()
+      {
+         return os().world->rand( os().id )();
+      }
+      // --------------------------------------------------------------------
+      value_t operator()( value_t max )
+      {
+         return (*this)() % max;
+      }
+
+   private:
+      PCSimOs& os()
+      { return os_; }
+      // --------------------------------------------------------------------
+      PCSimOs& os_;
+   };
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef CONNECTOR_PC_SIM_TIMER_H
+#define CONNECTOR_PC_SIM_TIMER_H
+
+#include "external_interface/pc_sim/pc_sim_world.h"
+
+namespace wiselib
+{
+   /** \brief PC simulator implementation of \ref timer_concept "Timer Concept".
+    *
+    *  \ingroup timer_concept
+    *
+    *  Timeouts are events in the world's scheduler and thus expire in
+    *  simulated, not wall-clock time.
+    */
+   template<typename OsModel_P>
+   class PCSimTimerModel
+   {
+   public:
+      typedef OsModel_P OsModel;
+
+      typedef PCSimTimerModel<OsModel> self_type;
+      typedef self_type* self_pointer_t;
+
+      typedef PCSimWorld<OsModel> World;
+      typedef uint32_t millis_t;
+      // --------------------------------------------------------------------
+      enum ErrorCodes
+      {
+         SUCCESS = OsModel::SUCCESS,
+         ERR_UNSPEC = OsModel::ERR_UNSPEC
+      };
+      // --------------------------------------------------------------------
+      PCSimTimerModel( PCSimOs& os )
+         : os_(os)
+      {}
+      // --------------------------------------------------------------------
+      template<typename T, void (T::*TMethod)(void*)>
+      int set_timer( millis_t millis, T *obj_pnt, void *userdata )
+      {
+         os().world->set_timer( os().id, (typename World::sim_time_t)millis * 1000,
+            delegate1<void, void*>::from_method<T, TMethod>( obj_pnt ), userdata );
+         return SUCCESS;
+      }
+
+   private:
+      PCSimOs& os()
+      { return os_; }
+      // --------------------------------------------------------------------
+      PCSimOs& os_;
+   };
+}
+
+#endif
@@ -0,0 +1,873 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef CONNECTOR_PC_SIM_WORLD_H
+#define CONNECTOR_PC_SIM_WORLD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <algorithm>
+
+#include "util/delegates/delegate.hpp"
+#include "util/base_classes/extended_radio_base.h"
+#include "util/base_classes/base_extended_data.h"
+#include "external_interface/pc_sim/pc_sim_link_models.h"
+
+namespace wiselib
+{
+
+   template<typename OsModel_P> class PCSimWorld;
+   class PCSimOsModel;
+
+   /** \brief Handle of one simulated node, passed to application_main.
+    *
+    *  Counterpart of ShawnOs: all facets of a node are constructed from
+    *  it.
+    */
+   struct PCSimOs
+   {
+      PCSimWorld<PCSimOsModel> *world;
+      uint16_t id;
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** \brief Discrete event scheduler of the PC simulator.
+    *
+    *  Events are either timer callbacks or radio transmissions; they are
+    *  kept in a binary heap ordered by (time, key). Keys are given by the
+    *  caller and must be unique; PCSimWorld derives them from the node
+    *  and a per-node counter, so the order of simultaneous events does not
+    *  depend on which scheduler they were inserted into. Transmission
+    *  payloads live in a recycled packet pool, so steady-state operation
+    *  does not allocate.
+    */
+   template<typename OsModel_P>
+   class PCSimScheduler
+   {
+   public:
+      typedef OsModel_P OsModel;
+      typedef typename OsModel::size_t size_t;
+      typedef typename OsModel::block_data_t block_data_t;
+      typedef uint16_t node_id_t;
+      typedef uint64_t sim_time_t;
+      typedef delegate1<void, void*> timer_delegate_t;
+
+      enum { MAX_MESSAGE_LENGTH = 0xff };
+      enum { NO_PACKET = 0xffffffff };
+      enum { ALL_PARTITIONS = 0xffff };
+
+      /** A transmission as seen by one partition; it is only delivered to
+       *  receivers in that partition (or to all, see ALL_PARTITIONS).
+       */
+      struct Packet
+      {
+         uint64_t tx;
+         node_id_t from;
+         node_id_t to;
+         uint16_t partition;
+         size_t len;
+         block_data_t data[MAX_MESSAGE_LENGTH];
+      };
+
+      struct Event
+      {
+         sim_time_t time;
+         uint64_t key;
+         node_id_t node;
+         uint32_t packet;
+         timer_delegate_t callback;
+         void *userdata;
+      };
+      // --------------------------------------------------------------------
+      PCSimScheduler()
+         : now_ ( 0 )
+      {}
+      // --------------------------------------------------------------------
+      sim_time_t now() const
+      { return now_; }
+      // --------------------------------------------------------------------
+      bool empty() const
+      { return events_.empty(); }
+      // --------------------------------------------------------------------
+      sim_time_t next_time() const
+      { return events_.front().time; }
+      // --------------------------------------------------------------------
+      void schedule_timer( node_id_t node, sim_time_t time, uint64_t key,
+                           timer_delegate_t callback, void *userdata )
+      {
+         Event ev;
+         ev.time = time;
+         ev.key = key;
+         ev.node = node;
+         ev.packet = NO_PACKET;
+         ev.callback = callback;
+         ev.userdata = userdata;
+         push( ev );
+      }
+      // --------------------------------------------------------------------
+      void schedule_packet( sim_time_t time, uint64_t tx, node_id_t from, node_id_t to,
+                            size_t len, const block_data_t *data,
+                            uint16_t partition = ALL_PARTITIONS )
+      {
+         uint32_t idx;
+         if ( free_packets_.empty() )
+         {
+            idx = packets_.size();
+            packets_.push_back( Packet() );
+         }
+         else
+         {
+            idx = free_packets_.back();
+            free_packets_.pop_back();
+         }
+
+         Packet& p = packets_[idx];
+         p.tx = tx;
+         p.from = from;
+         p.to = to;
+         p.partition = partition;
+         p.len = len;
+         memcpy( p.data, data, len );
+
+         Event ev;
+         ev.time = time;
+         ev.key = tx;
+         ev.node = from;
+         ev.packet = idx;
+         ev.userdata = 0;
+         push( ev );
+      }
+      // --------------------------------------------------------------------
+      /** Removes the next event and advances the clock to its time.
+       */
+      Event pop()
+      {
+         std::pop_heap( events_.begin(), events_.end(), later );
+         Event ev = events_.back();
+         events_.pop_back();
+         now_ = ev.time;
+         return ev;
+      }
+      // --------------------------------------------------------------------
+      Packet& packet( uint32_t idx )
+      { return packets_[idx]; }
+      // --------------------------------------------------------------------
+      void free_packet( uint32_t idx )
+      { free_packets_.push_back( idx ); }
+      // --------------------------------------------------------------------
+      void set_now( sim_time_t t )
+      { now_ = t; }
+
+   private:
+      static bool later( const Event& a, const Event& b )
+      {
+         if ( a.time != b.time )
+            return a.time > b.time;
+         return a.key > b.key;
+      }
+      // --------------------------------------------------------------------
+      void push( Event& ev )
+      {
+         events_.push_back( ev );
+         std::push_heap( events_.begin(), events_.end(), later );
+      }
+      // --------------------------------------------------------------------
+      sim_time_t now_;
+      std::vector<Event> events_;
+      std::vector<Packet> packets_;
+      std::vector<uint32_t> free_packets_;
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** \brief The "virtual world" of the PC simulator.
+    *
+    *  Holds all nodes of a simulation in one process: their positions, the
+    *  receive callbacks registered at their radios and the discrete event
+    *  schedulers. Whether and with which link metric a transmission
+    *  reaches a node is decided by a pluggable PCSimLinkModel; candidate
+    *  receivers are precomputed on a grid with cell size equal to the link
+    *  model's range, so a broadcast costs O(neighbors), not O(nodes).
+    *
+    *  run_parallel() spreads the nodes over several threads. Nodes are
+    *  split into spatial strips (partitions), each with its own scheduler.
+    *  Execution is conservative: since no packet arrives earlier than the
+    *  minimal transmission delay after it was sent, all partitions can
+    *  process a window of that length independently. Packets to other partitions are appended to
+    *  per-(sender, receiver) partition outboxes, which are only read after
+    *  the window barrier, so no locking is needed.
+    *
+    *  Results only depend on the seed, not on the number of threads:
+    *  simultaneous events are ordered by (node, per-node sequence number)
+    *  rather than by insertion into a partition's scheduler, and every
+    *  node draws from its own random generator (also for the link model
+    *  decisions on packets it receives). fingerprint() sums up all
+    *  receptions to compare runs.
+    *
+    *  Nodes of the same partition run on the same thread, but algorithms
+    *  must not share mutable state between nodes when run in parallel.
+    *
+    *  Typical use (see standalone/main.cc):
+    *  \code
+    *  PCSimUnitDiskLinkModel link( 30.0 );
+    *  PCSimWorld<PCSimOsModel> world( link );
+    *  for ( ... ) application_main( world.os( world.add_node( x, y ) ) );
+    *  world.run( 3600.0 );   // or world.run_parallel( 3600.0, 8 );
+    *  \endcode
+    */
+   template<typename OsModel_P>
+   class PCSimWorld
+   {
+   public:
+      typedef OsModel_P OsModel;
+      typedef PCSimScheduler<OsModel> Scheduler;
+      typedef PCSimWorld<OsModel> self_type;
+
+      typedef typename OsModel::size_t size_t;
+      typedef typename OsModel::block_data_t block_data_t;
+      typedef typename Scheduler::node_id_t node_id_t;
+      typedef typename Scheduler::sim_time_t sim_time_t;
+      typedef typename Scheduler::timer_delegate_t timer_delegate_t;
+      typedef typename Scheduler::Event Event;
+      typedef typename Scheduler::Packet Packet;
+
+      typedef BaseExtendedData<OsModel> ExtendedData;
+      typedef ExtendedRadioBase<OsModel, node_id_t, size_t, block_data_t,
+                                RADIO_BASE_MAX_RECEIVERS, ExtendedData> Receivers;
+      typedef typename Receivers::packet_buffer_t packet_buffer_t;
+      // --------------------------------------------------------------------
+      enum SpecialNodeIds
+      {
+         BROADCAST_ADDRESS = 0xffff,
+         NULL_NODE_ID      = 0xfffe
+      };
+      // --------------------------------------------------------------------
+      enum Restrictions
+      {
+         MAX_MESSAGE_LENGTH = Scheduler::MAX_MESSAGE_LENGTH,
+         MAX_NODES = NULL_NODE_ID,
+         MAX_THREADS = 256
+      };
+      // --------------------------------------------------------------------
+      struct Node
+      {
+         PCSimOs os;
+         double x, y;
+         bool radio_enabled;
+         uint32_t seq;  ///< Per-node part of the event keys
+         PCSimRandom rand;
+         Receivers receivers;
+      };
+      // --------------------------------------------------------------------
+      PCSimWorld( PCSimLinkModel& link_model, uint64_t seed = 1 )
+         : link_model_      ( &link_model ),
+            seed_            ( seed ),
+            neighbors_valid_ ( false ),
+            parallel_        ( false ),
+            delay_base_      ( 1000 ),
+            delay_per_byte_  ( 32 ),
+            debug_enabled_   ( true )
+      {
+         partitions_.push_back( new Partition() );
+      }
+      // --------------------------------------------------------------------
+      ~PCSimWorld()
+      {
+         for ( size_t i = 0; i < partitions_.size(); i++ )
+            delete partitions_[i];
+      }
+      // --------------------------------------------------------------------
+      ///@name Topology
+      ///@{
+      node_id_t add_node( double x, double y )
+      {
+         node_id_t id = nodes_.size();
+         nodes_.push_back( Node() );
+         Node& n = nodes_.back();
+         n.os.world = this;
+         n.os.id = id;
+         n.x = x;
+         n.y = y;
+         n.radio_enabled = false;
+         n.seq = 0;
+         n.rand.srand( ( seed_ + id + 1 ) * 0x9e3779b97f4a7c15ULL );
+         partition_of_.push_back( 0 );
+         neighbors_valid_ = false;
+         return id;
+      }
+      // --------------------------------------------------------------------
+      /** Must not be called from within a parallel run.
+       */
+      void set_position( node_id_t id, double x, double y )
+      {
+         nodes_[id].x = x;
+         nodes_[id].y = y;
+         neighbors_valid_ = false;
+      }
+      // --------------------------------------------------------------------
+      double distance( node_id_t a, node_id_t b )
+      {
+         double dx = nodes_[a].x - nodes_[b].x;
+         double dy = nodes_[a].y - nodes_[b].y;
+         return sqrt( dx * dx + dy * dy );
+      }
+      // --------------------------------------------------------------------
+      size_t size()
+      { return nodes_.size(); }
+      // --------------------------------------------------------------------
+      PCSimOs& os( node_id_t id )
+      { return nodes_[id].os; }
+      // --------------------------------------------------------------------
+      void set_link_model( PCSimLinkModel& link_model )
+      {
+         link_model_ = &link_model;
+         neighbors_valid_ = false;
+      }
+      ///@}
+      // --------------------------------------------------------------------
+      ///@name Services used by the node facets
+      ///@{
+      sim_time_t now( node_id_t id )
+      { return partition( id ).scheduler.now(); }
+      // --------------------------------------------------------------------
+      void set_timer( node_id_t id, sim_time_t delay, timer_delegate_t callback, void *userdata )
+      {
+         Scheduler& s = partition( id ).scheduler;
+         s.schedule_timer( id, s.now() + delay, next_key( id ), callback, userdata );
+      }
+      // --------------------------------------------------------------------
+      /** Transmission takes delay_base + len * delay_per_byte microseconds;
+       *  reception is decided by the link model when it ends.
+       */
+      int send( node_id_t from, node_id_t to, size_t len, block_data_t *data )
+      {
+         if ( len > MAX_MESSAGE_LENGTH || !nodes_[from].radio_enabled )
+            return OsModel::ERR_UNSPEC;
+
+         Partition& part = partition( from );
+         part.packets_sent++;
+         schedule_transmission( part.scheduler.now() + transmission_time( len ),
+            next_key( from ), from, to, len, data );
+         return OsModel::SUCCESS;
+      }
+      // --------------------------------------------------------------------
+      /** Sends the message to n nodes as one transmission: it occupies the
+       *  channel (and counts as sent) once and arrives at all of them at
+       *  the same time. Every destination still gets its own transmission
+       *  id, as merging partitions tells copies apart by it.
+       */
+      int send_multi( node_id_t from, node_id_t *ids, size_t n, size_t len, block_data_t *data )
+      {
+         if ( len > MAX_MESSAGE_LENGTH || !nodes_[from].radio_enabled )
+            return OsModel::ERR_UNSPEC;
+         if ( n == 0 )
+            return OsModel::SUCCESS;
+
+         Partition& part = partition( from );
+         part.packets_sent++;
+         sim_time_t arrival = part.scheduler.now() + transmission_time( len );
+         for ( size_t i = 0; i < n; i++ )
+            schedule_transmission( arrival, next_key( from ), from, ids[i], len, data );
+         return OsModel::SUCCESS;
+      }
+      // --------------------------------------------------------------------
+      Receivers& receivers( node_id_t id )
+      { return nodes_[id].receivers; }
+      // --------------------------------------------------------------------
+      void enable_radio( node_id_t id )
+      { nodes_[id].radio_enabled = true; }
+      // --------------------------------------------------------------------
+      void disable_radio( node_id_t id )
+      { nodes_[id].radio_enabled = false; }
+      // --------------------------------------------------------------------
+      PCSimRandom& rand( node_id_t id )
+      { return nodes_[id].rand; }
+      // --------------------------------------------------------------------
+      bool debug_enabled()
+      { return debug_enabled_; }
+      ///@}
+      // --------------------------------------------------------------------
+      ///@name Simulation Control
+      ///@{
+      /** Processes the next event. Returns false if there is none.
+       */
+      bool step()
+      {
+         Partition& part = *partitions_[0];
+         if ( part.scheduler.empty() )
+            return false;
+
+         if ( !neighbors_valid_ )
+            build_neighbors();
+
+         dispatch( part );
+         return true;
+      }
+      // --------------------------------------------------------------------
+      /** Runs the simulation until there are no more events or the given
+       *  simulated time (in seconds) is reached.
+       */
+      void run( double until_seconds )
+      {
+         sim_time_t until = to_sim_time( until_seconds );
+         Scheduler& s = partitions_[0]->scheduler;
+         while ( !s.empty() && s.next_time() <= until )
+            step();
+         if ( s.now() < until )
+            s.set_now( until );
+      }
+      // --------------------------------------------------------------------
+      /** Like run(), but distributes the nodes over the given number of
+       *  threads (see class description). Falls back to run() for a single
+       *  thread or without a positive transmission delay.
+       */
+      void run_parallel( double until_seconds, unsigned threads )
+      {
+         if ( threads > MAX_THREADS )
+            threads = MAX_THREADS;
+         if ( threads > nodes_.size() )
+            threads = nodes_.size();
+         if ( threads <= 1 || delay_base_ == 0 )
+         {
+            run( until_seconds );
+            return;
+         }
+
+         if ( !neighbors_valid_ )
+            build_neighbors();
+
+         partition_nodes( threads );
+
+         until_ = to_sim_time( until_seconds );
+         lookahead_ = delay_base_;
+         stop_ = false;
+         parallel_ = true;
+         pthread_barrier_init( &barrier_, 0, threads );
+
+         std::vector<pthread_t> tids( threads );
+         std::vector<WorkerArg> args( threads );
+         for ( unsigned i = 0; i < threads; i++ )
+         {
+            args[i].world = this;
+            args[i].index = i;
+         }
+         for ( unsigned i = 1; i < threads; i++ )
+            pthread_create( &tids[i], 0, &self_type::worker_thread, &args[i] );
+         worker( 0 );
+         for ( unsigned i = 1; i < threads; i++ )
+            pthread_join( tids[i], 0 );
+
+         pthread_barrier_destroy( &barrier_ );
+         parallel_ = false;
+
+         for ( size_t i = 0; i < partitions_.size(); i++ )
+            if ( partitions_[i]->scheduler.now() < until_ )
+               partitions_[i]->scheduler.set_now( until_ );
+
+         partition_nodes( 1 );
+      }
+      // --------------------------------------------------------------------
+      double seconds()
+      { return partitions_[0]->scheduler.now() / 1000000.0; }
+      // --------------------------------------------------------------------
+      void set_transmission_delay( uint32_t base_micros, uint32_t per_byte_micros )
+      {
+         delay_base_ = base_micros;
+         delay_per_byte_ = per_byte_micros;
+      }
+      // --------------------------------------------------------------------
+      sim_time_t transmission_time( size_t len )
+      { return delay_base_ + (sim_time_t)len * delay_per_byte_; }
+      // --------------------------------------------------------------------
+      void set_debug_enabled( bool enabled )
+      { debug_enabled_ = enabled; }
+      ///@}
+      // --------------------------------------------------------------------
+      ///@name Statistics
+      ///@{
+      uint64_t packets_sent()
+      { return partitions_[0]->packets_sent; }
+      // --------------------------------------------------------------------
+      uint64_t receptions()
+      { return partitions_[0]->receptions; }
+      // --------------------------------------------------------------------
+      uint64_t events()
+      { return partitions_[0]->events; }
+      // --------------------------------------------------------------------
+      /** Order-independent checksum over all receptions (time, sender,
+       *  receiver and payload). Equal for serial and parallel runs with the
+       *  same seed.
+       */
+      uint64_t fingerprint()
+      { return partitions_[0]->fingerprint; }
+      ///@}
+
+   protected:
+      /** Cross-partition transmission, see send().
+       */
+      struct Mail
+      {
+         sim_time_t time;
+         uint64_t tx;
+         node_id_t from;
+         node_id_t to;
+         size_t len;
+         block_data_t data[MAX_MESSAGE_LENGTH];
+      };
+      // --------------------------------------------------------------------
+      /** State owned by one worker thread. Allocated separately to keep
+       *  workers off each other's cache lines.
+       */
+      struct Partition
+      {
+         Partition()
+            : packets_sent ( 0 ),
+               receptions   ( 0 ),
+               events       ( 0 ),
+               fingerprint  ( 0 )
+         {}
+
+         Scheduler scheduler;
+         std::vector<std::vector<Mail> > outbox;
+         std::vector<uint8_t> targets;
+
+         uint64_t packets_sent;
+         uint64_t receptions;
+         uint64_t events;
+         uint64_t fingerprint;
+      };
+      // --------------------------------------------------------------------
+      struct WorkerArg
+      {
+         self_type *world;
+         unsigned index;
+      };
+      // --------------------------------------------------------------------
+      Partition& partition( node_id_t id )
+      { return *partitions_[partition_of_[id]]; }
+      // --------------------------------------------------------------------
+      static sim_time_t to_sim_time( double seconds )
+      { return (sim_time_t)( seconds * 1000000.0 ); }
+      // --------------------------------------------------------------------
+      /** Key of the next event caused by the given node: unique, and
+       *  independent of the partitioning.
+       */
+      uint64_t next_key( node_id_t id )
+      { return ( (uint64_t)id << 32 ) | nodes_[id].seq++; }
+      // --------------------------------------------------------------------
+      /** Serially, a transmission is a single event delivering to all
+       *  receivers. In parallel runs, every partition containing a receiver
+       *  gets its own copy (with the same transmission id), which only
+       *  delivers to that partition's nodes. Copies for other partitions go
+       *  to the outboxes while workers are running.
+       */
+      void schedule_transmission( sim_time_t arrival, uint64_t tx, node_id_t from, node_id_t to,
+                                  size_t len, const block_data_t *data )
+      {
+         Partition& part = partition( from );
+         if ( partitions_.size() == 1 )
+         {
+            part.scheduler.schedule_packet( arrival, tx, from, to, len, data );
+            return;
+         }
+
+         if ( to == BROADCAST_ADDRESS )
+         {
+            std::vector<node_id_t>& nb = neighbors_[from];
+            for ( size_t i = 0; i < nb.size(); i++ )
+               part.targets[partition_of_[nb[i]]] = 1;
+         }
+         else if ( to < nodes_.size() )
+            part.targets[partition_of_[to]] = 1;
+
+         uint16_t own = partition_of_[from];
+         for ( uint16_t q = 0; q < partitions_.size(); q++ )
+         {
+            if ( !part.targets[q] )
+               continue;
+            part.targets[q] = 0;
+
+            if ( q == own || !parallel_ )
+               partitions_[q]->scheduler.schedule_packet( arrival, tx, from, to, len, data, q );
+            else
+            {
+               part.outbox[q].push_back( Mail() );
+               Mail& m = part.outbox[q].back();
+               m.time = arrival;
+               m.tx = tx;
+               m.from = from;
+               m.to = to;
+               m.len = len;
+               memcpy( m.data, data, len );
+            }
+         }
+      }
+      // --------------------------------------------------------------------
+      /** Processes the next event of the given partition.
+       */
+      void dispatch( Partition& part )
+      {
+         Scheduler& scheduler = part.scheduler;
+         Event ev = scheduler.pop();
+         part.events++;
+
+         if ( ev.packet == Scheduler::NO_PACKET )
+         {
+            ev.callback( ev.userdata );
+            return;
+         }
+
+         // Copy the packet out of the pool: receivers may send (and thus
+         // grow the pool) and may modify the buffer they are handed.
+         Packet p = scheduler.packet( ev.packet );
+         scheduler.free_packet( ev.packet );
+
+         if ( p.to == BROADCAST_ADDRESS )
+         {
+            std::vector<node_id_t>& nb = neighbors_[p.from];
+            for ( size_t i = 0; i < nb.size(); i++ )
+               if ( p.partition == Scheduler::ALL_PARTITIONS || partition_of_[nb[i]] == p.partition )
+                  deliver( part, p, nb[i] );
+         }
+         else if ( p.to < nodes_.size() )
+            deliver( part, p, p.to );
+      }
+      // --------------------------------------------------------------------
+      void deliver( Partition& part, const Packet& p, node_id_t to )
+      {
+         Node& n = nodes_[to];
+         if ( !n.radio_enabled || to == p.from )
+            return;
+
+         uint16_t metric = 0;
+         if ( !link_model_->deliver( distance( p.from, to ), n.rand, metric ) )
+            return;
+
+         // received with headroom, so layers forwarding it can put their
+         // headers in front without copying
+         block_data_t storage[PACKET_BUFFER_HEADROOM + MAX_MESSAGE_LENGTH];
+         packet_buffer_t buffer( storage, sizeof( storage ), PACKET_BUFFER_HEADROOM );
+         buffer.append( p.len, p.data );
+
+         ExtendedData ex;
+         ex.set_link_metric( metric );
+         part.receptions++;
+         part.fingerprint += reception_hash( part.scheduler.now(), p, to );
+         n.receivers.notify_receivers( p.from, buffer, ex );
+      }
+      // --------------------------------------------------------------------
+      static uint64_t reception_hash( sim_time_t time, const Packet& p, node_id_t to )
+      {
+         // FNV-1a
+         uint64_t h = 0xcbf29ce484222325ULL;
+         uint64_t head[3] = { time, p.tx, ( (uint64_t)p.from << 16 ) | to };
+         const uint8_t *b = (const uint8_t*)head;
+         for ( size_t i = 0; i < sizeof(head); i++ )
+            h = ( h ^ b[i] ) * 0x100000001b3ULL;
+         for ( size_t i = 0; i < p.len; i++ )
+            h = ( h ^ p.data[i] ) * 0x100000001b3ULL;
+         return h;
+      }
+      // --------------------------------------------------------------------
+      static void* worker_thread( void *arg )
+      {
+         WorkerArg *a = (WorkerArg*)arg;
+         a->world->worker( a->index );
+         return 0;
+      }
+      // --------------------------------------------------------------------
+      /** Main loop of one partition. Each window consists of three phases
+       *  separated by barriers: collect the packets other partitions sent
+       *  during the last window; let worker 0 determine the next window
+       *  [T, T + lookahead), T being the earliest pending event anywhere;
+       *  process all local events in the window.
+       */
+      void worker( unsigned index )
+      {
+         Partition& part = *partitions_[index];
+
+         for ( ;; )
+         {
+            for ( size_t src = 0; src < partitions_.size(); src++ )
+            {
+               std::vector<Mail>& box = partitions_[src]->outbox[index];
+               for ( size_t i = 0; i < box.size(); i++ )
+                  part.scheduler.schedule_packet( box[i].time, box[i].tx, box[i].from, box[i].to,
+                                                  box[i].len, box[i].data, index );
+               box.clear();
+            }
+            pthread_barrier_wait( &barrier_ );
+
+            if ( index == 0 )
+            {
+               bool found = false;
+               sim_time_t next = 0;
+               for ( size_t i = 0; i < partitions_.size(); i++ )
+               {
+                  Scheduler& s = partitions_[i]->scheduler;
+                  if ( !s.empty() && ( !found || s.next_time() < next ) )
+                  {
+                     next = s.next_time();
+                     found = true;
+                  }
+               }
+
+               stop_ = !found || next > until_;
+               window_end_ = std::min( next + lookahead_, until_ + 1 );
+            }
+            pthread_barrier_wait( &barrier_ );
+
+            if ( stop_ )
+               break;
+
+            while ( !part.scheduler.empty() && part.scheduler.next_time() < window_end_ )
+               dispatch( part );
+            pthread_barrier_wait( &barrier_ );
+         }
+      }
+      // --------------------------------------------------------------------
+      /** Assigns nodes to the given number of partitions (vertical strips
+       *  with equal node counts) and moves pending events and statistics
+       *  accordingly; events keep their relative order. Either the current
+       *  or the new number of partitions has to be one. When merging,
+       *  per-partition copies of a transmission become one event again:
+       *  all copies have the same arrival time, so either all or none of
+       *  them are still pending.
+       */
+      void partition_nodes( unsigned count )
+      {
+         std::vector<Partition*> old;
+         old.swap( partitions_ );
+         for ( unsigned i = 0; i < count; i++ )
+         {
+            Partition *p = new Partition();
+            p->outbox.resize( count );
+            p->targets.assign( count, 0 );
+            partitions_.push_back( p );
+         }
+
+         std::vector<std::pair<double, node_id_t> > order;
+         for ( size_t i = 0; i < nodes_.size(); i++ )
+            order.push_back( std::make_pair( nodes_[i].x, (node_id_t)i ) );
+         std::sort( order.begin(), order.end() );
+         for ( size_t i = 0; i < order.size(); i++ )
+            partition_of_[order[i].second] = (uint64_t)i * count / order.size();
+
+         sim_time_t now = 0;
+         for ( size_t i = 0; i < old.size(); i++ )
+         {
+            Partition& from = *old[i];
+            now = std::max( now, from.scheduler.now() );
+            partitions_[0]->packets_sent += from.packets_sent;
+            partitions_[0]->receptions += from.receptions;
+            partitions_[0]->events += from.events;
+            partitions_[0]->fingerprint += from.fingerprint;
+         }
+         for ( size_t i = 0; i < partitions_.size(); i++ )
+            partitions_[i]->scheduler.set_now( now );
+
+         std::set<uint64_t> merged;
+         for ( size_t i = 0; i < old.size(); i++ )
+         {
+            Scheduler& s = old[i]->scheduler;
+            while ( !s.empty() )
+            {
+               Event ev = s.pop();
+               if ( ev.packet == Scheduler::NO_PACKET )
+               {
+                  partition( ev.node ).scheduler.schedule_timer( ev.node, ev.time, ev.key,
+                                                                 ev.callback, ev.userdata );
+                  continue;
+               }
+
+               Packet& p = s.packet( ev.packet );
+               if ( count > 1 || merged.insert( p.tx ).second )
+                  schedule_transmission( ev.time, p.tx, p.from, p.to, p.len, p.data );
+            }
+            delete old[i];
+         }
+      }
+      // --------------------------------------------------------------------
+      /** Collects, for each node, all nodes within link model range using
+       *  a uniform grid with range-sized cells.
+       */
+      void build_neighbors()
+      {
+         double range = link_model_->range();
+         neighbors_.assign( nodes_.size(), std::vector<node_id_t>() );
+
+         typedef std::pair<long, long> cell_t;
+         typedef std::map<cell_t, std::vector<node_id_t> > grid_t;
+         grid_t grid;
+         for ( size_t i = 0; i < nodes_.size(); i++ )
+            grid[cell( nodes_[i], range )].push_back( i );
+
+         for ( size_t i = 0; i < nodes_.size(); i++ )
+         {
+            cell_t c = cell( nodes_[i], range );
+            for ( long dx = -1; dx <= 1; dx++ )
+               for ( long dy = -1; dy <= 1; dy++ )
+               {
+                  typename grid_t::iterator it = grid.find( cell_t( c.first + dx, c.second + dy ) );
+                  if ( it == grid.end() )
+                     continue;
+                  for ( size_t j = 0; j < it->second.size(); j++ )
+                  {
+                     node_id_t other = it->second[j];
+                     if ( other != i && distance( i, other ) <= range )
+                        neighbors_[i].push_back( other );
+                  }
+               }
+            std::sort( neighbors_[i].begin(), neighbors_[i].end() );
+         }
+         neighbors_valid_ = true;
+      }
+      // --------------------------------------------------------------------
+      static std::pair<long, long> cell( const Node& n, double range )
+      { return std::pair<long, long>( (long)floor( n.x / range ), (long)floor( n.y / range ) ); }
+      // --------------------------------------------------------------------
+      std::deque<Node> nodes_;
+      std::vector<uint16_t> partition_of_;
+      std::vector<std::vector<node_id_t> > neighbors_;
+      std::vector<Partition*> partitions_;
+      PCSimLinkModel *link_model_;
+      uint64_t seed_;
+      bool neighbors_valid_;
+      bool parallel_;
+
+      uint32_t delay_base_;
+      uint32_t delay_per_byte_;
+      bool debug_enabled_;
+
+      pthread_barrier_t barrier_;
+      sim_time_t until_;
+      sim_time_t lookahead_;
+      sim_time_t window_end_;
+      bool stop_;
+   };
+
+}
+
+#endif
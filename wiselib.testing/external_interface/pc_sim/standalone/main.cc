@@ -0,0 +1,151 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "external_interface/pc_sim/pc_sim_os_model.h"
+
+void application_main( wiselib::PCSimOs& );
+
+namespace
+{
+   void usage( const char *prog )
+   {
+      fprintf( stderr,
+         "usage: %s [-n nodes] [-r range] [-a area] [-t seconds] [-s seed]\n"
+         "          [-l loss] [-j threads] [-c] [-q]\n"
+         "  -n  number of nodes (default 100)\n"
+         "  -r  communication range (default 30)\n"
+         "  -a  side length of the square deployment area (default 300)\n"
+         "  -t  simulated time in seconds (default 60)\n"
+         "  -s  random seed (default 1)\n"
+         "  -l  packet loss probability (default 0)\n"
+         "  -j  number of worker threads (default 1)\n"
+         "  -c  also run with one thread, fail if the results differ\n"
+         "  -q  suppress debug output\n", prog );
+      exit( 1 );
+   }
+   // -----------------------------------------------------------------------
+   struct Options
+   {
+      unsigned nodes;
+      double range;
+      double area;
+      double duration;
+      unsigned long seed;
+      double loss;
+      bool quiet;
+   };
+   // -----------------------------------------------------------------------
+   struct Result
+   {
+      double seconds;
+      unsigned long long events, sent, received, fingerprint;
+   };
+   // -----------------------------------------------------------------------
+   Result simulate( const Options& o, unsigned threads )
+   {
+      wiselib::PCSimLossyLinkModel link( o.range, o.loss );
+      wiselib::PCSimOsModel::World world( link, o.seed );
+      world.set_debug_enabled( !o.quiet );
+
+      wiselib::PCSimRandom placement( o.seed );
+      for ( unsigned i = 0; i < o.nodes; i++ )
+         world.add_node( placement.uniform() * o.area, placement.uniform() * o.area );
+
+      for ( unsigned i = 0; i < o.nodes; i++ )
+         application_main( world.os( i ) );
+
+      if ( threads > 1 )
+         world.run_parallel( o.duration, threads );
+      else
+         world.run( o.duration );
+
+      Result r;
+      r.seconds = world.seconds();
+      r.events = world.events();
+      r.sent = world.packets_sent();
+      r.received = world.receptions();
+      r.fingerprint = world.fingerprint();
+
+      fprintf( stderr, "simulated %.3fs: %llu events, %llu packets sent, %llu received"
+         " (%u threads, fingerprint %016llx)\n",
+         r.seconds, r.events, r.sent, r.received, threads, r.fingerprint );
+      return r;
+   }
+}
+
+int main( int argc, const char** argv )
+{
+   Options o;
+   o.nodes = 100;
+   o.range = 30.0;
+   o.area = 300.0;
+   o.duration = 60.0;
+   o.seed = 1;
+   o.loss = 0.0;
+   o.quiet = false;
+   unsigned threads = 1;
+   bool compare = false;
+
+   for ( int i = 1; i < argc; i++ )
+   {
+      if ( strcmp( argv[i], "-q" ) == 0 )
+         o.quiet = true;
+      else if ( strcmp( argv[i], "-c" ) == 0 )
+         compare = true;
+      else if ( i + 1 < argc && strcmp( argv[i], "-n" ) == 0 )
+         o.nodes = strtoul( argv[++i], 0, 10 );
+      else if ( i + 1 < argc && strcmp( argv[i], "-r" ) == 0 )
+         o.range = strtod( argv[++i], 0 );
+      else if ( i + 1 < argc && strcmp( argv[i], "-a" ) == 0 )
+         o.area = strtod( argv[++i], 0 );
+      else if ( i + 1 < argc && strcmp( argv[i], "-t" ) == 0 )
+         o.duration = strtod( argv[++i], 0 );
+      else if ( i + 1 < argc && strcmp( argv[i], "-s" ) == 0 )
+         o.seed = strtoul( argv[++i], 0, 10 );
+      else if ( i + 1 < argc && strcmp( argv[i], "-l" ) == 0 )
+         o.loss = strtod( argv[++i], 0 );
+      else if ( i + 1 < argc && strcmp( argv[i], "-j" ) == 0 )
+         threads = strtoul( argv[++i], 0, 10 );
+      else
+         usage( argv[0] );
+   }
+
+   if ( o.nodes == 0 || o.nodes >= wiselib::PCSimOsModel::World::MAX_NODES )
+      usage( argv[0] );
+
+   Result r = simulate( o, threads );
+   if ( !compare )
+      return 0;
+
+   // Events are not compared: parallel runs handle a transmission to
+   // several partitions as one event per partition
+   Result serial = simulate( o, 1 );
+   if ( r.sent != serial.sent || r.received != serial.received ||
+        r.fingerprint != serial.fingerprint )
+   {
+      fprintf( stderr, "MISMATCH between %u threads and the serial run\n", threads );
+      return 1;
+   }
+   fprintf( stderr, "%u threads match the serial run\n", threads );
+   return 0;
+}
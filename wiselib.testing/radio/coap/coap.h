@@ -36,6 +36,22 @@ static const size_t COAP_DEFAULT_STORAGE_SIZE = 127;
 static const size_t COAPRADIO_SENT_LIST_SIZE = 10;
 static const size_t COAPRADIO_RECEIVED_LIST_SIZE = 10;
 static const size_t COAPRADIO_RESOURCES_SIZE = 5;
+// maximum number of path segments of a registered resource (e.g. 3 for "sensors/temp/raw")
+static const size_t COAPRADIO_RESOURCE_MAX_DEPTH = 4;
+
+// Number of GET responses CoapServiceStatic keeps for answering repeated
+// requests without calling the resource. 0 disables the cache.
+static const size_t COAPRADIO_RESPONSE_CACHE_SIZE = 0;
+// responses with a larger payload are not cached
+static const size_t COAPRADIO_RESPONSE_CACHE_PAYLOAD_SIZE = 32;
+
+// number of clients that can observe resources of a CoapServiceStatic
+static const size_t COAPRADIO_OBSERVERS_SIZE = 4;
+// number of resources a CoapServiceStatic can observe on other nodes
+static const size_t COAPRADIO_OBSERVATIONS_SIZE = 2;
+// Block size used for block-wise transfers, 2^(SZX+4) bytes. Must fit into
+// the storage of a packet along with its options.
+static const uint8_t COAPRADIO_BLOCK_SZX = 2;
 
 enum CoapMsgIds
 {
@@ -79,11 +95,14 @@ enum CoapOptionNum
 	COAP_OPT_URI_PORT = 7,
 	COAP_OPT_LOCATION_QUERY = 8,
 	COAP_OPT_URI_PATH = 9,
+	COAP_OPT_OBSERVE = 10, // draft-ietf-core-observe-05
 	COAP_OPT_TOKEN = 11,
 	COAP_OPT_ACCEPT = 12,
 	COAP_OPT_IF_MATCH = 13,
 	COAP_OPT_FENCEPOST = 14,
 	COAP_OPT_URI_QUERY = 15,
+	COAP_OPT_BLOCK2 = 17, // draft-ietf-core-block-08
+	COAP_OPT_BLOCK1 = 19, // draft-ietf-core-block-08
 	COAP_OPT_IF_NONE_MATCH = 21
 };
 
@@ -96,6 +115,8 @@ static const uint8_t COAP_OPT_MAXLEN_TOKEN = 8;
 static const uint8_t COAP_OPT_MAXLEN_ACCEPT = 2;
 static const uint8_t COAP_OPT_MAXLEN_IF_MATCH = 8;
 static const uint8_t COAP_OPT_MAXLEN_IF_NONE_MATCH = 0;
+static const uint8_t COAP_OPT_MAXLEN_OBSERVE = 2;
+static const uint8_t COAP_OPT_MAXLEN_BLOCK = 3;
 static const uint16_t COAP_STRING_OPTS_MAXLEN = 270;
 static const uint16_t COAP_STRING_OPTS_MINLEN = 1;
 
@@ -125,6 +146,7 @@ enum CoapCode
 	COAP_CODE_VALID = 67, // 2.03
 	COAP_CODE_CHANGED = 68, // 2.04
 	COAP_CODE_CONTENT = 69, // 2.05
+	COAP_CODE_CONTINUE = 95, // 2.31, draft-ietf-core-block-08
 	COAP_CODE_BAD_REQUEST = 128, // 4.00
 	COAP_CODE_UNAUTHORIZED = 129, // 4.01
 	COAP_CODE_BAD_OPTION = 	130, // 4.02
@@ -172,16 +194,16 @@ static const uint8_t COAP_OPTION_FORMAT[COAP_OPTION_ARRAY_SIZE] =
 	COAP_FORMAT_UINT,			// 7: COAP_OPT_URI_PORT
 	COAP_FORMAT_STRING,			// 8: COAP_OPT_LOCATION_QUERY
 	COAP_FORMAT_STRING,			// 9: COAP_OPT_URI_PATH
-	COAP_FORMAT_UNKNOWN,		// 10: not in use
+	COAP_FORMAT_UINT,			// 10: COAP_OPT_OBSERVE
 	COAP_FORMAT_OPAQUE,			// 11: COAP_OPT_TOKEN
 	COAP_FORMAT_UINT,			// 12: COAP_OPT_ACCEPT
 	COAP_FORMAT_OPAQUE,			// 13: COAP_OPT_IF_MATCH
 	COAP_FORMAT_NONE,			// 14: COAP_OPT_FENCEPOST
 	COAP_FORMAT_STRING,			// 15: COAP_OPT_URI_QUERY
 	COAP_FORMAT_UNKNOWN,		// 16: not in use
-	COAP_FORMAT_UNKNOWN,		// 17: not in use
+	COAP_FORMAT_UINT,			// 17: COAP_OPT_BLOCK2
 	COAP_FORMAT_UNKNOWN,		// 18: not in use
-	COAP_FORMAT_UNKNOWN,		// 19: not in use
+	COAP_FORMAT_UINT,			// 19: COAP_OPT_BLOCK1
 	COAP_FORMAT_UNKNOWN,		// 20: not in use
 	COAP_FORMAT_NONE			// 21: COAP_OPT_IF_NONE_MATCH
 };
@@ -198,16 +220,16 @@ static const bool COAP_OPT_CAN_OCCUR_MULTIPLE[COAP_OPTION_ARRAY_SIZE] =
 	false,			// 7: COAP_OPT_URI_PORT
 	true,			// 8: COAP_OPT_LOCATION_QUERY
 	true,			// 9: COAP_OPT_URI_PATH
-	false,			// 10: not in use
+	false,			// 10: COAP_OPT_OBSERVE
 	false,			// 11: COAP_OPT_TOKEN
 	true,			// 12: COAP_OPT_ACCEPT
 	true,			// 13: COAP_OPT_IF_MATCH
 	false,			// 14: COAP_OPT_FENCEPOST
 	true,			// 15: COAP_OPT_URI_QUERY
 	false,			// 16: not in use
-	false,			// 17: not in use
+	false,			// 17: COAP_OPT_BLOCK2
 	false,			// 18: not in use
-	false,			// 19: not in use
+	false,			// 19: COAP_OPT_BLOCK1
 	false,			// 20: not in use
 	false			// 21: COAP_OPT_IF_NONE_MATCH
 };
@@ -218,6 +240,33 @@ namespace wiselib
 	// Size of tokens sent by coapradio.h. This does not affect what size tokens coapradio can receive/process!
 	typedef uint32_t coap_token_t;
 
+	// Block1/Block2 option values consist of the block number NUM, the
+	// "more blocks follow" flag M and the size exponent SZX
+	inline uint32_t coap_block_value( uint32_t num, bool more, uint8_t szx )
+	{
+		return ( num << 4 ) | ( more ? 0x08 : 0x00 ) | ( szx & 0x07 );
+	}
+
+	inline uint32_t coap_block_num( uint32_t value )
+	{
+		return value >> 4;
+	}
+
+	inline bool coap_block_more( uint32_t value )
+	{
+		return ( value & 0x08 ) != 0;
+	}
+
+	inline uint8_t coap_block_szx( uint32_t value )
+	{
+		return value & 0x07;
+	}
+
+	inline size_t coap_block_size( uint8_t szx )
+	{
+		return ( (size_t) 16 ) << szx;
+	}
+
 
 	class OpaqueData
 	{
@@ -1673,21 +1673,44 @@ namespace wiselib
 		uint8_t current = 0;
 		uint8_t previous = 0;
 		size_t opt_length;
-		while( ( option_count_ < num_of_opts  || num_of_opts == COAP_UNLIMITED_OPTIONS ) )
+		block_data_t *end = storage_ + message_length;
+		while( ( option_count_ < num_of_opts  || num_of_opts == COAP_UNLIMITED_OPTIONS )
+		       && curr_position < end )
 		{
 			// end of options
-			if( is_end_of_opts_marker( curr_position ) )
+			if( num_of_opts == COAP_UNLIMITED_OPTIONS && *curr_position == COAP_END_OF_OPTIONS_MARKER )
+			{
+				++curr_position;
 				break;
+			}
 
 			current = previous + ( ( *curr_position & 0xf0) >> 4);
 
 			// length of option plus header
 			opt_length = *curr_position & 0x0f;
 			if( opt_length == COAP_LONG_OPTION )
+			{
+				if( curr_position + 1 >= end )
+				{
+					error_code_ = COAP_CODE_BAD_REQUEST;
+					error_option_ = current;
+					return ERR_OPTIONS_EXCEED_PACKET_LENGTH;
+				}
 				opt_length = *(curr_position + 1) + 17;
+			}
 			else
 				++opt_length;
 
+			// every option, even an ignored one, has to lie within the
+			// message, and the message may not end before the last option
+			if( curr_position + opt_length > end
+			    || ( curr_position + opt_length == end && option_count_ + 1 < num_of_opts ) )
+			{
+				error_code_ = COAP_CODE_BAD_REQUEST;
+				error_option_ = current;
+				return ERR_OPTIONS_EXCEED_PACKET_LENGTH;
+			}
+
 			if( current == previous
 			    && !COAP_OPT_CAN_OCCUR_MULTIPLE[current] )
 			{
@@ -1747,15 +1770,6 @@ namespace wiselib
 			++option_count_;
 			previous = current;
 			curr_position += opt_length;
-
-			if( (curr_position >= (storage_ + storage_size_)
-			    || curr_position >= ( storage_ + message_length ))
-			    && ( option_count_ < num_of_opts ) )
-			{
-				error_code_ = COAP_CODE_BAD_REQUEST;
-				error_option_ = current;
-				return ERR_OPTIONS_EXCEED_PACKET_LENGTH;
-			}
 		}
 
 		end_of_options_ = curr_position;
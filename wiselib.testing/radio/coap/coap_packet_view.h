@@ -0,0 +1,480 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef COAP_PACKET_VIEW_H
+#define COAP_PACKET_VIEW_H
+
+#include "coap.h"
+
+namespace wiselib
+{
+	/**
+	 * \brief Non-owning reference to a string inside a buffer, e.g. the value
+	 * of a string option. It is not null-terminated.
+	 */
+	class CoapStringView
+	{
+	public:
+		CoapStringView()
+		{
+			data_ = NULL;
+			length_ = 0;
+		}
+
+		CoapStringView( const char *data, size_t length )
+		{
+			data_ = data;
+			length_ = length;
+		}
+
+		const char * data() const
+		{
+			return data_;
+		}
+
+		size_t length() const
+		{
+			return length_;
+		}
+
+		bool operator==( const char *other ) const
+		{
+			return strncmp( data_, other, length_ ) == 0 && other[length_] == '\0';
+		}
+
+		bool operator!=( const char *other ) const
+		{
+			return !( *this == other );
+		}
+
+		bool operator==( const CoapStringView &other ) const
+		{
+			return length_ == other.length_ && memcmp( data_, other.data_, length_ ) == 0;
+		}
+
+		bool operator!=( const CoapStringView &other ) const
+		{
+			return !( *this == other );
+		}
+
+	private:
+		const char *data_;
+		size_t length_;
+	};
+
+	/**
+	 * \brief Zero-copy view of a CoAP message in a datastream, e.g. the
+	 * buffer handed to a radio receive callback.
+	 *
+	 * parse() only checks the header and the option headers, the same way
+	 * CoapPacketStatic::parse_message() does, but copies nothing. Options are
+	 * decoded on demand while iterating over them, string values are
+	 * returned as CoapStringView into the datastream.<br>
+	 * The view is only valid as long as the datastream is.
+	 */
+	template<typename OsModel_P,
+	typename Radio_P>
+	class CoapPacketView
+	{
+	public:
+		typedef OsModel_P OsModel;
+		typedef Radio_P Radio;
+		typedef typename Radio::block_data_t block_data_t;
+
+		typedef CoapPacketView<OsModel_P, Radio_P> self_type;
+
+		enum error_code
+		{
+			// inherited from concepts::BasicReturnValues_concept
+			SUCCESS = OsModel::SUCCESS,
+			ERR_NOMEM = OsModel::ERR_NOMEM,
+			ERR_UNSPEC = OsModel::ERR_UNSPEC,
+			ERR_NOTIMPL = OsModel::ERR_NOTIMPL,
+			// view errors
+			ERR_OPT_NOT_SET,
+			ERR_WRONG_TYPE,
+			ERR_OPT_TOO_LONG,
+			ERR_OPTIONS_EXCEED_PACKET_LENGTH,
+			ERR_UNKNOWN_CRITICAL_OPTION,
+			ERR_MULTIPLE_OCCURENCES_OF_CRITICAL_OPTION,
+			ERR_NOT_COAP,
+			ERR_WRONG_COAP_VERSION
+		};
+
+		/**
+		 * Forward iterator over the options of a CoapPacketView, in
+		 * ascending order of their option numbers. Fenceposts are skipped.
+		 */
+		class option_iterator
+		{
+		public:
+			option_iterator()
+			{
+				pos_ = NULL;
+				end_ = NULL;
+				number_ = 0;
+				remaining_ = 0;
+				unlimited_ = false;
+			}
+
+			option_iterator( block_data_t *start, block_data_t *end, size_t count )
+			{
+				pos_ = start;
+				end_ = end;
+				number_ = 0;
+				remaining_ = count;
+				unlimited_ = ( count == COAP_UNLIMITED_OPTIONS );
+				enter();
+			}
+
+			bool operator==( const option_iterator &other ) const
+			{
+				return pos_ == other.pos_;
+			}
+
+			bool operator!=( const option_iterator &other ) const
+			{
+				return pos_ != other.pos_;
+			}
+
+			option_iterator& operator++()
+			{
+				step();
+				enter();
+				return *this;
+			}
+
+			/**
+			 * @return number of the current option
+			 */
+			uint8_t number() const
+			{
+				return number_;
+			}
+
+			/**
+			 * @return start of the current option's value in the datastream
+			 */
+			block_data_t * value() const
+			{
+				return ( ( *pos_ & 0x0f ) == COAP_LONG_OPTION ) ? pos_ + 2 : pos_ + 1;
+			}
+
+			/**
+			 * @return length of the current option's value
+			 */
+			size_t length() const
+			{
+				size_t len = *pos_ & 0x0f;
+				if( len == COAP_LONG_OPTION )
+					len += *( pos_ + 1 );
+				return len;
+			}
+
+			/**
+			 * @return the current option's value decoded as unsigned integer
+			 */
+			uint32_t uint_value() const
+			{
+				uint32_t result = 0;
+				block_data_t *v = value();
+				for( size_t i = 0; i < length() && i < sizeof( uint32_t ); ++i )
+					result = ( result << 8 ) | v[i];
+				return result;
+			}
+
+			/**
+			 * @return the current option's value as string, pointing into the datastream
+			 */
+			CoapStringView string_value() const
+			{
+				return CoapStringView( (const char*) value(), length() );
+			}
+
+		private:
+			// moves to the next option header, or to the end
+			void step()
+			{
+				pos_ = value() + length();
+				--remaining_;
+			}
+
+			// reads the option header at pos_, skipping fenceposts
+			void enter()
+			{
+				while( pos_ != NULL )
+				{
+					if( pos_ >= end_ || ( !unlimited_ && remaining_ == 0 )
+					    || ( unlimited_ && *pos_ == COAP_END_OF_OPTIONS_MARKER ) )
+					{
+						pos_ = NULL;
+						return;
+					}
+					number_ += ( *pos_ & 0xf0 ) >> 4;
+					if( number_ == 0 || number_ % COAP_OPT_FENCEPOST != 0 )
+						return;
+					step();
+				}
+			}
+
+			block_data_t *pos_;
+			block_data_t *end_;
+			uint8_t number_;
+			// options left including the current one
+			size_t remaining_;
+			// the end of options is marked instead of counted
+			bool unlimited_;
+		};
+
+		CoapPacketView()
+		{
+			datastream_ = NULL;
+			length_ = 0;
+			payload_ = NULL;
+		}
+
+		/**
+		 * Checks the message in datastream without copying it.
+		 * @return CoapPacketView::SUCCESS if the message can be read,<br>
+		 *         CoapPacketView::ERR_NOT_COAP<br>
+		 *         CoapPacketView::ERR_WRONG_COAP_VERSION<br>
+		 *         CoapPacketView::ERR_OPTIONS_EXCEED_PACKET_LENGTH<br>
+		 *         CoapPacketView::ERR_UNKNOWN_CRITICAL_OPTION<br>
+		 *         CoapPacketView::ERR_MULTIPLE_OCCURENCES_OF_CRITICAL_OPTION
+		 */
+		int parse( block_data_t *datastream, size_t length )
+		{
+			int status = parse_header( datastream, length );
+			if( status != SUCCESS )
+				return status;
+			datastream_ = NULL;
+
+			block_data_t *pos = datastream + COAP_START_OF_OPTIONS;
+			block_data_t *end = datastream + length;
+			size_t count = *datastream & 0x0f;
+			size_t seen = 0;
+			uint8_t previous = 0;
+			while( ( seen < count || count == COAP_UNLIMITED_OPTIONS ) && pos < end )
+			{
+				if( count == COAP_UNLIMITED_OPTIONS && *pos == COAP_END_OF_OPTIONS_MARKER )
+				{
+					++pos;
+					break;
+				}
+				uint8_t current = previous + ( ( *pos & 0xf0 ) >> 4 );
+				size_t opt_length = *pos & 0x0f;
+				if( opt_length == COAP_LONG_OPTION )
+				{
+					if( pos + 1 >= end )
+						return ERR_OPTIONS_EXCEED_PACKET_LENGTH;
+					opt_length = *( pos + 1 ) + 17;
+				}
+				else
+				{
+					++opt_length;
+				}
+
+				// same rules as CoapPacketStatic::initial_scan_opts()
+				if( current == previous && current <= COAP_LARGEST_OPTION_NUMBER
+				    && !COAP_OPT_CAN_OCCUR_MULTIPLE[current] && ( current & 0x01 ) )
+					return ERR_MULTIPLE_OCCURENCES_OF_CRITICAL_OPTION;
+				if( ( current > COAP_LARGEST_OPTION_NUMBER || COAP_OPTION_FORMAT[current] == COAP_FORMAT_UNKNOWN )
+				    && ( current & 0x01 ) )
+					return ERR_UNKNOWN_CRITICAL_OPTION;
+
+				++seen;
+				previous = current;
+				pos += opt_length;
+				if( pos > end || ( pos == end && seen < count ) )
+					return ERR_OPTIONS_EXCEED_PACKET_LENGTH;
+			}
+
+			datastream_ = datastream;
+			length_ = length;
+			payload_ = pos;
+			return SUCCESS;
+		}
+
+		/**
+		 * Checks only the header of the message in datastream. Afterwards
+		 * the header fields can be read, but the view is not valid() until
+		 * set_payload_length() is called for the message.
+		 * @return CoapPacketView::SUCCESS,<br>
+		 *         CoapPacketView::ERR_NOT_COAP<br>
+		 *         CoapPacketView::ERR_WRONG_COAP_VERSION
+		 */
+		int parse_header( block_data_t *datastream, size_t length )
+		{
+			datastream_ = NULL;
+			payload_ = NULL;
+			if( length < COAP_START_OF_OPTIONS )
+				return ERR_NOT_COAP;
+			if( ( *datastream >> 6 ) != COAP_VERSION )
+				return ERR_WRONG_COAP_VERSION;
+			datastream_ = datastream;
+			length_ = length;
+			return SUCCESS;
+		}
+
+		/**
+		 * Completes a view set up by parse_header() whose options were
+		 * checked elsewhere, e.g. by CoapPacketStatic::parse_message(), so
+		 * they are not scanned a second time.
+		 * @param payload_length length of the payload at the end of the message
+		 */
+		void set_payload_length( size_t payload_length )
+		{
+			payload_ = datastream_ + length_ - payload_length;
+		}
+
+		/**
+		 * @return true if parse() succeeded, or parse_header() and set_payload_length()
+		 */
+		bool valid() const
+		{
+			return datastream_ != NULL && payload_ != NULL;
+		}
+
+		/**
+		 * @return the datastream this view refers to
+		 */
+		block_data_t * datastream() const
+		{
+			return datastream_;
+		}
+
+		/**
+		 * @return length of the whole message
+		 */
+		size_t length() const
+		{
+			return length_;
+		}
+
+		uint8_t version() const
+		{
+			return *datastream_ >> 6;
+		}
+
+		CoapType type() const
+		{
+			return (CoapType) ( ( *datastream_ & 0x30 ) >> 4 );
+		}
+
+		CoapCode code() const
+		{
+			return (CoapCode) *( datastream_ + 1 );
+		}
+
+		bool is_request() const
+		{
+			return( code() >= COAP_REQUEST_CODE_RANGE_MIN && code() <= COAP_REQUEST_CODE_RANGE_MAX );
+		}
+
+		bool is_response() const
+		{
+			return( code() >= COAP_RESPONSE_CODE_RANGE_MIN && code() <= COAP_RESPONSE_CODE_RANGE_MAX );
+		}
+
+		coap_msg_id_t msg_id() const
+		{
+			return read<OsModel, block_data_t, coap_msg_id_t>( datastream_ + 2 );
+		}
+
+		/**
+		 * @return start of the payload in the datastream
+		 */
+		block_data_t * data() const
+		{
+			return payload_;
+		}
+
+		size_t data_length() const
+		{
+			return ( datastream_ + length_ ) - payload_;
+		}
+
+		option_iterator begin_options() const
+		{
+			return option_iterator( datastream_ + COAP_START_OF_OPTIONS, payload_, *datastream_ & 0x0f );
+		}
+
+		option_iterator end_options() const
+		{
+			return option_iterator();
+		}
+
+		/**
+		 * @return iterator to the first option with the given number,
+		 * end_options() if there is none. Options that may occur several
+		 * times (e.g. the segments of Uri-Path) follow it directly.
+		 */
+		option_iterator find( CoapOptionNum option_number ) const
+		{
+			option_iterator it = begin_options();
+			while( it != end_options() && it.number() < option_number )
+				++it;
+			if( it != end_options() && it.number() != option_number )
+				return end_options();
+			return it;
+		}
+
+		int get_option( CoapOptionNum option_number, uint32_t &value ) const
+		{
+			option_iterator it = find( option_number );
+			if( it == end_options() )
+				return ERR_OPT_NOT_SET;
+			if( COAP_OPTION_FORMAT[option_number] != COAP_FORMAT_UINT )
+				return ERR_WRONG_TYPE;
+			if( it.length() > sizeof( uint32_t ) )
+				return ERR_OPT_TOO_LONG;
+			value = it.uint_value();
+			return SUCCESS;
+		}
+
+		int get_option( CoapOptionNum option_number, OpaqueData &value ) const
+		{
+			option_iterator it = find( option_number );
+			if( it == end_options() )
+				return ERR_OPT_NOT_SET;
+			if( COAP_OPTION_FORMAT[option_number] != COAP_FORMAT_OPAQUE )
+				return ERR_WRONG_TYPE;
+			if( it.length() > COAP_OPT_MAXLEN_OPAQUE )
+				return ERR_OPT_TOO_LONG;
+			value.set( it.value(), it.length() );
+			return SUCCESS;
+		}
+
+		/**
+		 * Returns the token, a zero length OpaqueData object if it is not set
+		 */
+		void token( OpaqueData &token ) const
+		{
+			if( get_option( COAP_OPT_TOKEN, token ) != SUCCESS )
+				token = OpaqueData();
+		}
+
+	private:
+		block_data_t *datastream_;
+		size_t length_;
+		block_data_t *payload_;
+	};
+}
+
+#endif // COAP_PACKET_VIEW_H
@@ -22,6 +22,7 @@
 
 #include "coap.h"
 #include "coap_packet_static.h"
+#include "coap_packet_view.h"
 #include "util/delegates/delegate.hpp"
 #include "util/pstl/vector_static.h"
 #include "util/pstl/static_string.h"
@@ -38,9 +39,10 @@
 		typename coap_packet_t_, \
 		typename OsModel_P::size_t sent_list_size_, \
 		typename OsModel_P::size_t received_list_size_, \
-		typename OsModel_P::size_t resources_list_size_>
+		typename OsModel_P::size_t resources_list_size_, \
+		typename OsModel_P::size_t response_cache_size_>
 
-#define COAP_SERVICE_T	CoapServiceStatic<OsModel_P, Radio_P, Timer_P, Rand_P, String_T, preface_msg_id_, human_readable_errors_, coap_packet_t_, sent_list_size_, received_list_size_, resources_list_size_>
+#define COAP_SERVICE_T	CoapServiceStatic<OsModel_P, Radio_P, Timer_P, Rand_P, String_T, preface_msg_id_, human_readable_errors_, coap_packet_t_, sent_list_size_, received_list_size_, resources_list_size_, response_cache_size_>
 
 namespace wiselib {
 
@@ -64,6 +66,7 @@ namespace wiselib {
  * \tparam sent_list_size_ size of the message buffer that holds messages sent by CoapServiceStatic
  * \tparam received_list_size_ size of the message buffer that holds messages received by CoapServiceStatic
  * \tparam resources_list_size_ determines how many resources can be registered at CoapServiceStatic
+ * \tparam response_cache_size_ number of GET responses that are kept for answering repeated requests without calling the resource, 0 disables caching
  */
 template<typename OsModel_P,
 	typename Radio_P = typename OsModel_P::Radio,
@@ -75,7 +78,8 @@ template<typename OsModel_P,
 	typename coap_packet_t_ = typename wiselib::CoapPacketStatic<OsModel_P, Radio_P, String_T>::coap_packet_t,
 	typename OsModel_P::size_t sent_list_size_ = COAPRADIO_SENT_LIST_SIZE,
 	typename OsModel_P::size_t received_list_size_ = COAPRADIO_RECEIVED_LIST_SIZE,
-	typename OsModel_P::size_t resources_list_size_ = COAPRADIO_RESOURCES_SIZE>
+	typename OsModel_P::size_t resources_list_size_ = COAPRADIO_RESOURCES_SIZE,
+	typename OsModel_P::size_t response_cache_size_ = COAPRADIO_RESPONSE_CACHE_SIZE>
 	class CoapServiceStatic
 	{
 
@@ -102,6 +106,7 @@ template<typename OsModel_P,
 		typedef self_t CoapServiceStatic_t;
 
 		typedef coap_packet_t_ coap_packet_t;
+		typedef CoapPacketView<OsModel, Radio> coap_packet_view_t;
 
 		enum error_codes
 		{
@@ -138,7 +143,6 @@ template<typename OsModel_P,
 
 			ReceivedMessage()
 			{
-				message_ = coap_packet_t();
 				ack_ = NULL;
 				response_ = NULL;
 			}
@@ -174,6 +178,19 @@ template<typename OsModel_P,
 				return message_;
 			}
 
+			/**
+			 * Gets a zero-copy view of the message in the buffer it was
+			 * received in. Options read through the view are decoded on
+			 * demand. Only valid while the message is being handled, i.e.
+			 * during the resource or response callback, check valid() if
+			 * in doubt.
+			 * @return view of the received message
+			 */
+			const coap_packet_view_t & view() const
+			{
+				return view_;
+			}
+
 			/**
 			 * Gets sender of the message
 			 * @return sender of the CoAP message
@@ -205,12 +222,19 @@ template<typename OsModel_P,
 		private:
 			friend class COAP_SERVICE_T;
 			coap_packet_t message_;
+			// only set while the message is being handled, not copied
+			coap_packet_view_t view_;
 			// in this case the sender
 			node_id_t correspondent_;
 			coap_packet_t *ack_;
 			coap_packet_t *response_;
 			// TODO: empfangszeit? (Freshness)
 
+			void set_view( const coap_packet_view_t &view )
+			{
+				view_ = view;
+			}
+
 			void set_message( const coap_packet_t &message)
 			{
 				message_ = message;
@@ -290,9 +314,9 @@ template<typename OsModel_P,
 		 * Registers a resource. Whenever a request contains an Uri-Path that
 		 * equals the resource_path or is a subresource of it, it will be passed
 		 * to the callback
-		 * @param resource_path path of the resource
+		 * @param resource_path path of the resource, at most COAPRADIO_RESOURCE_MAX_DEPTH segments
 		 * @param callback Delegate to call when a request for the resource is received
-		 * @return index for unregistering a resource
+		 * @return index for unregistering a resource, -1 if there is no room left
 		 */
 		template<class T, void (T::*TMethod)(ReceivedMessage&)>
 		int reg_resource_callback( string_t resource_path, T *callback );
@@ -331,7 +355,7 @@ template<typename OsModel_P,
 		 * @param uri_path Uri-Path to be requested, use "" for empty path
 		 * @param uri_query Uri-Query to be requested, use "" for empty path
 		 * @param callback Delegate that is called when a response is received
-		 * @param payload body of the request
+		 * @param payload body of the request. Bodies larger than one block (COAPRADIO_BLOCK_SZX) are sent block-wise, payload has to stay valid until the final response arrived then
 		 * @param payload_length length of body
 		 * @param confirmable set to true if a CON message should be send
 		 * @param uri_host use if server hosts several virtual hosts
@@ -355,7 +379,7 @@ template<typename OsModel_P,
 		 * @param uri_path Uri-Path to be requested, use "" for empty path
 		 * @param uri_query Uri-Query to be requested, use "" for empty path
 		 * @param callback Delegate that is called when a response is received
-		 * @param payload body of the request
+		 * @param payload body of the request. Bodies larger than one block (COAPRADIO_BLOCK_SZX) are sent block-wise, payload has to stay valid until the final response arrived then
 		 * @param payload_length length of body
 		 * @param confirmable set to true if a CON message should be send
 		 * @param uri_host use if server hosts several virtual hosts
@@ -400,7 +424,7 @@ template<typename OsModel_P,
 		 * @param uri_path Uri-Path to be requested, use "" for empty path
 		 * @param uri_query Uri-Query to be requested, use "" for empty path
 		 * @param callback Delegate that is called when a response is received
-		 * @param payload body of the request
+		 * @param payload body of the request. Bodies larger than one block (COAPRADIO_BLOCK_SZX) are sent block-wise, payload has to stay valid until the final response arrived then
 		 * @param payload_length length of body
 		 * @param confirmable set to true if a CON message should be send
 		 * @param uri_host use if server hosts several virtual hosts
@@ -420,16 +444,72 @@ template<typename OsModel_P,
 					uint16_t uri_port = COAP_STD_PORT);
 
 		/**
-		 * Sends a reply to a received message.
+		 * Sends a reply to a received message.<br>
+		 * Block-wise transfers are handled statelessly: if the payload is larger than one block, only the block the client asked for
+		 * (the first one by default) is sent, and the resource is invoked again for every following block. Requests with a Block1
+		 * option reach the resource one block at a time, reply with COAP_CODE_CONTINUE until the last block (the one without the
+		 * "more" flag) has arrived.
 		 * @param req_msg received message that triggered this reply. Note that it has to be the reference that was passed to the application in the callback. Do not pass a copy here, because it would break mechanisms like piggybacked ACKs and retransmissions.
-		 * @param payload body of the reply
+		 * @param payload body of the reply, the whole representation for block-wise transfers
 		 * @param payload_length length of the body
 		 * @param code Code of the reply, COAP_CODE_CONTENT by default
+		 * @param max_age value of the Max-Age option in seconds. A 2.05 (Content) reply to a GET is kept in the response cache for that long, 0 prevents caching
 		 */
 		coap_packet_t* reply( ReceivedMessage& req_msg,
 				uint8_t* payload,
 				size_t payload_length,
-				CoapCode code = COAP_CODE_CONTENT );
+				CoapCode code = COAP_CODE_CONTENT,
+				uint32_t max_age = COAP_DEFAULT_MAX_AGE );
+
+		/**
+		 * Sends a notification to every client that observes the resource
+		 * uri_path, i.e. that sent a GET with an Observe option for it which
+		 * was answered with a 2.xx reply. Payloads larger than one block
+		 * are sent block-wise, observers fetch the remaining blocks with
+		 * GET requests which are answered by the resource.
+		 * @param uri_path Uri-Path of the resource that changed
+		 * @param payload new representation of the resource
+		 * @param payload_length length of payload
+		 * @param code Code of the notification, a code other than 2.xx ends the observation
+		 * @param confirmable set to true if the notifications should be CON messages
+		 * @param max_age value of the Max-Age option in seconds
+		 * @return number of observers notified
+		 */
+		int notify( const string_t &uri_path,
+				uint8_t* payload,
+				size_t payload_length,
+				CoapCode code = COAP_CODE_CONTENT,
+				bool confirmable = false,
+				uint32_t max_age = COAP_DEFAULT_MAX_AGE );
+
+		/**
+		 * Sends a GET request with an Observe option. The callback is
+		 * invoked for the response and for every notification that follows,
+		 * until cancel_observe() is called or the server ends the
+		 * observation (the response has no Observe option). Notifications
+		 * larger than one block arrive block by block, the remaining blocks
+		 * are fetched with ordinary GET requests.
+		 * @param receiver server to send the request to
+		 * @param uri_path Uri-Path to be observed, use "" for empty path
+		 * @param uri_query Uri-Query to be observed, use "" for empty path
+		 * @param callback Delegate that is called when a response or notification is received
+		 * @param confirmable set to true if a CON message should be send
+		 * @return index for cancel_observe(), -1 if the request could not be sent or COAPRADIO_OBSERVATIONS_SIZE resources are already observed
+		 */
+		template<class T, void (T::*TMethod)(ReceivedMessage&)>
+		int observe(node_id_t receiver,
+					const string_t &uri_path,
+					const string_t &uri_query,
+					T *callback,
+					bool confirmable = false);
+
+		/**
+		 * Stops observing a resource. Further notifications are answered
+		 * with RST, which makes the server forget about this node.
+		 * @param idx index returned by observe()
+		 * @return CoapServiceStatic::SUCCESS, or CoapServiceStatic::ERR_UNSPEC if idx is out of range
+		 */
+		int cancel_observe( int idx );
 
 	private:
 #ifdef BOOST_TEST_DECL
@@ -447,6 +527,8 @@ template<typename OsModel_P,
 				ack_received_ = false;
 				sender_callback_ = coapreceiver_delegate_t();
 				response_ = NULL;
+				block1_payload_ = NULL;
+				block1_length_ = 0;
 			}
 
 			coap_packet_t & message() const
@@ -531,6 +613,23 @@ template<typename OsModel_P,
 				sender_callback_ = callback;
 			}
 
+			uint8_t * block1_payload() const
+			{
+				return block1_payload_;
+			}
+
+			size_t block1_length() const
+			{
+				return block1_length_;
+			}
+
+			// whole body of a request that is sent block-wise
+			void set_block1_payload( uint8_t *payload, size_t length )
+			{
+				block1_payload_ = payload;
+				block1_length_ = length;
+			}
+
 		private:
 			coap_packet_t message_;
 			// in this case the receiver
@@ -540,6 +639,8 @@ template<typename OsModel_P,
 			bool ack_received_;
 			ReceivedMessage * response_;
 			coapreceiver_delegate_t sender_callback_;
+			uint8_t *block1_payload_;
+			size_t block1_length_;
 		};
 
 		class CoapResource
@@ -592,6 +693,99 @@ template<typename OsModel_P,
 			coapreceiver_delegate_t callback_;
 		};
 
+		typedef uint16_t trie_index_t;
+
+		enum
+		{
+			// every resource adds at most one node per path segment, plus the root
+			TRIE_SIZE = resources_list_size_ * COAPRADIO_RESOURCE_MAX_DEPTH + 1,
+			TRIE_NONE = 0xffff,
+			// zero sized arrays are not allowed, the cache is disabled at run time then
+			CACHE_SLOTS = response_cache_size_ ? response_cache_size_ : 1,
+			// age of cached responses is counted in steps of this many ms
+			CACHE_TICK = 1000
+		};
+
+		/**
+		 * One path segment of the resource trie. Instead of the segment
+		 * itself only its hash and length are stored; a match is confirmed
+		 * against the resource path before the callback is invoked.
+		 */
+		struct ResourceTrieNode
+		{
+			uint16_t hash_;
+			uint8_t length_;
+			trie_index_t first_child_;
+			trie_index_t next_sibling_;
+			// first resource registered for exactly this path, further ones are chained through resource_next_
+			trie_index_t resource_;
+		};
+
+		class CachedResponse
+		{
+		public:
+			CachedResponse()
+			{
+				max_age_ = 0;
+				payload_length_ = 0;
+			}
+
+			bool valid() const
+			{
+				return max_age_ > 0;
+			}
+
+			void invalidate()
+			{
+				max_age_ = 0;
+			}
+
+			// Uri-Path and Uri-Query, separated by '?'
+			string_t key_;
+			// remaining seconds this response may be served
+			uint32_t max_age_;
+			size_t payload_length_;
+			block_data_t payload_[COAPRADIO_RESPONSE_CACHE_PAYLOAD_SIZE];
+		};
+
+		// a client observing one of our resources
+		class Observer
+		{
+		public:
+			Observer()
+			{
+				active_ = false;
+			}
+
+			bool active_;
+			node_id_t correspondent_;
+			OpaqueData token_;
+			string_t path_;
+			// ID of the last notification, a RST for it ends the observation
+			coap_msg_id_t last_msg_id_;
+		};
+
+		// a resource we observe on another node
+		class Observation
+		{
+		public:
+			Observation()
+			{
+				active_ = false;
+			}
+
+			bool active_;
+			node_id_t correspondent_;
+			OpaqueData token_;
+			// to fetch the remaining blocks of block-wise notifications
+			string_t path_;
+			string_t query_;
+			// Observe value of the latest notification, to drop reordered ones
+			uint16_t last_seq_;
+			bool seq_valid_;
+			coapreceiver_delegate_t callback_;
+		};
+
 		typedef list_static<OsModel, ReceivedMessage, received_list_size_> received_list_t;
 		typedef list_static<OsModel, SentMessage, sent_list_size_> sent_list_t;
 
@@ -603,6 +797,18 @@ template<typename OsModel_P,
 		received_list_t received_;
 		vector_static<OsModel, CoapResource, resources_list_size_> resources_;
 
+		ResourceTrieNode trie_[TRIE_SIZE];
+		trie_index_t trie_size_;
+		trie_index_t resource_next_[resources_list_size_];
+
+		CachedResponse cache_[CACHE_SLOTS];
+		size_t cache_next_;
+		bool cache_timer_running_;
+
+		Observer observers_[COAPRADIO_OBSERVERS_SIZE];
+		Observation observations_[COAPRADIO_OBSERVATIONS_SIZE];
+		uint16_t observe_seq_;
+
 		coap_msg_id_t msg_id_;
 		coap_token_t token_;
 
@@ -612,7 +818,7 @@ template<typename OsModel_P,
 		coap_token_t token();
 
 		template <typename T, list_size_t N>
-		T * queue_message(T message, list_static<OsModel_P, T, N> &queue);
+		T * queue_message(const T &message, list_static<OsModel_P, T, N> &queue);
 
 		template <typename T, list_size_t N>
 		T* find_message_by_id (node_id_t correspondent, coap_msg_id_t id, list_static<OsModel_P, T, N> &queue);
@@ -634,6 +840,37 @@ template<typename OsModel_P,
 
 		int path_cmp( const string_t &lhs, const string_t &rhs);
 
+		SentMessage* send_coap_delegate( node_id_t receiver, const coap_packet_t & message, const coapreceiver_delegate_t &callback );
+
+		int set_block_data( coap_packet_t &packet, uint8_t* payload, size_t payload_length, bool block_requested, uint32_t block2 );
+		void request_next_block( ReceivedMessage& message, SentMessage *request );
+		bool send_next_block1( ReceivedMessage& message, SentMessage *request );
+
+		Observer* find_observer( node_id_t correspondent, const OpaqueData &token );
+		Observation* find_observation( node_id_t correspondent, const OpaqueData &token );
+		void update_observer( ReceivedMessage& message );
+		bool handle_notification( ReceivedMessage& message );
+
+		coap_packet_t* send_reply( ReceivedMessage& req_msg,
+				uint8_t* payload,
+				size_t payload_length,
+				CoapCode code,
+				uint32_t max_age );
+
+		uint16_t segment_hash( const char *segment, size_t length );
+		void trie_clear();
+		bool trie_insert( trie_index_t resource );
+		void trie_compile();
+		trie_index_t trie_child( trie_index_t node, const char *segment, size_t length );
+		bool path_matches( string_t path, const coap_packet_view_t &view, size_t depth );
+
+		bool cache_key( ReceivedMessage& message, string_t &key );
+		CachedResponse* cache_find( const string_t &key );
+		void cache_store( ReceivedMessage& req_msg, uint8_t* payload, size_t payload_length, uint32_t max_age );
+		void cache_invalidate( const string_t &path );
+		void cache_clear();
+		void cache_tick( void * );
+
 	};
 
 
@@ -643,6 +880,10 @@ template<typename OsModel_P,
 	COAP_SERVICE_T::CoapServiceStatic()
 	{
 		//init();
+		trie_clear();
+		cache_next_ = 0;
+		cache_timer_running_ = false;
+		observe_seq_ = 0;
 	}
 
 	COAP_SERVICE_TEMPLATE_PREFIX
@@ -720,27 +961,10 @@ template<typename OsModel_P,
 	template <class T, void (T::*TMethod)( typename COAP_SERVICE_T::ReceivedMessage& ) >
 	coap_packet_t_ * COAP_SERVICE_T::send_coap_as_is(node_id_t receiver, const coap_packet_t & message, T *callback)
 	{
-		block_data_t buf[message.serialize_length()];
-
-		size_t len = message.serialize(buf);
-		int status = send(receiver, len, buf);
-
-		if(status != SUCCESS )
+		SentMessage *sent = send_coap_delegate( receiver, message, coapreceiver_delegate_t::template from_method<T, TMethod>( callback ) );
+		if( sent == NULL )
 			return NULL;
-
-		SentMessage & sent = *( queue_message(SentMessage(), sent_) );
-		sent.set_correspondent( receiver );
-		sent.set_message( message );
-		sent.set_sender_callback( coapreceiver_delegate_t::template from_method<T, TMethod>( callback ) );
-		uint16_t response_timeout = (uint16_t) ((*rand_)( (COAP_MAX_RESPONSE_TIMEOUT - COAP_RESPONSE_TIMEOUT) ) + COAP_RESPONSE_TIMEOUT);
-		sent.set_retransmit_timeout( response_timeout );
-
-		if( message.type() == COAP_MSG_TYPE_CON )
-		{
-			timer_->template set_timer<self_type, &self_type::retransmit_timeout>( sent.retransmit_timeout(), this, &sent );
-		}
-
-		return &(sent.message());
+		return &(sent->message());
 	}
 
 	COAP_SERVICE_TEMPLATE_PREFIX
@@ -781,91 +1005,103 @@ template<typename OsModel_P,
 			}
 			if( ( preface_msg_id_ && msg_id == CoapMsgId ) || !preface_msg_id_ )
 			{
-				coap_packet_t packet;
+				// Check the header in place first, duplicates and
+				// non-CoAP traffic are never copied or parsed
+				coap_packet_view_t view;
+				if( view.parse_header( data + msg_id_t_size, len - msg_id_t_size ) != SUCCESS )
+				{
+					// ignore
+					// wrong Coap Version is a good indicator for "isn't
+					// actually CoAP", so better ignore
+					return;
+				}
 
-				int err_code = packet.parse_message( data + msg_id_t_size, len - msg_id_t_size );
+				ReceivedMessage *deduplication = find_message_by_id( from, view.msg_id(), received_ );
 
-				if( err_code == SUCCESS )
+				if( deduplication != NULL )
 				{
-					ReceivedMessage *deduplication;
-					// Only act if this message hasn't been received yet
-					if( (deduplication = find_message_by_id(from, packet.msg_id(), received_)) == NULL )
+					// if it's confirmable we might want to hurry sending an ACK
+					if( view.type() == COAP_MSG_TYPE_CON )
+						ack( *deduplication );
+					// if the response was piggybacked it was already resent by the line above
+					if( deduplication->response_sent() != NULL
+							&& deduplication->response_sent()->type() != COAP_MSG_TYPE_ACK)
 					{
-						ReceivedMessage& received_message = *( queue_message( ReceivedMessage( packet, from ), received_ ) );
-
-						SentMessage *request;
+						block_data_t buf[ deduplication->response_sent()->serialize_length() ];
 
-						if ( packet.type() == COAP_MSG_TYPE_RST )
-						{
-							request = find_message_by_id( from, packet.msg_id(), sent_ );
-							if( request != NULL )
-								(*request).sender_callback()( received_message );
-							return;
-						}
-						else if( packet.type() == COAP_MSG_TYPE_ACK )
-						{
-							request = find_message_by_id( from, packet.msg_id(), sent_ );
-
-							if ( request != NULL )
-							{
-								(*request).set_ack_received( true );
-								// piggy-backed response, give it to whoever sent the request
-								if( packet.is_response() )
-									handle_response( received_message, request );
-							}
-						}
-						else
-						{
-							if( packet.is_request() )
-							{
-								handle_request( received_message );
-							}
-							else if ( packet.is_response() )
-							{
-								handle_response( received_message );
-							}
-							else if( packet.type() == COAP_MSG_TYPE_CON )
-							{
-								char * error_description = NULL;
-								int len = 0;
-								if( human_readable_errors_ )
-								{
-									char error_description_str[COAP_ERROR_STRING_LEN];
-									len = sprintf( error_description, "Unknown Code %i", packet.code() );
-									error_description = error_description_str;
-								}
-								reply( received_message, (block_data_t*) error_description, len, COAP_CODE_NOT_IMPLEMENTED );
-							}
-						}
+						deduplication->response_sent()->serialize(buf);
+						send(deduplication->correspondent(), deduplication->response_sent()->serialize_length(), buf);
 					}
-					else
-					{
-						// if it's confirmable we might want to hurry sending an ACK
-						if( packet.type() == COAP_MSG_TYPE_CON )
-							ack( *deduplication );
-						// if the response was piggybacked it was already resent by the line above
-						if( deduplication->response_sent() != NULL
-								&& deduplication->response_sent()->type() != COAP_MSG_TYPE_ACK)
-						{
-							block_data_t buf[ deduplication->response_sent()->serialize_length() ];
+					return;
+				}
 
-							deduplication->response_sent()->serialize(buf);
-							send(deduplication->correspondent(), deduplication->response_sent()->serialize_length(), buf);
-						}
+				// Only act if this message hasn't been received yet. It is
+				// parsed straight into its slot, deferred replies need it.
+				// This is the only pass over the options, the view takes
+				// the end of the options from it.
+				ReceivedMessage& received_message = *( queue_message( ReceivedMessage(), received_ ) );
+				received_message.set_correspondent( from );
+				int parse_status = received_message.message_.parse_message( data + msg_id_t_size, len - msg_id_t_size );
+				if( parse_status != SUCCESS )
+				{
+					error_response( parse_status, received_message );
+					return;
+				}
+				view.set_payload_length( received_message.message_.data_length() );
+				received_message.set_view( view );
+
+				SentMessage *request;
+
+				if ( view.type() == COAP_MSG_TYPE_RST )
+				{
+					// a RST in response to a notification ends the observation
+					for( size_t i = 0; i < COAPRADIO_OBSERVERS_SIZE; ++i )
+					{
+						if( observers_[i].active_ && observers_[i].correspondent_ == from
+								&& observers_[i].last_msg_id_ == view.msg_id() )
+							observers_[i].active_ = false;
 					}
+					request = find_message_by_id( from, view.msg_id(), sent_ );
+					if( request != NULL )
+						(*request).sender_callback()( received_message );
 				}
-				else if( err_code == coap_packet_t::ERR_NOT_COAP
-				         || err_code == coap_packet_t::ERR_WRONG_COAP_VERSION )
+				else if( view.type() == COAP_MSG_TYPE_ACK )
 				{
-					// ignore
-					// wrong Coap Version is a good indicator for "isn't
-					// actually CoAP", so better ignore
+					request = find_message_by_id( from, view.msg_id(), sent_ );
+
+					if ( request != NULL )
+					{
+						(*request).set_ack_received( true );
+						// piggy-backed response, give it to whoever sent the request
+						if( view.is_response() )
+							handle_response( received_message, request );
+					}
 				}
 				else
 				{
-					ReceivedMessage& received_error = *( queue_message( ReceivedMessage( packet, from ), received_ ) );
-					error_response( err_code, received_error );
+					if( view.is_request() )
+					{
+						handle_request( received_message );
+					}
+					else if ( view.is_response() )
+					{
+						handle_response( received_message );
+					}
+					else if( view.type() == COAP_MSG_TYPE_CON )
+					{
+						char * error_description = NULL;
+						int len = 0;
+						if( human_readable_errors_ )
+						{
+							char error_description_str[COAP_ERROR_STRING_LEN];
+							len = sprintf( error_description, "Unknown Code %i", view.code() );
+							error_description = error_description_str;
+						}
+						reply( received_message, (block_data_t*) error_description, len, COAP_CODE_NOT_IMPLEMENTED );
+					}
 				}
+				// data is only borrowed for the duration of this call
+				received_message.set_view( coap_packet_view_t() );
 			}
 		}
 	}
@@ -885,7 +1121,7 @@ template<typename OsModel_P,
 	{
 
 		if ( resources_.empty() )
-			resources_.assign( COAPRADIO_RESOURCES_SIZE, CoapResource() );
+			resources_.assign( resources_list_size_, CoapResource() );
 
 		for ( unsigned int i = 0; i < resources_.size(); ++i )
 		{
@@ -893,6 +1129,15 @@ template<typename OsModel_P,
 			{
 				resources_.at(i).set_resource_path( resource_path );
 				resources_.at(i).set_callback( coapreceiver_delegate_t::template from_method<T, TMethod>( callback ) );
+				if( !trie_insert( i ) )
+				{
+					// path too deep, the trie may hold a partial path now
+					resources_.at(i) = CoapResource();
+					trie_compile();
+					return -1;
+				}
+				// cached responses may stem from a resource this one overrides
+				cache_clear();
 				return i;
 			}
 		}
@@ -904,6 +1149,100 @@ template<typename OsModel_P,
 	int COAP_SERVICE_T::unreg_resource_callback( int idx )
 	{
 		resources_.at(idx) = CoapResource();
+		trie_compile();
+		cache_clear();
+		return SUCCESS;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	int COAP_SERVICE_T::notify( const string_t &uri_path,
+				uint8_t* payload,
+				size_t payload_length,
+				CoapCode code,
+				bool confirmable,
+				uint32_t max_age )
+	{
+		// cached responses for the resource are outdated now
+		cache_invalidate( uri_path );
+
+		bool success = ( code >> 5 ) == 2;
+		if( success )
+			++observe_seq_;
+
+		int notified = 0;
+		for( size_t i = 0; i < COAPRADIO_OBSERVERS_SIZE; ++i )
+		{
+			Observer &observer = observers_[i];
+			if( !observer.active_ || !( observer.path_ == uri_path ) )
+				continue;
+
+			coap_packet_t notification;
+			confirmable ? notification.set_type( COAP_MSG_TYPE_CON ) : notification.set_type( COAP_MSG_TYPE_NON );
+			notification.set_code( code );
+			notification.set_token( observer.token_ );
+			if( success )
+				notification.set_option( COAP_OPT_OBSERVE, observe_seq_ );
+			else
+				observer.active_ = false;
+			if( max_age != COAP_DEFAULT_MAX_AGE )
+				notification.set_option( COAP_OPT_MAX_AGE, max_age );
+			set_block_data( notification, payload, payload_length, false, 0 );
+
+			coap_packet_t *sent = send_coap_gen_msg_id<self_type, &self_type::receive_coap>( observer.correspondent_, notification, this );
+			if( sent != NULL )
+			{
+				observer.last_msg_id_ = sent->msg_id();
+				++notified;
+			}
+		}
+		return notified;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	template <class T, void (T::*TMethod)( typename COAP_SERVICE_T::ReceivedMessage& ) >
+	int COAP_SERVICE_T::observe(node_id_t receiver,
+			const string_t &uri_path,
+			const string_t &uri_query,
+			T *callback,
+			bool confirmable)
+	{
+		int idx = -1;
+		for( size_t i = 0; i < COAPRADIO_OBSERVATIONS_SIZE && idx == -1; ++i )
+		{
+			if( !observations_[i].active_ )
+				idx = i;
+		}
+		if( idx == -1 )
+			return -1;
+
+		coap_packet_t pack;
+		pack.set_code( COAP_CODE_GET );
+		pack.set_uri_path( uri_path );
+		pack.set_uri_query( uri_query );
+		pack.set_option( COAP_OPT_OBSERVE, (uint32_t) 0 );
+		confirmable ? pack.set_type( COAP_MSG_TYPE_CON ) : pack.set_type( COAP_MSG_TYPE_NON );
+
+		coap_packet_t *sent = send_coap_gen_msg_id_token<T, TMethod>( receiver, pack, callback );
+		if( sent == NULL )
+			return -1;
+
+		Observation &observation = observations_[idx];
+		observation.active_ = true;
+		observation.correspondent_ = receiver;
+		sent->token( observation.token_ );
+		observation.path_ = uri_path;
+		observation.query_ = uri_query;
+		observation.seq_valid_ = false;
+		observation.callback_ = coapreceiver_delegate_t::template from_method<T, TMethod>( callback );
+		return idx;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	int COAP_SERVICE_T::cancel_observe( int idx )
+	{
+		if( idx < 0 || idx >= (int) COAPRADIO_OBSERVATIONS_SIZE )
+			return ERR_UNSPEC;
+		observations_[idx].active_ = false;
 		return SUCCESS;
 	}
 
@@ -990,7 +1329,18 @@ template<typename OsModel_P,
 		pack.set_uri_path( uri_path );
 		pack.set_uri_query( uri_query );
 
-		pack.set_data( payload, payload_length );
+		// larger bodies are sent block-wise, one block per 2.31 (Continue) reply
+		size_t block_size = coap_block_size( COAPRADIO_BLOCK_SZX );
+		bool block_wise = payload_length > block_size;
+		if( block_wise )
+		{
+			pack.set_option( COAP_OPT_BLOCK1, coap_block_value( 0, true, COAPRADIO_BLOCK_SZX ) );
+			pack.set_data( payload, block_size );
+		}
+		else
+		{
+			pack.set_data( payload, payload_length );
+		}
 
 		confirmable ? pack.set_type( COAP_MSG_TYPE_CON ) : pack.set_type( COAP_MSG_TYPE_NON );
 
@@ -1001,14 +1351,37 @@ template<typename OsModel_P,
 
 		pack.set_uri_port( uri_port );
 
-		return send_coap_gen_msg_id_token<T, TMethod>(receiver, pack, callback );
+		coap_packet_t *sent = send_coap_gen_msg_id_token<T, TMethod>(receiver, pack, callback );
+		if( sent != NULL && block_wise )
+		{
+			find_message_by_id( receiver, sent->msg_id(), sent_ )->set_block1_payload( payload, payload_length );
+		}
+		return sent;
 	}
 
 	COAP_SERVICE_TEMPLATE_PREFIX
 	coap_packet_t_ * COAP_SERVICE_T::reply(ReceivedMessage &req_msg,
 				uint8_t* payload,
 				size_t payload_length,
-				CoapCode code )
+				CoapCode code,
+				uint32_t max_age )
+	{
+		coap_packet_t *sendstatus = send_reply( req_msg, payload, payload_length, code, max_age );
+		if( sendstatus != NULL && code == COAP_CODE_CONTENT )
+		{
+			cache_store( req_msg, payload, payload_length, max_age );
+		}
+		return sendstatus;
+	}
+
+
+// private
+	COAP_SERVICE_TEMPLATE_PREFIX
+	coap_packet_t_ * COAP_SERVICE_T::send_reply(ReceivedMessage &req_msg,
+				uint8_t* payload,
+				size_t payload_length,
+				CoapCode code,
+				uint32_t max_age )
 	{
 		coap_packet_t *sendstatus = NULL;
 		coap_packet_t & request = req_msg.message();
@@ -1023,7 +1396,30 @@ template<typename OsModel_P,
 		else
 			return NULL;
 		reply.set_code( code );
-		reply.set_data( payload, payload_length );
+		// an absent Max-Age option means COAP_DEFAULT_MAX_AGE
+		if( max_age != COAP_DEFAULT_MAX_AGE )
+			reply.set_option( COAP_OPT_MAX_AGE, max_age );
+
+		uint32_t option_value;
+		if( request.get_option( COAP_OPT_OBSERVE, option_value ) == SUCCESS )
+		{
+			Observer *observer = find_observer( req_msg.correspondent(), token );
+			if( observer != NULL )
+			{
+				// only successful replies keep the client registered
+				if( ( code >> 5 ) == 2 )
+					reply.set_option( COAP_OPT_OBSERVE, observe_seq_ );
+				else
+					observer->active_ = false;
+			}
+		}
+
+		// the resource decides whether to Continue, we just echo the block
+		if( request.get_option( COAP_OPT_BLOCK1, option_value ) == SUCCESS )
+			reply.set_option( COAP_OPT_BLOCK1, option_value );
+
+		bool block_requested = ( request.get_option( COAP_OPT_BLOCK2, option_value ) == SUCCESS );
+		set_block_data( reply, payload, payload_length, block_requested, option_value );
 
 		if( request.type() == COAP_MSG_TYPE_CON && req_msg.ack_sent() == NULL )
 		{
@@ -1049,8 +1445,6 @@ template<typename OsModel_P,
 		return sendstatus;
 	}
 
-
-// private
 	COAP_SERVICE_TEMPLATE_PREFIX
 	coap_msg_id_t COAP_SERVICE_T::msg_id()
 	{
@@ -1065,7 +1459,7 @@ template<typename OsModel_P,
 
 	COAP_SERVICE_TEMPLATE_PREFIX
 	template <typename T, list_size_t N>
-	T * COAP_SERVICE_T::queue_message(T message, list_static<OsModel_P, T, N> &queue)
+	T * COAP_SERVICE_T::queue_message(const T &message, list_static<OsModel_P, T, N> &queue)
 	{
 		if( queue.full() )
 		{
@@ -1117,6 +1511,17 @@ template<typename OsModel_P,
 	COAP_SERVICE_TEMPLATE_PREFIX
 	void COAP_SERVICE_T::handle_response( ReceivedMessage& message, SentMessage *request )
 	{
+		if( handle_notification( message ) )
+			return;
+
+		uint32_t observe;
+		if( message.message().get_option( COAP_OPT_OBSERVE, observe ) == SUCCESS )
+		{
+			// notification for an observation we cancelled, make the server stop sending them
+			message.set_response_sent( rst( message.correspondent(), message.message().msg_id() ) );
+			return;
+		}
+
 		OpaqueData request_token, response_token;
 		message.message().token( response_token );
 
@@ -1146,12 +1551,21 @@ template<typename OsModel_P,
 			ack( message );
 		}
 
+		if( request->block1_payload() != NULL
+				&& message.message().code() == COAP_CODE_CONTINUE
+				&& send_next_block1( message, request ) )
+		{
+			// intermediate response of a block-wise request
+			return;
+		}
+
 		if( request->sender_callback() && request->sender_callback().obj_ptr() != NULL )
 		{
 			(*request).set_response_received( message );
 			(*request).sender_callback()( message );
 		}
 
+		request_next_block( message, request );
 	}
 
 	COAP_SERVICE_TEMPLATE_PREFIX
@@ -1164,24 +1578,65 @@ template<typename OsModel_P,
 			timer_->template set_timer<self_type, &self_type::ack_timeout>( COAP_ACK_GRACE_PERIOD, this, &message );
 		}
 
-		string_t available_res;
-		// TODO: we're looking at the first path segment only, subresources should be handled by their parents
-		string_t request_res = message.message().uri_path();
+		const coap_packet_view_t &view = message.view();
+
+		if( view.code() == COAP_CODE_GET )
+			update_observer( message );
+
+		if( response_cache_size_ > 0 )
+		{
+			if( view.code() == COAP_CODE_GET )
+			{
+				string_t key;
+				CachedResponse *cached = NULL;
+				if( cache_key( message, key ) )
+					cached = cache_find( key );
+				if( cached != NULL )
+				{
+					send_reply( message, cached->payload_, cached->payload_length_, COAP_CODE_CONTENT, cached->max_age_ );
+					return;
+				}
+			}
+			else
+			{
+				// PUT, POST and DELETE may change what a GET returns
+				cache_invalidate( message.message().uri_path() );
+			}
+		}
+
+		// in order to match a resource, the requested uri must match a resource, or it must be a sub-element of a resource.
+		// Walk down the trie one Uri-Path option at a time, every resource on the way is a match.
+		// The segments are read from the received datastream, no path string is assembled.
 		bool resource_found = false;
-		for(size_t i = 0; i < resources_.size(); ++i )
+		typename coap_packet_view_t::option_iterator segment = view.find( COAP_OPT_URI_PATH );
+		trie_index_t node = 0;
+		size_t depth = 0;
+		for( ;; )
 		{
-			if( resources_.at(i) != CoapResource() && resources_.at(i).callback() && resources_.at(i).callback().obj_ptr() != NULL )
+			// the empty path is not a parent of anything
+			if( node != 0 || segment == view.end_options() )
 			{
-				available_res = resources_.at(i).resource_path();
-				// in order to match a resource, the requested uri must match a resource, or it must be a sub-element of a resource,
-				// which means the next symbol in the request must be a slash
-				if( path_cmp( request_res, available_res ) == EQUAL
-				    || path_cmp( request_res, available_res ) == LHS_IS_SUBRESOURCE )
+				for( trie_index_t r = trie_[node].resource_; r != TRIE_NONE; r = resource_next_[r] )
 				{
-					resources_.at(i).callback()( message );
-					resource_found = true;
+					CoapResource &resource = resources_.at(r);
+					// rule out hash collisions
+					if( resource.callback() && resource.callback().obj_ptr() != NULL
+							&& path_matches( resource.resource_path(), view, depth ) )
+					{
+						resource.callback()( message );
+						resource_found = true;
+					}
 				}
 			}
+
+			if( segment == view.end_options() || segment.number() != COAP_OPT_URI_PATH )
+				break;
+
+			node = trie_child( node, (const char*) segment.value(), segment.length() );
+			if( node == TRIE_NONE )
+				break;
+			++depth;
+			++segment;
 		}
 		if( !resource_found )
 		{
@@ -1191,7 +1646,7 @@ template<typename OsModel_P,
 			if( human_readable_errors_ )
 			{
 				char error_description_str[COAP_ERROR_STRING_LEN];
-				len = sprintf(error_description, "Resource %s not found.", request_res.c_str() );
+				len = sprintf(error_description, "Resource %s not found.", message.message().uri_path().c_str() );
 				error_description = error_description_str;
 			}
 			reply( message, (uint8_t*) error_description, len, COAP_CODE_NOT_FOUND );
@@ -1336,6 +1791,477 @@ template<typename OsModel_P,
 				return NOT_EQUAL;
 		}
 	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	uint16_t COAP_SERVICE_T::segment_hash( const char *segment, size_t length )
+	{
+		// FNV-1a, folded to 16 bit
+		uint32_t hash = 2166136261UL;
+		for( size_t i = 0; i < length; ++i )
+		{
+			hash ^= (uint8_t) segment[i];
+			hash *= 16777619UL;
+		}
+		return (uint16_t) ( hash ^ ( hash >> 16 ) );
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	void COAP_SERVICE_T::trie_clear()
+	{
+		// node 0 is the root and stands for the empty path
+		trie_[0].hash_ = 0;
+		trie_[0].length_ = 0;
+		trie_[0].first_child_ = TRIE_NONE;
+		trie_[0].next_sibling_ = TRIE_NONE;
+		trie_[0].resource_ = TRIE_NONE;
+		trie_size_ = 1;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	bool COAP_SERVICE_T::trie_insert( trie_index_t resource )
+	{
+		string_t resource_path = resources_.at(resource).resource_path();
+		const char *path = resource_path.c_str();
+		size_t path_length = resource_path.length();
+
+		trie_index_t node = 0;
+		size_t start = 0;
+		size_t depth = 0;
+		while( path_length > 0 )
+		{
+			if( ++depth > COAPRADIO_RESOURCE_MAX_DEPTH )
+				return false;
+
+			size_t end = start;
+			while( end < path_length && path[end] != '/' )
+				++end;
+
+			trie_index_t child = trie_child( node, path + start, end - start );
+			if( child == TRIE_NONE )
+			{
+				if( trie_size_ == TRIE_SIZE )
+					return false;
+				child = trie_size_++;
+				trie_[child].hash_ = segment_hash( path + start, end - start );
+				trie_[child].length_ = (uint8_t) ( end - start );
+				trie_[child].first_child_ = TRIE_NONE;
+				trie_[child].resource_ = TRIE_NONE;
+				trie_[child].next_sibling_ = trie_[node].first_child_;
+				trie_[node].first_child_ = child;
+			}
+			node = child;
+
+			if( end == path_length )
+				break;
+			start = end + 1;
+		}
+
+		// keep registration order among resources with the same path
+		resource_next_[resource] = TRIE_NONE;
+		trie_index_t *last = &( trie_[node].resource_ );
+		while( *last != TRIE_NONE )
+			last = &( resource_next_[*last] );
+		*last = resource;
+		return true;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	void COAP_SERVICE_T::trie_compile()
+	{
+		trie_clear();
+		for( size_t i = 0; i < resources_.size(); ++i )
+		{
+			if( resources_.at(i) != CoapResource() )
+				trie_insert( i );
+		}
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	typename COAP_SERVICE_T::trie_index_t COAP_SERVICE_T::trie_child( trie_index_t node, const char *segment, size_t length )
+	{
+		uint16_t hash = segment_hash( segment, length );
+		for( trie_index_t child = trie_[node].first_child_; child != TRIE_NONE; child = trie_[child].next_sibling_ )
+		{
+			if( trie_[child].hash_ == hash && trie_[child].length_ == length )
+				return child;
+		}
+		return TRIE_NONE;
+	}
+
+	// Compares path to the first depth Uri-Path options of view, as if they
+	// were joined by '/'
+	COAP_SERVICE_TEMPLATE_PREFIX
+	bool COAP_SERVICE_T::path_matches( string_t path, const coap_packet_view_t &view, size_t depth )
+	{
+		const char *p = path.c_str();
+		size_t path_length = path.length();
+		size_t pos = 0;
+		typename coap_packet_view_t::option_iterator segment = view.find( COAP_OPT_URI_PATH );
+		for( size_t i = 0; i < depth; ++i, ++segment )
+		{
+			if( i > 0 )
+			{
+				if( pos >= path_length || p[pos] != '/' )
+					return false;
+				++pos;
+			}
+			if( pos + segment.length() > path_length
+					|| memcmp( p + pos, segment.value(), segment.length() ) != 0 )
+				return false;
+			pos += segment.length();
+		}
+		return pos == path_length;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	bool COAP_SERVICE_T::cache_key( ReceivedMessage& message, string_t &key )
+	{
+		string_t query;
+		key = message.message().uri_path();
+		size_t expected_length = key.length() + 1;
+		key.append( "?" );
+		if( message.message().get_option( COAP_OPT_URI_QUERY, query ) == SUCCESS )
+		{
+			expected_length += query.length();
+			key.append( query.c_str() );
+		}
+		// string_t silently drops what doesn't fit, don't mix up different queries then
+		return (size_t) key.length() == expected_length;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	typename COAP_SERVICE_T::CachedResponse* COAP_SERVICE_T::cache_find( const string_t &key )
+	{
+		for( size_t i = 0; i < response_cache_size_; ++i )
+		{
+			if( cache_[i].valid() && cache_[i].key_ == key )
+				return &cache_[i];
+		}
+		return NULL;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	void COAP_SERVICE_T::cache_store( ReceivedMessage& req_msg, uint8_t* payload, size_t payload_length, uint32_t max_age )
+	{
+		if( response_cache_size_ == 0 || max_age == 0
+				|| req_msg.message().code() != COAP_CODE_GET
+				|| payload_length > COAPRADIO_RESPONSE_CACHE_PAYLOAD_SIZE )
+			return;
+
+		string_t key;
+		if( !cache_key( req_msg, key ) )
+			return;
+
+		CachedResponse *entry = cache_find( key );
+		if( entry == NULL )
+		{
+			// take a free slot, or replace entries round robin
+			for( size_t i = 0; i < response_cache_size_ && entry == NULL; ++i )
+			{
+				if( !cache_[i].valid() )
+					entry = &cache_[i];
+			}
+			if( entry == NULL )
+			{
+				entry = &cache_[cache_next_];
+				cache_next_ = ( cache_next_ + 1 ) % response_cache_size_;
+			}
+			entry->key_ = key;
+		}
+		entry->max_age_ = max_age;
+		entry->payload_length_ = payload_length;
+		memcpy( entry->payload_, payload, payload_length );
+
+		if( !cache_timer_running_ )
+		{
+			cache_timer_running_ = true;
+			timer_->template set_timer<self_type, &self_type::cache_tick>( CACHE_TICK, this, NULL );
+		}
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	void COAP_SERVICE_T::cache_invalidate( const string_t &path )
+	{
+		size_t path_length = path.length();
+		for( size_t i = 0; i < response_cache_size_; ++i )
+		{
+			string_t &key = cache_[i].key_;
+			if( !cache_[i].valid()
+					|| (size_t) key.length() <= path_length
+					|| key[path_length] != '?' )
+				continue;
+
+			size_t j = 0;
+			while( j < path_length && key[j] == path[j] )
+				++j;
+			if( j == path_length )
+				cache_[i].invalidate();
+		}
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	void COAP_SERVICE_T::cache_clear()
+	{
+		for( size_t i = 0; i < response_cache_size_; ++i )
+			cache_[i].invalidate();
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	void COAP_SERVICE_T::cache_tick( void * )
+	{
+		bool any_valid = false;
+		for( size_t i = 0; i < response_cache_size_; ++i )
+		{
+			if( cache_[i].valid() )
+			{
+				--cache_[i].max_age_;
+				any_valid |= cache_[i].valid();
+			}
+		}
+
+		// no need to wake up while the cache is empty
+		cache_timer_running_ = any_valid;
+		if( any_valid )
+			timer_->template set_timer<self_type, &self_type::cache_tick>( CACHE_TICK, this, NULL );
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	typename COAP_SERVICE_T::SentMessage* COAP_SERVICE_T::send_coap_delegate( node_id_t receiver, const coap_packet_t & message, const coapreceiver_delegate_t &callback )
+	{
+		block_data_t buf[message.serialize_length()];
+
+		size_t len = message.serialize(buf);
+		int status = send(receiver, len, buf);
+
+		if(status != SUCCESS )
+			return NULL;
+
+		SentMessage & sent = *( queue_message(SentMessage(), sent_) );
+		sent.set_correspondent( receiver );
+		sent.set_message( message );
+		sent.set_sender_callback( callback );
+		uint16_t response_timeout = (uint16_t) ((*rand_)( (COAP_MAX_RESPONSE_TIMEOUT - COAP_RESPONSE_TIMEOUT) ) + COAP_RESPONSE_TIMEOUT);
+		sent.set_retransmit_timeout( response_timeout );
+
+		if( message.type() == COAP_MSG_TYPE_CON )
+		{
+			timer_->template set_timer<self_type, &self_type::retransmit_timeout>( sent.retransmit_timeout(), this, &sent );
+		}
+
+		return &sent;
+	}
+
+	// Puts payload into packet, or only the requested block of it if the
+	// client asked for one or the payload does not fit into a single block.
+	COAP_SERVICE_TEMPLATE_PREFIX
+	int COAP_SERVICE_T::set_block_data( coap_packet_t &packet, uint8_t* payload, size_t payload_length, bool block_requested, uint32_t block2 )
+	{
+		uint8_t szx = COAPRADIO_BLOCK_SZX;
+		size_t offset = 0;
+		if( block_requested )
+		{
+			// the client may ask for smaller blocks, but not for larger ones
+			if( coap_block_szx( block2 ) < szx )
+				szx = coap_block_szx( block2 );
+			offset = coap_block_num( block2 ) * coap_block_size( coap_block_szx( block2 ) );
+		}
+
+		size_t block_size = coap_block_size( szx );
+		if( !block_requested && payload_length <= block_size )
+			return packet.set_data( payload, payload_length );
+
+		if( offset > payload_length || ( offset == payload_length && offset > 0 ) )
+		{
+			packet.set_code( COAP_CODE_BAD_OPTION );
+			return ERR_UNSPEC;
+		}
+
+		size_t length = payload_length - offset;
+		bool more = false;
+		if( length > block_size )
+		{
+			length = block_size;
+			more = true;
+		}
+		packet.set_option( COAP_OPT_BLOCK2, coap_block_value( offset / block_size, more, szx ) );
+		return packet.set_data( payload + offset, length );
+	}
+
+	// Fetches the next block of a block-wise response
+	COAP_SERVICE_TEMPLATE_PREFIX
+	void COAP_SERVICE_T::request_next_block( ReceivedMessage& message, SentMessage *request )
+	{
+		uint32_t block2;
+		if( message.message().get_option( COAP_OPT_BLOCK2, block2 ) != SUCCESS
+				|| !coap_block_more( block2 ) )
+			return;
+
+		// the request is reused with a new message ID but the same token;
+		// it might be dropped from sent_ while sending, so copy it first
+		coap_packet_t next = request->message();
+		node_id_t receiver = request->correspondent();
+		coapreceiver_delegate_t callback = request->sender_callback();
+
+		next.remove_option( COAP_OPT_OBSERVE );
+		next.set_option( COAP_OPT_BLOCK2, coap_block_value( coap_block_num( block2 ) + 1, false, coap_block_szx( block2 ) ) );
+		next.set_msg_id( msg_id() );
+		send_coap_delegate( receiver, next, callback );
+	}
+
+	// Sends the block following the one acknowledged by a 2.31 (Continue) response
+	COAP_SERVICE_TEMPLATE_PREFIX
+	bool COAP_SERVICE_T::send_next_block1( ReceivedMessage& message, SentMessage *request )
+	{
+		uint32_t block1;
+		if( message.message().get_option( COAP_OPT_BLOCK1, block1 ) != SUCCESS )
+			return false;
+
+		uint8_t *payload = request->block1_payload();
+		size_t payload_length = request->block1_length();
+
+		// the server may ask for smaller blocks
+		uint8_t szx = coap_block_szx( block1 );
+		if( szx > COAPRADIO_BLOCK_SZX )
+			szx = COAPRADIO_BLOCK_SZX;
+		size_t block_size = coap_block_size( szx );
+		size_t offset = ( coap_block_num( block1 ) + 1 ) * coap_block_size( coap_block_szx( block1 ) );
+		if( offset >= payload_length )
+			return false;
+
+		size_t length = payload_length - offset;
+		bool more = false;
+		if( length > block_size )
+		{
+			length = block_size;
+			more = true;
+		}
+
+		coap_packet_t next = request->message();
+		node_id_t receiver = request->correspondent();
+		coapreceiver_delegate_t callback = request->sender_callback();
+
+		next.set_option( COAP_OPT_BLOCK1, coap_block_value( offset / block_size, more, szx ) );
+		next.set_data( payload + offset, length );
+		next.set_msg_id( msg_id() );
+		SentMessage *sent = send_coap_delegate( receiver, next, callback );
+		if( sent != NULL )
+			sent->set_block1_payload( payload, payload_length );
+		return true;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	typename COAP_SERVICE_T::Observer* COAP_SERVICE_T::find_observer( node_id_t correspondent, const OpaqueData &token )
+	{
+		for( size_t i = 0; i < COAPRADIO_OBSERVERS_SIZE; ++i )
+		{
+			if( observers_[i].active_ && observers_[i].correspondent_ == correspondent
+					&& observers_[i].token_ == token )
+				return &observers_[i];
+		}
+		return NULL;
+	}
+
+	COAP_SERVICE_TEMPLATE_PREFIX
+	typename COAP_SERVICE_T::Observation* COAP_SERVICE_T::find_observation( node_id_t correspondent, const OpaqueData &token )
+	{
+		for( size_t i = 0; i < COAPRADIO_OBSERVATIONS_SIZE; ++i )
+		{
+			if( observations_[i].active_ && observations_[i].correspondent_ == correspondent
+					&& observations_[i].token_ == token )
+				return &observations_[i];
+		}
+		return NULL;
+	}
+
+	// Registers the sender of a GET with Observe option as observer of path.
+	// Whether it stays registered depends on the reply of the resource.
+	COAP_SERVICE_TEMPLATE_PREFIX
+	void COAP_SERVICE_T::update_observer( ReceivedMessage& message )
+	{
+		uint32_t observe;
+		if( message.view().get_option( COAP_OPT_OBSERVE, observe ) != SUCCESS )
+			return;
+
+		OpaqueData token;
+		message.view().token( token );
+		Observer *observer = find_observer( message.correspondent(), token );
+		for( size_t i = 0; i < COAPRADIO_OBSERVERS_SIZE && observer == NULL; ++i )
+		{
+			if( !observers_[i].active_ )
+				observer = &observers_[i];
+		}
+		// no room, the reply won't carry an Observe option then
+		if( observer == NULL )
+			return;
+
+		observer->active_ = true;
+		observer->correspondent_ = message.correspondent();
+		observer->token_ = token;
+		observer->path_ = message.message().uri_path();
+	}
+
+	// Passes responses and notifications for an observe() request to the
+	// observation's callback. Returns false if message belongs to no observation.
+	COAP_SERVICE_TEMPLATE_PREFIX
+	bool COAP_SERVICE_T::handle_notification( ReceivedMessage& message )
+	{
+		OpaqueData token;
+		message.message().token( token );
+		Observation *observation = find_observation( message.correspondent(), token );
+		if( observation == NULL )
+			return false;
+
+		if( message.message().type() == COAP_MSG_TYPE_CON )
+		{
+			ack( message );
+		}
+
+		uint32_t observe;
+		if( message.message().get_option( COAP_OPT_OBSERVE, observe ) == SUCCESS )
+		{
+			uint16_t seq = (uint16_t) observe;
+			// notifications may overtake each other
+			if( observation->seq_valid_ && (int16_t) ( seq - observation->last_seq_ ) <= 0 )
+				return true;
+			observation->last_seq_ = seq;
+			observation->seq_valid_ = true;
+		}
+		else
+		{
+			// the server did not register us or ended the observation
+			observation->active_ = false;
+		}
+
+		// the callback may cancel the observation, copy what is needed for
+		// the remaining blocks first
+		node_id_t correspondent = observation->correspondent_;
+		string_t path = observation->path_;
+		string_t query = observation->query_;
+		coapreceiver_delegate_t callback = observation->callback_;
+		if( callback && callback.obj_ptr() != NULL )
+			callback( message );
+
+		// a notification only carries the first block, the rest is fetched
+		// with a new token so that the responses are not taken for notifications
+		uint32_t block2;
+		if( message.message().get_option( COAP_OPT_BLOCK2, block2 ) == SUCCESS
+				&& coap_block_more( block2 ) )
+		{
+			coap_packet_t next;
+			message.message().type() == COAP_MSG_TYPE_CON ? next.set_type( COAP_MSG_TYPE_CON ) : next.set_type( COAP_MSG_TYPE_NON );
+			next.set_code( COAP_CODE_GET );
+			next.set_uri_path( path );
+			next.set_uri_query( query );
+			next.set_option( COAP_OPT_BLOCK2, coap_block_value( coap_block_num( block2 ) + 1, false, coap_block_szx( block2 ) ) );
+			OpaqueData token;
+			coap_token_t raw_token = this->token();
+			token.set( ( uint8_t* ) &raw_token, sizeof( coap_token_t ) );
+			next.set_token( token );
+			next.set_msg_id( msg_id() );
+			send_coap_delegate( correspondent, next, callback );
+		}
+		return true;
+	}
 }
 
 
@@ -27,6 +27,8 @@
 #ifndef _VOLUMEMSG_H
 #define	_VOLUMEMSG_H
 
+#include "util/serialization/serialization.h"
+
 namespace wiselib {
 
     template <typename OsModel_P,typename Radio_P > // Template Parameters:  and the underluying Radio (Not the Reliable Radio)
@@ -46,7 +48,9 @@ namespace wiselib {
 
         enum message_types {
         VOLUME_MESSAGE = 201,   // message that is part of a bigger payload
-        SINGLE_MESSAGE = 202    // message containing a complete payload
+        SINGLE_MESSAGE = 202,   // message containing a complete payload
+        VOLUME_ACK = 203,       // bitmap of the fragments received so far
+        VOLUME_MESSAGE_END = 204 // last fragment of a burst, asks for a VOLUME_ACK
     };
 
         enum {
@@ -61,7 +65,8 @@ namespace wiselib {
         enum{
             FRAGMENT_SIZE = Radio::MAX_MESSAGE_LENGTH-PAYLOAD_POS-1,
             MESSAGE_LENGTH = Radio::MAX_MESSAGE_LENGTH,
-            MAX_MESSAGE_LENGTH = (FRAGMENT_SIZE)*256
+            MAX_MESSAGE_LENGTH = (FRAGMENT_SIZE)*255, // the number of fragments has to fit into a byte
+            MAX_FRAGMENTS = 255
         };
 
         // --------------------------------------------------------------------
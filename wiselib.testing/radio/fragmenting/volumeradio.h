@@ -29,10 +29,10 @@
 
 //wiselib includes
 #include "util/delegates/delegate.hpp"
-#include "util/pstl/vector_static.h"
+#include "util/pstl/map_static_hash.h"
 #include "util/pstl/pair.h"
 
-#include "../radio_base.h"
+#include "util/base_classes/radio_base.h"
 
 // volume message type include
 #include "volumemsg.h"
@@ -42,22 +42,60 @@
  * VolumeRadio::<task> [ type= ...]
  *
  * */
-#define DEBUG_VOLUMERADIO
+//#define DEBUG_VOLUMERADIO
+
+#ifndef VOLUME_MAX_TRANSFERS
+#define VOLUME_MAX_TRANSFERS 4 // transfers being sent resp. received at the same time
+#endif
+#ifndef VOLUME_BUFFERS
+#define VOLUME_BUFFERS 2 // pooled buffers, shared by sending and reassembly
+#endif
+#ifndef VOLUME_BUFFER_SIZE
+#define VOLUME_BUFFER_SIZE 512 // larger messages can only be streamed
+#endif
+#ifndef VOLUME_MAX_CONNECTIONS
+#define VOLUME_MAX_CONNECTIONS 40
+#endif
+#ifndef VOLUME_RETRANSMIT_TIMEOUT
+#define VOLUME_RETRANSMIT_TIMEOUT 500 // [ms]
+#endif
+#ifndef VOLUME_MAX_RETRIES
+#define VOLUME_MAX_RETRIES 3
+#endif
 
 namespace wiselib {
 
     /*
-     * ReliableRadio Template
+     * VolumeRadio Template
      * Uses OsModel, Radio and Timer
      * Degug is only for debugging
-     * ReliableRadio is used as a layer between normal radio
-     * and application to make sure that messages will be
-     * delivered besides any errors that may occur.
+     * VolumeRadio splits messages larger than a single radio
+     * message into fragments and puts them back together on
+     * the receiving side.
+     *
+     * The fragments of a transfer go out back-to-back, the last
+     * one of a burst asks the receiver for a bitmap of the
+     * fragments it has, and only the missing ones are resent.
+     * Transfers to be resent are kept in one of VOLUME_BUFFERS
+     * pooled buffers, or are read again from the application
+     * (send_stream()). Received fragments are put together in a
+     * pooled buffer as well, the receivers registered with
+     * reg_fragment_callback() get every fragment as it arrives,
+     * so transfers larger than VOLUME_BUFFER_SIZE need no buffer
+     * at all. Nothing is allocated from the heap.
+     *
+     * A transfer that is still not acknowledged after
+     * VOLUME_MAX_RETRIES retransmissions is given up and passed to
+     * the receiver registered with reg_drop_callback(). It may
+     * still have arrived if only the acks got lost.
      * */
     template<typename OsModel_P, typename Radio_P, typename Timer_P,
     typename Debug_P>
     class VolumeRadio
-    : public RadioBase<OsModel_P,Radio_P>{
+    : public RadioBase<OsModel_P,
+    typename Radio_P::node_id_t,
+    typename Radio_P::size_t,
+    typename Radio_P::block_data_t> {
     public:
         // Type definitions
         typedef OsModel_P OsModel;
@@ -72,37 +110,29 @@ namespace wiselib {
         typedef typename Radio::block_data_t block_data_t;
         typedef typename Radio::message_id_t message_id_t;
 
-
-
-
-
-
         typedef VolumeRadio<OsModel_P, Radio_P, Timer_P, Debug_P> self_t;
 
 
         typedef VolumeMsg<OsModel, Radio > VolumeMessage_t;
 
-        /*
-         * struct that describes a message buffer
-         * contains the sequence number
-         * the source of the message
-         * and data to show if receiving is complete
-         */
-        struct information {
-            uint16_t seq_no;
-            node_id_t source;
-            uint8_t fragments_received;
-            uint8_t total_fragments;
-        };
-
-        typedef struct information information_t;
-
-
-        // radio callbacks delegate
-        typedef delegate3<void, int, long, unsigned char*> radio_delegate_t;
+        // receives each fragment as it arrives: sender, transfer id,
+        // offset and length of the data, data, true once all fragments
+        // of the transfer were passed
+        typedef delegate6<void, node_id_t, uint16_t, size_t, size_t, block_data_t*, bool> fragment_delegate_t;
+        // fills in the data of a streamed transfer: offset, length, buffer
+        typedef delegate3<void, size_t, size_t, block_data_t*> fragment_source_delegate_t;
+        // told about a transfer given up: destination, transfer id, length,
+        // data (NULL if streamed, only valid during the call)
+        typedef delegate4<void, node_id_t, uint16_t, size_t, block_data_t*> drop_delegate_t;
 
         // --------------------------------------------------------------------
 
+        enum ErrorCodes {
+            SUCCESS = OsModel::SUCCESS,
+            ERR_NOMEM = OsModel::ERR_NOMEM,
+            ERR_BUSY = OsModel::ERR_BUSY
+        };
+
         enum SpecialNodeIds {
             BROADCAST_ADDRESS = Radio::BROADCAST_ADDRESS, ///< All nodes in communication rnage
             NULL_NODE_ID = Radio::NULL_NODE_ID
@@ -116,9 +146,53 @@ namespace wiselib {
             ///< Maximal number of bytes in payload
         };
 
-        // Vector Storing all messages received but not finished yet
-        typedef wiselib::vector_static<OsModel,
-        pair<information_t, uint8_t* >, MAX_PENDING> vector_t;
+        enum {
+            NO_BUFFER = 0xff,
+            BITMAP_SIZE = (VolumeMessage_t::MAX_FRAGMENTS + 7) / 8
+        };
+
+        /*
+         * struct that describes a transfer being sent
+         * seq_no == 0 means unused
+         */
+        struct outgoing_transfer {
+            uint16_t seq_no;
+            node_id_t destination;
+            size_t length;
+            uint8_t total_fragments;
+            uint8_t retries;
+            uint16_t timer_id; // identifies the retransmission timer currently armed
+            uint8_t buffer; // pooled copy of the data, NO_BUFFER if streamed
+            fragment_source_delegate_t source;
+            uint8_t acked[BITMAP_SIZE];
+        };
+
+        /*
+         * struct that describes a transfer being received
+         * contains the sequence number
+         * the source of the message
+         * and data to show if receiving is complete
+         */
+        struct incoming_transfer {
+            uint16_t seq_no;
+            node_id_t source;
+            uint8_t fragments_received;
+            uint8_t total_fragments;
+            size_t length; // known once the last fragment arrived
+            uint16_t age; // when the transfer was last heard of
+            uint8_t buffer; // pooled reassembly buffer, NO_BUFFER if streamed only
+            bool complete;
+            uint8_t received[BITMAP_SIZE];
+        };
+
+        typedef struct outgoing_transfer outgoing_transfer_t;
+        typedef struct incoming_transfer incoming_transfer_t;
+
+        // (source, sequence number) -> index into incoming_
+        typedef pair<node_id_t, uint16_t> transfer_key_t;
+        typedef wiselib::map_static_hash<OsModel, transfer_key_t, uint8_t, 2 * VOLUME_MAX_TRANSFERS> transfer_index_t;
+        // destination -> next sequence number
+        typedef wiselib::map_static_hash<OsModel, node_id_t, uint16_t, VOLUME_MAX_CONNECTIONS> connections_t;
 
         // --------------------------------------------------------------------
 
@@ -138,119 +212,145 @@ namespace wiselib {
             debug().debug("VolumeRadio::enable\n");
 #endif
 
-            //set the local os pointer
-            
             //enable normal radio
             radio().enable_radio();
             // register receive callback to normal radio
             recv_callback_id_ = radio().template reg_recv_callback<self_t,
                     &self_t::receive > ( this);
 
-            // initialize the buffers for pending messages
-            for (int i = 0; i < MAX_PENDING; i++) {
-                pending_messages_[i].first.seq_no = 0; // seq_no ==  0 means unused
-                pending_messages_[i].second = new uint8_t[MAX_MESSAGE_LENGTH]; // set the buffer size
-
+            for (int i = 0; i < VOLUME_MAX_TRANSFERS; i++) {
+                outgoing_[i].seq_no = 0; // seq_no ==  0 means unused
+                incoming_[i].seq_no = 0;
             }
-
-            // initialize the connections array
-            for (int i = 0; i < MAX_CONNECTIONS_; i++) {
-                open_connections[i].conn_id = -1; // -1 means connection unused
-                open_connections[i].sequence_numbers_ = 1; // sequence numbers start from 1 ( 0 means unused see above)
+            for (int i = 0; i < VOLUME_BUFFERS; i++) {
+                buffer_used_[i] = false;
             }
+            transfer_index_.clear();
+            open_connections_.clear();
 
-            // ??? only for broadcast messages ???
+            // sequence numbers start from 1 ( 0 means unused see above)
             seq_numbers_ = 1;
-
-
-
-
+            age_ = 0;
+            timer_ids_ = 0;
         }
         ;
 
         // --------------------------------------------------------------------
 
         
-        // Send a message the application has requested
-
-        void send( node_id_t id, uint16_t len, block_data_t *data) {
-
-            block_data_t local_data[len];
-
-            
-
-            // check for an open connection to the destination
-            int connection = check_connection(id);
-            // get the next available sequence number 
-            uint16_t seq_no = open_connections[connection].sequence_numbers_++;
-            // if the next sequence number is 0 then set it as 1
-            if (open_connections[connection].sequence_numbers_ == 0) open_connections[connection].sequence_numbers_++;
+        /*
+         * Send a message the application has requested
+         *
+         * Messages that fit into one radio message are sent as they are.
+         * Larger ones are kept in a pooled buffer until the receiver
+         * acknowledged all fragments. If no buffer or transfer is free,
+         * ERR_BUSY is returned and nothing is sent. Broadcasts cannot be
+         * acknowledged, their fragments are sent once. Unicasts larger
+         * than VOLUME_BUFFER_SIZE need send_stream() (ERR_NOMEM).
+         */
+        int send( node_id_t id, size_t len, block_data_t *data) {
 
 #ifdef DEBUG_VOLUMERADIO
-            debug().debug( "VolumeRadio::send [node %d |to %d |len %d |seq_no %d ", radio().id(), id, len, seq_no);
+            debug().debug( "VolumeRadio::send [node %d |to %d |len %d ]\n", radio().id(), id, len);
 #endif
 
-            // create a new volume message
-            VolumeMessage_t m = VolumeMessage_t();
-            // initialize the message
+            if (len <= FRAGMENT_SIZE) {
+                VolumeMessage_t m;
+                m.set_msg_id(VolumeMessage_t::SINGLE_MESSAGE);
+                m.set_seq_number(next_seq(id));
+                m.set_fragment_id(0);
+                m.set_fragments(1);
+                m.set_payload(len, data);
+                radio().send(id, m.buffer_size(), (uint8_t * ) &m);
+                return SUCCESS;
+            }
+            if (len > MAX_MESSAGE_LENGTH) {
+                return ERR_NOMEM;
+            }
 
-            if (len>VolumeMessage_t::FRAGMENT_SIZE){
-                m.set_msg_id(VolumeMessage_t::VOLUME_MESSAGE);
+            if (id == BROADCAST_ADDRESS) {
+                // nobody acks, send every fragment once
+                uint16_t seq_no = next_seq(id);
+                for (uint8_t i = 0; i < fragments(len); i++) {
+                    send_fragment(id, seq_no, len, i, data + i * FRAGMENT_SIZE, false);
+                }
+                return SUCCESS;
             }
-            else{
-                m.set_msg_id(VolumeMessage_t::SINGLE_MESSAGE);
+            if (len > VOLUME_BUFFER_SIZE) {
+                return ERR_NOMEM;
             }
 
-            m.set_seq_number(seq_no);
-            
-            uint8_t fragments = len/VolumeMessage_t::FRAGMENT_SIZE + 1;
-#ifdef DEBUG_VOLUMERADIO
-            debug().debug( "split_count= %d ]\n", fragments);
-#endif
-            m.set_fragments(fragments);
-            // Send all fragments of the message
-            uint8_t i;
-            for (i = 0 ; i < (fragments-1); i++) {
-                // create a temp buffer for the message
-                m.set_fragment_id(i);
-                m.set_payload(FRAGMENT_SIZE,local_data+(i*FRAGMENT_SIZE));
-
-                // send the fragment
-                radio().send(id, m.buffer_size(), (uint8_t * ) &m);
-#ifdef DEBUG_VOLUMERADIO
-                debug().debug( "VolumeRadio::send [%d |dest= %d |seq_no %d |fr_no %d |tot_fr %d |size= %d |...]\n",
-                    m.msg_id(),
-                    id,
-                    m.seq_number(),
-                    m.fragment_id(),
-                    m.fragments(),
-                    m.buffer_size()
+            uint8_t buffer = alloc_buffer();
+            if (buffer == NO_BUFFER || !has_free_outgoing()) {
+                free_buffer(buffer);
+                return ERR_BUSY;
+            }
+            outgoing_transfer_t *t = new_outgoing(id, next_seq(id), len);
+            memcpy(buffers_[buffer], data, len);
+            t->buffer = buffer;
+            send_burst(*t);
+            return SUCCESS;
+        }
 
-                        );
-#endif
-                                                      
+        // --------------------------------------------------------------------
+
+        /*
+         * Send a message without buffering it: the fragments are read from
+         * the application with the given method, whenever they are sent or
+         * resent, until the receiver acknowledged them all. Returns
+         * ERR_BUSY if all VOLUME_MAX_TRANSFERS transfers are in use.
+         */
+        template<class T, void (T::*TMethod)(size_t, size_t, block_data_t*)>
+        int send_stream( node_id_t id, size_t len, T *obj_pnt) {
+            if (len > MAX_MESSAGE_LENGTH || id == BROADCAST_ADDRESS) {
+                return ERR_NOMEM;
             }
-            m.set_fragment_id(i);
-            m.set_payload(len%FRAGMENT_SIZE,data+(i*FRAGMENT_SIZE));
-            radio().send(id, (size_t)m.buffer_size(), (uint8_t * ) &m);
-#ifdef DEBUG_VOLUMERADIO
-                debug().debug( "VolumeRadio::send [%d |dest= %d |seq_no %d |fr_no %d |tot_fr %d |size= %d |...]\n",
-                    m.msg_id(),
-                    id,
-                    m.seq_number(),
-                    m.fragment_id(),
-                    m.fragments(),
-                    m.buffer_size()
+            if (!has_free_outgoing()) {
+                return ERR_BUSY;
+            }
+            outgoing_transfer_t *t = new_outgoing(id, next_seq(id), len);
+            t->source = fragment_source_delegate_t::template from_method<T, TMethod>(obj_pnt);
+            send_burst(*t);
+            return SUCCESS;
+        }
 
-                        );
-#endif
+        // --------------------------------------------------------------------
 
-           
-            
+        /*
+         * Register for every fragment as it arrives. Transfers too large
+         * for a pooled buffer are only passed this way.
+         */
+        template<class T, void (T::*TMethod)(node_id_t, uint16_t, size_t, size_t, block_data_t*, bool)>
+        int reg_fragment_callback( T *obj_pnt ) {
+            fragment_callback_ = fragment_delegate_t::template from_method<T, TMethod>(obj_pnt);
+            return SUCCESS;
         }
-        ;
 
+        // --------------------------------------------------------------------
 
+        int unreg_fragment_callback() {
+            fragment_callback_ = fragment_delegate_t();
+            return SUCCESS;
+        }
+
+        // --------------------------------------------------------------------
+
+        /*
+         * Register for the transfers given up after VOLUME_MAX_RETRIES
+         * retransmissions without the receiver acknowledging all fragments.
+         */
+        template<class T, void (T::*TMethod)(node_id_t, uint16_t, size_t, block_data_t*)>
+        int reg_drop_callback( T *obj_pnt ) {
+            drop_callback_ = drop_delegate_t::template from_method<T, TMethod>(obj_pnt);
+            return SUCCESS;
+        }
+
+        // --------------------------------------------------------------------
+
+        int unreg_drop_callback() {
+            drop_callback_ = drop_delegate_t();
+            return SUCCESS;
+        }
 
         // --------------------------------------------------------------------
 
@@ -258,219 +358,423 @@ namespace wiselib {
          * Callback from the Radio module
          *
          * when a new message is received check its type:
-         * - Ack_Message : mark as received all containing sequence numbers
-         * - Broadcast message : send to the application
-         * - ReliableMessage : send ack , and forward message to the application
+         * - VolumeMessage : add the fragment to its transfer, ack if asked to
+         * - SingleMessage : send to the application
+         * - VolumeAck : resend the fragments missing
          *
          *
          */
         void receive(node_id_t from, size_t len, block_data_t* data_t) {
             // do not receive own messages
             if (radio().id() == from) {
-                debug().debug( "message heard\n");
                 return;
             }
-            VolumeMessage_t mrecv;
-            memcpy(&mrecv,data_t,len);
-            
-            if (mrecv.msg_id() == VolumeMessage_t::VOLUME_MESSAGE) {
+            if (len < VolumeMessage_t::PAYLOAD_POS + 1) {
+                return;
+            }
+            VolumeMessage_t *mrecv = (VolumeMessage_t *) data_t;
+
+            if (mrecv->msg_id() == VolumeMessage_t::VOLUME_MESSAGE
+                    || mrecv->msg_id() == VolumeMessage_t::VOLUME_MESSAGE_END) {
 
 #ifdef DEBUG_VOLUMERADIO
                 debug().debug( "VolumeRadio::receive [%d |from %d |seq_no %d |fr_no %d |tot_fr %d |size %d |...]\n",
-                        mrecv.msg_id(),
+                        mrecv->msg_id(),
                         from,
-                        mrecv.seq_number(),
-                        mrecv.fragment_id(),
-                        mrecv.fragments(),
+                        mrecv->seq_number(),
+                        mrecv->fragment_id(),
+                        mrecv->fragments(),
                         len);
 #endif
+                handle_fragment(mrecv, from);
 
-                // get all the information from the header
-                node_id_t source = from;
-                uint16_t seq_no = mrecv.seq_number();
-                uint8_t fragment_num = mrecv.fragment_id();
-                uint8_t total_frags = mrecv.fragments();
+            } else if (mrecv->msg_id() == VolumeMessage_t::SINGLE_MESSAGE) {
+                
+#ifdef DEBUG_VOLUMERADIO
+                debug().debug( "VolumeRadio::receive [%d |from %d |seq_no %d |...]\n",
+                        mrecv->msg_id(),
+                        from,
+                        mrecv->seq_number()
+                        );
+#endif
+                // forward message to the application
+                this->notify_receivers(from, mrecv->payload_size(), mrecv->payload());
 
+            } else if (mrecv->msg_id() == VolumeMessage_t::VOLUME_ACK) {
+                handle_ack(mrecv, from);
+            }
+        }
+        ;
 
-                // local buffer for payload fragment
-                uint8_t t_buff[mrecv.payload_size()];
+        // --------------------------------------------------------------------
 
-                memcpy(t_buff,mrecv.payload(),mrecv.payload_size());
-                //t_buff = VolumeMessage_t::strip_message(data);
 
-                // find the buffer dedicated to this message
-                int fd = flow_id(seq_no, source, total_frags);
+        // returns the node's id
 
-                if (fd != -1) {
-#ifdef DEBUG_VOLUMERADIO
-                    debug().debug( "VolumeRadio::receive pending_message %d frag_no %d\n", fd, fragment_num);
-#endif
+        node_id_t id() {
+            return radio().id();
+        }
+        // --------------------------------------------------------------------
 
-                    // add fragment to the buffer. if finished set the flag
-                    bool finished = add_fragment_to_message(fd, fragment_num, t_buff);
 
-                    // if finished forward to the application
-                    if (finished) {
-#ifdef DEBUG_VOLUMERADIO
-                        debug().debug( "VolumeRadio::receive pending_message %d completed %d \n", fd , );
-#endif
-                        notify_receivers(from, (FRAGMENT_SIZE) * total_frags, pending_messages_[fd].second);
-                    }
+        /*
+         initialize the module
+         */
+        void init(Radio& radio, Timer& timer, Debug& debug) {
+            radio_ = &radio;
+            timer_ = &timer;
+            debug_ = &debug;
+        };
 
 
-                } else {
+    private:
+
+        // --------------------------------------------------------------------
+        // sending
+
+        uint16_t next_seq(node_id_t destination) {
+            uint16_t seq_no;
+            if (open_connections_.contains(destination)) {
+                seq_no = open_connections_[destination]++;
+            } else if (open_connections_.size() < open_connections_.max_size()) {
+                seq_no = 1;
+                open_connections_[destination] = 2;
 #ifdef DEBUG_VOLUMERADIO
-                    debug().debug( "VolumeRadio::receive vector is full\n");
+                debug().debug( "VolumeRadio::connection Opened Connection %d to node %d\n", radio().id(), destination);
 #endif
+            } else {
+                // out of connections, share a counter
+                seq_no = seq_numbers_++;
+            }
+            // 0 means unused
+            if (seq_no == 0) {
+                return next_seq(destination);
+            }
+            return seq_no;
+        }
+
+        uint8_t fragments(size_t len) {
+            return (len + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE;
+        }
+
+        bool has_free_outgoing() {
+            for (int i = 0; i < VOLUME_MAX_TRANSFERS; i++) {
+                if (outgoing_[i].seq_no == 0) {
+                    return true;
                 }
+            }
+            return false;
+        }
 
+        outgoing_transfer_t* new_outgoing(node_id_t destination, uint16_t seq_no, size_t len) {
+            for (int i = 0; i < VOLUME_MAX_TRANSFERS; i++) {
+                if (outgoing_[i].seq_no == 0) {
+                    outgoing_transfer_t &t = outgoing_[i];
+                    t.seq_no = seq_no;
+                    t.destination = destination;
+                    t.length = len;
+                    t.total_fragments = fragments(len);
+                    t.retries = 0;
+                    t.buffer = NO_BUFFER;
+                    t.source = fragment_source_delegate_t();
+                    memset(t.acked, 0, BITMAP_SIZE);
+                    return &t;
+                }
+            }
+            return NULL;
+        }
 
-            } else if (mrecv.msg_id() == VolumeMessage_t::SINGLE_MESSAGE) {
-                
+        void release_outgoing(outgoing_transfer_t &t) {
+            free_buffer(t.buffer);
+            t.buffer = NO_BUFFER;
+            t.seq_no = 0;
+        }
+
+        void send_fragment(node_id_t destination, uint16_t seq_no, size_t len,
+                uint8_t fragment, block_data_t *data, bool end) {
+            VolumeMessage_t m;
+            m.set_msg_id(end ? VolumeMessage_t::VOLUME_MESSAGE_END : VolumeMessage_t::VOLUME_MESSAGE);
+            m.set_seq_number(seq_no);
+            m.set_fragment_id(fragment);
+            m.set_fragments(fragments(len));
+            m.set_payload(fragment_length(len, fragment), data);
+            radio().send(destination, m.buffer_size(), (uint8_t * ) &m);
 #ifdef DEBUG_VOLUMERADIO
-                debug().debug( "VolumeRadio::receive [%d |from %d |seq_no %d |fr_no %d |tot_fr %d |...]\n",
-                        mrecv.msg_id(),
-                        from,
-                        mrecv.seq_number(),
-                        mrecv.fragment_id(),
-                        mrecv.fragments()
-                        );
+            debug().debug( "VolumeRadio::send [%d |dest= %d |seq_no %d |fr_no %d |tot_fr %d |size= %d |...]\n",
+                    m.msg_id(),
+                    destination,
+                    m.seq_number(),
+                    m.fragment_id(),
+                    m.fragments(),
+                    m.buffer_size());
 #endif
-                // get the payload from the buffer
-                uint8_t t_buff[mrecv.payload_size()];
+        }
 
-                memcpy(t_buff,mrecv.payload(),mrecv.payload_size());
-                //uint8_t * t_buff = new uint8_t[len - VolumeMessage_t::header_size()];
-                //t_buff = VolumeMessage_t::strip_message(data);
-                // forward message to the application
-                
+        size_t fragment_length(size_t len, uint8_t fragment) {
+            size_t offset = fragment * FRAGMENT_SIZE;
+            return (len - offset < FRAGMENT_SIZE) ? len - offset : (size_t) FRAGMENT_SIZE;
+        }
+
+        /*
+         * sends all fragments not acked yet back-to-back, the last one
+         * asks for an ack
+         */
+        void send_burst(outgoing_transfer_t &t) {
+            uint8_t last = t.total_fragments;
+            for (uint8_t i = 0; i < t.total_fragments; i++) {
+                if (!bit(t.acked, i)) {
+                    last = i;
+                }
+            }
+            for (uint8_t i = 0; i <= last && last != t.total_fragments; i++) {
+                if (bit(t.acked, i)) {
+                    continue;
+                }
+                size_t offset = i * FRAGMENT_SIZE;
+                if (t.buffer != NO_BUFFER) {
+                    send_fragment(t.destination, t.seq_no, t.length, i, buffers_[t.buffer] + offset, i == last);
+                } else {
+                    block_data_t fragment[FRAGMENT_SIZE];
+                    t.source(offset, fragment_length(t.length, i), fragment);
+                    send_fragment(t.destination, t.seq_no, t.length, i, fragment, i == last);
+                }
+            }
+            t.timer_id = ++timer_ids_;
+            timer().template set_timer<self_t, &self_t::retransmit_timeout > (
+                    VOLUME_RETRANSMIT_TIMEOUT, this, (void*) (unsigned long) t.timer_id);
+        }
+
+        /*
+         * no ack for the last burst, resend what's missing or give up
+         * stale timers find no transfer
+         */
+        void retransmit_timeout(void *timer_id) {
+            for (int i = 0; i < VOLUME_MAX_TRANSFERS; i++) {
+                outgoing_transfer_t &t = outgoing_[i];
+                if (t.seq_no == 0 || t.timer_id != (uint16_t) (unsigned long) timer_id) {
+                    continue;
+                }
+                if (t.retries++ < VOLUME_MAX_RETRIES) {
+                    send_burst(t);
+                } else {
 #ifdef DEBUG_VOLUMERADIO
-                debug().debug( "VolumeRadio::message_received_callback\n");
+                    debug().debug( "VolumeRadio::abort [dest= %d |seq_no %d ]\n", t.destination, t.seq_no);
 #endif
-                notify_receivers(from, mrecv.payload_size() , t_buff);
-                
+                    if (drop_callback_ != drop_delegate_t()) {
+                        drop_callback_(t.destination, t.seq_no, t.length,
+                                t.buffer != NO_BUFFER ? buffers_[t.buffer] : NULL);
+                    }
+                    release_outgoing(t);
+                }
+                return;
+            }
+        }
 
+        void handle_ack(VolumeMessage_t *ack, node_id_t from) {
+            for (int i = 0; i < VOLUME_MAX_TRANSFERS; i++) {
+                outgoing_transfer_t &t = outgoing_[i];
+                if (t.seq_no != ack->seq_number() || t.destination != from) {
+                    continue;
+                }
+                size_t bytes = (t.total_fragments + 7) / 8;
+                if (ack->payload_size() < bytes) {
+                    return;
+                }
+                bool all = true;
+                for (size_t b = 0; b < bytes; b++) {
+                    t.acked[b] |= ack->payload()[b];
+                }
+                for (uint8_t f = 0; f < t.total_fragments; f++) {
+                    all = all && bit(t.acked, f);
+                }
+                if (all) {
+                    release_outgoing(t);
+                } else {
+                    // selective repeat of the fragments lost
+                    send_burst(t);
+                }
+                return;
             }
-             
         }
-        ;
 
-        // checks the vector of messages to see if the first fragment.
-        // if not returns the id of the vector position
-        // if yes allocates an available buffer and initializes data
-        // if yes && buffers full returns -1
+        // --------------------------------------------------------------------
+        // receiving
 
-        int flow_id(uint16_t seq_no, node_id_t source, uint8_t total_frags) {
-            int fd = -1;
+        /*
+         * finds the transfer a fragment belongs to, starts a new one if
+         * there is none. If all are in use the one heard of least recently
+         * is given up. If the buffer pool is empty, the incomplete transfer
+         * heard of least recently loses its buffer: its sender may have
+         * given up long ago and nothing else would ever free it.
+         */
+        incoming_transfer_t* find_incoming(node_id_t source, uint16_t seq_no, uint8_t total_frags) {
+            transfer_key_t key(source, seq_no);
+            typename transfer_index_t::iterator it = transfer_index_.find(key);
+            if (it != transfer_index_.end()) {
+                return &incoming_[it->second];
+            }
 
-            // search vector for message and a free slot
-            for (int i = 0; i < MAX_PENDING; i++) {
-                if ((seq_no == pending_messages_[i].first.seq_no) && (source == pending_messages_[i].first.source))
-                    return i;
-                if ((pending_messages_[i].first.seq_no == 0) && (fd == -1))
-                    fd = i;
+            int slot = -1;
+            for (int i = 0; i < VOLUME_MAX_TRANSFERS; i++) {
+                if (incoming_[i].seq_no == 0) {
+                    slot = i;
+                    break;
+                }
+                // prefer completed transfers, those are only kept to re-ack
+                if (slot == -1 || (incoming_[i].complete && !incoming_[slot].complete)
+                        || (incoming_[i].complete == incoming_[slot].complete
+                        && (uint16_t) (age_ - incoming_[i].age) > (uint16_t) (age_ - incoming_[slot].age))) {
+                    slot = i;
+                }
             }
-            if (fd != -1) {
-                // if does not exist but we have an empty buffer allocate it
-                pending_messages_[fd].first.seq_no = seq_no;
-                pending_messages_[fd].first.source = source;
-                pending_messages_[fd].first.fragments_received = 0;
-                pending_messages_[fd].first.total_fragments = total_frags;
+            incoming_transfer_t &t = incoming_[slot];
+            if (t.seq_no != 0) {
+                transfer_index_.erase(transfer_key_t(t.source, t.seq_no));
+                free_buffer(t.buffer);
             }
-            // if not return -1
-            return fd;
 
-        };
+            t.buffer = NO_BUFFER;
+            if (total_frags * FRAGMENT_SIZE <= VOLUME_BUFFER_SIZE) {
+                t.buffer = alloc_buffer();
+                if (t.buffer == NO_BUFFER && evict_incoming(slot)) {
+                    t.buffer = alloc_buffer();
+                }
+            }
+            if (t.buffer == NO_BUFFER && fragment_callback_ == fragment_delegate_t()) {
+                // nowhere to put it, don't ack so the sender tries again
+#ifdef DEBUG_VOLUMERADIO
+                debug().debug( "VolumeRadio::receive no buffer\n");
+#endif
+                t.seq_no = 0;
+                return NULL;
+            }
+            t.seq_no = seq_no;
+            t.source = source;
+            t.total_fragments = total_frags;
+            t.fragments_received = 0;
+            t.length = 0;
+            t.complete = false;
+            memset(t.received, 0, BITMAP_SIZE);
+            transfer_index_[key] = slot;
+            return &t;
+        }
 
-        // add a fragment to the payload buffer and returns if finished
-
-        bool add_fragment_to_message(int fd, uint8_t fragment_num, uint8_t * data) {
-            // copy data to local memory
-            memcpy(pending_messages_[fd].second + FRAGMENT_SIZE*fragment_num, data, FRAGMENT_SIZE);
-            // inrease fragments received
-            pending_messages_[fd].first.fragments_received++;
-            // if the last fragment clear the buffer
-            if (pending_messages_[fd].first.fragments_received ==
-                    pending_messages_[fd].first.total_fragments) {
-                pending_messages_[fd].first.seq_no = 0;
-                // return message is complete
-                return true;
-            } else {
-                // return message is incomplete
+        /*
+         * gives up the incomplete incoming transfer holding a buffer that
+         * was heard of least recently, except the given slot
+         */
+        bool evict_incoming(int except) {
+            int victim = -1;
+            for (int i = 0; i < VOLUME_MAX_TRANSFERS; i++) {
+                if (i == except || incoming_[i].seq_no == 0 || incoming_[i].buffer == NO_BUFFER) {
+                    continue;
+                }
+                if (victim == -1 || (uint16_t) (age_ - incoming_[i].age) > (uint16_t) (age_ - incoming_[victim].age)) {
+                    victim = i;
+                }
+            }
+            if (victim == -1) {
                 return false;
             }
+#ifdef DEBUG_VOLUMERADIO
+            debug().debug( "VolumeRadio::receive evict [from %d |seq_no %d ]\n", incoming_[victim].source, incoming_[victim].seq_no);
+#endif
+            transfer_index_.erase(transfer_key_t(incoming_[victim].source, incoming_[victim].seq_no));
+            free_buffer(incoming_[victim].buffer);
+            incoming_[victim].buffer = NO_BUFFER;
+            incoming_[victim].seq_no = 0;
+            return true;
+        }
 
-        };
-        // --------------------------------------------------------------------
+        void handle_fragment(VolumeMessage_t *mrecv, node_id_t from) {
+            uint8_t fragment_num = mrecv->fragment_id();
+            uint8_t total_frags = mrecv->fragments();
+            if (fragment_num >= total_frags) {
+                return;
+            }
 
-        // Check if a connection with the sender was established before
+            incoming_transfer_t *t = find_incoming(from, mrecv->seq_number(), total_frags);
+            if (t == NULL || t->total_fragments != total_frags) {
+                return;
+            }
+            t->age = ++age_;
+
+            if (!bit(t->received, fragment_num)) {
+                t->received[fragment_num / 8] |= 1 << (fragment_num % 8);
+                t->fragments_received++;
+                size_t offset = fragment_num * FRAGMENT_SIZE;
+                if (fragment_num == total_frags - 1) {
+                    t->length = offset + mrecv->payload_size();
+                }
+                if (t->buffer != NO_BUFFER) {
+                    memcpy(buffers_[t->buffer] + offset, mrecv->payload(), mrecv->payload_size());
+                }
+                t->complete = (t->fragments_received == total_frags);
 
-        int check_connection(node_id_t node) {
-            int avail = -1;
-            for (int i = 0; i < MAX_CONNECTIONS_; i++) {
-                if (open_connections[i].conn_id == node) {
-                    return i;
-                } else if (open_connections[i].conn_id == -1) {
-                    if (avail == -1) {
-                        avail = i;
-                    }
+                if (fragment_callback_ != fragment_delegate_t()) {
+                    fragment_callback_(from, t->seq_no, offset, mrecv->payload_size(), mrecv->payload(), t->complete);
                 }
-            }
-            // if the first connection get a new entry from the table
-            if (avail != -1) {
+                if (t->complete && t->buffer != NO_BUFFER) {
 #ifdef DEBUG_VOLUMERADIO
-                debug().debug( "VolumeRadio::connection Opened Connection %d to node %d\n", radio().id(), node);
+                    debug().debug( "VolumeRadio::receive transfer %d completed\n", t->seq_no);
 #endif
-                open_connections[avail].conn_id = node;
-                open_connections[avail].sequence_numbers_ = 1;
+                    this->notify_receivers(from, t->length, buffers_[t->buffer]);
+                    free_buffer(t->buffer);
+                    t->buffer = NO_BUFFER;
+                }
+            }
 
-            } else {
-#ifdef DEBUG_VOLUMERADIO
-                debug().debug( "VolumeRadio::connection Out of connections node= %d\n", radio().id());
-#endif
+            if (mrecv->msg_id() == VolumeMessage_t::VOLUME_MESSAGE_END) {
+                VolumeMessage_t ack;
+                ack.set_msg_id(VolumeMessage_t::VOLUME_ACK);
+                ack.set_seq_number(t->seq_no);
+                ack.set_fragment_id(0);
+                ack.set_fragments(total_frags);
+                ack.set_payload((total_frags + 7) / 8, t->received);
+                radio().send(from, ack.buffer_size(), (uint8_t * ) &ack);
             }
-            // return the connection id
-            return avail;
-        };
+        }
 
         // --------------------------------------------------------------------
+        // buffer pool
 
-
-        // returns the node's id
-
-        node_id_t id() {
-            return radio().id();
+        uint8_t alloc_buffer() {
+            for (uint8_t i = 0; i < VOLUME_BUFFERS; i++) {
+                if (!buffer_used_[i]) {
+                    buffer_used_[i] = true;
+                    return i;
+                }
+            }
+            return NO_BUFFER;
         }
-        // --------------------------------------------------------------------
 
+        void free_buffer(uint8_t buffer) {
+            if (buffer != NO_BUFFER) {
+                buffer_used_[buffer] = false;
+            }
+        }
 
-        /*
-         initialize the module
-         */
-        void init(Radio& radio, Timer& timer, Debug& debug) {
-            radio_ = &radio;
-            timer_ = &timer;
-            debug_ = &debug;
-        };
+        bool bit(const uint8_t *bitmap, uint8_t i) {
+            return bitmap[i / 8] & (1 << (i % 8));
+        }
 
+        // --------------------------------------------------------------------
 
-    private:
         int recv_callback_id_; // callback for receive function
-        radio_delegate_t message_received_callback_; // callback for application's receive function
-
-
-        vector_t pending_messages_; // contains the buffers for the pending messages
-
-        static const int MAX_CONNECTIONS_ = 40; // maximum available connections
-        uint16_t seq_numbers_; // sequence number for messages
-
-        struct connections {
-            node_id_t conn_id;
-            uint16_t sequence_numbers_;
-        } open_connections[MAX_CONNECTIONS_];
+        fragment_delegate_t fragment_callback_; // callback for fragments as they arrive
+        drop_delegate_t drop_callback_; // callback for transfers given up
 
+        outgoing_transfer_t outgoing_[VOLUME_MAX_TRANSFERS];
+        incoming_transfer_t incoming_[VOLUME_MAX_TRANSFERS];
+        transfer_index_t transfer_index_;
 
+        block_data_t buffers_[VOLUME_BUFFERS][VOLUME_BUFFER_SIZE];
+        bool buffer_used_[VOLUME_BUFFERS];
 
+        uint16_t seq_numbers_; // sequence number for messages to nodes without a connection entry
+        uint16_t age_;
+        uint16_t timer_ids_;
+        connections_t open_connections_;
 
         Radio * radio_;
         Timer * timer_;
@@ -495,4 +799,3 @@ namespace wiselib {
 
 
 #endif	/* _VOLUMERADIO_H */
-
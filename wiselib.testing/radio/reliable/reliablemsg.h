@@ -52,7 +52,8 @@ namespace wiselib {
         enum data_positions {
             MSG_ID_POS = 0, // message id position inside the message [uint8]
             SEQ_NUM_POS = 1, // seq_number position inside the message [1]+[2] [uint16]
-            PAYLOAD_POS = 3, // start of message payload
+            WINDOW_POS = 3, // distance to the oldest message the sender still tries to deliver [uint8]
+            PAYLOAD_POS = 4, // start of message payload
         };
 
         enum Restrictions {
@@ -65,6 +66,7 @@ namespace wiselib {
         ReliableMsg() {
             set_msg_id(BROADCAST_MESSAGE);
             set_seq_number(0);
+            set_window_offset(0);
             set_payload_size(0);
         };
 
@@ -94,6 +96,19 @@ namespace wiselib {
             write<OsModel, block_data_t, uint16_t > (buffer + SEQ_NUM_POS, seq_number);
         }
         // --------------------------------------------------------------------
+        // get the distance between seq_number and the oldest message the
+        // sender has not given up on yet
+
+        inline uint8_t window_offset() {
+            return read<OsModel, block_data_t, uint8_t > (buffer + WINDOW_POS);
+        }
+        // --------------------------------------------------------------------
+        // set the window offset
+
+        inline void set_window_offset(uint8_t offset) {
+            write<OsModel, block_data_t, uint8_t > (buffer + WINDOW_POS, offset);
+        }
+        // --------------------------------------------------------------------
 
         inline uint8_t payload_size() {
             return read<OsModel, block_data_t, uint8_t > (buffer + PAYLOAD_POS);
@@ -28,7 +28,7 @@
 #define	_RELIABLERADIO_H
 
 #include "util/pstl/vector_static.h"
-#include "util/pstl/map_static_vector.h"
+#include "util/pstl/map_static_hash.h"
 #include "util/pstl/pair.h"
 #include "util/delegates/delegate.hpp"
 #include "util/base_classes/radio_base.h"
@@ -46,7 +46,11 @@
 
 #define MAX_PENDING 10	// Maximum number of pending for delivery messages
 #define MAX_CONNECTIONS 20
-#define MAX_RECV 15
+#define MAX_RECV 32	// Width of the receive window, bounds the sequence numbers in flight per connection (at most 32)
+#define MAX_WINDOW 8	// Maximum number of unacknowledged messages per connection
+#define MIN_RTO 100	// Bounds of the retransmission timeout [ms]
+#define MAX_RTO 8000
+#define INITIAL_RTO 1000
 
 namespace wiselib {
 
@@ -57,6 +61,24 @@ namespace wiselib {
      * ReliableRadio is used as a layer between normal radio
      * and application to make sure that messages will be
      * delivered besides any errors that may occur.
+     *
+     * Every connection is a selective-repeat sliding window:
+     * up to MAX_WINDOW messages may be unacknowledged at a time.
+     * The receiver acknowledges cumulatively (all sequence numbers
+     * below the one in the ack) plus a bitmap of the following
+     * MAX_RECV sequence numbers it received out of order, so only
+     * the messages actually lost are resent. Each message is
+     * retransmitted from its own timer, the timeout is estimated
+     * per connection from the round trip times (SRTT/RTTVAR as in
+     * RFC 6298) and doubled with each retry.
+     *
+     * A new message is only sent while its sequence number is less
+     * than MAX_RECV ahead of the oldest unacknowledged one, so all
+     * messages in flight fit into the receive window. Every message
+     * carries the offset to that oldest one; the receiver only skips
+     * messages below it, i.e. the ones the sender gave up on (and
+     * reported as MSG_DROPPED). A message is thus never acknowledged
+     * without having been delivered.
      * */
     template<typename OsModel_P,
     typename Radio_P,
@@ -85,8 +107,9 @@ namespace wiselib {
         struct pending_messages_entry {
             uint16_t seq_no;
             node_id_t destination;
-            int timestamp;
+            uint32_t timestamp; // time of the last transmission [ms]
             int retries;
+            uint16_t timer_id; // identifies the retransmission timer currently armed
             event_notifier_delegate_t event_notifier_callback;
             ReliableMessage_t msg;
         }; // stores information about the status of a sent message
@@ -111,6 +134,11 @@ typedef self_t* self_pointer_t;
             MSG_ACK_RCVD = 2
         };
 
+        enum ErrorCodes {
+            SUCCESS = OsModel::SUCCESS,
+            ERR_BUSY = OsModel::ERR_BUSY
+        };
+
         enum SpecialNodeIds {
             BROADCAST_ADDRESS = Radio::BROADCAST_ADDRESS, //< All nodes in communication rnage
             NULL_NODE_ID = Radio::NULL_NODE_ID //< Unknown/No node id
@@ -135,6 +163,9 @@ typedef self_t* self_pointer_t;
         // --------------------------------------------------------------------
 
         ReliableRadio():
+        current_time_(0),
+        clock_running_(false),
+        timer_ids_(0),
         max_retries_(5){
         }
         // --------------------------------------------------------------------
@@ -154,14 +185,8 @@ typedef self_t* self_pointer_t;
 
             radio().template reg_recv_callback<self_t, &self_t::receive > (this);
            
-            // timestamps start from 0
+            // timestamps start from 0, the clock only runs while messages are pending
             current_time_ = 0;
-            // set timer to change time
-            timer().template set_timer<self_t, &self_t::time_passes > (
-                    time_slice_, this, (void*) 0);
-            // set timer to wake up realiable_deamon ( checks for undelivered messages and resends them )
-            timer().template set_timer<self_t, &self_t::reliable_daemon > (
-                    sleep_time_, this, (void*) 0);
         }
 
         // --------------------------------------------------------------------
@@ -182,7 +207,8 @@ typedef self_t* self_pointer_t;
          * @param data
          * pointer to the message payload
          * @return
-         * message sent status
+         * SUCCESS if queued for delivery (or broadcast), ERR_BUSY if the
+         * window to id is full (try again after an ack)
          */
         int send(node_id_t id, size_t len, block_data_t *data) {
             
@@ -200,7 +226,7 @@ typedef self_t* self_pointer_t;
 
                 // send a broadcast message
                 radio().send(id, m.buffer_size(), (uint8_t *) & m);
-                return -1;
+                return SUCCESS;
             }/*
              * ADD message to Vector
              * CREATE a special message containing the original
@@ -209,41 +235,43 @@ typedef self_t* self_pointer_t;
              * */
             else {
 
-                if (pending_messages_.size() != pending_messages_.max_size()) {
+                if (pending_messages_.size() != pending_messages_.max_size()
+                        && window_open(id)) {
 
                     seqNo_t next_seq_no = next_seq(id);
 
+#ifdef DEBUG_RELIABLERADIO
                     debug().debug("RR;next_seq_no=%d", next_seq_no);
+#endif
 
-                    if (next_seq_no != 0) {
-                        pending_messages_entry_t newmessage;
+                    pending_messages_entry_t newmessage;
 
-                        newmessage.seq_no = next_seq_no;
-                        newmessage.destination = id;
-                        newmessage.timestamp = current_time_;
-                        newmessage.retries = 0;
-                        // Store the message and set its headers
-                        newmessage.msg.set_msg_id(ReliableMessage_t::RELIABLE_MESSAGE);
-                        newmessage.msg.set_seq_number(next_seq_no);
-                        newmessage.msg.set_payload(len, data);
+                    newmessage.seq_no = next_seq_no;
+                    newmessage.destination = id;
+                    newmessage.timestamp = current_time_;
+                    newmessage.retries = 0;
+                    // Store the message and set its headers
+                    newmessage.msg.set_msg_id(ReliableMessage_t::RELIABLE_MESSAGE);
+                    newmessage.msg.set_seq_number(next_seq_no);
+                    newmessage.msg.set_payload(len, data);
 
-                        pending_messages_.push_back(newmessage);
-                        debug().debug("RR;added pending message");
+                    pending_messages_.push_back(newmessage);
 
 
 #ifdef DEBUG_RELIABLERADIO
-                        debug().debug("RR;send;type=%d;dest=%x;seq_no=%d;size=%d;", ReliableMessage_t::RELIABLE_MESSAGE, id, newmessage.msg.seq_number(), newmessage.msg.buffer_size());
+                    debug().debug("RR;send;type=%d;dest=%x;seq_no=%d;size=%d;", ReliableMessage_t::RELIABLE_MESSAGE, id, newmessage.msg.seq_number(), newmessage.msg.buffer_size());
 #endif
-                        radio().send(id, newmessage.msg.buffer_size(), (uint8_t *) & newmessage.msg);
-                    }
+                    transmit(pending_messages_.back());
+                    arm_retransmit_timer(pending_messages_.back());
                 } else {
 #ifdef DEBUG_RELIABLERADIO
-                    debug().debug("RR;error;vector_full");
+                    debug().debug("RR;error;window_full");
 #endif
+                    return ERR_BUSY;
                 }// Get message from the Vector and send it through normal radio
 
             }
-            return 1;
+            return SUCCESS;
         }
 
 
@@ -283,13 +311,16 @@ typedef self_t* self_pointer_t;
     protected:
 
         /**
-         * increase the time counter
+         * increase the time counter, stops once no messages are pending
          * @param
          * not used
          */
         void time_passes(void *) {
-            current_time_++;
-            //Debug::debug(os(),"Time is now %d\n",current_time_);
+            current_time_ += time_slice_;
+            if (pending_messages_.empty()) {
+                clock_running_ = false;
+                return;
+            }
             timer().template set_timer<self_t, &self_t::time_passes > (
                     time_slice_, this, (void*) 0);
         }
@@ -297,83 +328,41 @@ typedef self_t* self_pointer_t;
         // --------------------------------------------------------------------
 
         /*
-         * Reliable daemon
-         * Check to see if any messages are sent
-         * but not acked so to send them again.
+         * Retransmission timer of a single message
          *
-         *      check by timestamps
-         *          if time for ack receive has passed
-         *      and retries
-         *          if maximum retries reached abort
+         * Every transmission arms a new timer, so timers of
+         * messages already acked or resent in the meantime
+         * find no matching entry and do nothing.
+         *      if maximum retries reached abort
+         *      else resend with the doubled timeout
          *
-         * Reset timer for daemon
-         * @param
-         * not used
+         * @param timer_id
+         * timer_id of the pending message
          */
-
-        void reliable_daemon(void *) {
-            bool found = false; // true if a message is to be resent
+        void retransmit_timeout(void * timer_id) {
             for (typename pending_messages_vector_t::iterator it = pending_messages_.begin(); it != pending_messages_.end(); ++it) {
-                if (it->seq_no != 0) { // only for valid entries : 0 means no message
-                    if (it->timestamp < current_time_ - 2) { // 2 time units needed for message delivery
-                        if (it->retries < max_retries_) { // if max retries reached
-                            // a message is to be resend
-                            it->timestamp = current_time_; // refresh its sent timestamp
-
-                            size_t mess_size = it->msg.buffer_size();
-
-                            mess_size = mess_size;
-
-                            // resend the message
-                            radio().send(
-                                    it->destination,
-                                    it->msg.buffer_size(),
-                                    (uint8_t *) & it->msg);
-                            // increase by 1 retries
-                            it->retries++;
-
+                if (it->timer_id != (uint16_t) (unsigned long) timer_id) {
+                    continue;
+                }
+                if (it->retries < max_retries_) {
 #ifdef DEBUG_RELIABLERADIO
-                            debug().debug("RR;resend;RELIABLE_MESSAGE;%x;%d;%d", it->destination, it->seq_no, it->msg.buffer_size());
+                    debug().debug("RR;resend;RELIABLE_MESSAGE;%x;%d;%d", it->destination, it->seq_no, it->msg.buffer_size());
 #endif
-                        } else { // if max retries reached abort sending
-
+                    retransmit(*it);
+                } else { // if max retries reached abort sending
 #ifdef DEBUG_RELIABLERADIO
-#ifdef SHAWN
-
-                            debug().debug("RR;abort [ type= %d(reliable) destination= %x seq_no= %d  max_retries]", ReliableMessage::RELIABLE_MESSAGE,
-                                    pending_messages_[i].first.destination,
-                                    pending_messages_[i].first.seq_no);
-#else
-                            debug().debug("RR;abort;RELIABLE_MESSAGE;%d;%d;max_retries", it->destination, it->seq_no);
-#endif
+                    debug().debug("RR;abort;RELIABLE_MESSAGE;%d;%d;max_retries", it->destination, it->seq_no);
 #endif
-                            if (it->event_notifier_callback != event_notifier_delegate_t()) {
-                                it->event_notifier_callback(MSG_DROPPED,
-                                        it->destination,
-                                        it->msg.buffer_size(),
-                                        (uint8_t *) & it->msg);
-                            }
-                            pending_messages_.erase(it);
-
-                            //                            // clear vector entry to be reused
-                            //                            it->event_notifier_callback = event_notifier_delegate_t();
-                            //                            it->seq_no = 0;
-                            it--;
-                        }
-                        // a message was found
-                        found = true;
+                    if (it->event_notifier_callback != event_notifier_delegate_t()) {
+                        it->event_notifier_callback(MSG_DROPPED,
+                                it->destination,
+                                it->msg.buffer_size(),
+                                (uint8_t *) & it->msg);
                     }
+                    pending_messages_.erase(it);
                 }
+                return;
             }
-
-#ifdef DEBUG_RELIABLERADIO
-            if (!found) {
-                //                Debug::debug(os(), "RR;info No pending messages\n");
-            }
-#endif
-            // Reset the timer
-            timer().template set_timer<self_t, &self_t::reliable_daemon > (
-                    sleep_time_, this, (void*) 0);
         }
 
         /*
@@ -432,6 +421,22 @@ typedef self_t* self_pointer_t;
 
     private:
 
+        struct connections {
+            // sending
+            uint16_t sequence_numbers_;
+            uint16_t srtt_; // smoothed round trip time [ms]
+            uint16_t rttvar_; // round trip time variation [ms]
+            uint16_t rto_; // retransmission timeout [ms]
+            bool rtt_valid_;
+            // receiving
+            seqNo_t expected_seq_; // all sequence numbers below were received
+            uint32_t received_seqs_; // bit i set: expected_seq_ + 1 + i was received
+        };
+        typedef struct connections connection_entry_t;
+        typedef wiselib::pair<node_id_t, connection_entry_t> newconn_t;
+
+        typedef typename wiselib::map_static_hash<OsModel, node_id_t, connection_entry_t, MAX_CONNECTIONS> open_connections_t;
+
         /**
          * Handler for newly received ack message
          * @param ackmess
@@ -441,35 +446,53 @@ typedef self_t* self_pointer_t;
          */
         void handle_ack_message(ReliableMessage_t * ackmess, node_id_t from) {
 #ifdef DEBUG_RELIABLERADIO
-            debug().debug("RR;receive;ACK_MESSAGE;%d;%d", from, ackmess->payload_size());
+            debug().debug("RR;receive;ACK_MESSAGE;%d;%d", from, ackmess->seq_number());
 #endif
+            // everything below the cumulative ack was received, bit i of
+            // the bitmap stands for cumulative ack + 1 + i
+            seqNo_t cumulative = ackmess->seq_number();
+            uint32_t selective = 0;
+            if (ackmess->payload_size() >= sizeof (uint32_t)) {
+                selective = read<OsModel, block_data_t, uint32_t > (ackmess->payload());
+            }
+            // messages sent before the last one selectively acked are lost
+            int16_t highest = 0;
+            for (int16_t i = MAX_RECV; i > 0; i--) {
+                if (selective & ((uint32_t) 1 << (i - 1))) {
+                    highest = i;
+                    break;
+                }
+            }
 
-            uint8_t seq_nos[ackmess->payload_size()];
-            memcpy(seq_nos, ackmess->payload(), ackmess->payload_size());
-            // get sequence from the message and remove the respective messages from the list
-            for (size_t j = 0; j < ackmess->payload_size(); j += 2) {
-                uint16_t seq_no_acked = seq_nos[j] + seq_nos[j + 1]*256;
-                // search the whole vector
-                for (typename pending_messages_vector_t::iterator it = pending_messages_.begin(); it != pending_messages_.end(); ++it) {
-                    // if the sequence numbers match
-                    if (it->seq_no == seq_no_acked) {
-                        // if the destinations match
-                        if (it->destination == from) {
-                            // remove entry
+            connection_entry_t& conn = open_connections[from];
+            for (typename pending_messages_vector_t::iterator it = pending_messages_.begin(); it != pending_messages_.end(); ++it) {
+                if (it->destination != from) {
+                    continue;
+                }
+                int16_t distance = (int16_t) (it->seq_no - cumulative);
+                if (distance < 0 || (distance > 0 && distance <= MAX_RECV
+                        && (selective & ((uint32_t) 1 << (distance - 1))))) {
 #ifdef DEBUG_RELIABLERADIO
-                            debug().debug("RR;receive seq_no_acked=%d", seq_no_acked);
+                    debug().debug("RR;receive seq_no_acked=%d", it->seq_no);
 #endif
-                            if (it->event_notifier_callback != event_notifier_delegate_t()) {
-                                it->event_notifier_callback(MSG_ACK_RCVD,
-                                        it->destination,
-                                        it->msg.buffer_size(),
-                                        (uint8_t *) & it->msg);
-                            }
-
-                            pending_messages_.erase(it);
-                            it--;
-                        }
+                    // only unambiguous samples (Karn's algorithm)
+                    if (it->retries == 0) {
+                        update_rto(conn, current_time_ - it->timestamp);
+                    }
+                    if (it->event_notifier_callback != event_notifier_delegate_t()) {
+                        it->event_notifier_callback(MSG_ACK_RCVD,
+                                it->destination,
+                                it->msg.buffer_size(),
+                                (uint8_t *) & it->msg);
                     }
+
+                    pending_messages_.erase(it);
+                    it--;
+                } else if (distance < highest && (it->retries < max_retries_)
+                        && current_time_ - it->timestamp > (uint32_t) conn.srtt_ + conn.rttvar_) {
+                    // a hole in the window, resend right away instead of
+                    // waiting for the timeout
+                    retransmit(*it);
                 }
             }
         }
@@ -484,8 +507,8 @@ typedef self_t* self_pointer_t;
         void handle_reliable_message(ReliableMessage_t * relmess, node_id_t from) {
             // get sequence number from the message
             uint16_t curr_seq_no = relmess->seq_number();
-            // check if the message exists in cache
-            bool first_time = was_received(from, curr_seq_no);
+            // check if the message was received before
+            bool first_time = was_received(from, curr_seq_no, relmess->window_offset());
 
 #ifdef DEBUG_RELIABLERADIO
             debug().debug("RR;receive;RELIABLE_MESSAGE;%x;%d;%d", from, curr_seq_no, first_time);
@@ -498,66 +521,152 @@ typedef self_t* self_pointer_t;
 
                 // forward the payload to the application
                 notify_receivers(from, relmess->payload_size(), msg_striped);
+            }
+            // if the message was forwarded before to the application the
+            // ack was lost, so ack in both cases
+            send_ack(from);
+        }
 
-
-                // create the new ack message to send
-                ReliableMessage_t ackm;
-                ackm.set_msg_id(ReliableMessage_t::ACK_MESSAGE);
-                ackm.set_seq_number(0);
-                set_ack_list(&ackm, from);
-                // send the ack message
-                radio().send(from, ackm.buffer_size(), (uint8_t *) & ackm);
+        /**
+         * acknowledge the state of the receive window
+         * @param to
+         * the sender of the acknowledged messages
+         */
+        void send_ack(node_id_t to) {
+            connection_entry_t& conn = open_connections[to];
+
+            // cumulative ack in the sequence number field, the bitmap of
+            // messages received out of order as payload
+            ReliableMessage_t ackm;
+            ackm.set_msg_id(ReliableMessage_t::ACK_MESSAGE);
+            ackm.set_seq_number(conn.expected_seq_);
+            block_data_t selective[sizeof (uint32_t)];
+            write<OsModel, block_data_t, uint32_t > (selective, conn.received_seqs_);
+            ackm.set_payload(sizeof (selective), selective);
+            // send the ack message
+            radio().send(to, ackm.buffer_size(), (uint8_t *) & ackm);
 #ifdef DEBUG_RELIABLERADIO
-                debug().debug("RR;send;ACK_MESSAGE;%x;%d", from, ackm.buffer_size());
+            debug().debug("RR;send;ACK_MESSAGE;%x;%d", to, conn.expected_seq_);
 #endif
-#ifdef EXTRA
-                block_data_t ack[ackm.payload_size()];
-                memcpy(ack, &ackm, ackm.payload_size());
-                for (int i = 0; i < ackm.payload_size(); i += 2) {
-                    debug().debug(" %d", ack[i] + ack[i + 1]);
+        }
 
-                }
-#endif
-            } else {// if the sequence number exists in cache then just send an ack message ( message was forwarded before to the application
-                // create the new ack message to send
-                ReliableMessage_t ackm;
-                ackm.set_msg_id(ReliableMessage_t::ACK_MESSAGE);
-                ackm.set_seq_number(0);
-                set_ack_list(&ackm, from);
-                // send the ack message
-                radio().send(from, ackm.buffer_size(), (uint8_t *) & ackm);
-#ifdef DEBUG_RELIABLERADIO
-                debug().debug("RR;resend;ACK_MESSAGE;%x;%d", from, ackm.buffer_size());
-#endif
-#ifdef EXTRA
-                block_data_t ack[ackm.payload_size()];
-                memcpy(ack, &ackm, ackm.payload_size());
-                for (int i = 0; i < ackm.payload_size(); i += 2) {
-                    debug().debug(" %d", ack[i] + ack[i + 1]);
+        /**
+         * resend a pending message and rearm its timer
+         * @param entry
+         * the pending message
+         */
+        void retransmit(pending_messages_entry_t& entry) {
+            entry.timestamp = current_time_;
+            entry.retries++;
+            transmit(entry);
+            arm_retransmit_timer(entry);
+        }
 
-                }
-#endif
+        /**
+         * send a pending message, telling the receiver which older
+         * messages are still pending
+         * @param entry
+         * the pending message
+         */
+        void transmit(pending_messages_entry_t& entry) {
+            entry.msg.set_window_offset(entry.seq_no - oldest_pending(entry.destination));
+            radio().send(entry.destination, entry.msg.buffer_size(), (uint8_t *) & entry.msg);
+        }
+
+        /**
+         * set the retransmission timer of a message that was just sent
+         * @param entry
+         * the pending message
+         */
+        void arm_retransmit_timer(pending_messages_entry_t& entry) {
+            // exponential backoff
+            uint32_t rto = open_connections[entry.destination].rto_;
+            for (int i = 0; i < entry.retries && rto < MAX_RTO; i++) {
+                rto *= 2;
+            }
+            if (rto > MAX_RTO) {
+                rto = MAX_RTO;
+            }
+            entry.timer_id = ++timer_ids_;
+            timer().template set_timer<self_t, &self_t::retransmit_timeout > (
+                    rto, this, (void*) (unsigned long) entry.timer_id);
+
+            if (!clock_running_) {
+                clock_running_ = true;
+                timer().template set_timer<self_t, &self_t::time_passes > (
+                        time_slice_, this, (void*) 0);
             }
         }
 
         /**
-         * add the latest acks received from the node
-         * @param m
-         * pointer to the message
-         * @param sender
-         * sender of the message
+         * update the retransmission timeout of a connection
+         * @param conn
+         * the connection
+         * @param rtt
+         * round trip time measured [ms]
+         */
+        void update_rto(connection_entry_t& conn, uint32_t rtt) {
+            if (rtt > MAX_RTO) {
+                rtt = MAX_RTO;
+            }
+            if (!conn.rtt_valid_) {
+                conn.srtt_ = rtt;
+                conn.rttvar_ = rtt / 2;
+                conn.rtt_valid_ = true;
+            } else {
+                uint32_t err = (conn.srtt_ > rtt) ? conn.srtt_ - rtt : rtt - conn.srtt_;
+                conn.rttvar_ = (3 * (uint32_t) conn.rttvar_ + err) / 4;
+                conn.srtt_ = (7 * (uint32_t) conn.srtt_ + rtt) / 8;
+            }
+            // the clock ticks in time slices, which is the least variance measurable
+            uint32_t rto = conn.srtt_ + ((4 * (uint32_t) conn.rttvar_ > (uint32_t) time_slice_) ? 4 * (uint32_t) conn.rttvar_ : time_slice_);
+            if (rto < MIN_RTO) {
+                rto = MIN_RTO;
+            } else if (rto > MAX_RTO) {
+                rto = MAX_RTO;
+            }
+            conn.rto_ = rto;
+        }
+
+        /**
+         * whether another message may be sent to a node: less than
+         * MAX_WINDOW unacknowledged ones, and the new sequence number
+         * less than MAX_RECV ahead of the oldest of them
+         * @param destination
+         * the other end of the connection
          */
-        void set_ack_list(ReliableMessage_t * m, node_id_t sender) {
-
-            uint8_t seq_nos[open_connections[sender].received_seqs_.size()];
-            int i = 0;
-            for (received_seqs_iterator_t it = open_connections[sender].received_seqs_.begin(); it != open_connections[sender].received_seqs_.end(); ++it) {
-                seq_nos[2 * i] = *it % 256;
-                seq_nos[2 * i + 1] = *it / 256;
-                i++;
+        bool window_open(node_id_t destination) {
+            size_t count = 0;
+            for (typename pending_messages_vector_t::iterator it = pending_messages_.begin(); it != pending_messages_.end(); ++it) {
+                if (it->destination == destination) {
+                    count++;
+                }
+            }
+            if (count == 0) {
+                return true;
             }
-            m->set_payload(open_connections[sender].received_seqs_.size() * 2, seq_nos);
+            seqNo_t next = open_connections[destination].sequence_numbers_;
+            return count < MAX_WINDOW
+                    && (seqNo_t) (next - oldest_pending(destination)) < MAX_RECV;
+        }
 
+        /**
+         * sequence number of the oldest unacknowledged message to a node
+         * @param destination
+         * the other end of the connection, at least one message to it
+         * must be pending
+         */
+        seqNo_t oldest_pending(node_id_t destination) {
+            bool found = false;
+            seqNo_t oldest = 0;
+            for (typename pending_messages_vector_t::iterator it = pending_messages_.begin(); it != pending_messages_.end(); ++it) {
+                if (it->destination == destination
+                        && (!found || (int16_t) (it->seq_no - oldest) < 0)) {
+                    oldest = it->seq_no;
+                    found = true;
+                }
+            }
+            return oldest;
         }
 
         // --------------------------------------------------------------------
@@ -587,12 +696,11 @@ typedef self_t* self_pointer_t;
             } else {
                 newconn_t newconnection;
                 newconnection.first = destination;
-                newconnection.second.received_seqs_.clear();
+                init_connection(newconnection.second);
                 newconnection.second.sequence_numbers_ = 2;
                 open_connections.push_back(newconnection);
                 return 1;
             }
-            return 0;
         }
 
         // --------------------------------------------------------------------
@@ -610,62 +718,102 @@ typedef self_t* self_pointer_t;
             } else {
                 newconn_t newconnection;
                 newconnection.first = node;
-                newconnection.second.received_seqs_.clear();
-                newconnection.second.sequence_numbers_ = 1;
+                init_connection(newconnection.second);
                 open_connections.push_back(newconnection);
             }
             return true;
         }
 
+        void init_connection(connection_entry_t& conn) {
+            conn.sequence_numbers_ = 1;
+            conn.expected_seq_ = 1;
+            conn.received_seqs_ = 0;
+            conn.srtt_ = 0;
+            conn.rttvar_ = 0;
+            conn.rto_ = INITIAL_RTO;
+            conn.rtt_valid_ = false;
+        }
+
         /**
-         * Check sequence numbers cache to see if the message with this sequence number was previously received
+         * Check the receive window to see if the message with this sequence number was previously received
          * @param sd
          * sender the message
          * @param seq_no
          * Seq number of the message
+         * @param window_offset
+         * the sender gave up on all sequence numbers below seq_no - window_offset
          * @return
          *  true if the first time received
          */
-        bool was_received(node_id_t sd, seqNo_t seq_no) {
-            bool first_time = true;
-            if (open_connections.contains(sd)) {
-                for (received_seqs_iterator_t it = open_connections[sd].received_seqs_.begin(); it != open_connections[sd].received_seqs_.end(); ++it) {
-                    if (*it == seq_no) {
-                        first_time = false;
-                        break;
-                    }
-                }
-                if (first_time) {
-                    //if reached the max seq numbers delete the oldes
-                    if (open_connections[sd].received_seqs_.size() == open_connections[sd].received_seqs_.max_size()) {
-                        //                        debug().debug("exeeded max list size");
-                        open_connections[sd].received_seqs_.erase(open_connections[sd].received_seqs_.begin());
-                    }
-                    //                    debug().debug("add %d to existing seq nos", seq_no);
-                    open_connections[sd].received_seqs_.push_back(seq_no);
+        bool was_received(node_id_t sd, seqNo_t seq_no, uint8_t window_offset) {
+            if (!open_connections.contains(sd)) {
+                return true;
+            }
+            connection_entry_t& conn = open_connections[sd];
+
+            // skip the messages the sender dropped, they will never come
+            seqNo_t oldest = seq_no - window_offset;
+            while ((int16_t) (oldest - conn.expected_seq_) > 0
+                    && (int16_t) (oldest - conn.expected_seq_) <= MAX_RECV) {
+                advance_window(conn);
+            }
+
+            int16_t distance = (int16_t) (seq_no - conn.expected_seq_);
+            if (distance < 0) {
+                // acked before, unless the sender started over
+                if (distance >= -MAX_RECV) {
+                    return false;
                 }
-                return first_time;
+                conn.expected_seq_ = seq_no + 1;
+                conn.received_seqs_ = 0;
+                return true;
+            }
+            if ((int16_t) (oldest - conn.expected_seq_) > 0) {
+                // the sender gave up on more than a window, nothing in
+                // between is pending anymore
+                conn.expected_seq_ = oldest;
+                conn.received_seqs_ = 0;
+                distance = (int16_t) (seq_no - conn.expected_seq_);
+            }
+            if (distance > MAX_RECV) {
+                // cannot be tracked, and the sender never sends that far
+                // ahead of its oldest pending message
+                return false;
+            }
+            if (distance == 0) {
+                advance_window(conn);
+                return true;
+            }
+            uint32_t bit = (uint32_t) 1 << (distance - 1);
+            if (conn.received_seqs_ & bit) {
+                return false;
             }
-            return first_time;
+            conn.received_seqs_ |= bit;
+            return true;
+        }
+
+        /**
+         * move the receive window past the expected sequence number and all
+         * following ones already received
+         * @param conn
+         * the connection
+         */
+        void advance_window(connection_entry_t& conn) {
+            conn.expected_seq_++;
+            while (conn.received_seqs_ & 1) {
+                conn.received_seqs_ >>= 1;
+                conn.expected_seq_++;
+            }
+            conn.received_seqs_ >>= 1;
         }
 
         int recv_callback_id_;
-        uint16_t current_time_; //
+        uint32_t current_time_; // [ms]
+        bool clock_running_;
+        uint16_t timer_ids_;
         pending_messages_vector_t pending_messages_;
-        static const int time_slice_ = 200; // time_passes delay
-        static const int sleep_time_ = 1000; // reliable_daemon's sleep time
-
-        typedef typename wiselib::vector_static<OsModel, seqNo_t, MAX_RECV> received_seqs_vector_t;
-        typedef typename received_seqs_vector_t::iterator received_seqs_iterator_t;
-
-        struct connections {
-            received_seqs_vector_t received_seqs_;
-            uint16_t sequence_numbers_;
-        };
-        typedef struct connections connection_entry_t;
-        typedef wiselib::pair<node_id_t, connection_entry_t> newconn_t;
+        static const int time_slice_ = 20; // time_passes delay, resolution of the rtt measurement
 
-        typedef typename wiselib::MapStaticVector<OsModel, node_id_t, connection_entry_t, MAX_CONNECTIONS> open_connections_t;
         open_connections_t open_connections;
 
         int max_retries_; // Maximum retries to deliver a message before abort
@@ -0,0 +1,362 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef __WISELIB_UTIL_ALLOCATORS_SLAB_ALLOCATOR_H
+#define __WISELIB_UTIL_ALLOCATORS_SLAB_ALLOCATOR_H
+
+#ifndef assert
+	#define assert(X)
+#endif // assert
+
+/**
+ * Keep per-size-class occupancy statistics; on by default unless
+ * NDEBUG is defined.
+ */
+#ifndef SLAB_ALLOCATOR_KEEP_STATS
+	#ifdef NDEBUG
+		#define SLAB_ALLOCATOR_KEEP_STATS 0
+	#else
+		#define SLAB_ALLOCATOR_KEEP_STATS 1
+	#endif
+#endif
+
+#if SLAB_ALLOCATOR_KEEP_STATS && defined(PC)
+	#include <iostream>
+#endif
+
+namespace wiselib {
+	struct SlabAllocatorPlacement { };
+}
+
+inline void* operator new(size_t, void* place, wiselib::SlabAllocatorPlacement) {
+	return place;
+}
+
+inline void operator delete(void*, void*, wiselib::SlabAllocatorPlacement) {
+}
+
+namespace wiselib {
+
+namespace slab_allocator_impl {
+	template<size_t N_> struct Log2 { enum { value = 1 + Log2<N_ / 2>::value }; };
+	template<> struct Log2<1> { enum { value = 0 }; };
+}
+
+/**
+ * Size class (slab) allocator with constant time allocation and
+ * deallocation.
+ * 
+ * The buffer is divided into pages of PAGE_SIZE bytes. Each page is
+ * dedicated to one size class (powers of two from MIN_BLOCK_SIZE up to
+ * PAGE_SIZE) the first time that class needs memory, and is cut into
+ * blocks of that size. Freed blocks go to an intrusive free list of their
+ * class, so neither allocation nor deallocation searches anything; the
+ * price is internal fragmentation of up to 50% and pages not being
+ * returned to other classes.
+ * 
+ * Requests larger than PAGE_SIZE always fail, whatever memory is left:
+ * allocate() and allocate_array() then return a null pointer (and
+ * assert, where assert is enabled). This includes arrays of more than
+ * PAGE_SIZE / sizeof(T) elements, so PAGE_SIZE has to be chosen for the
+ * largest object or array (e.g. the largest vector_dynamic or
+ * string_dynamic buffer) the application allocates.
+ * 
+ * Pointers are plain pointers (as with MallocFreeAllocator), so
+ * list_dynamic, vector_dynamic and string_dynamic work unchanged.
+ * 
+ * With SLAB_ALLOCATOR_KEEP_STATS, per-class occupancy is tracked.
+ * 
+ * @ingroup Allocator_concept
+ */
+template<
+	typename OsModel_P,
+	size_t BUFFER_SIZE,
+	size_t PAGE_SIZE = 256,
+	size_t MIN_BLOCK_SIZE = 8
+>
+class SlabAllocator {
+	
+	public:
+		typedef OsModel_P OsModel;
+		typedef SlabAllocator<OsModel_P, BUFFER_SIZE, PAGE_SIZE, MIN_BLOCK_SIZE> self_type;
+		typedef self_type* self_pointer_t;
+		typedef typename OsModel::size_t size_t;
+		typedef typename OsModel::block_data_t block_data_t;
+		
+		enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+		
+		enum {
+			PAGES = BUFFER_SIZE / PAGE_SIZE,
+			SIZE_CLASSES = slab_allocator_impl::Log2<PAGE_SIZE / MIN_BLOCK_SIZE>::value + 1,
+			NO_CLASS = 0xff
+		};
+		
+		template<typename T>
+		struct pointer_t {
+			public:
+				pointer_t() : p_(0) { }
+				pointer_t(T* p) : p_(p) { }
+				pointer_t(const pointer_t& other) : p_(other.p_) { }
+				pointer_t& operator=(const pointer_t& other) { p_ = other.p_; return *this; }
+				T& operator*() const { return *p_; }
+				T* operator->() const { return p_; }
+				T& operator[](size_t idx) { return p_[idx]; }
+				const T& operator[](size_t idx) const { return p_[idx]; }
+				bool operator==(const pointer_t& other) const { return p_ == other.p_; }
+				bool operator!=(const pointer_t& other) const { return p_ != other.p_; }
+				operator bool() const { return p_ != 0; }
+				pointer_t& operator++() { ++p_; return *this; }
+				pointer_t& operator--() { --p_; return *this; }
+				pointer_t operator+(size_t i) { return pointer_t(p_ + i); }
+				
+				T* raw() { return p_; }
+				const T* raw() const { return p_; }
+			protected:
+				T* p_;
+				
+			friend class SlabAllocator<OsModel_P, BUFFER_SIZE, PAGE_SIZE, MIN_BLOCK_SIZE>;
+		};
+		
+		template<typename T>
+		struct array_pointer_t : public pointer_t<T> {
+			public:
+				array_pointer_t() : pointer_t<T>(0), elements_(0) { }
+				array_pointer_t(T* p) : pointer_t<T>(p), elements_(p ? 1 : 0) { }
+				array_pointer_t(T* p, size_t e) : pointer_t<T>(p), elements_(e) { }
+				array_pointer_t(const array_pointer_t& other) : pointer_t<T>(other.p_), elements_(other.elements_) { }
+				array_pointer_t& operator=(const array_pointer_t& other) {
+					this->p_ = other.p_;
+					elements_ = other.elements_;
+					return *this;
+				}
+				array_pointer_t& operator++() { ++this->p_; --elements_; return *this; }
+				array_pointer_t& operator--() { --this->p_; ++elements_; return *this; }
+				array_pointer_t operator+(size_t n) const { return array_pointer_t(this->p_ + n, elements_ - n); }
+				size_t elements() const { return elements_; }
+				
+			private:
+				size_t elements_;
+				
+			friend class SlabAllocator<OsModel_P, BUFFER_SIZE, PAGE_SIZE, MIN_BLOCK_SIZE>;
+		};
+		
+		SlabAllocator() : pages_used_(0) {
+			assert(MIN_BLOCK_SIZE >= sizeof(FreeBlock));
+			assert(PAGES > 0);
+			for(size_t i = 0; i < SIZE_CLASSES; i++) {
+				free_[i] = 0;
+				bump_[i] = 0;
+				bump_end_[i] = 0;
+			#if SLAB_ALLOCATOR_KEEP_STATS
+				in_use_[i] = 0;
+				peak_[i] = 0;
+				pages_[i] = 0;
+			#endif
+			}
+			for(size_t i = 0; i < PAGES; i++) {
+				page_class_[i] = NO_CLASS;
+			}
+		}
+		
+		template<typename T>
+		pointer_t<T> allocate() {
+			T *p = reinterpret_cast<T*>(allocate_block(sizeof(T)));
+			if(p) {
+				new(p, SlabAllocatorPlacement()) T;
+			}
+			return pointer_t<T>(p);
+		}
+		
+		/// Fails (null pointer) if sizeof(T) * n exceeds PAGE_SIZE
+		template<typename T>
+		array_pointer_t<T> allocate_array(typename OsModel::size_t n) {
+			assert(n != 0);
+			T *p = reinterpret_cast<T*>(allocate_block(sizeof(T) * n));
+			if(!p) {
+				return array_pointer_t<T>();
+			}
+			for(typename OsModel::size_t i = 0; i < n; i++) {
+				new(p + i, SlabAllocatorPlacement()) T;
+			}
+			return array_pointer_t<T>(p, n);
+		}
+		
+		template<typename T>
+		int free(pointer_t<T> p) {
+			return free(p.raw());
+		}
+		
+		template<typename T>
+		int free(T* p) {
+			if(!p) { return ERR_UNSPEC; }
+			p->~T();
+			return free_block(reinterpret_cast<block_data_t*>(p));
+		}
+		
+		template<typename T>
+		int free_array(array_pointer_t<T> p) {
+			if(!p) { return ERR_UNSPEC; }
+			for(size_t i = 0; i < p.elements_; i++) {
+				p.raw()[i].~T();
+			}
+			return free_block(reinterpret_cast<block_data_t*>(p.raw()));
+		}
+		
+		size_t capacity() { return PAGES * PAGE_SIZE; }
+		
+		/// Block size used for requests of the given size (0: too large)
+		static size_t block_size(size_t size) {
+			uint8_t c = size_class(size);
+			return (c == NO_CLASS) ? 0 : class_size(c);
+		}
+		
+	#if SLAB_ALLOCATOR_KEEP_STATS
+		///@name Statistics
+		///@{
+		size_t pages_used() { return pages_used_; }
+		/// Blocks currently allocated in class c (block size MIN_BLOCK_SIZE << c)
+		size_t blocks_in_use(size_t c) { return in_use_[c]; }
+		size_t blocks_peak(size_t c) { return peak_[c]; }
+		size_t pages(size_t c) { return pages_[c]; }
+		
+		/// Bytes in allocated blocks (including internal fragmentation)
+		size_t size() {
+			size_t s = 0;
+			for(size_t c = 0; c < SIZE_CLASSES; c++) {
+				s += in_use_[c] * class_size(c);
+			}
+			return s;
+		}
+		///@}
+		
+		#ifdef PC
+		void print_detailed_stats() {
+			for(size_t c = 0; c < SIZE_CLASSES; c++) {
+				if(pages_[c] == 0) { continue; }
+				std::cout << class_size(c) << " bytes: " << in_use_[c] << " in use, peak "
+					<< peak_[c] << ", " << pages_[c] << " pages ("
+					<< (pages_[c] * (PAGE_SIZE / class_size(c))) << " blocks)" << std::endl;
+			}
+			std::cout << pages_used_ << "/" << (size_t)PAGES << " pages used" << std::endl;
+		}
+		#endif
+	#endif
+		
+	private:
+		struct FreeBlock {
+			FreeBlock *next;
+		};
+		
+		static size_t class_size(uint8_t c) {
+			return MIN_BLOCK_SIZE << c;
+		}
+		
+		static uint8_t size_class(size_t size) {
+			uint8_t c = 0;
+			size_t s = MIN_BLOCK_SIZE;
+			while(s < size) {
+				s <<= 1;
+				if(++c >= SIZE_CLASSES) { return NO_CLASS; }
+			}
+			return c;
+		}
+		
+		block_data_t* allocate_block(size_t size) {
+			assert(size != 0);
+			uint8_t c = size_class(size);
+			if(c == NO_CLASS) {
+				assert(false && "SlabAllocator: request larger than PAGE_SIZE");
+				return 0;
+			}
+			
+			block_data_t *p;
+			if(free_[c]) {
+				p = reinterpret_cast<block_data_t*>(free_[c]);
+				free_[c] = free_[c]->next;
+			}
+			else {
+				// Blocks of a fresh page are handed out in order instead
+				// of being put on the free list first. PAGE_SIZE need not
+				// be a multiple of the block size, the rest of the page
+				// stays unused.
+				if(bump_[c] + class_size(c) > bump_end_[c]) {
+					if(pages_used_ >= PAGES) {
+						assert(false && "SlabAllocator: out of pages");
+						return 0;
+					}
+					page_class_[pages_used_] = c;
+					bump_[c] = memory_.data + pages_used_ * PAGE_SIZE;
+					bump_end_[c] = bump_[c] + PAGE_SIZE;
+					pages_used_++;
+				#if SLAB_ALLOCATOR_KEEP_STATS
+					pages_[c]++;
+				#endif
+				}
+				p = bump_[c];
+				bump_[c] += class_size(c);
+			}
+			
+		#if SLAB_ALLOCATOR_KEEP_STATS
+			in_use_[c]++;
+			if(in_use_[c] > peak_[c]) { peak_[c] = in_use_[c]; }
+		#endif
+			return p;
+		}
+		
+		int free_block(block_data_t *p) {
+			size_t page = (p - memory_.data) / PAGE_SIZE;
+			if(p < memory_.data || page >= pages_used_) {
+				assert(false && "SlabAllocator: freeing foreign pointer");
+				return ERR_UNSPEC;
+			}
+			
+			uint8_t c = page_class_[page];
+			FreeBlock *b = reinterpret_cast<FreeBlock*>(p);
+			b->next = free_[c];
+			free_[c] = b;
+			
+		#if SLAB_ALLOCATOR_KEEP_STATS
+			in_use_[c]--;
+		#endif
+			return SUCCESS;
+		}
+		
+		union {
+			block_data_t data[PAGES * PAGE_SIZE];
+			void *align_pointer_;
+			double align_double_;
+		} memory_;
+		
+		FreeBlock *free_[SIZE_CLASSES];
+		block_data_t *bump_[SIZE_CLASSES];
+		block_data_t *bump_end_[SIZE_CLASSES];
+		uint8_t page_class_[PAGES];
+		size_t pages_used_;
+		
+	#if SLAB_ALLOCATOR_KEEP_STATS
+		size_t in_use_[SIZE_CLASSES];
+		size_t peak_[SIZE_CLASSES];
+		size_t pages_[SIZE_CLASSES];
+	#endif
+};
+
+} // namespace wiselib
+
+#endif // __WISELIB_UTIL_ALLOCATORS_SLAB_ALLOCATOR_H
+
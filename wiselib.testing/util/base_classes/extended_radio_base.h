@@ -45,12 +45,14 @@ namespace wiselib
    {
    public:
 	  typedef ExtendedData_P ExtendedData;
+      typedef RadioBase<OsModel_P, NodeId_P, Size_P, BlockData_P, MAX_RECEIVERS> base_type;
 
       typedef OsModel_P OsModel;
 
       typedef NodeId_P node_id_t;
       typedef Size_P size_t;
       typedef BlockData_P block_data_t;
+      typedef typename base_type::packet_buffer_t packet_buffer_t;
 
       typedef delegate3<void, node_id_t, size_t, block_data_t*> radio_delegate_t;
       typedef delegate4<void, node_id_t, size_t, block_data_t*, const ExtendedData&> extended_radio_delegate_t;
@@ -91,9 +93,21 @@ namespace wiselib
          return -1;
       }
       // --------------------------------------------------------------------
+      template<class T, void (T::*TMethod)(node_id_t, packet_buffer_t&)>
+      int reg_recv_callback( T *obj_pnt )
+      {
+         return base_type::template reg_recv_callback<T, TMethod>( obj_pnt );
+      }
+      // --------------------------------------------------------------------
+      template<class T, void (T::*TMethod)(node_id_t, size_t, block_data_t*)>
+      int reg_recv_callback( T *obj_pnt, typename base_type::message_id_t msg_id )
+      {
+         return base_type::template reg_recv_callback<T, TMethod>( obj_pnt, msg_id );
+      }
+      // --------------------------------------------------------------------
       int unreg_recv_callback( int idx )
       {
-    	  if( idx < MAX_RECEIVERS )
+    	  if( idx < MAX_RECEIVERS || idx >= base_type::BUFFER_CALLBACK_OFFSET )
     		  return RadioBase<OsModel_P, NodeId_P, Size_P, BlockData_P, MAX_RECEIVERS>::unreg_recv_callback( idx );
     	  else
     		  extended_callbacks_.at( idx - MAX_RECEIVERS ) = extended_radio_delegate_t();
@@ -106,6 +120,11 @@ namespace wiselib
     	  RadioBase<OsModel_P, NodeId_P, Size_P, BlockData_P, MAX_RECEIVERS>::notify_receivers( from, len, data );
       }
       // --------------------------------------------------------------------
+      void notify_receivers( node_id_t from, packet_buffer_t& buffer )
+      {
+         base_type::notify_receivers( from, buffer );
+      }
+      // --------------------------------------------------------------------
       void notify_receivers( node_id_t from, size_t len, block_data_t *data, const ExtendedData& ext_data )
       {
     	 notify_receivers( from, len, data );
@@ -119,6 +138,25 @@ namespace wiselib
                (*it)( from, len, data, ext_data );
          }
       }
+      // --------------------------------------------------------------------
+      /** Buffer and plain callbacks as in notify_receivers( from, buffer ),
+       *  then the extended ones with the data of the buffer as passed in.
+       */
+      void notify_receivers( node_id_t from, packet_buffer_t& buffer, const ExtendedData& ext_data )
+      {
+         typename packet_buffer_t::State state = buffer.state();
+         base_type::notify_receivers( from, buffer );
+         buffer.restore( state );
+
+         for ( ExtendedCallbackVectorIterator
+                  it = extended_callbacks_.begin();
+                  it != extended_callbacks_.end();
+                  ++it )
+         {
+            if ( *it != extended_radio_delegate_t() )
+               (*it)( from, buffer.size(), buffer.data(), ext_data );
+         }
+      }
 
    private:
       ExtendedCallbackVector extended_callbacks_;
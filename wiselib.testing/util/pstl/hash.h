@@ -0,0 +1,65 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef __WISELIB_INTERNAL_INTERFACE_STL_HASH_H
+#define __WISELIB_INTERNAL_INTERFACE_STL_HASH_H
+
+#include "util/pstl/pair.h"
+
+namespace wiselib
+{
+
+   /** FNV-1a over a raw byte range. Used by the pSTL hash functors; only
+    *  suitable for types without padding bytes.
+    */
+   inline uint32_t hash_bytes( const void *data, unsigned int len,
+                               uint32_t h = 2166136261UL )
+   {
+      const uint8_t *p = (const uint8_t*)data;
+      for ( unsigned int i = 0; i < len; i++ )
+      {
+         h ^= p[i];
+         h *= 16777619UL;
+      }
+      return h;
+   }
+   // -----------------------------------------------------------------------
+   /** Default hash functor for pSTL hash containers. Works for all plain
+    *  types without padding (node ids, integers, packed structs). Provide
+    *  an own functor for anything else.
+    */
+   template<typename Key_P>
+   struct hash
+   {
+      uint32_t operator()( const Key_P& k ) const
+      { return hash_bytes( &k, sizeof(Key_P) ); }
+   };
+   // -----------------------------------------------------------------------
+   template<typename First_P, typename Second_P>
+   struct hash<pair<First_P, Second_P> >
+   {
+      uint32_t operator()( const pair<First_P, Second_P>& k ) const
+      {
+         uint32_t h = hash_bytes( &k.first, sizeof(First_P) );
+         return hash_bytes( &k.second, sizeof(Second_P), h );
+      }
+   };
+
+}
+
+#endif
@@ -0,0 +1,364 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef __UTIL_PSTL_MAP_STATIC_HASH__
+#define __UTIL_PSTL_MAP_STATIC_HASH__
+
+#include "util/pstl/pair.h"
+#include "util/pstl/hash.h"
+#include <string.h>
+
+namespace wiselib
+{
+
+   template<typename Map_P>
+   class map_static_hash_iterator
+   {
+   public:
+      typedef Map_P map_type;
+      typedef typename map_type::value_type value_type;
+      typedef typename map_type::size_type size_type;
+      typedef value_type& reference;
+      typedef value_type* pointer;
+      // --------------------------------------------------------------------
+      map_static_hash_iterator()
+         : map_( 0 ), pos_( 0 )
+      {}
+      // --------------------------------------------------------------------
+      map_static_hash_iterator( map_type *map, size_type pos )
+         : map_( map ), pos_( pos )
+      {}
+      // --------------------------------------------------------------------
+      reference operator*() const
+      { return map_->slots_[pos_]; }
+      // --------------------------------------------------------------------
+      pointer operator->() const
+      { return &map_->slots_[pos_]; }
+      // --------------------------------------------------------------------
+      map_static_hash_iterator& operator++()
+      {
+         pos_ = map_->next_used( pos_ + 1 );
+         return *this;
+      }
+      // --------------------------------------------------------------------
+      map_static_hash_iterator operator++( int )
+      {
+         map_static_hash_iterator tmp = *this;
+         ++(*this);
+         return tmp;
+      }
+      // --------------------------------------------------------------------
+      bool operator==( const map_static_hash_iterator& other ) const
+      { return pos_ == other.pos_ && map_ == other.map_; }
+      // --------------------------------------------------------------------
+      bool operator!=( const map_static_hash_iterator& other ) const
+      { return !( *this == other ); }
+      // --------------------------------------------------------------------
+      size_type slot() const
+      { return pos_; }
+
+   private:
+      map_type *map_;
+      size_type pos_;
+   };
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   // -----------------------------------------------------------------------
+   /** \brief Fixed-capacity map with open addressing (linear probing).
+    *
+    *  Drop-in replacement for MapStaticVector: provides the same interface
+    *  (insert, erase, find, count, contains, operator[], push_back and
+    *  iteration over pair<Key, Value>), but lookup is O(1) on average
+    *  instead of a linear scan. No heap memory is used; all TABLE_SIZE
+    *  slots live inside the object. Keep the table at most ~75% full for
+    *  short probe sequences.
+    *
+    *  Iteration order is the slot order and thus unspecified. Erasing an
+    *  element does not invalidate iterators to other elements.
+    */
+   template<typename OsModel_P,
+            typename Key_P,
+            typename Value_P,
+            unsigned int TABLE_SIZE,
+            typename Hash_P = hash<Key_P> >
+   class map_static_hash
+   {
+   public:
+      typedef OsModel_P OsModel;
+
+      typedef map_static_hash<OsModel, Key_P, Value_P, TABLE_SIZE, Hash_P> map_type;
+
+      typedef Key_P key_type;
+      typedef Value_P mapped_type;
+      typedef pair<Key_P, Value_P> value_type;
+      typedef value_type* pointer;
+      typedef value_type& reference;
+      typedef Hash_P hasher;
+
+      typedef map_static_hash_iterator<map_type> iterator;
+      typedef typename OsModel_P::size_t size_type;
+
+      friend class map_static_hash_iterator<map_type>;
+      // --------------------------------------------------------------------
+      map_static_hash()
+      { clear(); }
+      // --------------------------------------------------------------------
+      map_static_hash( const map_static_hash& map )
+      { *this = map; }
+      // --------------------------------------------------------------------
+      template <class InputIterator>
+      map_static_hash( InputIterator f, InputIterator l )
+      {
+         clear();
+         insert( f, l );
+      }
+      // --------------------------------------------------------------------
+      ~map_static_hash()
+      {}
+      // --------------------------------------------------------------------
+      map_static_hash& operator=( const map_static_hash& map )
+      {
+         for ( size_type i = 0; i < TABLE_SIZE; i++ )
+         {
+            state_[i] = map.state_[i];
+            if ( state_[i] == SLOT_USED )
+               slots_[i] = map.slots_[i];
+         }
+         size_ = map.size_;
+         return *this;
+      }
+      // --------------------------------------------------------------------
+      void swap( map_type& m )
+      {
+         map_type tmp = *this;
+         *this = m;
+         m = tmp;
+      }
+      // --------------------------------------------------------------------
+      ///@name Iterators
+      ///@{
+      iterator begin()
+      { return iterator( this, next_used( 0 ) ); }
+      // --------------------------------------------------------------------
+      iterator end()
+      { return iterator( this, TABLE_SIZE ); }
+      ///@}
+      // --------------------------------------------------------------------
+      ///@name Capacity
+      ///@{
+      size_type size() const
+      { return size_; }
+      // --------------------------------------------------------------------
+      size_type max_size() const
+      { return TABLE_SIZE; }
+      // --------------------------------------------------------------------
+      size_type capacity() const
+      { return TABLE_SIZE; }
+      // --------------------------------------------------------------------
+      bool empty() const
+      { return size_ == 0; }
+      ///@}
+      // --------------------------------------------------------------------
+      ///@name Modifiers
+      ///@{
+      pair<iterator, bool> insert( const value_type& x )
+      {
+         pair<iterator, bool> ret;
+         size_type free_slot = TABLE_SIZE;
+         size_type pos = lookup( x.first, free_slot );
+
+         if ( pos != TABLE_SIZE )
+         {
+            ret.first = iterator( this, pos );
+            ret.second = false;
+            return ret;
+         }
+         // table is full
+         if ( free_slot == TABLE_SIZE )
+         {
+            ret.first = end();
+            ret.second = false;
+            return ret;
+         }
+
+         slots_[free_slot] = x;
+         state_[free_slot] = SLOT_USED;
+         size_++;
+
+         ret.first = iterator( this, free_slot );
+         ret.second = true;
+         return ret;
+      }
+      // --------------------------------------------------------------------
+      template <class InputIterator>
+      void insert( InputIterator first, InputIterator last )
+      {
+         for ( InputIterator it = first; it != last; ++it )
+            insert( *it );
+      }
+      // --------------------------------------------------------------------
+      /** Compatibility with MapStaticVector, which inherits push_back from
+       *  vector_static. Does not overwrite an existing entry.
+       */
+      void push_back( const value_type& x )
+      { insert( x ); }
+      // --------------------------------------------------------------------
+      size_type erase( const key_type& k )
+      {
+         size_type free_slot;
+         size_type pos = lookup( k, free_slot );
+         if ( pos == TABLE_SIZE )
+            return 0;
+
+         release( pos );
+         return 1;
+      }
+      // --------------------------------------------------------------------
+      iterator erase( iterator position )
+      {
+         if ( position == end() )
+            return end();
+
+         size_type pos = position.slot();
+         release( pos );
+         return iterator( this, next_used( pos + 1 ) );
+      }
+      // --------------------------------------------------------------------
+      void clear()
+      {
+         memset( state_, SLOT_EMPTY, sizeof(state_) );
+         size_ = 0;
+      }
+      ///@}
+      // --------------------------------------------------------------------
+      ///@name Operations
+      ///@{
+      iterator find( const key_type& k )
+      {
+         size_type free_slot;
+         return iterator( this, lookup( k, free_slot ) );
+      }
+      // --------------------------------------------------------------------
+      size_type count( const key_type& k )
+      { return contains( k ) ? 1 : 0; }
+      // --------------------------------------------------------------------
+      bool contains( const key_type& k )
+      {
+         size_type free_slot;
+         return lookup( k, free_slot ) != TABLE_SIZE;
+      }
+      ///@}
+      // --------------------------------------------------------------------
+      ///@name Element Access
+      ///@{
+      mapped_type& operator[]( const key_type& k )
+      {
+         value_type val;
+         val.first = k;
+         iterator it = insert( val ).first;
+         if ( it != end() )
+            return it->second;
+
+         // return dummy value that can be written to; this dummy value is
+         // *only* returned if the table is full and can not hold new
+         // components
+         return dummy_;
+      }
+      ///@}
+
+   private:
+      enum SlotState
+      {
+         SLOT_EMPTY = 0,
+         SLOT_USED = 1,
+         SLOT_DELETED = 2
+      };
+      // --------------------------------------------------------------------
+      size_type home( const key_type& k ) const
+      { return size_type( hasher()( k ) % TABLE_SIZE ); }
+      // --------------------------------------------------------------------
+      /** Returns the slot holding k, or TABLE_SIZE if not present. In the
+       *  latter case, free_slot is set to the first reusable slot on the
+       *  probe sequence (TABLE_SIZE if the table is full).
+       */
+      size_type lookup( const key_type& k, size_type& free_slot ) const
+      {
+         free_slot = TABLE_SIZE;
+         size_type pos = home( k );
+         for ( size_type i = 0; i < TABLE_SIZE; i++ )
+         {
+            if ( state_[pos] == SLOT_EMPTY )
+            {
+               if ( free_slot == TABLE_SIZE )
+                  free_slot = pos;
+               return TABLE_SIZE;
+            }
+            if ( state_[pos] == SLOT_DELETED )
+            {
+               if ( free_slot == TABLE_SIZE )
+                  free_slot = pos;
+            }
+            else if ( slots_[pos].first == k )
+               return pos;
+
+            if ( ++pos == TABLE_SIZE )
+               pos = 0;
+         }
+         return TABLE_SIZE;
+      }
+      // --------------------------------------------------------------------
+      /** Frees a used slot. If the following slot is empty, no probe
+       *  sequence runs across this one, so it (and any directly preceding
+       *  tombstones) can become empty again instead of piling up.
+       */
+      void release( size_type pos )
+      {
+         size_--;
+         size_type next = ( pos + 1 == TABLE_SIZE ) ? 0 : pos + 1;
+         if ( state_[next] != SLOT_EMPTY )
+         {
+            state_[pos] = SLOT_DELETED;
+            return;
+         }
+
+         state_[pos] = SLOT_EMPTY;
+         pos = ( pos == 0 ) ? TABLE_SIZE - 1 : pos - 1;
+         while ( state_[pos] == SLOT_DELETED )
+         {
+            state_[pos] = SLOT_EMPTY;
+            pos = ( pos == 0 ) ? TABLE_SIZE - 1 : pos - 1;
+         }
+      }
+      // --------------------------------------------------------------------
+      size_type next_used( size_type pos ) const
+      {
+         while ( pos < TABLE_SIZE && state_[pos] != SLOT_USED )
+            pos++;
+         return pos;
+      }
+      // --------------------------------------------------------------------
+      value_type slots_[TABLE_SIZE];
+      uint8_t state_[TABLE_SIZE];
+      size_type size_;
+
+      mapped_type dummy_;
+   };
+
+}
+
+#endif
@@ -47,7 +47,7 @@ public:
 
 	queue_static &operator=(queue_static const &q) {
 		if(this==&q)
-		return;
+		return *this;
 		front_=q.front_;
 		size_=q.size();
 		memcpy(queue,q.queue,sizeof(queue));